@@ -101,22 +101,20 @@ int dma_sync_cpu_to_device(int fd) {
     return ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
 }
 
-int dma_buf_alloc(const char *path, size_t size, int *fd, void **va) {
+int dma_heap_open(const char *path) {
+    int dma_heap_fd = open(path, O_RDWR | O_CLOEXEC);
+    if (dma_heap_fd < 0)
+        printf("open %s fail!\n", path);
+
+    return dma_heap_fd;
+}
+
+int dma_heap_buf_alloc(int dma_heap_fd, size_t size, int *fd, void **va) {
     int ret;
     int prot;
     void *mmap_va;
-    int dma_heap_fd = -1;
     struct dma_heap_allocation_data buf_data;
 
-    /* open dma_heap fd */
-    if (dma_heap_fd < 0) {
-        dma_heap_fd = open(path, O_RDWR);
-        if (dma_heap_fd < 0) {
-            printf("open %s fail!\n", path);
-            return dma_heap_fd;
-        }
-    }
-
     /* alloc buffer */
     memset(&buf_data, 0x0, sizeof(struct dma_heap_allocation_data));
 
@@ -137,16 +135,32 @@ int dma_buf_alloc(const char *path, size_t size, int *fd, void **va) {
     /* mmap contiguors buffer to user */
     mmap_va = (void *)mmap(NULL, buf_data.len, prot, MAP_SHARED, buf_data.fd, 0);
     if (mmap_va == MAP_FAILED) {
+        ret = -errno;
         printf("mmap failed: %s\n", strerror(errno));
-        return -errno;
+        close(buf_data.fd);
+        return ret;
     }
 
     *va = mmap_va;
     *fd = buf_data.fd;
 
+    return 0;
+}
+
+int dma_buf_alloc(const char *path, size_t size, int *fd, void **va) {
+    int ret;
+    int dma_heap_fd;
+
+    /* open dma_heap fd */
+    dma_heap_fd = dma_heap_open(path);
+    if (dma_heap_fd < 0)
+        return dma_heap_fd;
+
+    ret = dma_heap_buf_alloc(dma_heap_fd, size, fd, va);
+
     close(dma_heap_fd);
 
-    return 0;
+    return ret;
 }
 
 void dma_buf_free(size_t size, int *fd, void *va) {
@@ -30,6 +30,9 @@ int dma_sync_device_to_cpu(int fd);
 int dma_sync_cpu_to_device(int fd);
 
 int dma_buf_alloc(const char *path, size_t size, int *fd, void **va);
+/* keep the heap fd open across allocations: dma_heap_open() once, close() when done */
+int dma_heap_open(const char *path);
+int dma_heap_buf_alloc(int dma_heap_fd, size_t size, int *fd, void **va);
 void dma_buf_free(size_t size, int *fd, void *va);
 
 #endif /* #ifndef __RGA_SAMPLES_ALLOCATOR_DMA_ALLOC_H__ */
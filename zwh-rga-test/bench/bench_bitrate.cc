@@ -0,0 +1,156 @@
+// BitrateAllocator 码率分配仿真基准
+// 用法：bench_bitrate [轨迹文件，可选] [--bitrate=<总码率kbps>[,<周期ms>]，放在最后]
+// - 轨迹每行一个周期，逗号分隔各路在参考 QP 下需要的码率（kbps）；'#' 开头的行忽略。
+//   流水线 --bitrate=<总码率>,<周期>,<文件> 记录的是各路实际产出，也可直接回放；不给文件时生成 4x4 合成轨迹：
+//   顶行天空几乎静止、中间两行街景、底行地面，一个运动目标在中间两行逐列移动
+// - 编码器模型：QP = 参考 QP + 6 x log2(需求 / 产出)；CBR 用满分配，但 QP 不低于 kMinQp（静止画面用不满），
+//   AVBR 需求低于分配时按需求出码（不低于分配的 1/4）
+// - 对比固定平均码率 CBR、按字节+QP 分配、只按字节分配三种方式的总码率、平均/P95 QP 与 QP>=40 的 tile 周期数
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "utils/bitrate_allocator.h"
+
+typedef std::vector<std::vector<double> > Trace; // [周期][tile] 需求 kbps
+
+static const int kRefQp = 30;
+static const int kMinQp = 22;
+static const int kBadQp = 40;
+
+static bool LoadTrace(const char *path, Trace *trace) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        printf("cannot open %s\n", path);
+        return false;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        std::vector<double> row;
+        for (char *tok = strtok(line, ",\n"); tok; tok = strtok(NULL, ",\n")) row.push_back(atof(tok));
+        if (!trace->empty() && row.size() != trace->front().size()) {
+            printf("%s: inconsistent tile count\n", path);
+            fclose(fp);
+            return false;
+        }
+        trace->push_back(row);
+    }
+    fclose(fp);
+    return !trace->empty();
+}
+
+static double Noise(unsigned *seed, double amplitude) {
+    return 1.0 + amplitude * (2.0 * rand_r(seed) / RAND_MAX - 1.0);
+}
+
+static void SynthesizeTrace(int windows, Trace *trace) {
+    const int cols = 4;
+    const int rows = 4;
+    unsigned seed = 12345;
+    for (int w = 0; w < windows; ++w) {
+        std::vector<double> row(cols * rows);
+        int objectTile = cols + (w / 8) % (2 * cols); // 中间两行逐列移动
+        for (int t = 0; t < cols * rows; ++t) {
+            int r = t / cols;
+            double base = r == 0 ? 30 : r == rows - 1 ? 120 : 200;
+            row[t] = base * Noise(&seed, 0.2);
+            if (t == objectTile) row[t] += 900 * Noise(&seed, 0.1);
+        }
+        trace->push_back(row);
+    }
+}
+
+struct SimResult {
+    double avgTotalKbps = 0;
+    double maxTotalKbps = 0;
+    double meanQp = 0;
+    int p95Qp = 0;
+    int badTileWindows = 0;
+};
+
+// 编码器对一个周期的响应
+static void Encode(double demand, int kbps, BitrateAllocator::RcMode mode, double *produced, int *qp) {
+    double out = std::min((double)kbps, demand * pow(2.0, (kRefQp - kMinQp) / 6.0));
+    if (mode == BitrateAllocator::RC_AVBR && demand < kbps) out = std::max(demand, kbps / 4.0);
+    double q = kRefQp + 6.0 * log2(std::max(demand, 1.0) / std::max(out, 1.0));
+    *produced = out;
+    *qp = std::min(51, std::max(10, (int)lround(q)));
+}
+
+// allocator 为空时各路固定 CBR 平均码率；reportQp 为 false 时不给分配器 QP，只看字节
+static SimResult Simulate(const Trace &trace, const BitrateAllocator::Options &options, bool adaptive,
+                          bool reportQp) {
+    int tiles = (int)trace.front().size();
+    BitrateAllocator allocator;
+    allocator.Init(options, tiles);
+    std::vector<BitrateAllocator::TileSample> samples(tiles);
+    std::vector<int> qps;
+    SimResult result;
+    double qpSum = 0;
+
+    for (size_t w = 0; w < trace.size(); ++w) {
+        const std::vector<BitrateAllocator::Allocation> &allocs = allocator.Current();
+        double total = 0;
+        for (int t = 0; t < tiles; ++t) {
+            int kbps = adaptive ? allocs[t].kbps : allocator.InitialTileKbps();
+            BitrateAllocator::RcMode mode = adaptive ? allocs[t].mode : BitrateAllocator::RC_CBR;
+            double produced = 0;
+            int qp = 0;
+            Encode(trace[w][t], kbps, mode, &produced, &qp);
+            total += produced;
+            qpSum += qp;
+            qps.push_back(qp);
+            if (qp >= kBadQp) result.badTileWindows++;
+            samples[t].bytes = (uint64_t)(produced * options.periodMs / 8);
+            samples[t].frames = (uint32_t)(30 * options.periodMs / 1000);
+            samples[t].meanQp = reportQp ? (uint32_t)qp : 0;
+        }
+        result.avgTotalKbps += total;
+        result.maxTotalKbps = std::max(result.maxTotalKbps, total);
+        if (adaptive) allocator.Update(samples, options.periodMs);
+    }
+    result.avgTotalKbps /= trace.size();
+    result.meanQp = qpSum / qps.size();
+    std::sort(qps.begin(), qps.end());
+    result.p95Qp = qps[qps.size() * 95 / 100];
+    return result;
+}
+
+static void Print(const char *name, const SimResult &r, int budget) {
+    printf("[BENCH]   %-14s total avg=%.0fkbps max=%.0fkbps (budget %d) qp mean=%.1f p95=%d qp>=%d: %d\n", name,
+           r.avgTotalKbps, r.maxTotalKbps, budget, r.meanQp, r.p95Qp, kBadQp, r.badTileWindows);
+}
+
+int main(int argc, char *argv[]) {
+    BitrateAllocator::Options options;
+    options.periodMs = 1000;
+    while (argc > 1 && strncmp(argv[argc - 1], "--", 2) == 0) {
+        const char *opt = argv[--argc];
+        if (strncmp(opt, "--bitrate=", 10) != 0 || !BitrateAllocator::ParseOption(opt + 10, &options)) {
+            printf("bad option \"%s\"\n", opt);
+            return -1;
+        }
+    }
+
+    Trace trace;
+    if (argc > 1) {
+        if (!LoadTrace(argv[1], &trace)) return -1;
+    } else {
+        SynthesizeTrace(240, &trace);
+    }
+    int tiles = (int)trace.front().size();
+    if (options.totalKbps <= 0) options.totalKbps = tiles * BitrateAllocator::kDefaultTileKbps;
+    options.refQp = kRefQp;
+
+    printf("[BENCH] bitrate trace=%s windows=%zu tiles=%d budget=%dkbps\n", argc > 1 ? argv[1] : "synthetic",
+           trace.size(), tiles, options.totalKbps);
+    Print("fixed cbr", Simulate(trace, options, false, false), options.totalKbps);
+    Print("alloc", Simulate(trace, options, true, true), options.totalKbps);
+    Print("alloc (bytes)", Simulate(trace, options, true, false), options.totalKbps);
+    return 0;
+}
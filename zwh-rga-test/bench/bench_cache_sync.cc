@@ -0,0 +1,155 @@
+// CacheSync 归属跟踪基准与检查（主机构建，HostMpiHal 记录刷新次数与字节数，DmaBuf 用 memfd 替身）
+// 用法：bench_cache_sync [帧数，默认 600]
+// - 硬件到硬件（VI -> RGA -> VENC）的块从不同步
+// - 变化检测先同步 Y 平面，合成时整帧读只补 UV；硬件再写之后重新作废
+// - CPU 脏段与要读的范围重叠时先 clean 再作废；交给硬件前只 clean 脏段，没有脏段时不同步
+// - DmaBuf：uncached 堆从不同步，cached 堆按整块 dma_sync
+// - 模拟一帧的调用序列（VI 帧抽样 + 合成 + 画布交给 VENC + 各 tile 交给 VENC），
+//   对比跟踪模式与 ZWH_CACHE_SYNC=full（每次整块刷新）实际刷新的次数与字节数
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal/dma_heap.h"
+#include "hal/host_mpi_hal.h"
+#include "utils/cache_sync.h"
+#include "utils/config.h"
+#include "utils/dma_buf_pool.h"
+#include "bench_util.h"
+
+struct Blocks {
+    MB_BLK vi;
+    MB_BLK canvas;
+    MB_BLK tiles[MAX_TILES];
+};
+
+// 合成流程一帧的调用序列（与 process_loop / process_merge_loop 的接线一致）
+static void RunFrame(CacheSync &sync, const Blocks &b) {
+    const size_t frameBytes = SRC_WIDTH * SRC_HEIGHT * 3 / 2;
+    const size_t tileBytes = SUB_WIDTH * SUB_HEIGHT * 3 / 2;
+    sync.DeviceWrote(b.vi, 0, frameBytes);
+    sync.BeginCpuRead(b.vi, 0, (size_t)SRC_WIDTH * SRC_HEIGHT); // 变化检测读 Y
+    for (int i = 0; i < TOTAL_CHNS; ++i) {
+        sync.DeviceWrote(b.tiles[i], 0, tileBytes);               // RGA 裁剪
+        sync.BeginDeviceAccess(b.tiles[i]);                       // 交给 VENC
+    }
+    sync.BeginCpuRead(b.vi, 0, frameBytes);                       // CPU 合成读整帧
+    sync.CpuWrote(b.canvas, 0, frameBytes);
+    sync.BeginDeviceAccess(b.canvas);                             // 画布交给 VENC
+}
+
+int main(int argc, char *argv[]) {
+    int frames = argc > 1 ? atoi(argv[1]) : 600;
+    if (frames <= 0) return -1;
+    const size_t frameBytes = SRC_WIDTH * SRC_HEIGHT * 3 / 2;
+    const size_t yBytes = (size_t)SRC_WIDTH * SRC_HEIGHT;
+    const size_t tileBytes = SUB_WIDTH * SUB_HEIGHT * 3 / 2;
+
+    HostMpiHal hal;
+    SetMpiHal(&hal);
+    MB_POOL viPool = CreatePool(frameBytes, 2);
+    MB_POOL subPool = CreatePool(tileBytes, TOTAL_CHNS + 1);
+    Blocks b;
+    b.vi = hal.MbGetMB(viPool, frameBytes, RK_TRUE);
+    b.canvas = hal.MbGetMB(viPool, frameBytes, RK_TRUE);
+    for (int i = 0; i < TOTAL_CHNS; ++i) b.tiles[i] = hal.MbGetMB(subPool, tileBytes, RK_TRUE);
+    MB_BLK spare = hal.MbGetMB(subPool, tileBytes, RK_TRUE);
+
+    printf("[BENCH] cache sync ownership tracking, %d frames\n", frames);
+    bool ok = true;
+
+    {
+        CacheSync sync;
+        sync.SetFullFlush(false);
+        sync.DeviceWrote(spare, 0, tileBytes);
+        sync.BeginDeviceAccess(spare);
+        sync.DeviceWrote(spare, 0, tileBytes);
+        sync.BeginDeviceAccess(spare);
+        ok = Check(sync.GetStats().syncs == 0, "device -> device: no syncs") && ok;
+
+        sync.DeviceWrote(b.vi, 0, frameBytes);
+        sync.BeginCpuRead(b.vi, 0, yBytes);
+        CacheSync::Stats s1 = sync.GetStats();
+        sync.BeginCpuRead(b.vi, 0, frameBytes);
+        CacheSync::Stats s2 = sync.GetStats();
+        ok = Check(s1.syncBytes == yBytes && s2.syncs == s1.syncs + 1 && s2.syncBytes - s1.syncBytes == frameBytes - yBytes,
+                   "Y read then full read: second sync covers UV only") && ok;
+        sync.BeginCpuRead(b.vi, 0, frameBytes);
+        ok = Check(sync.GetStats().syncs == s2.syncs, "repeated read without device write: no sync") && ok;
+        sync.DeviceWrote(b.vi, 0, frameBytes);
+        sync.BeginCpuRead(b.vi, 0, yBytes);
+        ok = Check(sync.GetStats().syncs == s2.syncs + 1, "device write invalidates again") && ok;
+
+        // CPU 写了 [100, 200)，硬件随后写了 [150, 300)：有效段只剩 [300, end)，脏段 [100, 150) 落在要作废的范围里
+        sync.BeginCpuRead(spare, 0, tileBytes);
+        sync.CpuWrote(spare, 100, 100);
+        sync.DeviceWrote(spare, 150, 150);
+        uint64_t flushes = hal.CacheFlushes();
+        sync.BeginCpuRead(spare, 0, tileBytes);
+        ok = Check(hal.CacheFlushes() == flushes + 2, "dirty range cleaned before invalidating over it") && ok;
+        flushes = hal.CacheFlushes();
+        sync.BeginDeviceAccess(spare);
+        ok = Check(hal.CacheFlushes() == flushes, "no dirty range: device access needs no sync") && ok;
+        sync.CpuWrote(spare, 64, 128);
+        sync.BeginDeviceAccess(spare);
+        sync.BeginDeviceAccess(spare);
+        ok = Check(hal.CacheFlushes() == flushes + 1, "device access cleans the dirty range once") && ok;
+        sync.ReleaseAll();
+    }
+
+    {
+        DmaBufPool pool;
+        MemfdDmaHeap cachedHeap(true);
+        MemfdDmaHeap uncachedHeap(false);
+        pool.SetHeap(DMA_ROLE_CPU, &cachedHeap);
+        pool.SetHeap(DMA_ROLE_DEVICE, &uncachedHeap);
+        DmaBuf cpu, dev;
+        bool got = pool.Alloc(tileBytes, DMA_ROLE_CPU, &cpu) && pool.Alloc(tileBytes, DMA_ROLE_DEVICE, &dev);
+        CacheSync sync;
+        sync.SetFullFlush(false);
+        sync.CpuWrote(dev, 0, tileBytes);
+        sync.BeginDeviceAccess(dev);
+        sync.DeviceWrote(dev, 0, tileBytes);
+        sync.BeginCpuRead(dev, 0, tileBytes);
+        ok = Check(got && uncachedHeap.Syncs() == 0 && sync.GetStats().syncs == 0, "uncached dma-buf: never synced") && ok;
+        sync.CpuWrote(cpu, 0, 64);
+        sync.BeginDeviceAccess(cpu);
+        sync.DeviceWrote(cpu, 0, tileBytes);
+        sync.BeginCpuRead(cpu, 0, 64);
+        sync.BeginCpuRead(cpu, 64, tileBytes - 64);
+        ok = Check(cachedHeap.Syncs() == 2 && sync.GetStats().syncBytes == 2 * cpu.capacity,
+                   "cached dma-buf: whole-buffer sync, once per direction") && ok;
+        sync.Forget(cpu);
+        sync.Forget(dev);
+        pool.Free(&cpu);
+        pool.Free(&dev);
+        pool.Shutdown();
+    }
+
+    // 同样的调用序列：跟踪模式 vs 整块刷新
+    uint64_t counts[2], bytes[2];
+    for (int mode = 0; mode < 2; ++mode) {
+        CacheSync sync;
+        sync.SetFullFlush(mode == 1);
+        uint64_t f0 = hal.CacheFlushes();
+        uint64_t b0 = hal.CacheFlushBytes();
+        for (int i = 0; i < frames; ++i) RunFrame(sync, b);
+        counts[mode] = hal.CacheFlushes() - f0;
+        bytes[mode] = hal.CacheFlushBytes() - b0;
+        printf("[BENCH]   %-7s flushes/frame=%.1f  MB/frame=%.2f\n", mode ? "full" : "tracked",
+               (double)counts[mode] / frames, bytes[mode] / 1048576.0 / frames);
+        sync.PrintWindow();
+        sync.ReleaseAll();
+    }
+    ok = Check(counts[1] == (uint64_t)frames * (TOTAL_CHNS + 3), "full mode: one whole-block flush per call") && ok;
+    ok = Check(counts[0] == (uint64_t)frames * 3 && bytes[0] == (uint64_t)frames * 2 * frameBytes,
+               "tracked: Y + UV + canvas clean per frame, tiles untouched") && ok;
+
+    for (int i = 0; i < TOTAL_CHNS; ++i) hal.MbReleaseMB(b.tiles[i]);
+    hal.MbReleaseMB(spare);
+    hal.MbReleaseMB(b.vi);
+    hal.MbReleaseMB(b.canvas);
+    hal.MbDestroyPool(subPool);
+    hal.MbDestroyPool(viPool);
+    return ok ? 0 : 1;
+}
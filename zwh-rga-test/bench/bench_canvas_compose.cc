@@ -0,0 +1,289 @@
+// 增量画布合成基准与检查（主机构建，HostMpiHal 仿真 MB 池）
+// 用法：bench_canvas_compose [帧数，默认 600]
+// - 合并模式：每帧随机改写少数 tile、不时改变跳过集合，CanvasCompositor 只重写过期/涂黑状态改变的 tile，
+//   输出逐字节等于整幅重画的参考画面（CPU 路径、带 stride 的 VI 帧；AUTO 路径中间夹着直通帧）
+// - 接收端：收到的 tile 写进轮到的画布，过期而本帧没收到的从另一块画布拷过来，结果等于常驻整幅画布
+// - 反压：另一块画布仍被 VENC 引用时复用上一块；两块都被引用时等满 kBusyWaitMs 后返回空（丢帧）并计数
+// - 对比 ZWH_CANVAS=full（每帧整幅重画）每帧重写的 tile 数与合成耗时
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <set>
+#include <vector>
+
+#include "hal/host_mpi_hal.h"
+#include "process/merge/canvas_compositor.h"
+#include "utils/config.h"
+#include "utils/nv12_blit.h"
+#include "utils/tile_canvas_pair.h"
+#include "bench_util.h"
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+static uint32_t Rand(uint32_t *seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 16;
+}
+
+// 测试里可以把画布标记为"VENC 仍在引用"
+class HeldMpiHal : public HostMpiHal {
+public:
+    RK_S32 MbInquireUserCnt(MB_BLK blk) override {
+        return HostMpiHal::MbInquireUserCnt(blk) + (RK_S32)held.count(blk);
+    }
+    std::set<MB_BLK> held;
+};
+
+static void FillTile(const Nv12View &view, int tileId, uint32_t *seed) {
+    const GridConfig &grid = GetGridConfig();
+    Nv12Rect r;
+    r.x = grid.TileX(tileId);
+    r.y = grid.TileY(tileId);
+    r.w = SUB_WIDTH;
+    r.h = SUB_HEIGHT;
+    uint32_t v = Rand(seed);
+    Nv12Fill(view, r, (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 3));
+    // 每个 tile 再点几个像素，避免整块同色掩盖错位
+    for (int i = 0; i < 8; ++i) {
+        int x = r.x + (int)(Rand(seed) % SUB_WIDTH);
+        int y = r.y + (int)(Rand(seed) % SUB_HEIGHT);
+        view.y[(size_t)y * view.stride + x] = (uint8_t)Rand(seed);
+        view.uv[(size_t)(y / 2) * view.stride + x] = (uint8_t)Rand(seed);
+    }
+}
+
+// 整幅重画的参考画面：黑底，未跳过的 tile 从源拷贝
+static void ReferenceCanvas(const Nv12View &src, TileMask skipMask, std::vector<uint8_t> *out) {
+    out->assign((size_t)SRC_WIDTH * SRC_HEIGHT, 0);
+    out->resize((size_t)SRC_WIDTH * SRC_HEIGHT * 3 / 2, 128);
+    Nv12View dst = Nv12At(out->data(), SRC_WIDTH, SRC_HEIGHT);
+    const GridConfig &grid = GetGridConfig();
+    for (int t = 0; t < grid.TileCount(); ++t) {
+        if (skipMask & TILE_BIT(t)) continue;
+        Nv12Copy(src, grid.TileX(t), grid.TileY(t), dst, grid.TileX(t), grid.TileY(t), SUB_WIDTH, SUB_HEIGHT);
+    }
+}
+
+// 每帧改写 0~3 个 tile（每 50 帧全部改写），每 7 帧随机换一次跳过集合
+struct Scene {
+    uint32_t seed = 7;
+    TileMask skip = 0;
+
+    TileMask Next(int frame, const Nv12View &vi) {
+        const int tiles = GetGridConfig().TileCount();
+        TileMask changed = 0;
+        if (frame % 50 == 0) {
+            changed = GetGridConfig().AllTilesMask();
+        } else {
+            int n = (int)(Rand(&seed) % 4);
+            for (int i = 0; i < n; ++i) changed |= TILE_BIT(Rand(&seed) % tiles);
+        }
+        for (int t = 0; t < tiles; ++t) {
+            if (changed & TILE_BIT(t)) FillTile(vi, t, &seed);
+        }
+        if (frame % 7 == 0) {
+            skip = 0;
+            for (int t = 0; t < tiles; ++t) {
+                if (Rand(&seed) % 5 == 0) skip |= TILE_BIT(t);
+            }
+        }
+        return changed;
+    }
+};
+
+struct ComposeRun {
+    uint64_t frames = 0;
+    uint64_t us = 0;
+    uint64_t tilesWritten = 0;
+    bool match = true;
+};
+
+// 同一场景跑 frames 帧；viStride != SRC_WIDTH 时不会直通。passthroughEvery > 0 时每隔几帧不跳过 tile（AUTO 下直通）
+static ComposeRun RunCompositor(CompositeMode mode, bool fullRedraw, int viStride, int viVStride, int frames,
+                                int passthroughEvery, bool verify) {
+    ComposeRun run;
+    if (fullRedraw) setenv("ZWH_CANVAS", "full", 1);
+    CanvasCompositor compositor;
+    bool inited = compositor.Init(mode);
+    unsetenv("ZWH_CANVAS");
+    if (!inited) {
+        run.match = false;
+        return run;
+    }
+
+    MB_POOL viPool = CreatePool((uint64_t)viStride * viVStride * 3 / 2, 1);
+    MB_BLK viBlk = GetMpiHal()->MbGetMB(viPool, (uint64_t)viStride * viVStride * 3 / 2, RK_TRUE);
+    Nv12View vi = Nv12At(GetMpiHal()->MbHandle2VirAddr(viBlk), viStride, viVStride);
+    VIDEO_FRAME_INFO_S viFrame;
+    memset(&viFrame, 0, sizeof(viFrame));
+    viFrame.stVFrame.u32Width = SRC_WIDTH;
+    viFrame.stVFrame.u32Height = SRC_HEIGHT;
+    viFrame.stVFrame.u32VirWidth = viStride;
+    viFrame.stVFrame.u32VirHeight = viVStride;
+    viFrame.stVFrame.enPixelFormat = RK_FMT_YUV420SP;
+    viFrame.stVFrame.pMbBlk = viBlk;
+
+    Scene scene;
+    std::vector<uint8_t> ref;
+    for (int f = 0; f < frames; ++f) {
+        TileMask changed = scene.Next(f, vi);
+        TileMask skip = (passthroughEvery > 0 && f % passthroughEvery == 0) ? 0 : scene.skip;
+        VIDEO_FRAME_INFO_S out;
+        uint64_t startUs = GetUs();
+        bool ok = compositor.Compose(viFrame, skip, changed, &out);
+        run.us += GetUs() - startUs;
+        run.frames++;
+        if (!ok) {
+            run.match = false;
+            break;
+        }
+        if (verify && out.stVFrame.pMbBlk != viBlk) {
+            ReferenceCanvas(vi, skip, &ref);
+            const uint8_t *canvas = static_cast<const uint8_t *>(GetMpiHal()->MbHandle2VirAddr(out.stVFrame.pMbBlk));
+            if (!canvas || memcmp(canvas, ref.data(), ref.size()) != 0) {
+                printf("[BENCH]   frame %d differs from full redraw\n", f);
+                run.match = false;
+                break;
+            }
+        }
+        compositor.Release(&out);
+    }
+    GetMpiHal()->MbReleaseMB(viBlk);
+    GetMpiHal()->MbDestroyPool(viPool);
+    return run;
+}
+
+// 接收端的画布更新（与 SimulatedReceiverDevice::EncodeAndSend 一致），对比常驻整幅画布
+static bool RunReceiver(int frames, uint64_t *tilesWritten) {
+    const size_t frameBytes = (size_t)SRC_WIDTH * SRC_HEIGHT * 3 / 2;
+    MB_POOL pool = CreatePool(frameBytes, 2);
+    bool match = true;
+    {
+        TileCanvasPair pair;
+        if (!pair.Init(pool)) return false;
+        std::vector<uint8_t> persistent((size_t)SRC_WIDTH * SRC_HEIGHT, 0);
+        persistent.resize(frameBytes, 128);
+        Nv12View whole = Nv12At(persistent.data(), SRC_WIDTH, SRC_HEIGHT);
+        std::vector<uint8_t> tile((size_t)SUB_WIDTH * SUB_HEIGHT * 3 / 2);
+        Nv12View tileView = Nv12At(tile.data(), SUB_WIDTH, SUB_HEIGHT);
+        const GridConfig &grid = GetGridConfig();
+        uint32_t seed = 11;
+        for (int f = 0; f < frames && match; ++f) {
+            TileCanvasPair::Canvas *canvas = pair.Acquire();
+            Nv12View dst = Nv12At(canvas->vir, SRC_WIDTH, SRC_HEIGHT);
+            TileMask received = 0;
+            int n = f % 40 == 0 ? grid.TileCount() : (int)(Rand(&seed) % 5);
+            for (int i = 0; i < n; ++i) {
+                int t = f % 40 == 0 ? i : (int)(Rand(&seed) % grid.TileCount());
+                uint32_t v = Rand(&seed);
+                Nv12Rect r;
+                r.w = SUB_WIDTH;
+                r.h = SUB_HEIGHT;
+                Nv12Fill(tileView, r, (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 4));
+                Nv12Copy(tileView, 0, 0, whole, grid.TileX(t), grid.TileY(t), SUB_WIDTH, SUB_HEIGHT);
+                Nv12Copy(tileView, 0, 0, dst, grid.TileX(t), grid.TileY(t), SUB_WIDTH, SUB_HEIGHT);
+                received |= TILE_BIT(t);
+            }
+            TileMask carried = canvas->stale & ~received;
+            Nv12View src = Nv12At(pair.Peer(canvas)->vir, SRC_WIDTH, SRC_HEIGHT);
+            for (int t = 0; t < grid.TileCount(); ++t) {
+                if ((carried & TILE_BIT(t)) == 0) continue;
+                Nv12Copy(src, grid.TileX(t), grid.TileY(t), dst, grid.TileX(t), grid.TileY(t), SUB_WIDTH, SUB_HEIGHT);
+            }
+            pair.MarkChanged(received);
+            pair.MarkWritten(canvas, received | carried);
+            match = memcmp(canvas->vir, persistent.data(), frameBytes) == 0;
+            if (!match) printf("[BENCH]   receiver frame %d differs from persistent canvas\n", f);
+        }
+        *tilesWritten = pair.GetStats().tilesWritten;
+    }
+    GetMpiHal()->MbDestroyPool(pool);
+    return match;
+}
+
+int main(int argc, char *argv[]) {
+    int frames = argc > 1 ? atoi(argv[1]) : 600;
+    if (frames <= 0) return -1;
+    HeldMpiHal hal;
+    SetMpiHal(&hal);
+    const int tiles = GetGridConfig().TileCount();
+    const int viStride = (SRC_WIDTH + 63) & ~63;
+    const int viVStride = SRC_HEIGHT + 8;
+
+    printf("[BENCH] incremental canvas compose, %dx%d, %d tiles, %d frames\n", SRC_WIDTH, SRC_HEIGHT, tiles, frames);
+    bool ok = true;
+
+    ComposeRun cpu = RunCompositor(COMPOSITE_CPU, false, viStride, viVStride, frames, 0, true);
+    ok = Check(cpu.match && cpu.frames == (uint64_t)frames, "cpu: every frame equals a full redraw (strided VI)") && ok;
+    ComposeRun autoRun = RunCompositor(COMPOSITE_AUTO, false, SRC_WIDTH, SRC_HEIGHT, frames, 3, true);
+    ok = Check(autoRun.match, "auto: composed frames stay exact across passthrough frames") && ok;
+
+    uint64_t receiverTiles = 0;
+    ok = Check(RunReceiver(frames, &receiverTiles), "receiver: carried + received tiles equal persistent canvas") && ok;
+
+    {
+        MB_POOL pool = CreatePool((uint64_t)SRC_WIDTH * SRC_HEIGHT * 3 / 2, 2);
+        TileCanvasPair pair;
+        pair.Init(pool);
+        TileCanvasPair::Canvas *a = pair.Acquire();
+        TileCanvasPair::Canvas *b = pair.Acquire();
+        ok = Check(a && b && a != b, "canvases alternate when both are free") && ok;
+        hal.held.insert(a->blk);
+        TileCanvasPair::Canvas *c = pair.Acquire();
+        ok = Check(c == b && pair.GetStats().busyWaits == 0, "peer still encoding: last canvas reused without waiting") &&
+             ok;
+        hal.held.insert(b->blk);
+        uint64_t startUs = GetUs();
+        TileCanvasPair::Canvas *d = pair.Acquire();
+        uint64_t waitedUs = GetUs() - startUs;
+        TileCanvasPair::Stats s = pair.GetStats();
+        ok = Check(!d && s.busyWaits == 1 && s.busyTimeouts == 1 && waitedUs >= TileCanvasPair::kBusyWaitMs * 1000ULL,
+                   "both encoding: waits kBusyWaitMs, then drops the frame") && ok;
+        hal.held.erase(a->blk);
+        ok = Check(pair.Acquire() == a, "canvas released by VENC is handed out again") && ok;
+        hal.held.clear();
+        pair.Destroy();
+        hal.MbDestroyPool(pool);
+    }
+
+    ComposeRun full = RunCompositor(COMPOSITE_CPU, true, viStride, viVStride, frames, 0, false);
+    ComposeRun dirty = RunCompositor(COMPOSITE_CPU, false, viStride, viVStride, frames, 0, false);
+    double tileMB = SUB_WIDTH * SUB_HEIGHT * 3 / 2 / 1048576.0;
+    // 整幅重画每帧拷贝/涂黑全部 tile；增量路径的数字来自同一场景
+    double dirtyTiles = 0;
+    {
+        MB_POOL pool = CreatePool((uint64_t)SRC_WIDTH * SRC_HEIGHT * 3 / 2, 2);
+        TileCanvasPair pair;
+        pair.Init(pool);
+        Scene scene;
+        std::vector<uint8_t> vi((size_t)viStride * viVStride * 3 / 2);
+        Nv12View view = Nv12At(vi.data(), viStride, viVStride);
+        for (int f = 0; f < frames; ++f) {
+            TileMask changed = scene.Next(f, view);
+            pair.MarkChanged(changed);
+            TileCanvasPair::Canvas *canvas = pair.Acquire();
+            TileMask all = GetGridConfig().AllTilesMask();
+            TileMask copy = ~scene.skip & all & (canvas->stale | canvas->black);
+            TileMask fill = scene.skip & ~canvas->black;
+            pair.MarkWritten(canvas, copy | fill);
+            canvas->black = scene.skip;
+        }
+        dirtyTiles = (double)pair.GetStats().tilesWritten / frames;
+        pair.Destroy();
+        hal.MbDestroyPool(pool);
+    }
+    printf("[BENCH]   merge canvas: full redraw %d tiles (%.2fMB)/frame %6.1fus, dirty %.1f tiles (%.2fMB)/frame %6.1fus "
+           "(%.2fx)\n",
+           tiles, tiles * tileMB, (double)full.us / frames, dirtyTiles, dirtyTiles * tileMB,
+           (double)dirty.us / frames, dirty.us ? (double)full.us / dirty.us : 0.0);
+    printf("[BENCH]   receiver canvas: whole-canvas memcpy %.2fMB/frame, dirty %.1f tiles (%.2fMB)/frame\n",
+           SRC_WIDTH * SRC_HEIGHT * 3 / 2 / 1048576.0, (double)receiverTiles / frames,
+           (double)receiverTiles / frames * tileMB);
+    ok = Check(dirtyTiles < tiles, "dirty compose rewrites fewer tiles than a full redraw") && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+// TileDetector 调度与结果分发基准（NPU 桩后端）
+// 用法：bench_detect [每阶段秒数，默认 5] [单次推理耗时 us，默认 20000] [检测间隔 ms，默认 100]
+// - 30fps 送 1080P NV12 帧：暗背景上一个亮方块停在某个 tile 中心，每 15 帧换到下一个 tile
+// - 整帧阶段与逐 tile 阶段各跑一遍：桩后端在最亮处出一个目标，检查发布的结果只在方块所在 tile 上有目标，
+//   且 frameSeq 对得上；推理耗时大于间隔时看 busy（跳过）计数，确认采集线程不被 NPU 拖慢
+// - 统计采集线程 Offer 的耗时分布（主机上含 CPU 缩放转色，板端为 RGA）与提交到发布的时延
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "hal/host_mpi_hal.h"
+#include "hal/stub_npu_backend.h"
+#include "utils/tile_detector.h"
+#include "utils/tile_slicer.h"
+
+static const int kFps = 30;
+static const int kHoldFrames = 15;
+static const int kSquare = 96;
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+static int SquareTile(const GridConfig &grid, uint16_t frameSeq) {
+    return (frameSeq / kHoldFrames) % grid.TileCount();
+}
+
+// 在 tile 中心画（或擦掉）亮方块
+static void DrawSquare(const GridConfig &grid, std::vector<uint8_t> &frame, int tileId, uint8_t luma) {
+    int x0 = grid.TileX(tileId) + grid.tileWidth / 2 - kSquare / 2;
+    int y0 = grid.TileY(tileId) + grid.tileHeight / 2 - kSquare / 2;
+    for (int row = 0; row < kSquare; ++row) memset(&frame[(size_t)(y0 + row) * grid.srcWidth + x0], luma, kSquare);
+}
+
+struct Check {
+    std::mutex mtx;
+    uint64_t results = 0;
+    uint64_t hits = 0;       // 方块所在 tile 上有目标
+    uint64_t mismatches = 0; // 有目标的 tile 不对，或方块所在 tile 没检出
+};
+
+static bool RunPhase(const GridConfig &grid, bool perTile, int seconds, int intervalMs) {
+    TileDetector::Options options;
+    options.enabled = true;
+    options.intervalMs = intervalMs;
+    options.perTile = perTile;
+    Check check;
+    TileDetector detector;
+    bool started = detector.Start(options, grid, GetNpuBackend(), [&grid, &check](const TileDetector::Result &r) {
+        bool expected = r.tileId == SquareTile(grid, r.frameSeq);
+        std::lock_guard<std::mutex> lk(check.mtx);
+        check.results++;
+        if (expected && r.count > 0) check.hits++;
+        if (expected != (r.count > 0)) check.mismatches++;
+    });
+    if (!started) return false;
+
+    TileSlicer slicer;
+    if (!slicer.Init(grid)) return false;
+    std::vector<uint8_t> frame((size_t)grid.srcWidth * grid.srcHeight * 3 / 2);
+    memset(frame.data(), 16, (size_t)grid.srcWidth * grid.srcHeight);
+    memset(frame.data() + (size_t)grid.srcWidth * grid.srcHeight, 128, frame.size() - (size_t)grid.srcWidth * grid.srcHeight);
+    std::vector<std::vector<uint8_t> > tileBufs(grid.TileCount());
+    Nv12Image src;
+    src.vir = frame.data();
+    src.width = grid.srcWidth;
+    src.height = grid.srcHeight;
+    Nv12Image tiles[MAX_TILES];
+    for (int i = 0; i < grid.TileCount(); ++i) {
+        tileBufs[i].resize((size_t)grid.tileWidth * grid.tileHeight * 3 / 2);
+        tiles[i].vir = tileBufs[i].data();
+        tiles[i].width = grid.tileWidth;
+        tiles[i].height = grid.tileHeight;
+    }
+
+    std::vector<uint32_t> offerUs;
+    uint64_t frames = (uint64_t)seconds * kFps;
+    uint64_t startUs = GetUs();
+    int drawn = -1;
+    for (uint64_t f = 1; f <= frames; ++f) {
+        uint64_t dueUs = startUs + f * 1000000ULL / kFps;
+        uint64_t nowUs = GetUs();
+        if (dueUs > nowUs) usleep((useconds_t)(dueUs - nowUs));
+        uint16_t frameSeq = (uint16_t)f;
+        int tileId = SquareTile(grid, frameSeq);
+        if (tileId != drawn) {
+            if (drawn >= 0) DrawSquare(grid, frame, drawn, 16);
+            DrawSquare(grid, frame, tileId, 235);
+            drawn = tileId;
+        }
+        TileMask mask = grid.AllTilesMask();
+        if (perTile) slicer.Slice(src, tiles, mask, NULL);
+        uint64_t t0 = GetUs();
+        if (detector.Offer(src, tiles, mask, frameSeq, f * 1000000ULL / kFps)) {
+            offerUs.push_back((uint32_t)(GetUs() - t0));
+        }
+    }
+    detector.Stop();
+
+    TileDetector::Stats s = detector.GetStats();
+    std::sort(offerUs.begin(), offerUs.end());
+    printf("[BENCH]   %-5s runs=%llu busy=%llu objects=%llu infer avg=%lluus latency avg=%lluus "
+           "offer p50=%uus p99=%uus\n",
+           perTile ? "tiles" : "frame", (unsigned long long)s.runs, (unsigned long long)s.busy,
+           (unsigned long long)s.objects, (unsigned long long)s.avgInferUs, (unsigned long long)s.avgLatencyUs,
+           offerUs.empty() ? 0 : offerUs[offerUs.size() / 2], offerUs.empty() ? 0 : offerUs[offerUs.size() * 99 / 100]);
+    printf("[BENCH]   %-5s results=%llu hits=%llu mismatches=%llu\n", perTile ? "tiles" : "frame",
+           (unsigned long long)check.results, (unsigned long long)check.hits, (unsigned long long)check.mismatches);
+    return s.runs > 0 && check.hits > 0 && check.mismatches == 0;
+}
+
+int main(int argc, char *argv[]) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 5;
+    int inferUs = argc > 2 ? atoi(argv[2]) : 20000;
+    int intervalMs = argc > 3 ? atoi(argv[3]) : 100;
+    if (seconds <= 0 || inferUs < 0 || intervalMs <= 0) return -1;
+
+    HostMpiHal hal;
+    SetMpiHal(&hal);
+    StubNpuBackend::Options npuOptions;
+    npuOptions.inferUs = inferUs;
+    StubNpuBackend npu(npuOptions);
+    SetNpuBackend(&npu);
+
+    GridConfig grid;
+    printf("[BENCH] detect %dx%d grid %dx%d, %d fps, interval %dms, infer %dus, %ds per phase\n", grid.srcWidth,
+           grid.srcHeight, grid.cols, grid.rows, kFps, intervalMs, inferUs, seconds);
+    bool ok = RunPhase(grid, false, seconds, intervalMs);
+    ok = RunPhase(grid, true, seconds, intervalMs) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+// DmaBufPool 基准与检查（主机构建，堆换成 memfd 替身）
+// 用法：bench_dma_pool [每项循环次数，默认 2000]
+// - 尺寸档：页对齐、单调、1/4 以内的浪费
+// - 借出的 fd 确实是可共享的 dma-buf 替身：另行 mmap 同一 fd 能看到 CPU 写入的数据
+// - 临时缓冲反复借还只向堆分配一次；用途决定堆（DEVICE 为 uncached 语义）；在用字节数与高水位；
+//   缓存上限、Trim、换堆后旧堆的缓冲直接归还；换堆与另一线程的堆分配 / 归还并发时自有堆不被提前析构
+// - 计时：按 tile / 整帧 NV12 大小，每次直接向堆分配 + 释放（dma_buf_alloc/free 的用法）对比经池借还
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "hal/dma_heap.h"
+#include "utils/config.h"
+#include "utils/dma_buf_pool.h"
+#include "bench_util.h"
+
+static uint64_t GetNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool CheckClasses() {
+    bool ok = true;
+    size_t prev = 0;
+    for (size_t size = 1; size <= (64u << 20); size += size / 7 + 1) {
+        size_t cls = DmaBufPool::ClassBytes(size);
+        if (cls < size || cls % 4096 != 0 || cls < prev) ok = false;
+        if (size > 16384 && (cls - size) * 4 > size) ok = false;
+        prev = cls;
+    }
+    ok = ok && DmaBufPool::ClassBytes(1) == 4096 && DmaBufPool::ClassBytes(4096) == 4096 &&
+         DmaBufPool::ClassBytes(SRC_WIDTH * SRC_HEIGHT * 3 / 2) >= (size_t)SRC_WIDTH * SRC_HEIGHT * 3 / 2;
+    printf("[BENCH]   classes: tile %zu -> %zu, frame %zu -> %zu\n", (size_t)SUB_WIDTH * SUB_HEIGHT * 3 / 2,
+           DmaBufPool::ClassBytes(SUB_WIDTH * SUB_HEIGHT * 3 / 2), (size_t)SRC_WIDTH * SRC_HEIGHT * 3 / 2,
+           DmaBufPool::ClassBytes(SRC_WIDTH * SRC_HEIGHT * 3 / 2));
+    return Check(ok, "size classes page aligned, monotonic, waste < 1/4");
+}
+
+// 每次向堆分配、CPU 写一遍首尾页、释放；与经池借还对比
+static void Time(DmaBufPool &pool, DmaHeap *heap, size_t size, int loops) {
+    uint64_t t0 = GetNs();
+    for (int i = 0; i < loops; ++i) {
+        int fd = -1;
+        void *vir = NULL;
+        if (!heap->Alloc(size, &fd, &vir)) return;
+        static_cast<uint8_t *>(vir)[0] = (uint8_t)i;
+        static_cast<uint8_t *>(vir)[size - 1] = (uint8_t)i;
+        heap->Free(size, fd, vir);
+    }
+    uint64_t t1 = GetNs();
+    for (int i = 0; i < loops; ++i) {
+        DmaBuf buf;
+        if (!pool.Alloc(size, DMA_ROLE_CPU, &buf)) return;
+        static_cast<uint8_t *>(buf.vir)[0] = (uint8_t)i;
+        static_cast<uint8_t *>(buf.vir)[size - 1] = (uint8_t)i;
+        pool.Free(&buf);
+    }
+    uint64_t t2 = GetNs();
+    double direct = (double)(t1 - t0) / loops;
+    double pooled = (double)(t2 - t1) / loops;
+    printf("[BENCH]   %8zu bytes: direct alloc+mmap+free %.0fns  pooled %.0fns  (%.0fx)\n", size, direct, pooled,
+           pooled > 0 ? direct / pooled : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+    int loops = argc > 1 ? atoi(argv[1]) : 2000;
+    if (loops <= 0) return -1;
+    const size_t tileBytes = SUB_WIDTH * SUB_HEIGHT * 3 / 2;
+    const size_t frameBytes = SRC_WIDTH * SRC_HEIGHT * 3 / 2;
+
+    printf("[BENCH] dma-buf pool on memfd, %d loops\n", loops);
+    bool ok = CheckClasses();
+
+    DmaBufPool pool;
+    DmaBufPool::Options options;
+    options.maxCachedBytes = 4 * DmaBufPool::ClassBytes(frameBytes);
+    if (!pool.Init(options)) return -1;
+
+    // 数据经 fd 可见
+    DmaBuf buf;
+    bool shared = pool.Alloc(tileBytes, DMA_ROLE_CPU, &buf);
+    if (shared) {
+        memset(buf.vir, 0x5a, tileBytes);
+        void *view = mmap(NULL, buf.capacity, PROT_READ, MAP_SHARED, buf.fd, 0);
+        shared = view != MAP_FAILED && static_cast<uint8_t *>(view)[tileBytes - 1] == 0x5a;
+        if (view != MAP_FAILED) munmap(view, buf.capacity);
+    }
+    ok = Check(shared && buf.cached, "cpu buffer: shareable fd, cached heap") && ok;
+    pool.Free(&buf);
+
+    DmaBuf dev;
+    ok = Check(pool.Alloc(tileBytes, DMA_ROLE_DEVICE, &dev) && !dev.cached, "device buffer from uncached heap") && ok;
+    pool.Free(&dev);
+
+    // 临时缓冲反复借还
+    for (int i = 0; i < loops; ++i) {
+        DmaBuf t;
+        if (!pool.Alloc(tileBytes, DMA_ROLE_CPU, &t)) break;
+        pool.Free(&t);
+    }
+    DmaBufPool::Stats s = pool.GetStats(DMA_ROLE_CPU);
+    ok = Check(s.heapAllocs == 1 && s.hits == (uint64_t)loops && s.inUseBufs == 0,
+               "transient buffers: one heap allocation, then hits") && ok;
+
+    // 同时持有若干整帧：高水位；归还超过缓存上限的部分直接还给堆
+    std::vector<DmaBuf> held(6);
+    for (size_t i = 0; i < held.size(); ++i) pool.Alloc(frameBytes, DMA_ROLE_CPU, &held[i]);
+    s = pool.GetStats(DMA_ROLE_CPU);
+    size_t frameClass = DmaBufPool::ClassBytes(frameBytes);
+    ok = Check(s.inUseBufs == held.size() && s.highWaterBytes >= held.size() * frameClass,
+               "in-use bytes and high-water mark") && ok;
+    uint64_t freesBefore = s.heapFrees;
+    for (size_t i = 0; i < held.size(); ++i) pool.Free(&held[i]);
+    s = pool.GetStats(DMA_ROLE_CPU);
+    ok = Check(s.cachedBytes <= options.maxCachedBytes && s.heapFrees > freesBefore && s.inUseBytes == 0 &&
+               s.highWaterBytes >= held.size() * frameClass,
+               "cache capped at maxCachedBytes, high-water kept") && ok;
+
+    // Trim 后空闲链表清空
+    pool.Trim();
+    s = pool.GetStats(DMA_ROLE_CPU);
+    ok = Check(s.cachedBufs == 0 && s.cachedBytes == 0 && s.heapFrees == s.heapAllocs, "Trim frees every idle buffer")
+         && ok;
+
+    // 换堆：在用的旧缓冲归还时直接还给旧堆，新借出的来自新堆
+    DmaBuf old;
+    pool.Alloc(tileBytes, DMA_ROLE_CONTIG, &old);
+    MemfdDmaHeap custom(false);
+    pool.SetHeap(DMA_ROLE_CONTIG, &custom);
+    pool.Free(&old);
+    DmaBuf fresh;
+    bool swapped = pool.Alloc(tileBytes, DMA_ROLE_CONTIG, &fresh) && fresh.heap == &custom && custom.Allocs() == 1;
+    s = pool.GetStats(DMA_ROLE_CONTIG);
+    ok = Check(swapped && s.heapFrees == 1 && s.cachedBufs == 0, "SetHeap: old buffers bypass the cache") && ok;
+    pool.Free(&fresh);
+
+    // 另一线程不停向堆分配时反复把 CONTIG 换回自有堆再换走：在途分配与借出的缓冲都要能正常归还
+    std::atomic<bool> stop(false);
+    std::thread worker([&]() {
+        for (int i = 0; !stop.load(); ++i) {
+            DmaBuf t;
+            if (pool.Alloc(tileBytes * (1 + i % 3), DMA_ROLE_CONTIG, &t)) pool.Free(&t);
+        }
+    });
+    for (int round = 0; round < 8; ++round) {
+        pool.SetHeap(DMA_ROLE_CONTIG, nullptr);
+        pool.Init(options);
+        usleep(2000);
+        pool.SetHeap(DMA_ROLE_CONTIG, &custom);
+        usleep(2000);
+    }
+    stop = true;
+    worker.join();
+    s = pool.GetStats(DMA_ROLE_CONTIG);
+    ok = Check(s.inUseBufs == 0 && s.heapAllocs == s.heapFrees + s.cachedBufs,
+               "SetHeap racing heap allocations keeps the old heap alive") && ok;
+
+    // 另一线程逐块归还自有堆上借出的缓冲时反复换堆：最后一块还给堆之前旧堆不能被析构
+    bool drained = true;
+    for (int round = 0; round < 8; ++round) {
+        pool.SetHeap(DMA_ROLE_CONTIG, nullptr);
+        pool.Init(options);
+        std::vector<DmaBuf> lent(32);
+        for (size_t i = 0; i < lent.size(); ++i) pool.Alloc(tileBytes, DMA_ROLE_CONTIG, &lent[i]);
+        pool.SetHeap(DMA_ROLE_CONTIG, &custom);
+        std::atomic<bool> freed(false);
+        std::thread releaser([&]() {
+            for (size_t i = 0; i < lent.size(); ++i) pool.Free(&lent[i]);
+            freed = true;
+        });
+        while (!freed.load()) pool.SetHeap(DMA_ROLE_CONTIG, &custom);
+        releaser.join();
+        s = pool.GetStats(DMA_ROLE_CONTIG);
+        drained = drained && s.inUseBufs == 0;
+    }
+    ok = Check(drained, "SetHeap racing heap frees keeps the old heap alive") && ok;
+
+    pool.Trim();
+    Time(pool, pool.Heap(DMA_ROLE_CPU), tileBytes, loops);
+    Time(pool, pool.Heap(DMA_ROLE_CPU), frameBytes, loops / 4 > 0 ? loops / 4 : 1);
+    pool.PrintStats();
+
+    pool.Shutdown();
+    s = pool.GetStats(DMA_ROLE_CPU);
+    ok = Check(s.cachedBufs == 0 && s.inUseBufs == 0 && s.heapFrees == s.heapAllocs,
+               "Shutdown: every heap allocation released") && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+// TileJitterBuffer 压力测试与吞吐基准
+// 用法：bench_jitter_buffer [帧数，默认 5000] [生产者线程数，默认 2] [丢包率%，默认 2] [重复率%，默认 5] [乱序窗口帧数，默认 2]
+//       [--grid=CxR 等网格选项，放在最后]
+// - 按帧生成 tile 事件：按比例丢弃/重复，再在乱序窗口内整体打乱；frameSeq 从 65000 起跑，覆盖回绕
+// - 第一阶段单线程交替 Push/Acquire，要求未丢 tile 的帧全部完整交出
+// - 第二阶段多个生产者线程并发 Push，合成线程同时取帧；生产者领先合成线程不超过槽位数
+// - 两阶段都校验：tile 内容逐字节正确、frameSeq 单调递增、交出的 tile 确实发送过
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "utils/config.h"
+#include "transport/tile_jitter_buffer.h"
+
+static const uint16_t kFirstSeq = 65000;
+static const size_t kMaxTileBytes = 1024;
+static const int kSlots = 4;
+
+struct TileEvent {
+    uint16_t frameSeq;
+    int tileId;
+};
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+static size_t TileBytes(uint16_t frameSeq, int tileId) {
+    return 64 + (frameSeq * 13 + tileId * 29) % (kMaxTileBytes - 64);
+}
+
+static uint8_t PatternByte(uint16_t frameSeq, int tileId, size_t i) {
+    return (uint8_t)(frameSeq * 31 + tileId * 7 + i);
+}
+
+static void FillTile(uint16_t frameSeq, int tileId, uint8_t *buf) {
+    size_t n = TileBytes(frameSeq, tileId);
+    for (size_t i = 0; i < n; ++i) buf[i] = PatternByte(frameSeq, tileId, i);
+}
+
+// 生成事件序列，sentMask[f] 记录第 f 帧实际发出的 tile
+static std::vector<TileEvent> BuildEvents(int frames, int dropPct, int dupPct, int window,
+                                          std::vector<TileMask> *sentMask, std::mt19937 &rng) {
+    std::vector<TileEvent> events;
+    sentMask->assign(frames, 0);
+    std::uniform_int_distribution<int> pct(0, 99);
+    for (int base = 0; base < frames; base += window) {
+        size_t begin = events.size();
+        for (int f = base; f < base + window && f < frames; ++f) {
+            uint16_t seq = (uint16_t)(kFirstSeq + f);
+            for (int t = 0; t < TOTAL_CHNS; ++t) {
+                if (pct(rng) < dropPct) continue;
+                (*sentMask)[f] |= TILE_BIT(t);
+                events.push_back({seq, t});
+                if (pct(rng) < dupPct) events.push_back({seq, t});
+            }
+        }
+        std::shuffle(events.begin() + begin, events.end(), rng);
+    }
+    return events;
+}
+
+struct Checker {
+    std::vector<TileMask> sentMask;
+    bool hasLast = false;
+    uint16_t lastSeq = 0;
+    uint64_t frames = 0;
+    uint64_t corrupt = 0;
+    uint64_t phantom = 0;
+    uint64_t disorder = 0;
+    uint64_t intactButPartial = 0; // 未丢 tile 却以残缺帧交出
+
+    void Check(const TileJitterBuffer &jb, const TileJitterBuffer::FrameView &view) {
+        frames++;
+        if (hasLast && (int16_t)(view.frameSeq - lastSeq) <= 0) disorder++;
+        hasLast = true;
+        lastSeq = view.frameSeq;
+        int f = (uint16_t)(view.frameSeq - kFirstSeq);
+        if (f < 0 || f >= (int)sentMask.size()) {
+            phantom++;
+            return;
+        }
+        if (view.receivedMask & ~sentMask[f]) phantom++;
+        if (view.receivedMask != sentMask[f]) intactButPartial += (sentMask[f] == GetGridConfig().AllTilesMask());
+        for (int t = 0; t < TOTAL_CHNS; ++t) {
+            if (!(view.receivedMask & TILE_BIT(t))) continue;
+            const uint8_t *data = jb.TileData(view, t);
+            size_t n = jb.TileSize(view, t);
+            bool ok = data && n == TileBytes(view.frameSeq, t);
+            for (size_t i = 0; ok && i < n; ++i) ok = data[i] == PatternByte(view.frameSeq, t, i);
+            if (!ok) corrupt++;
+        }
+    }
+
+    bool Passed() const { return corrupt == 0 && phantom == 0 && disorder == 0; }
+};
+
+static void PrintResult(const char *phase, const TileJitterBuffer &jb, const Checker &ck, size_t events,
+                        uint64_t elapsedUs) {
+    printf("[BENCH] %s events=%zu frames out=%llu (complete=%llu partial=%llu) %.2f Mtiles/s\n", phase, events,
+           (unsigned long long)ck.frames, (unsigned long long)jb.FramesComplete(),
+           (unsigned long long)jb.FramesPartial(), elapsedUs ? events / (double)elapsedUs : 0.0);
+    printf("[BENCH]   tiles accepted=%llu dup=%llu late=%llu overrun=%llu evicted frames=%llu\n",
+           (unsigned long long)jb.TilesAccepted(), (unsigned long long)jb.TilesDuplicate(),
+           (unsigned long long)jb.TilesLate(), (unsigned long long)jb.TilesOverrun(),
+           (unsigned long long)jb.FramesEvicted());
+    printf("[BENCH]   check corrupt=%llu phantom=%llu disorder=%llu intact-but-partial=%llu -> %s\n",
+           (unsigned long long)ck.corrupt, (unsigned long long)ck.phantom, (unsigned long long)ck.disorder,
+           (unsigned long long)ck.intactButPartial, ck.Passed() ? "ok" : "FAIL");
+}
+
+int main(int argc, char *argv[]) {
+    int frames = argc > 1 ? atoi(argv[1]) : 5000;
+    int producers = argc > 2 ? atoi(argv[2]) : 2;
+    int dropPct = argc > 3 ? atoi(argv[3]) : 2;
+    int dupPct = argc > 4 ? atoi(argv[4]) : 5;
+    int window = argc > 5 ? atoi(argv[5]) : 2;
+    if (frames <= 0) frames = 5000;
+    if (producers <= 0) producers = 1;
+    if (window <= 0 || window > kSlots - 2) window = kSlots - 2; // 乱序不超过槽位容量
+    GridConfig grid;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--", 2) == 0 && !ParseGridOption(&grid, argv[i])) return -1;
+    }
+    if (!ApplyGridConfig(grid)) return -1;
+
+    std::mt19937 rng(1234);
+    std::vector<uint8_t> tile(kMaxTileBytes);
+    bool passed = true;
+
+    // 阶段一：单线程，确定性校验
+    {
+        TileJitterBuffer jb;
+        if (!jb.Init(kSlots, kMaxTileBytes)) return -1;
+        Checker ck;
+        std::vector<TileEvent> events = BuildEvents(frames, dropPct, dupPct, window, &ck.sentMask, rng);
+        TileJitterBuffer::FrameView view;
+        uint64_t startUs = GetUs();
+        uint64_t fakeMs = 0;
+        for (size_t i = 0; i < events.size(); ++i) {
+            const TileEvent &ev = events[i];
+            FillTile(ev.frameSeq, ev.tileId, tile.data());
+            jb.Push(ev.tileId, ev.frameSeq, GetGridConfig().AllTilesMask(), ev.frameSeq, tile.data(), TileBytes(ev.frameSeq, ev.tileId),
+                    fakeMs);
+            // 每个乱序窗口结束推进一次虚拟时钟，残缺帧在下一窗口结束时超时交出
+            bool windowEnd = i + 1 == events.size() ||
+                             (uint16_t)(events[i + 1].frameSeq - kFirstSeq) / window !=
+                                 (uint16_t)(ev.frameSeq - kFirstSeq) / window;
+            if (windowEnd) fakeMs += 10;
+            while (jb.AcquireFrame(fakeMs, 20, &view)) {
+                ck.Check(jb, view);
+                jb.ReleaseFrame(view);
+            }
+        }
+        while (jb.AcquireFrame(fakeMs + 1000, 20, &view)) {
+            ck.Check(jb, view);
+            jb.ReleaseFrame(view);
+        }
+        PrintResult("jitter_buffer single-thread", jb, ck, events.size(), GetUs() - startUs);
+        passed = passed && ck.Passed() && ck.intactButPartial == 0;
+    }
+
+    // 阶段二：多生产者并发 + 合成线程
+    {
+        TileJitterBuffer jb;
+        if (!jb.Init(kSlots, kMaxTileBytes)) return -1;
+        Checker ck;
+        std::vector<TileEvent> events = BuildEvents(frames, dropPct, dupPct, window, &ck.sentMask, rng);
+        std::atomic<size_t> next(0);
+        std::atomic<int> running(producers);
+        std::atomic<int> emitted(-1); // 已交出的最新帧序号（相对 kFirstSeq），生产者据此限速
+        uint64_t startUs = GetUs();
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&]() {
+                std::vector<uint8_t> buf(kMaxTileBytes);
+                size_t i;
+                while ((i = next.fetch_add(1)) < events.size()) {
+                    const TileEvent &ev = events[i];
+                    // 模拟实际帧率：领先合成线程不超过槽位容量，避免单纯测成覆盖丢帧
+                    int f = (uint16_t)(ev.frameSeq - kFirstSeq);
+                    while (f > emitted.load() + kSlots) std::this_thread::yield();
+                    FillTile(ev.frameSeq, ev.tileId, buf.data());
+                    jb.Push(ev.tileId, ev.frameSeq, GetGridConfig().AllTilesMask(), ev.frameSeq, buf.data(),
+                            TileBytes(ev.frameSeq, ev.tileId), GetUs() / 1000);
+                }
+                running--;
+            });
+        }
+
+        TileJitterBuffer::FrameView view;
+        while (true) {
+            bool done = running.load() == 0;
+            while (jb.AcquireFrame(GetUs() / 1000 + (done ? 1000 : 0), 20, &view)) {
+                ck.Check(jb, view);
+                jb.ReleaseFrame(view);
+                emitted = (uint16_t)(view.frameSeq - kFirstSeq);
+            }
+            if (done) break;
+            std::this_thread::yield();
+        }
+        for (auto &t : threads) t.join();
+        char phase[64];
+        snprintf(phase, sizeof(phase), "jitter_buffer %d-producer", producers);
+        PrintResult(phase, jb, ck, events.size(), GetUs() - startUs);
+        passed = passed && ck.Passed();
+    }
+    return passed ? 0 : 1;
+}
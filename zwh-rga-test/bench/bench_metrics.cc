@@ -0,0 +1,80 @@
+// PipelineMetrics 记录开销基准
+// 用法：bench_metrics [帧数，默认 200000] [--grid=CxR 等网格选项，放在最后]
+// - 采集线程按真实顺序调用 FrameCaptured / FrameCropped / TileSubmitted，发送线程并发调用 TileSent
+//   （发送线程落后采集线程若干帧，覆盖时间轴被覆盖的情况）
+// - 打印每次记录调用的平均耗时；同一帧序号跑一遍关闭状态作为对照
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include "utils/config.h"
+#include "utils/pipeline_metrics.h"
+
+static void RunCapture(PipelineMetrics &metrics, int frames, std::atomic<int> *published) {
+    int tiles = TOTAL_CHNS;
+    for (int f = 1; f <= frames; ++f) {
+        uint16_t seq = (uint16_t)f;
+        uint64_t now = MetricsNowUs();
+        metrics.FrameCaptured(seq, now > 500 ? now - 500 : now, now);
+        metrics.FrameCropped(seq, MetricsNowUs());
+        for (int t = 0; t < tiles; ++t) {
+            metrics.TileSubmitted(seq, t, MetricsNowUs());
+        }
+        published->store(f, std::memory_order_release);
+    }
+}
+
+static void RunSender(PipelineMetrics &metrics, int frames, std::atomic<int> *published) {
+    int tiles = TOTAL_CHNS;
+    for (int f = 1; f <= frames; ++f) {
+        while (published->load(std::memory_order_acquire) < f) {
+        }
+        for (int t = 0; t < tiles; ++t) {
+            uint64_t now = MetricsNowUs();
+            metrics.TileSent((uint16_t)f, t, 1000 + t, now, now);
+        }
+    }
+}
+
+static double RunOnce(PipelineMetrics &metrics, int frames) {
+    std::atomic<int> published(0);
+    uint64_t startUs = MetricsNowUs();
+    std::thread sender(RunSender, std::ref(metrics), frames, &published);
+    RunCapture(metrics, frames, &published);
+    sender.join();
+    uint64_t elapsedUs = MetricsNowUs() - startUs;
+    // 每帧 2 次帧级调用 + 每 tile 2 次，外加同样次数的取时间
+    double calls = (double)frames * (2 + 2 * TOTAL_CHNS);
+    return elapsedUs * 1000.0 / calls;
+}
+
+int main(int argc, char *argv[]) {
+    GridConfig grid;
+    while (argc > 1 && strncmp(argv[argc - 1], "--", 2) == 0) {
+        if (!ParseGridOption(&grid, argv[--argc])) return -1;
+    }
+    if (!ApplyGridConfig(grid)) return -1;
+    int frames = argc > 1 ? atoi(argv[1]) : 200000;
+    if (frames <= 0) frames = 200000;
+
+    PipelineMetrics::Options options;
+    options.periodMs = 1000;
+    options.socketPath.clear();
+
+    static PipelineMetrics off; // 对象较大（时间轴+直方图），不放栈上
+    double offNs = RunOnce(off, frames);
+
+    static PipelineMetrics on;
+    if (!on.Start(options)) return -1;
+    double onNs = RunOnce(on, frames);
+    std::string last = on.Snapshot();
+    on.Stop();
+
+    printf("[BENCH] metrics frames=%d tiles=%d off=%.1fns/call on=%.1fns/call overhead=%.1fns/call\n",
+           frames, TOTAL_CHNS, offNs, onNs, onNs - offNs);
+    if (!last.empty()) printf("[BENCH]   last window: %s\n", last.c_str());
+    return 0;
+}
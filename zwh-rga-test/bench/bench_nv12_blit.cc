@@ -0,0 +1,222 @@
+// NV12 区域内核基准与检查（主机构建）
+// 用法：bench_nv12_blit [每项循环次数，默认 200]
+// - 正确性：与原来的逐行 memcpy 循环逐字节比较（tile 拷进画布、带 stride 的整帧裁剪出 tile、
+//   源 stride 不等于宽度且目标起点不对齐）；FillUncovered 只写未覆盖的像素，覆盖区保持原值
+// - 计时（每项同一份数据先跑原循环再跑内核）：
+//   接收端 blit：紧凑 tile 按原位置拷进画布（BlitTile / SendTileOverNetwork_Test）
+//   裁剪：整帧（stride 对齐到 64）裁出一个 tile（TileSlicer 主机回退）
+//   合成：整幅 memset + 保留 tile 拷贝（原 ComposeCpu）对比只填未覆盖区 + 保留 tile 拷贝
+// 板端构建走 NEON 内核，设 ZWH_NV12_BLIT=memcpy 可在同一程序里对比原循环
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "utils/config.h"
+#include "utils/nv12_blit.h"
+#include "bench_util.h"
+
+static uint64_t GetNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void FillPattern(std::vector<uint8_t> &buf, uint32_t seed) {
+    for (size_t i = 0; i < buf.size(); ++i) {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+// 原来的逐行 memcpy：src 中 (sx, sy) 起 w x h 拷到 dst 的 (dx, dy)
+static void MemcpyRegion(const uint8_t *src, int srcStride, int srcVStride, int sx, int sy, uint8_t *dst, int dstStride,
+                         int dstVStride, int dx, int dy, int w, int h) {
+    for (int row = 0; row < h; ++row) {
+        memcpy(dst + (size_t)(dy + row) * dstStride + dx, src + (size_t)(sy + row) * srcStride + sx, w);
+    }
+    const uint8_t *srcUV = src + (size_t)srcStride * srcVStride;
+    uint8_t *dstUV = dst + (size_t)dstStride * dstVStride;
+    for (int row = 0; row < h / 2; ++row) {
+        memcpy(dstUV + (size_t)(dy / 2 + row) * dstStride + dx, srcUV + (size_t)(sy / 2 + row) * srcStride + sx, w);
+    }
+}
+
+static void PrintTime(const char *what, uint64_t refNs, uint64_t newNs, int loops) {
+    double ref = (double)refNs / loops / 1000.0;
+    double now = (double)newNs / loops / 1000.0;
+    printf("[BENCH]   %-30s memcpy loops %8.1fus  %s %8.1fus  (%.2fx)\n", what, ref, Nv12BlitKernel(), now,
+           now > 0 ? ref / now : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+    int loops = argc > 1 ? atoi(argv[1]) : 200;
+    if (loops <= 0) return -1;
+    const GridConfig &grid = GetGridConfig();
+    const int frameW = SRC_WIDTH;
+    const int frameH = SRC_HEIGHT;
+    const int tileW = SUB_WIDTH;
+    const int tileH = SUB_HEIGHT;
+    const int tiles = TOTAL_CHNS;
+    const size_t frameBytes = (size_t)frameW * frameH * 3 / 2;
+    const size_t tileBytes = (size_t)tileW * tileH * 3 / 2;
+    const int viStride = (frameW + 63) & ~63;
+    const int viVStride = frameH + 8;
+
+    printf("[BENCH] nv12 kernels (%s), %dx%d frame, %d tiles of %dx%d, %d loops\n", Nv12BlitKernel(), frameW, frameH,
+           tiles, tileW, tileH, loops);
+    bool ok = true;
+
+    std::vector<uint8_t> vi((size_t)viStride * viVStride * 3 / 2);
+    std::vector<uint8_t> packed(tileBytes * tiles);
+    std::vector<uint8_t> refCanvas(frameBytes), canvas(frameBytes);
+    FillPattern(vi, 1);
+    FillPattern(packed, 2);
+
+    // blit：紧凑 tile -> 画布
+    Nv12View canvasView = Nv12At(canvas.data(), frameW, frameH);
+    for (int t = 0; t < tiles; ++t) {
+        MemcpyRegion(&packed[t * tileBytes], tileW, tileH, 0, 0, refCanvas.data(), frameW, frameH, grid.TileX(t),
+                     grid.TileY(t), tileW, tileH);
+        Nv12Copy(Nv12At(&packed[t * tileBytes], tileW, tileH), 0, 0, canvasView, grid.TileX(t), grid.TileY(t), tileW,
+                 tileH);
+    }
+    ok = Check(refCanvas == canvas, "blit packed tiles into canvas matches memcpy loops") && ok;
+
+    // 裁剪：带 stride 的整帧 -> 紧凑 tile
+    std::vector<uint8_t> refTile(tileBytes), tile(tileBytes);
+    bool cropOk = true;
+    Nv12View viView = Nv12At(vi.data(), viStride, viVStride);
+    for (int t = 0; t < tiles; ++t) {
+        MemcpyRegion(vi.data(), viStride, viVStride, grid.TileX(t), grid.TileY(t), refTile.data(), tileW, tileH, 0, 0,
+                     tileW, tileH);
+        Nv12Copy(viView, grid.TileX(t), grid.TileY(t), Nv12At(tile.data(), tileW, tileH), 0, 0, tileW, tileH);
+        cropOk = cropOk && refTile == tile;
+    }
+    ok = Check(cropOk, "crop from strided frame matches memcpy loops") && ok;
+
+    // 不整齐的尺寸与起点：宽度不是 16 的倍数，目标起点不对齐
+    {
+        const int w = 94, h = 30, sx = 6, sy = 4, dx = 18, dy = 10;
+        std::vector<uint8_t> a((size_t)frameW * 64 * 3 / 2), b(a.size());
+        FillPattern(a, 3);
+        b = a;
+        MemcpyRegion(vi.data(), viStride, viVStride, sx, sy, a.data(), frameW, 64, dx, dy, w, h);
+        Nv12Copy(viView, sx, sy, Nv12At(b.data(), frameW, 64), dx, dy, w, h);
+        ok = Check(a == b, "odd widths and unaligned destinations") && ok;
+    }
+
+    // FillUncovered：随机跳过几个 tile，未覆盖区为填充值，覆盖区保持原值
+    {
+        std::vector<uint8_t> c(frameBytes);
+        FillPattern(c, 4);
+        std::vector<uint8_t> before = c;
+        TileMask skip = TILE_BIT(0) | TILE_BIT(tiles / 2) | TILE_BIT(tiles - 1);
+        Nv12Rect kept[MAX_TILES];
+        int keptCnt = 0;
+        for (int t = 0; t < tiles; ++t) {
+            if (skip & TILE_BIT(t)) continue;
+            kept[keptCnt].x = grid.TileX(t);
+            kept[keptCnt].y = grid.TileY(t);
+            kept[keptCnt].w = tileW;
+            kept[keptCnt].h = tileH;
+            keptCnt++;
+        }
+        size_t bytes = Nv12FillUncovered(Nv12At(c.data(), frameW, frameH), frameW, frameH, kept, keptCnt, 16, 128, 130);
+        bool fillOk = true;
+        size_t filled = 0;
+        for (int yy = 0; yy < frameH && fillOk; ++yy) {
+            for (int xx = 0; xx < frameW; ++xx) {
+                bool covered = false;
+                for (int i = 0; i < keptCnt && !covered; ++i) {
+                    covered = xx >= kept[i].x && xx < kept[i].x + kept[i].w && yy >= kept[i].y &&
+                              yy < kept[i].y + kept[i].h;
+                }
+                size_t yi = (size_t)yy * frameW + xx;
+                size_t uvi = (size_t)frameW * frameH + (size_t)(yy / 2) * frameW + xx;
+                uint8_t expectUV = (xx & 1) ? 130 : 128;
+                if (covered) {
+                    fillOk = c[yi] == before[yi] && c[uvi] == before[uvi];
+                } else {
+                    fillOk = c[yi] == 16 && c[uvi] == expectUV;
+                    filled++;
+                }
+                if (!fillOk) break;
+            }
+        }
+        ok = Check(fillOk && bytes == filled * 3 / 2, "fill touches exactly the uncovered pixels") && ok;
+        size_t none = Nv12FillUncovered(Nv12At(c.data(), frameW, frameH), frameW, frameH, NULL, 0, 0, 128, 128);
+        ok = Check(none == frameBytes, "no covered rects: whole canvas filled") && ok;
+    }
+
+    // 计时
+    uint64_t t0 = GetNs();
+    for (int i = 0; i < loops; ++i) {
+        for (int t = 0; t < tiles; ++t) {
+            MemcpyRegion(&packed[t * tileBytes], tileW, tileH, 0, 0, refCanvas.data(), frameW, frameH, grid.TileX(t),
+                         grid.TileY(t), tileW, tileH);
+        }
+    }
+    uint64_t t1 = GetNs();
+    for (int i = 0; i < loops; ++i) {
+        for (int t = 0; t < tiles; ++t) {
+            Nv12Copy(Nv12At(&packed[t * tileBytes], tileW, tileH), 0, 0, canvasView, grid.TileX(t), grid.TileY(t),
+                     tileW, tileH);
+        }
+    }
+    uint64_t t2 = GetNs();
+    PrintTime("blit all tiles (receiver)", t1 - t0, t2 - t1, loops);
+
+    t0 = GetNs();
+    for (int i = 0; i < loops; ++i) {
+        for (int t = 0; t < tiles; ++t) {
+            MemcpyRegion(vi.data(), viStride, viVStride, grid.TileX(t), grid.TileY(t), refTile.data(), tileW, tileH, 0,
+                         0, tileW, tileH);
+        }
+    }
+    t1 = GetNs();
+    for (int i = 0; i < loops; ++i) {
+        for (int t = 0; t < tiles; ++t) {
+            Nv12Copy(viView, grid.TileX(t), grid.TileY(t), Nv12At(tile.data(), tileW, tileH), 0, 0, tileW, tileH);
+        }
+    }
+    t2 = GetNs();
+    PrintTime("crop all tiles (slicer)", t1 - t0, t2 - t1, loops);
+
+    const int skips[] = {0, 3};
+    for (size_t s = 0; s < sizeof(skips) / sizeof(skips[0]); ++s) {
+        TileMask skip = 0;
+        for (int k = 0; k < skips[s] && k < tiles; ++k) skip |= TILE_BIT((k * 5) % tiles);
+        Nv12Rect kept[MAX_TILES];
+        int keptCnt = 0;
+        for (int t = 0; t < tiles; ++t) {
+            if (skip & TILE_BIT(t)) continue;
+            kept[keptCnt].x = grid.TileX(t);
+            kept[keptCnt].y = grid.TileY(t);
+            kept[keptCnt].w = tileW;
+            kept[keptCnt].h = tileH;
+            keptCnt++;
+        }
+        t0 = GetNs();
+        for (int i = 0; i < loops; ++i) {
+            memset(refCanvas.data(), 0, frameBytes);
+            for (int k = 0; k < keptCnt; ++k) {
+                MemcpyRegion(vi.data(), viStride, viVStride, kept[k].x, kept[k].y, refCanvas.data(), frameW, frameH,
+                             kept[k].x, kept[k].y, tileW, tileH);
+            }
+        }
+        t1 = GetNs();
+        for (int i = 0; i < loops; ++i) {
+            Nv12FillUncovered(canvasView, frameW, frameH, kept, keptCnt, 0, 128, 128);
+            for (int k = 0; k < keptCnt; ++k) {
+                Nv12Copy(viView, kept[k].x, kept[k].y, canvasView, kept[k].x, kept[k].y, tileW, tileH);
+            }
+        }
+        t2 = GetNs();
+        char what[64];
+        snprintf(what, sizeof(what), "compose canvas, %d skipped", skips[s]);
+        PrintTime(what, t1 - t0, t2 - t1, loops);
+    }
+    return ok ? 0 : 1;
+}
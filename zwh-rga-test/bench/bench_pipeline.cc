@@ -0,0 +1,233 @@
+// 整条流水线在主机仿真后端上的端到端基准
+// 用法：bench_pipeline [模式 0/1/2/3，默认 0] [帧数，默认 300] [VI 帧率，0 不限速，默认 0] [NV12 文件，可选]
+//       [--src=WxH --grid=CxR --tile=WxH --motion=off|<阈值>[,<刷新帧数>] --metrics=off|<周期ms>[,<socket>] --workers=N --vpss=<组数>
+//        --gop=sync|stagger|refresh[,<gop>] --bitrate=off|<总码率kbps>[,<周期ms>[,<轨迹文件>]]
+//        --rtsp=<每会话积压帧数>[,<积压KB>] --lazy=off|<常驻掩码> --subscribe=<掩码>[,<租期ms>]
+//        --record=off|<总MB>[,<段MB>[,<目录>]] --pre-event=off|<预算KB>[,<事前ms>[,<事后ms>[,<目录>]]]
+//        --detect=off|<间隔ms>[,frame|tiles]，放在最后]
+// - 环境变量 ZWH_RTSP_STUB_TX_US 让 RTSP 桩每次发送耗时若干微秒，模拟慢客户端
+// - 检测走 NPU 桩后端，环境变量 ZWH_NPU_STUB_US 指定单次推理耗时（默认 20000）
+// - 模式与主程序一致：0=逐 tile 裁剪编码，1=合并编码，2=网络测试，3=VPSS 绑定直通（超出的 tile 走 RGA）
+// - 采集-裁剪-编码-推流循环与板端共用同一份代码，只是 MpiHal 换成 HostMpiHal、RTSP 换成桩实现
+// - --subscribe 在本进程起一个回环 UDP 接收端订阅这些 tile（模式 0/3），配合 --lazy 对比只看少数 tile 时的 CPU 占用
+// - VI 出到一半时请求一次全部 tile 同步 IDR，检验重同步后能重新错开；开启 --pre-event 时出到 3/4 触发一次导出
+// - VI 出满指定帧数后请求停止，打印吞吐、编码量、丢帧、VI 出帧到码流取走的平均时延与进程 CPU 占用
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <thread>
+
+#include "hal/host_mpi_hal.h"
+#include "hal/stub_npu_backend.h"
+#include "process/merge/process_merge_loop.h"
+#include "process/bind/process_bind_loop.h"
+#include "process/net/process_net_loop.h"
+#include "process/test/process_loop.h"
+#include "transport/tile_receiver.h"
+#include "utils/pipeline_init.h"
+#include "utils/pipeline_metrics.h"
+#include "utils/rtsp_helper.h"
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+static uint64_t GetCpuUs() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL + usage.ru_utime.tv_usec +
+           usage.ru_stime.tv_usec;
+}
+
+static const uint16_t kSubscriberPort = 46000;
+
+// 解析 "<掩码>[,<租期ms>]"
+static bool ParseSubscribe(const char *text, TileMask *mask, uint32_t *leaseMs) {
+    char *end = NULL;
+    *mask = (TileMask)strtoull(text, &end, 0);
+    if (end == text) return false;
+    if (*end == ',') {
+        const char *next = end + 1;
+        *leaseMs = (uint32_t)strtoul(next, &end, 10);
+        if (end == next || *leaseMs == 0) return false;
+    }
+    return *end == '\0';
+}
+
+int main(int argc, char *argv[]) {
+    GridConfig grid;
+    TileMotionGate::Options motion;
+    PipelineMetrics::Options metrics;
+    int tileWorkers = kDefaultTileWorkers;
+    int vpssGroups = kDefaultVpssGroups;
+    GopScheduler::Options gop;
+    BitrateAllocator::Options bitrate;
+    RtspService::Options rtsp;
+    TileSubscriptions::Options lazy;
+    TileRecorder::Options record;
+    PreEventBuffer::Options preEvent;
+    TileDetector::Options detect;
+    const char *subscribe = NULL;
+    TileMask subscribeMask = 0;
+    uint32_t subscribeLeaseMs = 1000;
+    bitrate.periodMs = 1000;
+    metrics.periodMs = 1000;
+    metrics.socketPath.clear();
+    while (argc > 1 && strncmp(argv[argc - 1], "--", 2) == 0) {
+        const char *opt = argv[--argc];
+        if (strncmp(opt, "--workers=", 10) == 0) {
+            tileWorkers = atoi(opt + 10);
+            continue;
+        }
+        if (strncmp(opt, "--vpss=", 7) == 0) {
+            vpssGroups = atoi(opt + 7);
+            continue;
+        }
+        if (strncmp(opt, "--subscribe=", 12) == 0) {
+            subscribe = opt + 12;
+            if (!ParseSubscribe(subscribe, &subscribeMask, &subscribeLeaseMs)) return -1;
+            continue;
+        }
+        bool ok = strncmp(opt, "--motion=", 9) == 0    ? TileMotionGate::ParseOption(opt + 9, &motion)
+                  : strncmp(opt, "--metrics=", 10) == 0 ? PipelineMetrics::ParseOption(opt + 10, &metrics)
+                  : strncmp(opt, "--gop=", 6) == 0      ? GopScheduler::ParseOption(opt + 6, &gop)
+                  : strncmp(opt, "--bitrate=", 10) == 0 ? BitrateAllocator::ParseOption(opt + 10, &bitrate)
+                  : strncmp(opt, "--rtsp=", 7) == 0     ? RtspService::ParseOption(opt + 7, &rtsp)
+                  : strncmp(opt, "--lazy=", 7) == 0     ? TileSubscriptions::ParseOption(opt + 7, &lazy)
+                  : strncmp(opt, "--record=", 9) == 0   ? TileRecorder::ParseOption(opt + 9, &record)
+                  : strncmp(opt, "--pre-event=", 12) == 0 ? PreEventBuffer::ParseOption(opt + 12, &preEvent)
+                  : strncmp(opt, "--detect=", 9) == 0   ? TileDetector::ParseOption(opt + 9, &detect)
+                                                        : ParseGridOption(&grid, opt);
+        if (!ok) return -1;
+    }
+    if (!ApplyGridConfig(grid)) return -1;
+    if (!GetPipelineMetrics().Start(metrics)) return -1;
+
+    int mode = argc > 1 ? atoi(argv[1]) : 0;
+    int frames = argc > 2 ? atoi(argv[2]) : 300;
+    if (frames <= 0) frames = 300;
+
+    HostMpiHal::Options options;
+    options.fps = argc > 3 ? atoi(argv[3]) : 0;
+    options.nv12File = argc > 4 ? argv[4] : nullptr;
+    HostMpiHal hal(options);
+    SetMpiHal(&hal);
+    StubNpuBackend::Options npuOptions;
+    if (getenv("ZWH_NPU_STUB_US")) npuOptions.inferUs = atoi(getenv("ZWH_NPU_STUB_US"));
+    StubNpuBackend npu(npuOptions);
+    SetNpuBackend(&npu);
+
+    if (!InitMpiSys()) return -1;
+    RtspContext rtspCtx;
+    if ((mode == 0 || mode == 3) && gop.mode == GopScheduler::GOP_REFRESH) rtsp.refreshFrames = gop.gop;
+    if (!InitRtsp(rtspCtx, rtsp) || !InitViInput(mode == 3)) return -1;
+    MB_POOL subImgPool = MB_INVALID_POOLID;
+    if (!CreateSubImgPool(subImgPool)) return -1;
+    if (bitrate.totalKbps <= 0) bitrate.totalKbps = TOTAL_CHNS * BitrateAllocator::kDefaultTileKbps;
+    if ((mode == 0 || mode == 3) && !InitVencChannels(GopScheduler::ChannelGop(gop), bitrate.totalKbps / TOTAL_CHNS)) {
+        return -1;
+    }
+
+    std::atomic<bool> finished(false);
+    std::thread watcher([&]() {
+        bool resynced = false;
+        bool exported = !preEvent.enabled;
+        while (!finished.load() && hal.ViFrames() < (uint64_t)frames) {
+            if (!resynced && hal.ViFrames() >= (uint64_t)frames / 2) {
+                RequestKeyframeResync();
+                resynced = true;
+            }
+            if (!exported && hal.ViFrames() >= (uint64_t)frames * 3 / 4) {
+                RequestPreEventExport();
+                exported = true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        RequestPipelineStop();
+    });
+
+    // 回环订阅者：与发送端同进程，CPU 占用一并计入
+    TileReceiver subscriber;
+    std::thread subscriberThread;
+    TileMask receivedMask = 0;
+    char endpoint[64] = "";
+    if (subscribe) {
+        if (!subscriber.Open(kSubscriberPort, TILE_TRANSPORT_UDP)) return -1;
+        subscriber.SetCallbacks([&receivedMask](const TileInfo &info, const uint8_t *) {
+            receivedMask |= TILE_BIT(info.tileId);
+        });
+        subscriber.SetSubscription(subscribeMask, subscribeLeaseMs);
+        snprintf(endpoint, sizeof(endpoint), "udp://127.0.0.1:%u", (unsigned int)kSubscriberPort);
+        subscriberThread = std::thread([&]() {
+            while (!finished.load()) subscriber.Poll(20);
+        });
+    }
+
+    uint64_t startUs = GetUs();
+    uint64_t startCpuUs = GetCpuUs();
+    ProcessOptions processOptions;
+    processOptions.motion = motion;
+    processOptions.tileWorkers = tileWorkers;
+    processOptions.gop = gop;
+    processOptions.bitrate = bitrate;
+    processOptions.lazy = lazy;
+    processOptions.record = record;
+    processOptions.preEvent = preEvent;
+    processOptions.detect = detect;
+    if (subscribe) processOptions.tileEndpoint = endpoint;
+    if (mode == 1) {
+        ProcessMergedFrames(rtspCtx, subImgPool, COMPOSITE_AUTO);
+    } else if (mode == 2) {
+        ProcessNetLoop(rtspCtx, subImgPool, NULL, motion);
+    } else if (mode == 3) {
+        ProcessBindLoop(rtspCtx, subImgPool, processOptions, vpssGroups);
+    } else {
+        ProcessFrames(rtspCtx, subImgPool, processOptions);
+    }
+    uint64_t elapsedUs = GetUs() - startUs;
+    uint64_t cpuUs = GetCpuUs() - startCpuUs;
+    finished = true;
+    watcher.join();
+    if (subscriberThread.joinable()) subscriberThread.join();
+    std::string lastMetrics = GetPipelineMetrics().Snapshot();
+    GetPipelineMetrics().Stop();
+
+    printf("[BENCH] pipeline mode=%d vi frames=%llu drops=%llu %.1f fps\n", mode,
+           (unsigned long long)hal.ViFrames(), (unsigned long long)hal.ViDrops(),
+           elapsedUs ? hal.ViFrames() * 1e6 / elapsedUs : 0.0);
+    printf("[BENCH]   encoded frames=%llu bytes=%llu drops=%llu avg latency=%lluus cache flushes=%llu\n",
+           (unsigned long long)hal.EncodedFrames(), (unsigned long long)hal.EncodedBytes(),
+           (unsigned long long)hal.EncodeDrops(), (unsigned long long)hal.AvgStreamLatencyUs(),
+           (unsigned long long)hal.CacheFlushes());
+    printf("[BENCH]   cpu=%.1f%% vpss frames=%llu drops=%llu\n", elapsedUs ? cpuUs * 100.0 / elapsedUs : 0.0,
+           (unsigned long long)hal.VpssFrames(), (unsigned long long)hal.VpssDrops());
+    GopScheduler &gopScheduler = GetGopScheduler();
+    printf("[BENCH]   gop=%s I frames=%llu idr requests=%llu resyncs=%llu steady peak I/frame=%d "
+           "peak/avg frame bytes=%.2f\n",
+           GopScheduler::ModeName(gop.mode), (unsigned long long)gopScheduler.Keyframes(),
+           (unsigned long long)gopScheduler.IdrRequests(), (unsigned long long)gopScheduler.Resyncs(),
+           gopScheduler.PeakKeyframesPerFrame(), gopScheduler.PeakToAvgFrameBytes());
+    RtspService::Stats rtspStats = rtspCtx.service->GetStats();
+    printf("[BENCH]   rtsp sent=%llu ring drops=%llu gop drops=%llu dropped frames=%llu idr requests=%llu "
+           "(throttled %llu) refresh skips=%llu\n",
+           (unsigned long long)rtspStats.frames, (unsigned long long)rtspStats.ringDrops,
+           (unsigned long long)rtspStats.gopDrops, (unsigned long long)rtspStats.droppedFrames,
+           (unsigned long long)rtspStats.keyframeRequests, (unsigned long long)rtspStats.keyframeThrottled,
+           (unsigned long long)rtspStats.refreshSkips);
+    if (subscribe) {
+        printf("[BENCH]   subscribed=0x%llx lease=%ums received tiles=%llu from 0x%llx bad packets=%llu\n",
+               (unsigned long long)subscribeMask, subscribeLeaseMs,
+               (unsigned long long)subscriber.TilesCompleted(), (unsigned long long)receivedMask,
+               (unsigned long long)subscriber.BadPackets());
+    }
+    if (!lastMetrics.empty()) printf("[BENCH]   last metrics window: %s\n", lastMetrics.c_str());
+
+    CleanupRtsp(rtspCtx);
+    ExitMpiSys();
+    return hal.EncodedFrames() > 0 ? 0 : 1;
+}
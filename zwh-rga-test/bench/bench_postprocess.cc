@@ -0,0 +1,177 @@
+// YOLOv5 输出解码基准：快速实现（int8 域判阈值 + 类别分桶 NMS）对参考实现（全部反量化成 float）
+// 用法：bench_postprocess [录制文件 ...]
+// - 录制文件由板端检测阶段在 ZWH_NPU_DUMP=<文件> 时写出；不给文件时合成一组 640x640 输入的三头输出
+//   （背景低置信度噪声 + 若干目标在相邻格点/anchor 上的成簇响应，含同分与恰在阈值边界的取值），
+//   先写入 /tmp/zwh-npu-synth.bin 再读回，录制格式一并走一遍
+// - 每组输出在几档阈值下比较两种实现的结果，框坐标、类别与置信度（按位）必须完全一致
+// - 计时：同一组输出重复解码，报告两种实现的平均耗时与过阈值的 anchor 数
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "utils/yolo_decode.h"
+
+static const int kModelSize = 640;
+static const int kSynthFrames = 100;
+static const int kRepeat = 20;
+static const char *kSynthPath = "/tmp/zwh-npu-synth.bin";
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+static uint32_t g_seed = 12345;
+static int Rand(int lo, int hi) {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return lo + (int)((g_seed >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+static int8_t Quantize(float v, int32_t zp, float scale) {
+    int q = (int)(v / scale + 0.5f) + zp;
+    return (int8_t)(q < -128 ? -128 : q > 127 ? 127 : q);
+}
+
+// 一帧合成输出：三个头各自的 zp/scale 略有不同，目标响应落在对应步长的头上并扩散到相邻格点
+static void SynthesizeFrame(std::vector<std::vector<int8_t> > *heads, std::vector<NpuTensor> *tensors) {
+    static const int kStrides[3] = {8, 16, 32};
+    static const int32_t kZps[3] = {-128, -126, -120};
+    static const float kScales[3] = {1.0f / 255.0f, 0.0039f, 0.0041f};
+    const int props = 5 + kYoloClasses;
+    heads->resize(3);
+    tensors->resize(3);
+    for (int h = 0; h < 3; ++h) {
+        NpuTensor &t = (*tensors)[h];
+        t.gridH = kModelSize / kStrides[h];
+        t.gridW = t.gridH;
+        t.channels = 3 * props;
+        t.cellStride = t.channels + (h == 1 ? 1 : 0); // 中间的头按原生布局多一个填充通道
+        t.zp = kZps[h];
+        t.scale = kScales[h];
+        std::vector<int8_t> &data = (*heads)[h];
+        data.resize((size_t)t.gridH * t.gridW * t.cellStride);
+        for (size_t i = 0; i < data.size(); ++i) data[i] = (int8_t)Rand(-128, -96);
+        t.data = data.data();
+    }
+
+    int objects = Rand(5, 30);
+    for (int o = 0; o < objects; ++o) {
+        int h = Rand(0, 2);
+        NpuTensor &t = (*tensors)[h];
+        int8_t *data = (*heads)[h].data();
+        int cx = Rand(1, t.gridW - 2);
+        int cy = Rand(1, t.gridH - 2);
+        int cls = Rand(0, kYoloClasses - 1);
+        float conf = Rand(30, 98) / 100.0f;
+        int sw = Rand(35, 65);
+        int sh = Rand(35, 65);
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                int8_t *cell = data + ((size_t)(cy + dy) * t.gridW + cx + dx) * t.cellStride;
+                for (int a = 0; a < 3; ++a) {
+                    int8_t *p = cell + a * props;
+                    float obj = conf - 0.1f * (abs(dx) + abs(dy)) - 0.2f * a; // 主要由第一个 anchor 响应
+                    p[0] = Quantize(0.5f - 0.25f * dx + Rand(-5, 5) / 100.0f, t.zp, t.scale);
+                    p[1] = Quantize(0.5f - 0.25f * dy + Rand(-5, 5) / 100.0f, t.zp, t.scale);
+                    p[2] = Quantize((sw + Rand(-2, 2)) / 100.0f, t.zp, t.scale);
+                    p[3] = Quantize((sh + Rand(-2, 2)) / 100.0f, t.zp, t.scale);
+                    p[4] = Quantize(obj > 0.0f ? obj : 0.0f, t.zp, t.scale);
+                    p[5 + cls] = Quantize(Rand(60, 95) / 100.0f, t.zp, t.scale);
+                    // 偶尔让另一类与之同分，检验取第一个最大值
+                    if (Rand(0, 7) == 0) p[5 + (cls + 7) % kYoloClasses] = p[5 + cls];
+                }
+            }
+        }
+        // 复制出一个完全相同的格点：同分候选须保持扫描顺序
+        if (Rand(0, 3) == 0 && cx + 2 < t.gridW) {
+            int8_t *src = data + ((size_t)cy * t.gridW + cx) * t.cellStride;
+            memcpy(src + 2 * t.cellStride, src, t.cellStride);
+        }
+    }
+}
+
+static bool SameResult(const DetectList &a, const DetectList &b) {
+    if (a.count != b.count) return false;
+    for (int i = 0; i < a.count; ++i) {
+        const DetectBox &x = a.boxes[i];
+        const DetectBox &y = b.boxes[i];
+        if (x.left != y.left || x.top != y.top || x.right != y.right || x.bottom != y.bottom || x.clsId != y.clsId ||
+            memcmp(&x.prop, &y.prop, sizeof(float)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<NpuTensorRecording> recordings(1);
+    if (argc > 1) {
+        recordings.resize(argc - 1);
+        for (int i = 1; i < argc; ++i) {
+            if (!LoadNpuTensors(argv[i], &recordings[i - 1])) {
+                printf("cannot load %s\n", argv[i]);
+                return -1;
+            }
+        }
+    } else {
+        remove(kSynthPath);
+        for (int f = 0; f < kSynthFrames; ++f) {
+            std::vector<std::vector<int8_t> > heads;
+            std::vector<NpuTensor> tensors;
+            SynthesizeFrame(&heads, &tensors);
+            if (!AppendNpuTensors(kSynthPath, tensors.data(), (int)tensors.size())) return -1;
+        }
+        if (!LoadNpuTensors(kSynthPath, &recordings[0])) return -1;
+    }
+
+    static const float kConfs[3] = {0.25f, 0.45f, 0.7f};
+    YoloV5Decoder decoder;
+    DetectList ref;
+    DetectList fast;
+    uint64_t frames = 0;
+    uint64_t mismatches = 0;
+    uint64_t boxes = 0;
+    uint64_t passed = 0;
+    uint64_t refUs = 0;
+    uint64_t fastUs = 0;
+    for (size_t r = 0; r < recordings.size(); ++r) {
+        for (size_t f = 0; f < recordings[r].frames.size(); ++f) {
+            const std::vector<NpuTensor> &outs = recordings[r].frames[f];
+            int n = (int)outs.size();
+            for (int c = 0; c < 3; ++c) {
+                DecodeYoloV5(outs.data(), n, kModelSize, kModelSize, kConfs[c], 0.45f, &ref);
+                decoder.Decode(outs.data(), n, kModelSize, kModelSize, kConfs[c], 0.45f, &fast);
+                if (!SameResult(ref, fast)) {
+                    mismatches++;
+                    printf("[BENCH] mismatch: file %zu frame %zu conf %.2f: ref %d boxes, fast %d boxes\n", r, f,
+                           kConfs[c], ref.count, fast.count);
+                }
+            }
+
+            uint64_t t0 = GetUs();
+            for (int k = 0; k < kRepeat; ++k) DecodeYoloV5(outs.data(), n, kModelSize, kModelSize, 0.25f, 0.45f, &ref);
+            uint64_t t1 = GetUs();
+            for (int k = 0; k < kRepeat; ++k) {
+                decoder.Decode(outs.data(), n, kModelSize, kModelSize, 0.25f, 0.45f, &fast);
+            }
+            uint64_t t2 = GetUs();
+            refUs += t1 - t0;
+            fastUs += t2 - t1;
+            boxes += fast.count;
+            passed += decoder.LastPassed();
+            frames++;
+        }
+    }
+    if (frames == 0) return -1;
+    printf("[BENCH] postprocess %llu frames (%s), conf 0.25/0.45/0.70, nms 0.45\n", (unsigned long long)frames,
+           argc > 1 ? "recorded" : "synthetic");
+    printf("[BENCH]   reference %.1fus/frame  fast %.1fus/frame  speedup %.1fx  passed anchors %.1f/frame  "
+           "boxes %.1f/frame\n",
+           refUs / (double)(frames * kRepeat), fastUs / (double)(frames * kRepeat),
+           fastUs ? (double)refUs / fastUs : 0.0, passed / (double)frames, boxes / (double)frames);
+    printf("[BENCH]   bit-exact: %s (%llu mismatches)\n", mismatches ? "NO" : "yes", (unsigned long long)mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+// PreEventBuffer 事前录像基准：追加与导出速率、内存预算下的可回看时长
+// 用法：bench_preevent [秒数，默认 5] [每路码率 kbps，默认 1000] [--pre-event=<预算KB>[,<事前ms>[,<事后ms>[,<目录>]]]，放在最后]
+// - 16 路合成码流（I 帧为平均帧长 4 倍，各路错开，I 帧为 SPS/PPS/slice 三个 pack）按 PTS 30fps 不限速追加，
+//   得到单线程追加速率；预算装满后的可回看时长即给定码率下的事前录像长度
+// - 追加的同时另一线程反复导出全部 tile 的事前窗口，统计导出速率与导出期间追加耗时的分布（回收线程被拖住多久）；
+//   单核机器上 max 含线程切换，p99 更能说明持锁拷贝的影响
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "utils/pre_event_buffer.h"
+#include "bench_stream.h"
+
+static const int kTiles = 16;
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+int main(int argc, char *argv[]) {
+    PreEventBuffer::Options options;
+    options.dir = "/tmp/zwh-clips-bench";
+    options.enabled = true;
+    while (argc > 1 && strncmp(argv[argc - 1], "--", 2) == 0) {
+        const char *opt = argv[--argc];
+        if (strncmp(opt, "--pre-event=", 12) != 0 || !PreEventBuffer::ParseOption(opt + 12, &options)) {
+            printf("bad option \"%s\"\n", opt);
+            return -1;
+        }
+    }
+    int seconds = argc > 1 ? atoi(argv[1]) : 5;
+    int kbps = argc > 2 ? atoi(argv[2]) : 1000;
+    if (seconds <= 0 || kbps <= 0) return -1;
+    SyntheticStream stream(kbps);
+
+    PreEventBuffer buffer;
+    if (!buffer.Start(options, kTiles)) return -1;
+    printf("[BENCH] pre-event budget=%dKB window=%dms+%dms %d tiles x %dkbps, %ds\n", options.budgetKB,
+           options.preMs, options.postMs, kTiles, kbps, seconds);
+
+    // 只追加：单线程速率
+    StreamFrame frame;
+    uint64_t f = 0;
+    uint64_t appended = 0;
+    uint64_t startUs = GetUs();
+    uint64_t endUs = startUs + (uint64_t)seconds * 1000000ULL / 2;
+    while (GetUs() < endUs) {
+        for (int i = 0; i < 100; ++i, ++f) {
+            for (int t = 0; t < kTiles; ++t) {
+                stream.Make(t, f, &frame);
+                buffer.Append(t, frame);
+                appended += frame.bytes;
+            }
+        }
+    }
+    uint64_t elapsedUs = GetUs() - startUs;
+    printf("[BENCH]   append    %.0f frames/s %.1fMB/s\n", f * kTiles * 1e6 / elapsedUs, appended / (double)elapsedUs);
+    buffer.PrintBudget();
+
+    // 追加同时导出：导出线程反复导出全部 tile 最近 preMs 的码流
+    std::atomic<bool> done(false);
+    std::atomic<uint64_t> latestPts(0);
+    uint64_t clips = 0;
+    uint64_t exportUs = 0;
+    std::thread exporter([&]() {
+        while (!done.load()) {
+            uint64_t pts = latestPts.load();
+            uint64_t t0 = GetUs();
+            buffer.ExportClip(~(TileMask)0, pts - options.preMs * 1000ULL, pts, "bench");
+            exportUs += GetUs() - t0;
+            clips++;
+        }
+    });
+    std::vector<uint32_t> appendUs;
+    appendUs.reserve(1 << 20);
+    uint64_t exportedBefore = buffer.GetStats().exportedBytes;
+    startUs = GetUs();
+    endUs = startUs + (uint64_t)seconds * 1000000ULL / 2;
+    while (GetUs() < endUs) {
+        for (int t = 0; t < kTiles; ++t, f += t == kTiles - 1) {
+            stream.Make(t, f, &frame);
+            uint64_t t0 = GetUs();
+            buffer.Append(t, frame);
+            if (appendUs.size() < appendUs.capacity()) appendUs.push_back((uint32_t)(GetUs() - t0));
+        }
+        latestPts.store(frame.pts);
+    }
+    done = true;
+    exporter.join();
+    elapsedUs = GetUs() - startUs;
+    PreEventBuffer::Stats stats = buffer.GetStats();
+    std::sort(appendUs.begin(), appendUs.end());
+    printf("[BENCH]   export    %llu clips (%d files each) %.1fMB/s avg %lluus/clip\n", (unsigned long long)clips,
+           kTiles, (stats.exportedBytes - exportedBefore) / (double)elapsedUs,
+           (unsigned long long)(clips ? exportUs / clips : 0));
+    printf("[BENCH]   append us during export p50=%u p99=%u p99.9=%u max=%u\n", appendUs[appendUs.size() / 2],
+           appendUs[appendUs.size() * 99 / 100], appendUs[appendUs.size() * 999 / 1000], appendUs.back());
+    printf("[BENCH]   totals    frames=%llu evicted gops=%llu skipped=%llu\n", (unsigned long long)stats.frames,
+           (unsigned long long)stats.evictedGops, (unsigned long long)stats.skipped);
+    buffer.Stop();
+    return clips > 0 ? 0 : 1;
+}
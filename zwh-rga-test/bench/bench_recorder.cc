@@ -0,0 +1,116 @@
+// TileRecorder 分段录制基准：16 路并发码流的持续写盘吞吐
+// 用法：bench_recorder [秒数，默认 10] [每路码率 kbps，默认 2000] [--record=<总MB>[,<段MB>[,<目录>]]，放在最后]
+// - 实时：16 路按 30fps 送帧（I 帧为平均帧长 4 倍，各路 I 帧错开），看 Submit 耗时与丢帧，确认不阻塞调用线程
+// - 饱和：同样的帧不限速送入，暂存区满即丢帧，写盘线程的实际写出量即持续写盘吞吐
+// - 定位：按实时阶段中间的 PTS 查某一路之前最近的关键帧，读回记录头校验
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "utils/tile_recorder.h"
+#include "bench_stream.h"
+
+static const int kTiles = 16;
+static const int kFps = SyntheticStream::kFps;
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+static void PrintStats(const char *name, const TileRecorder::Stats &s, uint64_t elapsedUs, uint64_t offeredBytes) {
+    printf("[BENCH]   %-9s offered=%.1fMB/s written=%.1fMB/s frames=%llu drops=%llu skipped=%llu segments=%llu "
+           "max write=%lluus\n",
+           name, offeredBytes / (double)elapsedUs, s.bytesWritten / (double)elapsedUs, (unsigned long long)s.frames,
+           (unsigned long long)s.drops, (unsigned long long)s.skipped, (unsigned long long)s.segments,
+           (unsigned long long)s.maxWriteUs);
+}
+
+int main(int argc, char *argv[]) {
+    TileRecorder::Options options;
+    options.dir = "/tmp/zwh-rec-bench";
+    while (argc > 1 && strncmp(argv[argc - 1], "--", 2) == 0) {
+        const char *opt = argv[--argc];
+        if (strncmp(opt, "--record=", 9) != 0 || !TileRecorder::ParseOption(opt + 9, &options)) {
+            printf("bad option \"%s\"\n", opt);
+            return -1;
+        }
+    }
+    int seconds = argc > 1 ? atoi(argv[1]) : 10;
+    int kbps = argc > 2 ? atoi(argv[2]) : 2000;
+    if (seconds <= 0 || kbps <= 0) return -1;
+    SyntheticStream stream(kbps);
+
+    printf("[BENCH] recorder dir=%s %dMB in %dMB segments, %d tiles x %dkbps, %ds per phase\n", options.dir.c_str(),
+           options.totalMB, options.segmentMB, kTiles, kbps, seconds);
+    StreamFrame frame;
+
+    // 实时：按帧率送帧，统计 Submit 耗时分布
+    TileRecorder recorder;
+    if (!recorder.Start(options, kTiles)) return -1;
+    std::vector<uint32_t> submitUs;
+    submitUs.reserve((size_t)seconds * kFps * kTiles);
+    uint64_t offered = 0;
+    uint64_t frames = (uint64_t)seconds * kFps;
+    uint64_t startUs = GetUs();
+    for (uint64_t f = 0; f < frames; ++f) {
+        uint64_t dueUs = startUs + f * 1000000ULL / kFps;
+        uint64_t nowUs = GetUs();
+        if (dueUs > nowUs) usleep((useconds_t)(dueUs - nowUs));
+        for (int t = 0; t < kTiles; ++t) {
+            stream.Make(t, f, &frame);
+            uint64_t t0 = GetUs();
+            recorder.Submit(t, frame);
+            submitUs.push_back((uint32_t)(GetUs() - t0));
+            offered += frame.bytes;
+        }
+    }
+    recorder.Stop();
+    uint64_t elapsedUs = GetUs() - startUs;
+    std::sort(submitUs.begin(), submitUs.end());
+    PrintStats("realtime", recorder.GetStats(), elapsedUs, offered);
+    printf("[BENCH]   submit us p50=%u p99=%u max=%u\n", submitUs[submitUs.size() / 2],
+           submitUs[submitUs.size() * 99 / 100], submitUs.back());
+
+    // 定位：实时阶段中间时刻之前 tile 7 最近的关键帧
+    uint64_t seekPts = frames / 2 * 1000000ULL / kFps;
+    TileRecorder::SeekResult seek;
+    uint64_t t0 = GetUs();
+    bool found = TileRecorder::FindKeyframe(options.dir, 7, seekPts, &seek);
+    uint64_t seekUs = GetUs() - t0;
+    bool valid = false;
+    if (found) {
+        FILE *fp = fopen(seek.path.c_str(), "rb");
+        TileRecorder::RecordHeader rec;
+        valid = fp && fseek(fp, seek.offset, SEEK_SET) == 0 && fread(&rec, sizeof(rec), 1, fp) == 1 &&
+                rec.magic == TileRecorder::kRecordMagic && rec.tileId == 7 &&
+                (rec.flags & TileRecorder::kRecordKeyframe) && rec.pts == seek.pts;
+        if (fp) fclose(fp);
+    }
+    printf("[BENCH]   seek tile 7 @%llums: %s pts=%llums %s (%lluus)\n", (unsigned long long)(seekPts / 1000),
+           found ? seek.path.c_str() : "not found", (unsigned long long)(seek.pts / 1000),
+           valid ? "record ok" : "record BAD", (unsigned long long)seekUs);
+
+    // 饱和：不限速送帧，看写盘线程能持续写出多少
+    TileRecorder saturated;
+    if (!saturated.Start(options, kTiles)) return -1;
+    offered = 0;
+    startUs = GetUs();
+    uint64_t endUs = startUs + (uint64_t)seconds * 1000000ULL;
+    for (uint64_t f = frames; GetUs() < endUs; ++f) {
+        for (int t = 0; t < kTiles; ++t) {
+            stream.Make(t, f, &frame);
+            saturated.Submit(t, frame);
+            offered += frame.bytes;
+        }
+    }
+    saturated.Stop();
+    elapsedUs = GetUs() - startUs;
+    PrintStats("saturate", saturated.GetStats(), elapsedUs, offered);
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+// RgaBufferRegistry 登记逻辑基准（主机构建，导入/归还换成计数的假 handle）
+// 用法：bench_rga_registry [帧数，默认 3000]
+// - 模拟采集循环：VI 池 4 块轮转，每帧为全部 tile 从子画面池取块、登记、归还；
+//   检查每块只导入一次、其余全部命中，同一块前后拿到的 handle 不变，不同块的 handle 不重复
+// - 按持有者销毁池的顺序 ReleasePool：只归还该池的 handle，另一个池不受影响，再次取块会重新导入
+// - 关闭后 Acquire 返回 0 且不登记；达到上限时只按最久未用归还闲置的 handle，最近用过的保留
+// - 计时：命中时单次 Acquire 的耗时（含互斥锁与查表），对比每个 tile 都要做的 Handle2Fd + 导入
+//   的板端开销需在板上用 ZWH_RGA_IMPORT=0 对比 [SLICE] 的 crop 耗时
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "hal/host_mpi_hal.h"
+#include "utils/config.h"
+#include "utils/rga_buffer_registry.h"
+#include "bench_util.h"
+
+static const int kViBlocks = 4;
+
+static uint64_t GetNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 假的 librga：按调用顺序发 handle，记下仍未归还的
+struct FakeRga {
+    uint32_t next = 1;
+    uint64_t imports = 0;
+    uint64_t releases = 0;
+    uint64_t badReleases = 0; // 归还了不存在或已归还的 handle
+    std::set<uint32_t> live;
+};
+
+int main(int argc, char *argv[]) {
+    int frames = argc > 1 ? atoi(argv[1]) : 3000;
+    if (frames <= 0) return -1;
+
+    HostMpiHal hal;
+    SetMpiHal(&hal);
+    FakeRga fake;
+    RgaBufferRegistry &registry = GetRgaBufferRegistry();
+    registry.SetEnabled(true);
+    registry.SetImporter(
+        [&fake](int fd, uint64_t size) -> uint32_t {
+            (void)fd;
+            if (size == 0) return 0;
+            fake.imports++;
+            fake.live.insert(fake.next);
+            return fake.next++;
+        },
+        [&fake](uint32_t handle) {
+            fake.releases++;
+            if (fake.live.erase(handle) == 0) fake.badReleases++;
+        });
+
+    const uint64_t viBytes = SRC_WIDTH * SRC_HEIGHT * 3 / 2;
+    const uint64_t subBytes = SUB_WIDTH * SUB_HEIGHT * 3 / 2;
+    MB_POOL viPool = CreatePool(viBytes, kViBlocks);
+    MB_POOL subPool = CreatePool(subBytes, TOTAL_CHNS * 2);
+    if (viPool == MB_INVALID_POOLID || subPool == MB_INVALID_POOLID) return -1;
+
+    // 采集循环：VI 块轮转占用，子画面块取了就还（池内块的取用顺序由池决定）
+    std::map<MB_BLK, uint32_t> seen;
+    std::set<uint32_t> handles;
+    bool stable = true;
+    bool unique = true;
+    uint64_t acquires = 0;
+    uint64_t hitNs = 0;
+    uint64_t hitCnt = 0;
+    MB_BLK viHeld[kViBlocks] = {0};
+    MB_BLK dst[MAX_TILES];
+    for (int f = 0; f < frames; ++f) {
+        int slot = f % kViBlocks;
+        if (viHeld[slot]) GetMpiHal()->MbReleaseMB(viHeld[slot]);
+        viHeld[slot] = GetMpiHal()->MbGetMB(viPool, viBytes, RK_TRUE);
+        int blocks = 0;
+        MB_BLK blks[MAX_TILES + 1];
+        blks[blocks++] = viHeld[slot];
+        for (int t = 0; t < TOTAL_CHNS; ++t) {
+            dst[t] = GetMpiHal()->MbGetMB(subPool, subBytes, RK_TRUE);
+            blks[blocks++] = dst[t];
+        }
+        for (int i = 0; i < blocks; ++i) {
+            bool known = seen.count(blks[i]) != 0;
+            uint64_t t0 = GetNs();
+            uint32_t handle = registry.Acquire(blks[i], i == 0 ? viBytes : subBytes);
+            uint64_t t1 = GetNs();
+            acquires++;
+            if (known) {
+                hitNs += t1 - t0;
+                hitCnt++;
+                if (seen[blks[i]] != handle) stable = false;
+            } else {
+                if (!handles.insert(handle).second) unique = false;
+                seen[blks[i]] = handle;
+            }
+        }
+        for (int t = 0; t < TOTAL_CHNS; ++t) GetMpiHal()->MbReleaseMB(dst[t]);
+    }
+    for (int i = 0; i < kViBlocks; ++i) {
+        if (viHeld[i]) GetMpiHal()->MbReleaseMB(viHeld[i]);
+    }
+
+    RgaBufferRegistry::Stats s = registry.GetStats();
+    printf("[BENCH] rga registry: %d frames, %d tiles, %llu acquires over %zu blocks\n", frames, TOTAL_CHNS,
+           (unsigned long long)acquires, seen.size());
+    printf("[BENCH]   imports=%llu hits=%llu  hit cost %.0fns/acquire\n", (unsigned long long)s.imports,
+           (unsigned long long)s.hits, hitCnt ? (double)hitNs / hitCnt : 0.0);
+    bool ok = true;
+    ok = Check(s.imports == seen.size() && fake.imports == seen.size(), "each block imported exactly once") && ok;
+    ok = Check(s.hits == acquires - seen.size(), "every other acquire is a cache hit") && ok;
+    ok = Check(stable && unique, "handles stable per block and distinct across blocks") && ok;
+
+    // 子画面池先销毁：只归还它的 handle
+    size_t subBlocks = 0;
+    for (auto &kv : seen) {
+        if (GetMpiHal()->MbHandle2PoolId(kv.first) == subPool) subBlocks++;
+    }
+    uint64_t before = fake.live.size();
+    registry.ReleasePool(subPool);
+    ok = Check(fake.live.size() == before - subBlocks && registry.GetStats().entries == before - subBlocks,
+               "ReleasePool releases only that pool's handles") && ok;
+    GetMpiHal()->MbDestroyPool(subPool);
+
+    // 同一 VI 块仍命中；换一个新池的块重新导入
+    MB_BLK vi = GetMpiHal()->MbGetMB(viPool, viBytes, RK_TRUE);
+    uint64_t importsBefore = fake.imports;
+    ok = Check(registry.Acquire(vi, viBytes) == seen[vi] && fake.imports == importsBefore,
+               "surviving pool keeps its handles") && ok;
+    MB_POOL subPool2 = CreatePool(subBytes, 1);
+    MB_BLK sub = GetMpiHal()->MbGetMB(subPool2, subBytes, RK_TRUE);
+    uint32_t fresh = registry.Acquire(sub, subBytes);
+    ok = Check(fresh != 0 && fake.imports == importsBefore + 1 && handles.count(fresh) == 0,
+               "block of a new pool gets a fresh import") && ok;
+    GetMpiHal()->MbReleaseMB(sub);
+    registry.ReleasePool(subPool2);
+    GetMpiHal()->MbDestroyPool(subPool2);
+
+    // 关闭后不登记
+    registry.SetEnabled(false);
+    uint64_t entriesOff = registry.GetStats().entries;
+    ok = Check(registry.Acquire(vi, viBytes) == 0 && entriesOff == 0 && fake.live.empty(),
+               "disabled: returns 0, earlier handles released") && ok;
+    registry.SetEnabled(true);
+    GetMpiHal()->MbReleaseMB(vi);
+
+    // 达到上限：最近用过的 handle 不归还（可能还在异步 job 里），闲置超过 kEvictIdleUs 后按最久未用归还
+    MB_POOL bigPool = CreatePool(64, (int)RgaBufferRegistry::kMaxEntries + 2);
+    std::vector<MB_BLK> bigBlks;
+    std::vector<uint32_t> bigHandles;
+    for (size_t i = 0; i <= RgaBufferRegistry::kMaxEntries; ++i) {
+        MB_BLK blk = GetMpiHal()->MbGetMB(bigPool, 64, RK_TRUE);
+        bigBlks.push_back(blk);
+        bigHandles.push_back(registry.Acquire(blk, 64));
+    }
+    s = registry.GetStats();
+    ok = Check(s.evictions == 0 && s.overflows == 1 && s.entries == RgaBufferRegistry::kMaxEntries + 1 &&
+                   fake.live.size() == s.entries,
+               "over kMaxEntries while all in use: nothing released") && ok;
+    usleep(RgaBufferRegistry::kEvictIdleUs + 100000);
+    registry.Acquire(bigBlks[1], 64); // 刚用过，不能被归还
+    bigBlks.push_back(GetMpiHal()->MbGetMB(bigPool, 64, RK_TRUE));
+    registry.Acquire(bigBlks.back(), 64);
+    s = registry.GetStats();
+    ok = Check(s.evictions == 2 && s.entries == RgaBufferRegistry::kMaxEntries && fake.live.count(bigHandles[0]) == 0 &&
+                   fake.live.count(bigHandles[1]) == 1 && fake.live.count(bigHandles[2]) == 0,
+               "idle handles evicted least recently used first") && ok;
+    for (size_t i = 0; i < bigBlks.size(); ++i) GetMpiHal()->MbReleaseMB(bigBlks[i]);
+    registry.ReleasePool(bigPool);
+    GetMpiHal()->MbDestroyPool(bigPool);
+
+    registry.ReleaseAll();
+    ok = Check(fake.live.empty() && fake.badReleases == 0 && fake.releases == fake.imports,
+               "all handles released exactly once") && ok;
+    registry.PrintStats();
+    GetMpiHal()->MbDestroyPool(viPool);
+    registry.SetImporter(RgaBufferRegistry::ImportFn(), RgaBufferRegistry::ReleaseFn());
+    return ok ? 0 : 1;
+}
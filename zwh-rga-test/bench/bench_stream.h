@@ -0,0 +1,49 @@
+#pragma once
+
+// 写盘 / 事前录像基准共用的合成码流
+// - 每路 GOP 为 kGop 帧，各路 I 帧按 tile 错开；I 帧为平均帧长 4 倍，分 SPS/PPS/slice 三个 pack，P 帧一个 pack
+// - 所有帧都指向同一块只读伪随机数据的不同偏移，生成本身不拷贝、不分配
+// - PTS 按 kFps 从一帧间隔起算（不出现 0）
+#include <stdint.h>
+#include <vector>
+
+#include "utils/venc_drain.h"
+
+class SyntheticStream {
+public:
+    static const int kFps = 30;
+    static const int kGop = 15;
+
+    explicit SyntheticStream(int kbps) : avgBytes_((uint32_t)kbps * 1000 / 8 / kFps), payload_(4096 + avgBytes_ * 4) {
+        for (size_t i = 0; i < payload_.size(); ++i) payload_[i] = (uint8_t)(i * 2654435761u >> 24);
+    }
+
+    uint32_t AvgBytes() const { return avgBytes_; }
+
+    // 第 frame 帧第 tile 路的码流；out 中的 pack 指向本对象的数据，对象存在期间有效
+    void Make(int tile, uint64_t frame, StreamFrame *out) const {
+        bool keyframe = (frame + tile) % kGop == 0;
+        uint32_t bytes = keyframe ? avgBytes_ * 4 : avgBytes_ * 4 / 5;
+        uint8_t *base = const_cast<uint8_t *>(payload_.data()) + (frame * 131 + tile * 17) % 4096;
+        out->keyframe = keyframe;
+        out->pts = (frame + 1) * 1000000ULL / kFps;
+        out->bytes = bytes;
+        if (keyframe) {
+            out->packCount = 3;
+            out->iov[0].iov_base = base;
+            out->iov[0].iov_len = 16;
+            out->iov[1].iov_base = base + 16;
+            out->iov[1].iov_len = 8;
+            out->iov[2].iov_base = base + 24;
+            out->iov[2].iov_len = bytes - 24;
+        } else {
+            out->packCount = 1;
+            out->iov[0].iov_base = base;
+            out->iov[0].iov_len = bytes;
+        }
+    }
+
+private:
+    uint32_t avgBytes_;
+    std::vector<uint8_t> payload_;
+};
@@ -0,0 +1,127 @@
+// TileSender/TileReceiver 回环吞吐与时延基准
+// 用法：bench_tile_transport [udp|tcp] [帧数，默认 600] [单 tile 字节数，默认 2048] [帧率，默认 30，0 表示不限速]
+// - 发送线程按帧率发出 16 个 tile，pts 写入发送时刻，接收端据此统计 tile 时延
+// - 每个 tile 负载按 (frameSeq, tileId) 生成，接收端逐字节校验
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "utils/config.h"
+#include "transport/tile_receiver.h"
+#include "transport/tile_sender.h"
+
+static const uint16_t kBenchPort = 19000;
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+static uint8_t PatternByte(uint16_t frameSeq, int tileId, size_t i) {
+    return (uint8_t)(frameSeq * 31 + tileId * 7 + i);
+}
+
+int main(int argc, char *argv[]) {
+    TileTransport transport = (argc > 1 && strcmp(argv[1], "tcp") == 0) ? TILE_TRANSPORT_TCP : TILE_TRANSPORT_UDP;
+    int frames = argc > 2 ? atoi(argv[2]) : 600;
+    size_t tileBytes = argc > 3 ? (size_t)atoi(argv[3]) : 2048;
+    int fps = argc > 4 ? atoi(argv[4]) : 30;
+    if (frames <= 0) frames = 600;
+
+    TileReceiver receiver;
+    if (!receiver.Open(kBenchPort, transport, tileBytes)) return -1;
+
+    std::vector<uint32_t> latencies;
+    latencies.reserve(frames * TOTAL_CHNS);
+    uint64_t corrupt = 0;
+    uint64_t completeFrames = 0;
+    uint64_t rxBytes = 0;
+    receiver.SetCallbacks(
+        [&](const TileInfo &info, const uint8_t *data) {
+            latencies.push_back((uint32_t)(GetUs() - info.pts));
+            rxBytes += info.size;
+            for (size_t i = 0; i < info.size; ++i) {
+                if (data[i] != PatternByte(info.frameSeq, info.tileId, i)) {
+                    corrupt++;
+                    break;
+                }
+            }
+        },
+        [&](uint16_t, TileMask tileMask, TileMask receivedMask) {
+            if ((receivedMask & tileMask) == tileMask) completeFrames++;
+        });
+
+    std::atomic<bool> senderDone(false);
+    uint64_t syscalls = 0;
+    uint64_t packets = 0;
+    uint64_t sendErrors = 0;
+    uint64_t startUs = GetUs();
+    std::thread sender([&]() {
+        TileSender tx;
+        if (transport == TILE_TRANSPORT_TCP) usleep(50 * 1000); // 等接收端进入 Poll 再连接
+        if (!tx.Open("127.0.0.1", kBenchPort, transport)) {
+            senderDone = true;
+            return;
+        }
+        std::vector<uint8_t> payload(tileBytes);
+        for (int f = 1; f <= frames; ++f) {
+            uint64_t frameStartUs = GetUs();
+            for (int tileId = 0; tileId < TOTAL_CHNS; ++tileId) {
+                for (size_t i = 0; i < tileBytes; ++i) payload[i] = PatternByte((uint16_t)f, tileId, i);
+                TileInfo info;
+                info.tileId = tileId;
+                info.frameSeq = (uint16_t)f;
+                info.tileMask = GetGridConfig().AllTilesMask();
+                info.pts = GetUs();
+                info.size = (uint32_t)tileBytes;
+                tx.QueueTile(info, payload.data());
+            }
+            tx.Flush();
+            if (fps > 0) {
+                uint64_t spent = GetUs() - frameStartUs;
+                uint64_t period = 1000000ULL / fps;
+                if (spent < period) usleep(period - spent);
+            }
+        }
+        syscalls = tx.Syscalls();
+        packets = tx.PacketsSent();
+        sendErrors = tx.SendErrors();
+        tx.Close();
+        senderDone = true;
+    });
+
+    // 发送结束后再多收 200ms 尾包
+    uint64_t idleSinceUs = 0;
+    while (true) {
+        receiver.Poll(10);
+        if (senderDone) {
+            if (!idleSinceUs) idleSinceUs = GetUs();
+            if (GetUs() - idleSinceUs > 200000) break;
+        }
+    }
+    sender.join();
+    double secs = (GetUs() - startUs) / 1e6;
+
+    std::sort(latencies.begin(), latencies.end());
+    uint32_t p50 = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+    uint32_t p99 = latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100];
+    printf("[BENCH] tile_transport %s frames=%d tile=%zuB fps=%d\n",
+           transport == TILE_TRANSPORT_TCP ? "tcp" : "udp", frames, tileBytes, fps);
+    printf("[BENCH]   tx packets=%llu syscalls=%llu (%.2f/frame) errors=%llu\n",
+           (unsigned long long)packets, (unsigned long long)syscalls,
+           frames ? (double)syscalls / frames : 0.0, (unsigned long long)sendErrors);
+    printf("[BENCH]   rx tiles=%llu/%d frames=%llu dropped=%llu corrupt=%llu\n",
+           (unsigned long long)receiver.TilesCompleted(), frames * TOTAL_CHNS,
+           (unsigned long long)completeFrames,
+           (unsigned long long)receiver.TilesDropped(), (unsigned long long)corrupt);
+    printf("[BENCH]   throughput=%.2f MB/s latency p50=%uus p99=%uus\n",
+           rxBytes / secs / (1024.0 * 1024.0), p50, p99);
+    return corrupt == 0 ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// 各基准程序共用的小工具：检查项输出与 MPI 内存池
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal/mpi_hal.h"
+
+// 打印一行检查结果，返回 cond 便于 ok = Check(...) && ok 串联
+static inline bool Check(bool cond, const char *what) {
+    printf("[BENCH]   %-66s %s\n", what, cond ? "ok" : "FAILED");
+    return cond;
+}
+
+// 经当前 MpiHal 建 count 块、每块 size 字节的 DMA 内存池
+static inline MB_POOL CreatePool(uint64_t size, int count) {
+    MB_POOL_CONFIG_S cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.u64MBSize = size;
+    cfg.u32MBCnt = count;
+    cfg.enAllocType = MB_ALLOC_TYPE_DMA;
+    return GetMpiHal()->MbCreatePool(&cfg);
+}
@@ -0,0 +1,89 @@
+#include "dma_heap.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "dma_alloc.h"
+
+DeviceDmaHeap::~DeviceDmaHeap() {
+    if (heapFd_ >= 0) close(heapFd_);
+}
+
+bool DeviceDmaHeap::Open() {
+    if (heapFd_ >= 0) return true;
+    if (access(path_.c_str(), F_OK) != 0) return false;
+    heapFd_ = dma_heap_open(path_.c_str());
+    return heapFd_ >= 0;
+}
+
+bool DeviceDmaHeap::Alloc(size_t size, int *fd, void **vir) {
+    if (heapFd_ < 0) return false;
+    return dma_heap_buf_alloc(heapFd_, size, fd, vir) == 0;
+}
+
+void DeviceDmaHeap::Free(size_t size, int fd, void *vir) {
+    dma_buf_free(size, &fd, vir);
+}
+
+int DeviceDmaHeap::SyncForCpu(int fd) {
+    return cached_ ? dma_sync_device_to_cpu(fd) : 0;
+}
+
+int DeviceDmaHeap::SyncForDevice(int fd) {
+    return cached_ ? dma_sync_cpu_to_device(fd) : 0;
+}
+
+// 老版本 libc（板端 uclibc）没有 memfd_create 的封装，直接走系统调用
+static int MemfdCreate(const char *name) {
+#ifdef __NR_memfd_create
+    return (int)syscall(__NR_memfd_create, name, 1U /* MFD_CLOEXEC */);
+#else
+    (void)name;
+    return -1;
+#endif
+}
+
+bool MemfdDmaHeap::Alloc(size_t size, int *fd, void **vir) {
+    int memfd = MemfdCreate("zwh-dma-buf");
+    if (memfd < 0) {
+        printf("MemfdDmaHeap: memfd_create failed: %s\n", strerror(errno));
+        return false;
+    }
+    if (ftruncate(memfd, (off_t)size) != 0) {
+        printf("MemfdDmaHeap: ftruncate %zu failed: %s\n", size, strerror(errno));
+        close(memfd);
+        return false;
+    }
+    void *va = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (va == MAP_FAILED) {
+        printf("MemfdDmaHeap: mmap %zu failed: %s\n", size, strerror(errno));
+        close(memfd);
+        return false;
+    }
+    allocs_++;
+    *fd = memfd;
+    *vir = va;
+    return true;
+}
+
+void MemfdDmaHeap::Free(size_t size, int fd, void *vir) {
+    munmap(vir, size);
+    close(fd);
+}
+
+int MemfdDmaHeap::SyncForCpu(int fd) {
+    (void)fd;
+    if (cached_) syncs_++;
+    return 0;
+}
+
+int MemfdDmaHeap::SyncForDevice(int fd) {
+    (void)fd;
+    if (cached_) syncs_++;
+    return 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+// dma-buf 堆：板端为 /dev/dma_heap 或 /dev/rk_dma_heap 下的堆设备（建在 3rdparty 的 dma_alloc 之上），
+// 主机上用 memfd 代替，分配出的 fd 同样可 mmap、可在进程间传递
+// - 堆设备 fd 在 Open 时打开一次并保持，之后每次 Alloc 只有一次 ioctl + mmap
+// - Cached() 表示映射带 CPU cache：CPU 写完交给硬件、硬件写完交给 CPU 读之前都需要 Sync
+class DmaHeap {
+public:
+    virtual ~DmaHeap() {}
+
+    virtual const char *Name() const = 0;
+    virtual bool Cached() const = 0;
+
+    // 分配 size 字节并映射，成功返回 true
+    virtual bool Alloc(size_t size, int *fd, void **vir) = 0;
+    virtual void Free(size_t size, int fd, void *vir) = 0;
+
+    // 缓存维护：硬件写完后 CPU 读之前 / CPU 写完后硬件读之前
+    virtual int SyncForCpu(int fd) = 0;
+    virtual int SyncForDevice(int fd) = 0;
+};
+
+// 板端堆设备
+class DeviceDmaHeap : public DmaHeap {
+public:
+    DeviceDmaHeap(const char *path, bool cached) : path_(path), cached_(cached) {}
+    ~DeviceDmaHeap() override;
+
+    // 打开堆设备，不存在时返回 false
+    bool Open();
+
+    const char *Name() const override { return path_.c_str(); }
+    bool Cached() const override { return cached_; }
+    bool Alloc(size_t size, int *fd, void **vir) override;
+    void Free(size_t size, int fd, void *vir) override;
+    int SyncForCpu(int fd) override;
+    int SyncForDevice(int fd) override;
+
+private:
+    std::string path_;
+    bool cached_;
+    int heapFd_ = -1;
+};
+
+// 主机替身：memfd + ftruncate + mmap；cached 只决定 Cached() 的返回值，Sync 只计数，
+// 便于在主机上验证调用方的缓存维护次数
+class MemfdDmaHeap : public DmaHeap {
+public:
+    explicit MemfdDmaHeap(bool cached = true) : cached_(cached) {}
+
+    const char *Name() const override { return cached_ ? "memfd" : "memfd-uncached"; }
+    bool Cached() const override { return cached_; }
+    bool Alloc(size_t size, int *fd, void **vir) override;
+    void Free(size_t size, int fd, void *vir) override;
+    int SyncForCpu(int fd) override;
+    int SyncForDevice(int fd) override;
+
+    uint64_t Allocs() const { return allocs_; }
+    uint64_t Syncs() const { return syncs_; }
+
+private:
+    bool cached_;
+    std::atomic<uint64_t> allocs_{0};
+    std::atomic<uint64_t> syncs_{0};
+};
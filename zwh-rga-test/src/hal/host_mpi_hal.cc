@@ -0,0 +1,853 @@
+#include "host_mpi_hal.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+static const int kPatternFrames = 8;      // 预生成/预读取的源画面数
+static const int kStreamBufCount = 4;     // 每路编码输出缓冲数
+static const size_t kMaxEncodeJobs = 64;  // 编码输入队列上限，满时 SendFrame 阻塞
+static const uint32_t kIdrSizeFactor = 4; // I 帧相对 P 帧的大小倍数
+// IDR 前的参数集与真实编码器一样作为单独的 pack 输出（同一码流块内按偏移排列）
+static const uint32_t kSpsBytes = 16;
+static const uint32_t kPpsBytes = 8;
+static const uint32_t kSliceHeadBytes = 5; // 起始码 + NAL 头
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+HostMpiHal::HostMpiHal() {}
+
+HostMpiHal::HostMpiHal(const Options &options) : options_(options) {}
+
+HostMpiHal::~HostMpiHal() {
+    StopThreads();
+    for (auto &chn : vencChns_) {
+        if (chn.eventFd >= 0) close(chn.eventFd);
+        chn.eventFd = -1;
+    }
+}
+
+bool HostMpiHal::SysInit() {
+    if (running_) return true;
+    running_ = true;
+    encodeThread_ = std::thread(&HostMpiHal::EncodeLoop, this);
+    printf("HostMpiHal: emulated MPI ready (fps=%d, source=%s)\n", options_.fps,
+           options_.nv12File ? options_.nv12File : "pattern");
+    return true;
+}
+
+void HostMpiHal::SysExit() {
+    StopThreads();
+}
+
+void HostMpiHal::StopThreads() {
+    running_ = false;
+    viCv_.notify_all();
+    encodeCv_.notify_all();
+    streamCv_.notify_all();
+    if (viThread_.joinable()) viThread_.join();
+    if (encodeThread_.joinable()) encodeThread_.join();
+}
+
+uint64_t HostMpiHal::AvgStreamLatencyUs() const {
+    uint64_t cnt = latencyCnt_.load();
+    return cnt ? latencyTotalUs_.load() / cnt : 0;
+}
+
+// ---------------------------------------------------------------- MB
+
+HostMpiHal::HostPool *HostMpiHal::FindPool(MB_POOL pool) {
+    std::lock_guard<std::mutex> lk(poolMtx_);
+    auto it = pools_.find(pool);
+    return it == pools_.end() ? nullptr : it->second.get();
+}
+
+MB_POOL HostMpiHal::MbCreatePool(MB_POOL_CONFIG_S *cfg) {
+    if (!cfg || cfg->u64MBSize == 0 || cfg->u32MBCnt == 0) return MB_INVALID_POOLID;
+    std::unique_ptr<HostPool> pool(new HostPool());
+    pool->blockSize = cfg->u64MBSize;
+    for (RK_U32 i = 0; i < cfg->u32MBCnt; ++i) {
+        std::unique_ptr<HostBlock> blk(new HostBlock());
+        blk->owner = pool.get();
+        blk->size = cfg->u64MBSize;
+        blk->data.reset(new uint8_t[blk->size]);
+        pool->freeList.push_back(blk.get());
+        pool->blocks.push_back(std::move(blk));
+    }
+
+    std::lock_guard<std::mutex> lk(poolMtx_);
+    pool->id = nextPoolId_++;
+    MB_POOL id = pool->id;
+    pools_[id] = std::move(pool);
+    return id;
+}
+
+RK_S32 HostMpiHal::MbDestroyPool(MB_POOL pool) {
+    std::lock_guard<std::mutex> lk(poolMtx_);
+    auto it = pools_.find(pool);
+    if (it == pools_.end()) return RK_ERR_MB_UNEXIST;
+    HostPool *p = it->second.get();
+    {
+        std::lock_guard<std::mutex> plk(p->mtx);
+        if (p->freeList.size() != p->blocks.size()) {
+            printf("HostMpiHal: pool %u destroyed with %zu blocks in use\n", pool,
+                   p->blocks.size() - p->freeList.size());
+            return RK_FAILURE;
+        }
+    }
+    pools_.erase(it);
+    return RK_SUCCESS;
+}
+
+MB_BLK HostMpiHal::TakeBlock(HostPool *pool, bool block, int timeoutMs) {
+    std::unique_lock<std::mutex> lk(pool->mtx);
+    if (pool->freeList.empty()) {
+        if (!block) return MB_INVALID_HANDLE;
+        auto ready = [&] { return !pool->freeList.empty() || !running_; };
+        if (timeoutMs < 0) {
+            pool->cv.wait(lk, ready);
+        } else {
+            pool->cv.wait_for(lk, std::chrono::milliseconds(timeoutMs), ready);
+        }
+        if (pool->freeList.empty()) return MB_INVALID_HANDLE;
+    }
+    HostBlock *blk = pool->freeList.back();
+    pool->freeList.pop_back();
+    blk->refs = 1;
+    return blk;
+}
+
+MB_BLK HostMpiHal::MbGetMB(MB_POOL pool, RK_U64 size, RK_BOOL block) {
+    HostPool *p = FindPool(pool);
+    if (!p || size > p->blockSize) return MB_INVALID_HANDLE;
+    return TakeBlock(p, block == RK_TRUE, -1);
+}
+
+RK_S32 HostMpiHal::MbReleaseMB(MB_BLK blk) {
+    HostBlock *b = ToBlock(blk);
+    if (!b) return RK_ERR_MB_NULL_PTR;
+    if (b->refs.fetch_sub(1) == 1) {
+        HostPool *pool = b->owner;
+        std::lock_guard<std::mutex> lk(pool->mtx);
+        pool->freeList.push_back(b);
+        pool->cv.notify_one();
+    }
+    return RK_SUCCESS;
+}
+
+void *HostMpiHal::MbHandle2VirAddr(MB_BLK blk) {
+    HostBlock *b = ToBlock(blk);
+    return b ? b->data.get() : nullptr;
+}
+
+RK_S32 HostMpiHal::MbInquireUserCnt(MB_BLK blk) {
+    HostBlock *b = ToBlock(blk);
+    return b ? b->refs.load() : 0;
+}
+
+RK_S32 HostMpiHal::MbHandle2Fd(MB_BLK blk) {
+    (void)blk;
+    return -1; // 主机上没有 dma-buf，调用方回退到虚拟地址
+}
+
+MB_POOL HostMpiHal::MbHandle2PoolId(MB_BLK blk) {
+    HostBlock *b = ToBlock(blk);
+    return b ? b->owner->id : MB_INVALID_POOLID;
+}
+
+RK_S32 HostMpiHal::SysMmzFlushCache(MB_BLK blk, RK_BOOL readOnly) {
+    (void)readOnly;
+    HostBlock *b = ToBlock(blk);
+    cacheFlushes_++; // 主机内存一致，只计数
+    cacheFlushBytes_ += b ? b->size : 0;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::SysMmzFlushCacheRange(MB_BLK blk, RK_U32 offset, RK_U32 length, RK_BOOL readOnly) {
+    (void)readOnly;
+    HostBlock *b = ToBlock(blk);
+    if (!b || (size_t)offset + length > b->size) return RK_ERR_MB_ILLEGAL_PARAM;
+    cacheFlushes_++;
+    cacheFlushBytes_ += length;
+    return RK_SUCCESS;
+}
+
+// ---------------------------------------------------------------- VI
+
+void HostMpiHal::GeneratePattern(uint8_t *dst, int index) const {
+    // 斜向渐变 + 随帧平移，保证相邻帧内容不同
+    uint8_t *y = dst;
+    for (int row = 0; row < viHeight_; ++row) {
+        for (int col = 0; col < viWidth_; ++col) {
+            y[row * viWidth_ + col] = (uint8_t)(col + row + index * 16);
+        }
+    }
+    uint8_t *uv = dst + viWidth_ * viHeight_;
+    for (int row = 0; row < viHeight_ / 2; ++row) {
+        for (int col = 0; col < viWidth_; col += 2) {
+            uv[row * viWidth_ + col] = (uint8_t)(128 + ((col >> 5) + index) % 32 - 16);
+            uv[row * viWidth_ + col + 1] = (uint8_t)(128 + ((row >> 4) + index) % 32 - 16);
+        }
+    }
+}
+
+bool HostMpiHal::ViInit(int width, int height, int bufCount, int depth) {
+    (void)bufCount; // 缓冲数与队列深度以 Options 为准，基准程序可按需调整
+    (void)depth;
+    if (viPool_ != MB_INVALID_POOLID) return true;
+    viWidth_ = width;
+    viHeight_ = height;
+    size_t frameSize = (size_t)width * height * 3 / 2;
+
+    FILE *fp = options_.nv12File ? fopen(options_.nv12File, "rb") : nullptr;
+    if (options_.nv12File && !fp) {
+        printf("HostMpiHal: open %s failed: %s, use test pattern\n", options_.nv12File, strerror(errno));
+    }
+    for (int i = 0; i < kPatternFrames; ++i) {
+        std::vector<uint8_t> frame(frameSize);
+        if (fp) {
+            if (fread(frame.data(), 1, frameSize, fp) != frameSize) break; // 文件帧数不足时按已读帧循环
+        } else {
+            GeneratePattern(frame.data(), i);
+        }
+        viSources_.push_back(std::move(frame));
+    }
+    if (fp) fclose(fp);
+    if (viSources_.empty()) {
+        printf("HostMpiHal: %s holds no complete %dx%d frame\n", options_.nv12File, width, height);
+        return false;
+    }
+
+    MB_POOL_CONFIG_S cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.u64MBSize = frameSize;
+    cfg.u32MBCnt = options_.viBufCount;
+    viPool_ = MbCreatePool(&cfg);
+    if (viPool_ == MB_INVALID_POOLID) return false;
+
+    if (!running_) SysInit();
+    viThread_ = std::thread(&HostMpiHal::ViLoop, this);
+    return true;
+}
+
+void HostMpiHal::ViLoop() {
+    HostPool *pool = FindPool(viPool_);
+    size_t frameSize = (size_t)viWidth_ * viHeight_ * 3 / 2;
+    uint64_t periodUs = options_.fps > 0 ? 1000000ULL / options_.fps : 0;
+    uint64_t nextUs = GetUs();
+    uint64_t index = 0;
+
+    while (running_) {
+        if (periodUs) {
+            uint64_t now = GetUs();
+            if (now < nextUs) usleep(nextUs - now);
+            nextUs += periodUs;
+        }
+        // 缓冲都在上层手里时等待归还（不限速模式下这就是节拍）
+        MB_BLK blk = TakeBlock(pool, true, 100);
+        if (blk == MB_INVALID_HANDLE) continue;
+        memcpy(MbHandle2VirAddr(blk), viSources_[index % viSources_.size()].data(), frameSize);
+        index++;
+
+        VIDEO_FRAME_INFO_S frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.stVFrame.u32Width = viWidth_;
+        frame.stVFrame.u32Height = viHeight_;
+        frame.stVFrame.u32VirWidth = viWidth_;
+        frame.stVFrame.u32VirHeight = viHeight_;
+        frame.stVFrame.enPixelFormat = RK_FMT_YUV420SP;
+        frame.stVFrame.pMbBlk = blk;
+        frame.stVFrame.u64PTS = GetUs();
+        frame.stVFrame.u32TimeRef = (RK_U32)index;
+
+        // 绑定的下游先处理（硬件上 VI 缓冲被 VPSS 读完才回收），再交给用户队列
+        ForwardToVpss(frame);
+
+        MB_BLK dropped = MB_INVALID_HANDLE;
+        {
+            std::lock_guard<std::mutex> lk(viMtx_);
+            if ((int)viReady_.size() >= options_.viDepth) {
+                dropped = viReady_.front().stVFrame.pMbBlk;
+                viReady_.pop_front();
+            }
+            viReady_.push_back(frame);
+        }
+        viCv_.notify_one();
+        viFrames_++;
+        if (dropped != MB_INVALID_HANDLE) {
+            viDrops_++;
+            MbReleaseMB(dropped);
+        }
+    }
+}
+
+RK_S32 HostMpiHal::ViGetChnFrame(int pipe, int chn, VIDEO_FRAME_INFO_S *frame, RK_S32 timeoutMs) {
+    (void)pipe;
+    (void)chn;
+    if (!frame) return RK_ERR_VI_INVALID_NULL_PTR;
+    std::unique_lock<std::mutex> lk(viMtx_);
+    auto ready = [&] { return !viReady_.empty() || !running_; };
+    if (timeoutMs < 0) {
+        viCv_.wait(lk, ready);
+    } else {
+        viCv_.wait_for(lk, std::chrono::milliseconds(timeoutMs), ready);
+    }
+    if (viReady_.empty()) return RK_ERR_VI_BUF_EMPTY;
+    *frame = viReady_.front();
+    viReady_.pop_front();
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::ViReleaseChnFrame(int pipe, int chn, const VIDEO_FRAME_INFO_S *frame) {
+    (void)pipe;
+    (void)chn;
+    if (!frame) return RK_ERR_VI_INVALID_NULL_PTR;
+    return MbReleaseMB(frame->stVFrame.pMbBlk);
+}
+
+// ---------------------------------------------------------------- VENC
+
+// 码控参数中仿真编码器用到的部分
+struct RcInfo {
+    uint32_t bitRate = 1024; // kbps
+    uint32_t minBitRate = 0; // 只有 VBR/AVBR 有
+    uint32_t gop = 30;
+    uint32_t fps = 30;
+};
+
+// VBR 与 AVBR 字段相同、类型不同
+template <typename VbrAttr>
+static void ParseVbr(const VbrAttr &vbr, RcInfo *info) {
+    info->bitRate = vbr.u32BitRate;
+    info->minBitRate = vbr.u32MinBitRate ? vbr.u32MinBitRate : vbr.u32BitRate / 2;
+    info->gop = vbr.u32Gop;
+    if (vbr.fr32DstFrameRateNum > 0 && vbr.fr32DstFrameRateDen > 0) {
+        info->fps = vbr.fr32DstFrameRateNum / vbr.fr32DstFrameRateDen;
+    }
+}
+
+static RcInfo ParseRc(const VENC_RC_ATTR_S &rc) {
+    RcInfo info;
+    if (rc.enRcMode == VENC_RC_MODE_H264CBR) {
+        info.bitRate = rc.stH264Cbr.u32BitRate;
+        info.gop = rc.stH264Cbr.u32Gop;
+        if (rc.stH264Cbr.fr32DstFrameRateNum > 0 && rc.stH264Cbr.fr32DstFrameRateDen > 0) {
+            info.fps = rc.stH264Cbr.fr32DstFrameRateNum / rc.stH264Cbr.fr32DstFrameRateDen;
+        }
+    } else if (rc.enRcMode == VENC_RC_MODE_H265CBR) {
+        info.bitRate = rc.stH265Cbr.u32BitRate;
+        info.gop = rc.stH265Cbr.u32Gop;
+    } else if (rc.enRcMode == VENC_RC_MODE_H264VBR) {
+        ParseVbr(rc.stH264Vbr, &info);
+    } else if (rc.enRcMode == VENC_RC_MODE_H264AVBR) {
+        ParseVbr(rc.stH264Avbr, &info);
+    }
+    if (info.fps == 0) info.fps = 30;
+    return info;
+}
+
+// u32BitRate 单位 kbps；码流缓冲按 u32BufSize 分配，帧大小不超过缓冲
+static uint32_t RcFrameBytes(uint32_t kbps, uint32_t fps) {
+    uint32_t bytes = kbps * 1000 / 8 / fps;
+    return bytes < 64 ? 64 : bytes;
+}
+
+RK_S32 HostMpiHal::VencCreateChn(int chn, const VENC_CHN_ATTR_S *attr) {
+    if (chn < 0 || chn >= kMaxVencChns || !attr) return RK_ERR_VENC_ILLEGAL_PARAM;
+    RcInfo rc = ParseRc(attr->stRcAttr);
+
+    std::lock_guard<std::mutex> lk(vencMtx_);
+    VencChn &c = vencChns_[chn];
+    if (c.created) return RK_ERR_VENC_EXIST;
+    c.attr = *attr;
+    c.width = attr->stVencAttr.u32PicWidth;
+    c.height = attr->stVencAttr.u32PicHeight;
+    c.gop = rc.gop;
+    c.frameBytes = RcFrameBytes(rc.bitRate, rc.fps);
+    c.minFrameBytes = rc.minBitRate ? RcFrameBytes(rc.minBitRate, rc.fps) : 0;
+    c.frameCnt = 0;
+    c.seq = 0;
+
+    MB_POOL_CONFIG_S cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.u64MBSize = std::max<RK_U64>((RK_U64)c.frameBytes * kIdrSizeFactor, attr->stVencAttr.u32BufSize);
+    cfg.u32MBCnt = kStreamBufCount;
+    c.streamPool = MbCreatePool(&cfg);
+    if (c.eventFd < 0) c.eventFd = eventfd(0, EFD_NONBLOCK | EFD_SEMAPHORE | EFD_CLOEXEC);
+    if (c.streamPool == MB_INVALID_POOLID || c.eventFd < 0) return RK_ERR_VENC_NOMEM;
+    c.created = true;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VencGetChnAttr(int chn, VENC_CHN_ATTR_S *attr) {
+    if (chn < 0 || chn >= kMaxVencChns) return RK_ERR_VENC_ILLEGAL_PARAM;
+    if (!attr) return RK_ERR_VENC_NULL_PTR;
+    std::lock_guard<std::mutex> lk(vencMtx_);
+    VencChn &c = vencChns_[chn];
+    if (!c.created) return RK_ERR_VENC_UNEXIST;
+    *attr = c.attr;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VencSetChnAttr(int chn, const VENC_CHN_ATTR_S *attr) {
+    if (chn < 0 || chn >= kMaxVencChns) return RK_ERR_VENC_ILLEGAL_PARAM;
+    if (!attr) return RK_ERR_VENC_NULL_PTR;
+    RcInfo rc = ParseRc(attr->stRcAttr);
+    std::lock_guard<std::mutex> lk(vencMtx_);
+    VencChn &c = vencChns_[chn];
+    if (!c.created) return RK_ERR_VENC_UNEXIST;
+    if ((int)attr->stVencAttr.u32PicWidth != c.width || (int)attr->stVencAttr.u32PicHeight != c.height) {
+        return RK_ERR_VENC_NOT_PERM;
+    }
+    c.attr = *attr;
+    c.gop = rc.gop;
+    c.frameBytes = RcFrameBytes(rc.bitRate, rc.fps);
+    c.minFrameBytes = rc.minBitRate ? RcFrameBytes(rc.minBitRate, rc.fps) : 0;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VencStartRecvFrame(int chn, const VENC_RECV_PIC_PARAM_S *param) {
+    (void)param;
+    if (chn < 0 || chn >= kMaxVencChns) return RK_ERR_VENC_ILLEGAL_PARAM;
+    std::lock_guard<std::mutex> lk(vencMtx_);
+    if (!vencChns_[chn].created) return RK_ERR_VENC_UNEXIST;
+    vencChns_[chn].recv = true;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VencStopRecvFrame(int chn) {
+    if (chn < 0 || chn >= kMaxVencChns) return RK_ERR_VENC_ILLEGAL_PARAM;
+    std::lock_guard<std::mutex> lk(vencMtx_);
+    if (!vencChns_[chn].created) return RK_ERR_VENC_UNEXIST;
+    vencChns_[chn].recv = false;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VencSendFrame(int chn, const VIDEO_FRAME_INFO_S *frame, RK_S32 timeoutMs) {
+    if (chn < 0 || chn >= kMaxVencChns) return RK_ERR_VENC_ILLEGAL_PARAM;
+    if (!frame || !frame->stVFrame.pMbBlk) return RK_ERR_VENC_NULL_PTR;
+
+    std::unique_lock<std::mutex> lk(vencMtx_);
+    if (!vencChns_[chn].created || !vencChns_[chn].recv) return RK_ERR_VENC_UNEXIST;
+    auto space = [&] { return encodeJobs_.size() < kMaxEncodeJobs || !running_; };
+    if (timeoutMs < 0) {
+        encodeCv_.wait(lk, space);
+    } else {
+        encodeCv_.wait_for(lk, std::chrono::milliseconds(timeoutMs), space);
+    }
+    if (encodeJobs_.size() >= kMaxEncodeJobs || !running_) return RK_ERR_VENC_BUSY;
+
+    // 与硬件一致：编码器持有输入块的一份引用，调用方可以立即 ReleaseMB
+    HostBlock *blk = ToBlock(frame->stVFrame.pMbBlk);
+    blk->refs++;
+    encodeJobs_.push_back({chn, blk, frame->stVFrame.u64PTS});
+    encodeCv_.notify_all();
+    return RK_SUCCESS;
+}
+
+void HostMpiHal::EncodeLoop() {
+    while (true) {
+        EncodeJob job;
+        {
+            std::unique_lock<std::mutex> lk(vencMtx_);
+            encodeCv_.wait(lk, [&] { return !encodeJobs_.empty() || !running_; });
+            if (encodeJobs_.empty()) break;
+            job = encodeJobs_.front();
+            encodeJobs_.pop_front();
+            encodeCv_.notify_all(); // 唤醒因队列满而阻塞的 SendFrame
+        }
+        EncodeOne(job);
+        MbReleaseMB(job.blk);
+    }
+}
+
+void HostMpiHal::EncodeOne(const EncodeJob &job) {
+    VencChn &c = vencChns_[job.chn];
+    uint64_t startUs = GetUs();
+
+    // 按缓存行读一遍输入，模拟编码器对整帧的内存读取
+    size_t inBytes = (size_t)c.width * c.height * 3 / 2;
+    if (inBytes > job.blk->size) inBytes = job.blk->size;
+    const uint8_t *in = job.blk->data.get();
+    uint32_t sum = 0;
+    for (size_t i = 0; i < inBytes; i += 64) sum += in[i];
+
+    uint32_t refreshFrames;
+    uint32_t gop;
+    uint32_t frameBytes;
+    uint32_t minFrameBytes;
+    {
+        std::lock_guard<std::mutex> lk(vencMtx_);
+        if (c.forceIdr) {
+            c.forceIdr = false;
+            c.frameCnt = 0;
+        }
+        refreshFrames = c.refreshFrames;
+        gop = c.gop;
+        frameBytes = c.frameBytes;
+        minFrameBytes = c.minFrameBytes;
+    }
+    bool keyframe = gop <= 1 || c.frameCnt % gop == 0;
+    c.frameCnt++;
+    uint32_t len = keyframe ? frameBytes * kIdrSizeFactor : frameBytes;
+    // 帧内刷新：一轮刷新的 I 宏块摊到各 P 帧
+    if (!keyframe && refreshFrames > 0) len += frameBytes * (kIdrSizeFactor - 1) / refreshFrames;
+    // VBR/AVBR：画面静止时码率降到下限（CBR 填充到目标码率）
+    if (!keyframe && minFrameBytes > 0 && sum == c.lastSum) len = minFrameBytes;
+    c.lastSum = sum;
+
+    MB_BLK out = TakeBlock(FindPool(c.streamPool), false, 0);
+    if (out == MB_INVALID_HANDLE) {
+        encodeDrops_++; // 上层取流不及时，丢弃本帧
+        return;
+    }
+    if (len > ToBlock(out)->size) len = (uint32_t)ToBlock(out)->size; // 运行中调高码率也不超出码流缓冲
+    uint8_t *bs = ToBlock(out)->data.get();
+    static const uint8_t kStartCode[4] = {0, 0, 0, 1};
+    bool paramSets = keyframe && len >= kSpsBytes + kPpsBytes + kSliceHeadBytes;
+    uint32_t slice = 0;
+    if (paramSets) {
+        memcpy(bs, kStartCode, sizeof(kStartCode));
+        bs[4] = 0x67; // SPS
+        memset(bs + 5, 0x42, kSpsBytes - 5);
+        memcpy(bs + kSpsBytes, kStartCode, sizeof(kStartCode));
+        bs[kSpsBytes + 4] = 0x68; // PPS
+        memset(bs + kSpsBytes + 5, 0xce, kPpsBytes - 5);
+        slice = kSpsBytes + kPpsBytes;
+    }
+    memcpy(bs + slice, kStartCode, sizeof(kStartCode));
+    bs[slice + 4] = keyframe ? 0x65 : 0x41; // IDR / P slice NAL 头
+    memset(bs + slice + kSliceHeadBytes, (int)(sum & 0xff), len - slice - kSliceHeadBytes);
+
+    if (options_.encodeUs > 0) {
+        uint64_t spent = GetUs() - startUs;
+        if (spent < (uint64_t)options_.encodeUs) usleep(options_.encodeUs - spent);
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(vencMtx_);
+        c.streams.push_back({ToBlock(out), len, job.pts, keyframe, paramSets});
+    }
+    uint64_t one = 1;
+    if (write(c.eventFd, &one, sizeof(one)) != sizeof(one)) {
+        printf("HostMpiHal: eventfd write ch%d failed: %s\n", job.chn, strerror(errno));
+    }
+    streamCv_.notify_all();
+    encodedFrames_++;
+    encodedBytes_ += len;
+}
+
+RK_S32 HostMpiHal::VencGetStream(int chn, VENC_STREAM_S *stream, RK_S32 timeoutMs) {
+    if (chn < 0 || chn >= kMaxVencChns) return RK_ERR_VENC_ILLEGAL_PARAM;
+    if (!stream || !stream->pstPack) return RK_ERR_VENC_NULL_PTR;
+
+    VencChn &c = vencChns_[chn];
+    StreamItem item;
+    {
+        std::unique_lock<std::mutex> lk(vencMtx_);
+        if (!c.created) return RK_ERR_VENC_UNEXIST;
+        auto ready = [&] { return !c.streams.empty() || !running_; };
+        if (timeoutMs < 0) {
+            streamCv_.wait(lk, ready);
+        } else if (timeoutMs > 0) {
+            streamCv_.wait_for(lk, std::chrono::milliseconds(timeoutMs), ready);
+        }
+        if (c.streams.empty()) return RK_ERR_VENC_BUF_EMPTY;
+        item = c.streams.front();
+        // 入参 u32PackCount 为 pack 数组容量（旧调用方清零时按 1 个），不够放整帧时不取走，由调用方扩容重试
+        RK_U32 capacity = stream->u32PackCount ? stream->u32PackCount : 1;
+        if (capacity < (item.paramSets ? 3u : 1u)) return RK_ERR_VENC_ILLEGAL_PARAM;
+        c.streams.pop_front();
+        // 计数与队列不同步只影响 poll 唤醒，不影响取流
+        uint64_t cnt;
+        ssize_t n = read(c.eventFd, &cnt, sizeof(cnt));
+        (void)n;
+        stream->u32Seq = c.seq++;
+    }
+
+    // 各 pack 共用一个码流块：数据在 u32Offset 处，u32Len 含偏移（与 rockit 的约定一致）
+    RK_U32 packs = 0;
+    auto addPack = [&](uint32_t offset, uint32_t end, H264E_NALU_TYPE_E type) {
+        VENC_PACK_S &pack = stream->pstPack[packs++];
+        memset(&pack, 0, sizeof(pack));
+        pack.pMbBlk = item.blk;
+        pack.u32Offset = offset;
+        pack.u32Len = end;
+        pack.u64PTS = item.pts;
+        pack.DataType.enH264EType = type;
+    };
+    uint32_t slice = 0;
+    if (item.paramSets) {
+        addPack(0, kSpsBytes, H264E_NALU_SPS);
+        addPack(kSpsBytes, kSpsBytes + kPpsBytes, H264E_NALU_PPS);
+        slice = kSpsBytes + kPpsBytes;
+    }
+    addPack(slice, item.len, item.keyframe ? H264E_NALU_IDRSLICE : H264E_NALU_PSLICE);
+    stream->pstPack[packs - 1].bFrameEnd = RK_TRUE;
+    stream->u32PackCount = packs;
+
+    latencyTotalUs_ += GetUs() - item.pts;
+    latencyCnt_++;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VencReleaseStream(int chn, VENC_STREAM_S *stream) {
+    (void)chn;
+    if (!stream || !stream->pstPack) return RK_ERR_VENC_NULL_PTR;
+    // 同一块上的多个 pack 只释放一次
+    for (RK_U32 i = 0; i < stream->u32PackCount; ++i) {
+        MB_BLK blk = stream->pstPack[i].pMbBlk;
+        bool seen = false;
+        for (RK_U32 j = 0; j < i && !seen; ++j) seen = stream->pstPack[j].pMbBlk == blk;
+        if (!seen) MbReleaseMB(blk);
+    }
+    stream->u32PackCount = 0;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VencQueryStatus(int chn, VENC_CHN_STATUS_S *status) {
+    if (chn < 0 || chn >= kMaxVencChns) return RK_ERR_VENC_ILLEGAL_PARAM;
+    if (!status) return RK_ERR_VENC_NULL_PTR;
+    std::lock_guard<std::mutex> lk(vencMtx_);
+    VencChn &c = vencChns_[chn];
+    if (!c.created) return RK_ERR_VENC_UNEXIST;
+    memset(status, 0, sizeof(*status));
+    status->u32LeftStreamFrames = (RK_U32)c.streams.size();
+    for (const StreamItem &item : c.streams) status->u32LeftStreamBytes += item.len;
+    if (!c.streams.empty()) status->u32CurPacks = c.streams.front().paramSets ? 3 : 1;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VencGetFd(int chn) {
+    if (chn < 0 || chn >= kMaxVencChns) return -1;
+    std::lock_guard<std::mutex> lk(vencMtx_);
+    return vencChns_[chn].created ? vencChns_[chn].eventFd : -1;
+}
+
+RK_S32 HostMpiHal::VencCloseFd(int chn) {
+    (void)chn;
+    return RK_SUCCESS; // eventfd 随通道生命周期关闭
+}
+
+RK_S32 HostMpiHal::VencRequestIDR(int chn, RK_BOOL instant) {
+    (void)instant; // 仿真编码器按队列顺序，下一个出队的帧即为 IDR
+    if (chn < 0 || chn >= kMaxVencChns) return RK_ERR_VENC_ILLEGAL_PARAM;
+    std::lock_guard<std::mutex> lk(vencMtx_);
+    VencChn &c = vencChns_[chn];
+    if (!c.created) return RK_ERR_VENC_UNEXIST;
+    c.forceIdr = true;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VencSetIntraRefresh(int chn, const VENC_INTRA_REFRESH_S *refresh) {
+    if (chn < 0 || chn >= kMaxVencChns) return RK_ERR_VENC_ILLEGAL_PARAM;
+    if (!refresh) return RK_ERR_VENC_NULL_PTR;
+    std::lock_guard<std::mutex> lk(vencMtx_);
+    VencChn &c = vencChns_[chn];
+    if (!c.created) return RK_ERR_VENC_UNEXIST;
+    if (!refresh->bRefreshEnable) {
+        c.refreshFrames = 0;
+        return RK_SUCCESS;
+    }
+    if (refresh->u32RefreshNum == 0) return RK_ERR_VENC_ILLEGAL_PARAM;
+    int mbLines = refresh->enIntraRefreshMode == INTRA_REFRESH_COLUMN ? (c.width + 15) / 16 : (c.height + 15) / 16;
+    c.refreshFrames = (mbLines + refresh->u32RefreshNum - 1) / refresh->u32RefreshNum;
+    return RK_SUCCESS;
+}
+
+// ---------------------------------------------------------------- VPSS / 绑定
+
+HostMpiHal::VpssChnState *HostMpiHal::FindVpssChn(int grp, int chn) {
+    if (chn < 0 || chn >= VPSS_MAX_CHN_NUM) return nullptr;
+    auto it = vpssGrps_.find(grp);
+    return it == vpssGrps_.end() ? nullptr : &it->second.chns[chn];
+}
+
+RK_S32 HostMpiHal::VpssCreateGrp(int grp, const VPSS_GRP_ATTR_S *attr) {
+    if (!attr) return RK_ERR_VPSS_NULL_PTR;
+    if (grp < 0 || grp >= VPSS_MAX_GRP_NUM) return RK_ERR_VPSS_ILLEGAL_PARAM;
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    if (vpssGrps_.count(grp)) return RK_ERR_VPSS_EXIST;
+    vpssGrps_[grp] = VpssGrpState();
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VpssDestroyGrp(int grp) {
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    auto it = vpssGrps_.find(grp);
+    if (it == vpssGrps_.end()) return RK_ERR_VPSS_UNEXIST;
+    for (auto &chn : it->second.chns) {
+        if (chn.pool != MB_INVALID_POOLID) MbDestroyPool(chn.pool);
+    }
+    vpssGrps_.erase(it);
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VpssStartGrp(int grp) {
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    auto it = vpssGrps_.find(grp);
+    if (it == vpssGrps_.end()) return RK_ERR_VPSS_UNEXIST;
+    it->second.started = true;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VpssStopGrp(int grp) {
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    auto it = vpssGrps_.find(grp);
+    if (it == vpssGrps_.end()) return RK_ERR_VPSS_UNEXIST;
+    it->second.started = false;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VpssSetChnAttr(int grp, int chn, const VPSS_CHN_ATTR_S *attr) {
+    if (!attr) return RK_ERR_VPSS_NULL_PTR;
+    if (attr->u32Width == 0 || attr->u32Height == 0 || (attr->u32Height & 1)) return RK_ERR_VPSS_ILLEGAL_PARAM;
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    VpssChnState *state = FindVpssChn(grp, chn);
+    if (!state) return RK_ERR_VPSS_UNEXIST;
+    if (state->enabled) return RK_ERR_VPSS_NOT_PERM;
+    state->configured = true;
+    state->width = attr->u32Width;
+    state->height = attr->u32Height;
+    state->bufCount = attr->u32FrameBufCnt ? attr->u32FrameBufCnt : 3;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VpssSetChnCrop(int grp, int chn, const VPSS_CROP_INFO_S *crop) {
+    if (!crop) return RK_ERR_VPSS_NULL_PTR;
+    if (crop->bEnable && crop->enCropCoordinate != VPSS_CROP_ABS_COOR) return RK_ERR_VPSS_NOT_SUPPORT;
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    VpssChnState *state = FindVpssChn(grp, chn);
+    if (!state) return RK_ERR_VPSS_UNEXIST;
+    state->crop = *crop;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VpssEnableChn(int grp, int chn) {
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    VpssChnState *state = FindVpssChn(grp, chn);
+    if (!state) return RK_ERR_VPSS_UNEXIST;
+    if (!state->configured) return RK_ERR_VPSS_NOTREADY;
+    if (state->enabled) return RK_SUCCESS;
+    MB_POOL_CONFIG_S cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.u64MBSize = (RK_U64)state->width * state->height * 3 / 2;
+    cfg.u32MBCnt = state->bufCount;
+    state->pool = MbCreatePool(&cfg);
+    if (state->pool == MB_INVALID_POOLID) return RK_ERR_VPSS_NOMEM;
+    state->enabled = true;
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::VpssDisableChn(int grp, int chn) {
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    VpssChnState *state = FindVpssChn(grp, chn);
+    if (!state) return RK_ERR_VPSS_UNEXIST;
+    if (!state->enabled) return RK_SUCCESS;
+    MbDestroyPool(state->pool);
+    state->pool = MB_INVALID_POOLID;
+    state->enabled = false;
+    return RK_SUCCESS;
+}
+
+static bool SameChn(const MPP_CHN_S &a, const MPP_CHN_S &b) {
+    return a.enModId == b.enModId && a.s32DevId == b.s32DevId && a.s32ChnId == b.s32ChnId;
+}
+
+RK_S32 HostMpiHal::SysBind(const MPP_CHN_S *src, const MPP_CHN_S *dst) {
+    if (!src || !dst) return RK_ERR_SYS_NULL_PTR;
+    // 仿真只支持 VI -> VPSS 组、VPSS 通道 -> VENC 两种绑定
+    bool viToVpss = src->enModId == RK_ID_VI && dst->enModId == RK_ID_VPSS;
+    bool vpssToVenc = src->enModId == RK_ID_VPSS && dst->enModId == RK_ID_VENC;
+    if (!viToVpss && !vpssToVenc) return RK_ERR_SYS_NOT_SUPPORT;
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    for (const Binding &b : binds_) {
+        // 一个目的端只能有一个源
+        if (SameChn(b.dst, *dst)) return RK_ERR_SYS_NOT_PERM;
+    }
+    binds_.push_back({*src, *dst});
+    return RK_SUCCESS;
+}
+
+RK_S32 HostMpiHal::SysUnBind(const MPP_CHN_S *src, const MPP_CHN_S *dst) {
+    if (!src || !dst) return RK_ERR_SYS_NULL_PTR;
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    for (auto it = binds_.begin(); it != binds_.end(); ++it) {
+        if (SameChn(it->src, *src) && SameChn(it->dst, *dst)) {
+            binds_.erase(it);
+            return RK_SUCCESS;
+        }
+    }
+    return RK_ERR_SYS_ILLEGAL_PARAM;
+}
+
+// VI 线程调用：把一帧按绑定关系送过 VPSS 各通道，裁剪结果非阻塞送编码
+void HostMpiHal::ForwardToVpss(const VIDEO_FRAME_INFO_S &frame) {
+    std::lock_guard<std::mutex> lk(vpssMtx_);
+    if (binds_.empty()) return;
+    const uint8_t *src = static_cast<const uint8_t *>(MbHandle2VirAddr(frame.stVFrame.pMbBlk));
+    int srcW = frame.stVFrame.u32Width;
+    int srcH = frame.stVFrame.u32Height;
+    int srcStride = frame.stVFrame.u32VirWidth;
+
+    for (const Binding &in : binds_) {
+        if (in.src.enModId != RK_ID_VI || in.dst.enModId != RK_ID_VPSS) continue;
+        auto grpIt = vpssGrps_.find(in.dst.s32DevId);
+        if (grpIt == vpssGrps_.end() || !grpIt->second.started) continue;
+
+        for (const Binding &out : binds_) {
+            if (out.src.enModId != RK_ID_VPSS || out.src.s32DevId != in.dst.s32DevId) continue;
+            VpssChnState *chn = FindVpssChn(out.src.s32DevId, out.src.s32ChnId);
+            if (!chn || !chn->enabled) continue;
+
+            RECT_S rect = {0, 0, (RK_U32)srcW, (RK_U32)srcH};
+            if (chn->crop.bEnable) rect = chn->crop.stCropRect;
+            int x = rect.s32X & ~1;
+            int y = rect.s32Y & ~1;
+            int w = std::min<int>(std::min<int>(rect.u32Width, chn->width), srcW - x);
+            int h = std::min<int>(std::min<int>(rect.u32Height, chn->height), srcH - y) & ~1;
+            if (w <= 0 || h <= 0) continue;
+
+            MB_BLK blk = MbGetMB(chn->pool, (RK_U64)chn->width * chn->height * 3 / 2, RK_FALSE);
+            if (blk == MB_INVALID_HANDLE) {
+                vpssDrops_++;
+                continue;
+            }
+            uint8_t *dst = static_cast<uint8_t *>(MbHandle2VirAddr(blk));
+            for (int r = 0; r < h; ++r) {
+                memcpy(dst + (size_t)r * chn->width, src + (size_t)(y + r) * srcStride + x, w);
+            }
+            const uint8_t *srcUV = src + (size_t)srcStride * frame.stVFrame.u32VirHeight;
+            uint8_t *dstUV = dst + (size_t)chn->width * chn->height;
+            for (int r = 0; r < h / 2; ++r) {
+                memcpy(dstUV + (size_t)r * chn->width, srcUV + (size_t)(y / 2 + r) * srcStride + x, w);
+            }
+
+            VIDEO_FRAME_INFO_S tile;
+            memset(&tile, 0, sizeof(tile));
+            tile.stVFrame.u32Width = chn->width;
+            tile.stVFrame.u32Height = chn->height;
+            tile.stVFrame.u32VirWidth = chn->width;
+            tile.stVFrame.u32VirHeight = chn->height;
+            tile.stVFrame.enPixelFormat = RK_FMT_YUV420SP;
+            tile.stVFrame.pMbBlk = blk;
+            tile.stVFrame.u64PTS = frame.stVFrame.u64PTS;
+            if (VencSendFrame(out.dst.s32ChnId, &tile, 0) == RK_SUCCESS) {
+                vpssFrames_++;
+            } else {
+                vpssDrops_++;
+            }
+            MbReleaseMB(blk);
+        }
+    }
+}
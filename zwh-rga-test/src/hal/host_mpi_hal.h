@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mpi_hal.h"
+
+// 主机仿真后端：不依赖任何板端库，x86 Linux 上即可运行整条流水线
+// - MB：进程内存模拟内存池，引用计数归零时块回到池中；无 dma-buf，Handle2Fd 返回 -1
+// - VI：后台线程按帧率出帧，内容为预生成的测试图或循环读取的 NV12 文件；队列满时丢最旧帧
+// - VENC：单个编码线程模拟硬件编码核，按整帧读一遍输入（模拟 DMA 读），
+//   按码率生成 H.264 形式的假码流（起始码 + NAL 头），每路一个 eventfd 供 poll；
+//   支持 RequestIDR、帧内刷新与运行中改码率；VBR/AVBR 在输入抽样不变时按最小码率出帧
+// - VPSS / 绑定：VI 出帧时由 VI 线程按绑定关系转给已启动的 VPSS 组，各通道 CPU 裁剪后
+//   非阻塞送入绑定的 VENC 通道（编码器忙时丢弃，与硬件通道满时丢帧一致）；不做缩放
+class HostMpiHal : public MpiHal {
+public:
+    struct Options {
+        int fps = 30;                   // VI 出帧速率，0 表示不限速（受缓冲归还速度约束）
+        const char *nv12File = nullptr; // 循环读取的 NV12 原始文件，空则生成测试图
+        int viBufCount = 4;             // VI 缓冲个数（含已交给上层未归还的）
+        int viDepth = 2;                // 待取帧队列深度
+        int encodeUs = 0;               // 每帧额外模拟的编码耗时（微秒）
+    };
+
+    HostMpiHal();
+    explicit HostMpiHal(const Options &options);
+    ~HostMpiHal() override;
+
+    const char *Name() const override { return "host"; }
+
+    bool SysInit() override;
+    void SysExit() override;
+
+    bool ViInit(int width, int height, int bufCount, int depth) override;
+    RK_S32 ViGetChnFrame(int pipe, int chn, VIDEO_FRAME_INFO_S *frame, RK_S32 timeoutMs) override;
+    RK_S32 ViReleaseChnFrame(int pipe, int chn, const VIDEO_FRAME_INFO_S *frame) override;
+
+    MB_POOL MbCreatePool(MB_POOL_CONFIG_S *cfg) override;
+    RK_S32 MbDestroyPool(MB_POOL pool) override;
+    MB_BLK MbGetMB(MB_POOL pool, RK_U64 size, RK_BOOL block) override;
+    RK_S32 MbReleaseMB(MB_BLK blk) override;
+    void *MbHandle2VirAddr(MB_BLK blk) override;
+    RK_S32 MbHandle2Fd(MB_BLK blk) override;
+    MB_POOL MbHandle2PoolId(MB_BLK blk) override;
+    RK_S32 MbInquireUserCnt(MB_BLK blk) override;
+    RK_S32 SysMmzFlushCache(MB_BLK blk, RK_BOOL readOnly) override;
+    RK_S32 SysMmzFlushCacheRange(MB_BLK blk, RK_U32 offset, RK_U32 length, RK_BOOL readOnly) override;
+
+    RK_S32 VencCreateChn(int chn, const VENC_CHN_ATTR_S *attr) override;
+    RK_S32 VencStartRecvFrame(int chn, const VENC_RECV_PIC_PARAM_S *param) override;
+    RK_S32 VencStopRecvFrame(int chn) override;
+    RK_S32 VencGetChnAttr(int chn, VENC_CHN_ATTR_S *attr) override;
+    RK_S32 VencSetChnAttr(int chn, const VENC_CHN_ATTR_S *attr) override;
+    RK_S32 VencSendFrame(int chn, const VIDEO_FRAME_INFO_S *frame, RK_S32 timeoutMs) override;
+    RK_S32 VencGetStream(int chn, VENC_STREAM_S *stream, RK_S32 timeoutMs) override;
+    RK_S32 VencReleaseStream(int chn, VENC_STREAM_S *stream) override;
+    RK_S32 VencQueryStatus(int chn, VENC_CHN_STATUS_S *status) override;
+    RK_S32 VencGetFd(int chn) override;
+    RK_S32 VencCloseFd(int chn) override;
+    RK_S32 VencRequestIDR(int chn, RK_BOOL instant) override;
+    RK_S32 VencSetIntraRefresh(int chn, const VENC_INTRA_REFRESH_S *refresh) override;
+
+    RK_S32 VpssCreateGrp(int grp, const VPSS_GRP_ATTR_S *attr) override;
+    RK_S32 VpssDestroyGrp(int grp) override;
+    RK_S32 VpssStartGrp(int grp) override;
+    RK_S32 VpssStopGrp(int grp) override;
+    RK_S32 VpssSetChnAttr(int grp, int chn, const VPSS_CHN_ATTR_S *attr) override;
+    RK_S32 VpssSetChnCrop(int grp, int chn, const VPSS_CROP_INFO_S *crop) override;
+    RK_S32 VpssEnableChn(int grp, int chn) override;
+    RK_S32 VpssDisableChn(int grp, int chn) override;
+
+    RK_S32 SysBind(const MPP_CHN_S *src, const MPP_CHN_S *dst) override;
+    RK_S32 SysUnBind(const MPP_CHN_S *src, const MPP_CHN_S *dst) override;
+
+    // 统计：VI 出帧/丢帧、编码帧数/字节数/丢帧、VI 出帧到码流被取走的平均时延
+    uint64_t ViFrames() const { return viFrames_.load(); }
+    uint64_t ViDrops() const { return viDrops_.load(); }
+    uint64_t EncodedFrames() const { return encodedFrames_.load(); }
+    uint64_t EncodedBytes() const { return encodedBytes_.load(); }
+    uint64_t EncodeDrops() const { return encodeDrops_.load(); }
+    uint64_t CacheFlushes() const { return cacheFlushes_.load(); }
+    uint64_t CacheFlushBytes() const { return cacheFlushBytes_.load(); } // 整块刷新按块大小计
+    uint64_t VpssFrames() const { return vpssFrames_.load(); } // 经绑定送入 VENC 的通道帧数
+    uint64_t VpssDrops() const { return vpssDrops_.load(); }
+    uint64_t AvgStreamLatencyUs() const;
+
+private:
+    static const int kMaxVencChns = VENC_MAX_CHN_NUM;
+
+    struct HostPool;
+    struct HostBlock {
+        HostPool *owner = nullptr;
+        std::unique_ptr<uint8_t[]> data;
+        size_t size = 0;
+        std::atomic<int> refs{0};
+    };
+
+    struct HostPool {
+        MB_POOL id = MB_INVALID_POOLID;
+        size_t blockSize = 0;
+        std::vector<std::unique_ptr<HostBlock>> blocks;
+        std::vector<HostBlock *> freeList;
+        std::mutex mtx;
+        std::condition_variable cv;
+    };
+
+    struct EncodeJob {
+        int chn;
+        HostBlock *blk;
+        uint64_t pts;
+    };
+
+    struct StreamItem {
+        HostBlock *blk;
+        uint32_t len;
+        uint64_t pts;
+        bool keyframe;
+        bool paramSets; // 块首带 SPS/PPS，取流时拆成 SPS、PPS、slice 三个 pack
+    };
+
+    struct VencChn {
+        bool created = false;
+        bool recv = false;
+        int width = 0;
+        int height = 0;
+        uint32_t gop = 0;
+        VENC_CHN_ATTR_S attr;
+        uint32_t frameBytes = 0;    // 按码率/帧率折算的 P 帧大小
+        uint32_t minFrameBytes = 0; // VBR/AVBR 画面静止时的 P 帧大小（按最小码率）
+        uint32_t lastSum = 0;       // 上一帧输入抽样和，判断画面是否静止
+        uint32_t frameCnt = 0;
+        uint32_t seq = 0;
+        bool forceIdr = false;      // RequestIDR 后的下一帧编为 IDR，GOP 从该帧重新计数
+        uint32_t refreshFrames = 0; // 帧内刷新一轮的帧数，非 0 时 P 帧分摊 I 帧的增量
+        MB_POOL streamPool = MB_INVALID_POOLID;
+        int eventFd = -1;
+        std::deque<StreamItem> streams;
+    };
+
+    struct VpssChnState {
+        bool configured = false;
+        bool enabled = false;
+        int width = 0;
+        int height = 0;
+        int bufCount = 0;
+        VPSS_CROP_INFO_S crop;
+        MB_POOL pool = MB_INVALID_POOLID;
+    };
+
+    struct VpssGrpState {
+        bool started = false;
+        VpssChnState chns[VPSS_MAX_CHN_NUM];
+    };
+
+    struct Binding {
+        MPP_CHN_S src;
+        MPP_CHN_S dst;
+    };
+
+    static HostBlock *ToBlock(MB_BLK blk) { return static_cast<HostBlock *>(blk); }
+    HostPool *FindPool(MB_POOL pool);
+    MB_BLK TakeBlock(HostPool *pool, bool block, int timeoutMs);
+    void ViLoop();
+    void EncodeLoop();
+    void EncodeOne(const EncodeJob &job);
+    void GeneratePattern(uint8_t *dst, int index) const;
+    void ForwardToVpss(const VIDEO_FRAME_INFO_S &frame);
+    VpssChnState *FindVpssChn(int grp, int chn);
+    void StopThreads();
+
+    Options options_;
+    std::mutex poolMtx_;
+    std::map<MB_POOL, std::unique_ptr<HostPool>> pools_;
+    MB_POOL nextPoolId_ = 1;
+
+    // VI
+    int viWidth_ = 0;
+    int viHeight_ = 0;
+    MB_POOL viPool_ = MB_INVALID_POOLID;
+    std::vector<std::vector<uint8_t>> viSources_; // 轮流拷入 VI 缓冲的源画面
+    std::deque<VIDEO_FRAME_INFO_S> viReady_;
+    std::mutex viMtx_;
+    std::condition_variable viCv_;
+    std::thread viThread_;
+
+    // VENC
+    VencChn vencChns_[kMaxVencChns];
+    std::deque<EncodeJob> encodeJobs_;
+    std::mutex vencMtx_;
+    std::condition_variable encodeCv_;
+    std::condition_variable streamCv_;
+    std::thread encodeThread_;
+
+    // VPSS / 绑定
+    std::map<int, VpssGrpState> vpssGrps_;
+    std::vector<Binding> binds_;
+    std::mutex vpssMtx_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> viFrames_{0};
+    std::atomic<uint64_t> viDrops_{0};
+    std::atomic<uint64_t> encodedFrames_{0};
+    std::atomic<uint64_t> encodedBytes_{0};
+    std::atomic<uint64_t> encodeDrops_{0};
+    std::atomic<uint64_t> cacheFlushes_{0};
+    std::atomic<uint64_t> cacheFlushBytes_{0};
+    std::atomic<uint64_t> vpssFrames_{0};
+    std::atomic<uint64_t> vpssDrops_{0};
+    std::atomic<uint64_t> latencyTotalUs_{0};
+    std::atomic<uint64_t> latencyCnt_{0};
+};
@@ -0,0 +1,34 @@
+#include "mpi_hal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_mpi_hal.h"
+#include "rockit_mpi_hal.h"
+
+static MpiHal *g_hal = nullptr;
+
+static MpiHal *CreateDefaultMpiHal() {
+#ifdef RV1106_1103
+    const char *name = getenv("ZWH_MPI_HAL");
+    if (!name || strcmp(name, "host") != 0) {
+        static RockitMpiHal rockitHal;
+        return &rockitHal;
+    }
+#endif
+    static HostMpiHal hostHal;
+    return &hostHal;
+}
+
+MpiHal *GetMpiHal() {
+    if (!g_hal) {
+        g_hal = CreateDefaultMpiHal();
+        printf("MpiHal backend: %s\n", g_hal->Name());
+    }
+    return g_hal;
+}
+
+void SetMpiHal(MpiHal *hal) {
+    g_hal = hal;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rk_mpi_mb.h"
+#include "rk_mpi_sys.h"
+#include "rk_mpi_venc.h"
+#include "rk_mpi_vi.h"
+#include "rk_mpi_vpss.h"
+
+// 流水线访问 VI / MB / VENC 的薄抽象层
+// - 方法与 RK_MPI_* 一一对应（参数、返回码、句柄类型都沿用 rockit 定义），移植时只是换个调用入口
+// - 板端后端（RockitMpiHal）原样转发到 rockit；主机后端（HostMpiHal）用普通内存、
+//   合成/文件 NV12 帧和桩编码器模拟，同一套采集-裁剪-编码-推流循环可以在 x86 上跑和测
+// - RGA 裁剪/拷贝仍由 TileSlicer / CanvasCompositor 封装，非板端构建自动走 CPU 路径
+class MpiHal {
+public:
+    virtual ~MpiHal() {}
+
+    virtual const char *Name() const = 0;
+
+    // 系统
+    virtual bool SysInit() = 0;
+    virtual void SysExit() = 0;
+
+    // VI：ViInit 打开设备/通道并设置输出尺寸（NV12）
+    // bufCount 为 VI 缓冲数，depth 为用户可取帧的队列深度；绑定到下游模块时须 depth < bufCount
+    virtual bool ViInit(int width, int height, int bufCount, int depth) = 0;
+    virtual RK_S32 ViGetChnFrame(int pipe, int chn, VIDEO_FRAME_INFO_S *frame, RK_S32 timeoutMs) = 0;
+    virtual RK_S32 ViReleaseChnFrame(int pipe, int chn, const VIDEO_FRAME_INFO_S *frame) = 0;
+
+    // MB 内存池
+    virtual MB_POOL MbCreatePool(MB_POOL_CONFIG_S *cfg) = 0;
+    virtual RK_S32 MbDestroyPool(MB_POOL pool) = 0;
+    virtual MB_BLK MbGetMB(MB_POOL pool, RK_U64 size, RK_BOOL block) = 0;
+    virtual RK_S32 MbReleaseMB(MB_BLK blk) = 0;
+    virtual void *MbHandle2VirAddr(MB_BLK blk) = 0;
+    virtual RK_S32 MbHandle2Fd(MB_BLK blk) = 0;
+    virtual MB_POOL MbHandle2PoolId(MB_BLK blk) = 0;
+    // 块当前的引用数（送进 VENC 后编码完成前，编码器也持有一份）
+    virtual RK_S32 MbInquireUserCnt(MB_BLK blk) = 0;
+    virtual RK_S32 SysMmzFlushCache(MB_BLK blk, RK_BOOL readOnly) = 0;
+    // 只维护块内 [offset, offset + length) 的缓存：readOnly 为 RK_TRUE 时把 CPU 写入刷给硬件，
+    // 否则在 CPU 读硬件写入的数据前作废旧缓存行（语义同 SysMmzFlushCache）
+    virtual RK_S32 SysMmzFlushCacheRange(MB_BLK blk, RK_U32 offset, RK_U32 length, RK_BOOL readOnly) = 0;
+
+    // VENC
+    virtual RK_S32 VencCreateChn(int chn, const VENC_CHN_ATTR_S *attr) = 0;
+    virtual RK_S32 VencStartRecvFrame(int chn, const VENC_RECV_PIC_PARAM_S *param) = 0;
+    // 停止接收后通道保留（码控、已编码未取走的码流不变），可再次 StartRecvFrame
+    virtual RK_S32 VencStopRecvFrame(int chn) = 0;
+    // 运行中改码控（码率 / CBR、VBR、AVBR 切换），编码尺寸不可变
+    virtual RK_S32 VencGetChnAttr(int chn, VENC_CHN_ATTR_S *attr) = 0;
+    virtual RK_S32 VencSetChnAttr(int chn, const VENC_CHN_ATTR_S *attr) = 0;
+    virtual RK_S32 VencSendFrame(int chn, const VIDEO_FRAME_INFO_S *frame, RK_S32 timeoutMs) = 0;
+    virtual RK_S32 VencGetStream(int chn, VENC_STREAM_S *stream, RK_S32 timeoutMs) = 0;
+    virtual RK_S32 VencReleaseStream(int chn, VENC_STREAM_S *stream) = 0;
+    // u32CurPacks 为下一帧码流的 pack 数，取流前据此准备 pack 数组
+    virtual RK_S32 VencQueryStatus(int chn, VENC_CHN_STATUS_S *status) = 0;
+    virtual RK_S32 VencGetFd(int chn) = 0;
+    virtual RK_S32 VencCloseFd(int chn) = 0;
+    // I 帧控制：RequestIDR 让后续一帧编为 IDR 并从该帧重新计 GOP；SetIntraRefresh 开启逐行/逐列帧内刷新
+    virtual RK_S32 VencRequestIDR(int chn, RK_BOOL instant) = 0;
+    virtual RK_S32 VencSetIntraRefresh(int chn, const VENC_INTRA_REFRESH_S *refresh) = 0;
+
+    // VPSS：每组一个输入、最多 VPSS_MAX_CHN_NUM 个输出通道，通道可各自裁剪
+    virtual RK_S32 VpssCreateGrp(int grp, const VPSS_GRP_ATTR_S *attr) = 0;
+    virtual RK_S32 VpssDestroyGrp(int grp) = 0;
+    virtual RK_S32 VpssStartGrp(int grp) = 0;
+    virtual RK_S32 VpssStopGrp(int grp) = 0;
+    virtual RK_S32 VpssSetChnAttr(int grp, int chn, const VPSS_CHN_ATTR_S *attr) = 0;
+    virtual RK_S32 VpssSetChnCrop(int grp, int chn, const VPSS_CROP_INFO_S *crop) = 0;
+    virtual RK_S32 VpssEnableChn(int grp, int chn) = 0;
+    virtual RK_S32 VpssDisableChn(int grp, int chn) = 0;
+
+    // 模块绑定：绑定后帧在媒体框架内流转（VI -> VPSS -> VENC），不再经过用户态
+    virtual RK_S32 SysBind(const MPP_CHN_S *src, const MPP_CHN_S *dst) = 0;
+    virtual RK_S32 SysUnBind(const MPP_CHN_S *src, const MPP_CHN_S *dst) = 0;
+};
+
+// 当前后端：板端默认 rockit（环境变量 ZWH_MPI_HAL=host 时改用仿真），主机构建固定为仿真
+MpiHal *GetMpiHal();
+
+// 替换后端（需在流水线启动前调用，例如基准程序注入自定义参数的 HostMpiHal）
+void SetMpiHal(MpiHal *hal);
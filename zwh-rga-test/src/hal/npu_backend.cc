@@ -0,0 +1,34 @@
+#include "npu_backend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rknn_npu_backend.h"
+#include "stub_npu_backend.h"
+
+static NpuBackend *g_npu = nullptr;
+
+static NpuBackend *CreateDefaultNpuBackend() {
+#ifdef RV1106_1103
+    const char *name = getenv("ZWH_NPU");
+    if (!name || strcmp(name, "stub") != 0) {
+        static RknnNpuBackend rknnBackend;
+        return &rknnBackend;
+    }
+#endif
+    static StubNpuBackend stubBackend;
+    return &stubBackend;
+}
+
+NpuBackend *GetNpuBackend() {
+    if (!g_npu) {
+        g_npu = CreateDefaultNpuBackend();
+        printf("NpuBackend: %s\n", g_npu->Name());
+    }
+    return g_npu;
+}
+
+void SetNpuBackend(NpuBackend *backend) {
+    g_npu = backend;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "mpi_hal.h"
+
+// NPU 输出张量（NHWC int8，仿射量化）：gridH x gridW 个格点，每个格点 channels 个有效通道，
+// 相邻格点间隔 cellStride 个元素（原生布局可能按对齐填充通道）
+struct NpuTensor {
+    const int8_t *data = nullptr;
+    int gridH = 0;
+    int gridW = 0;
+    int channels = 0;
+    int cellStride = 0;
+    int32_t zp = 0;
+    float scale = 1.0f;
+};
+
+// 模型输入：RGB888 NHWC，每行 wstride 个像素
+struct NpuModelInfo {
+    int width = 0;
+    int height = 0;
+    int wstride = 0;
+    int outputCount = 0;
+};
+
+// NPU 推理后端：板端走 RKNN，主机上用桩实现验证调度与结果分发
+// - 输入缓冲由调用方从 MB 池取出，启动时逐块 BindInput 注册一次（板端即 rknn_create_mem_from_mb_blk），
+//   之后每次 Run 只指明用哪一块，不经 CPU 拷贝
+// - 输出缓冲由后端持有，Run 返回的张量在下一次 Run / Unload 之前有效
+// - 同一后端实例只在一个线程里 Run
+class NpuBackend {
+public:
+    virtual ~NpuBackend() {}
+
+    virtual const char *Name() const = 0;
+
+    virtual bool Load(const char *modelPath, NpuModelInfo *info) = 0;
+    // 释放已注册的输入与模型，须在输入 MB 归还之前调用
+    virtual void Unload() = 0;
+
+    // 注册一块输入缓冲（至少 wstride * height * 3 字节），返回输入句柄，失败返回 -1
+    virtual int BindInput(MB_BLK blk) = 0;
+
+    // 以 input 句柄对应的缓冲为输入同步推理一次
+    virtual bool Run(int input, const NpuTensor **outputs, int *count) = 0;
+};
+
+// 全局后端：板端默认 RKNN，环境变量 ZWH_NPU=stub 或主机构建时为桩实现
+NpuBackend *GetNpuBackend();
+// 替换全局后端（基准程序注入带参数的桩实现），须在流水线启动前调用
+void SetNpuBackend(NpuBackend *backend);
@@ -0,0 +1,142 @@
+#include "rknn_npu_backend.h"
+
+#ifdef RV1106_1103
+
+#include <stdio.h>
+#include <string.h>
+
+bool RknnNpuBackend::Load(const char *modelPath, NpuModelInfo *info) {
+    if (ctx_) Unload();
+    FILE *fp = modelPath ? fopen(modelPath, "rb") : NULL;
+    if (!fp) {
+        printf("RknnNpuBackend: open model %s failed\n", modelPath ? modelPath : "(null)");
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    std::vector<char> model(size > 0 ? size : 0);
+    bool readOk = size > 0 && fread(model.data(), 1, model.size(), fp) == model.size();
+    fclose(fp);
+    if (!readOk) {
+        printf("RknnNpuBackend: read model %s failed\n", modelPath);
+        return false;
+    }
+
+    int ret = rknn_init(&ctx_, model.data(), (uint32_t)model.size(), 0, NULL);
+    if (ret != RKNN_SUCC) {
+        printf("RknnNpuBackend: rknn_init ret=%d\n", ret);
+        ctx_ = 0;
+        return false;
+    }
+
+    rknn_input_output_num ioNum;
+    memset(&ioNum, 0, sizeof(ioNum));
+    ret = rknn_query(ctx_, RKNN_QUERY_IN_OUT_NUM, &ioNum, sizeof(ioNum));
+    if (ret != RKNN_SUCC || ioNum.n_input != 1 || ioNum.n_output == 0) {
+        printf("RknnNpuBackend: unsupported model io %u/%u ret=%d\n", ioNum.n_input, ioNum.n_output, ret);
+        Unload();
+        return false;
+    }
+
+    // 输入按 NHWC uint8 RGB 直接喂 NPU，不做格式转换
+    memset(&inputAttr_, 0, sizeof(inputAttr_));
+    inputAttr_.index = 0;
+    ret = rknn_query(ctx_, RKNN_QUERY_NATIVE_INPUT_ATTR, &inputAttr_, sizeof(inputAttr_));
+    if (ret != RKNN_SUCC || inputAttr_.n_dims != 4 || inputAttr_.dims[3] != 3) {
+        printf("RknnNpuBackend: unsupported input attr ret=%d\n", ret);
+        Unload();
+        return false;
+    }
+    inputAttr_.type = RKNN_TENSOR_UINT8;
+    inputAttr_.fmt = RKNN_TENSOR_NHWC;
+
+    outputAttrs_.resize(ioNum.n_output);
+    outputMems_.assign(ioNum.n_output, NULL);
+    outputs_.resize(ioNum.n_output);
+    for (uint32_t i = 0; i < ioNum.n_output; ++i) {
+        rknn_tensor_attr &attr = outputAttrs_[i];
+        memset(&attr, 0, sizeof(attr));
+        attr.index = i;
+        ret = rknn_query(ctx_, RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR, &attr, sizeof(attr));
+        if (ret != RKNN_SUCC || attr.n_dims != 4 || attr.type != RKNN_TENSOR_INT8) {
+            printf("RknnNpuBackend: output %u unsupported attr ret=%d\n", i, ret);
+            Unload();
+            return false;
+        }
+        outputMems_[i] = rknn_create_mem(ctx_, attr.size_with_stride);
+        if (!outputMems_[i] || rknn_set_io_mem(ctx_, outputMems_[i], &attr) != RKNN_SUCC) {
+            printf("RknnNpuBackend: bind output %u failed\n", i);
+            Unload();
+            return false;
+        }
+        NpuTensor &tensor = outputs_[i];
+        tensor.data = static_cast<const int8_t *>(outputMems_[i]->virt_addr);
+        tensor.gridH = (int)attr.dims[1];
+        tensor.gridW = (int)attr.dims[2];
+        tensor.channels = (int)attr.dims[3];
+        tensor.cellStride = (int)(attr.size_with_stride / (attr.dims[1] * attr.dims[2]));
+        tensor.zp = attr.zp;
+        tensor.scale = attr.scale;
+    }
+
+    info->height = (int)inputAttr_.dims[1];
+    info->width = (int)inputAttr_.dims[2];
+    info->wstride = inputAttr_.w_stride ? (int)inputAttr_.w_stride : info->width;
+    info->outputCount = (int)ioNum.n_output;
+    printf("RknnNpuBackend: %s input %dx%d (stride %d), %u outputs\n", modelPath, info->width, info->height,
+           info->wstride, ioNum.n_output);
+    return true;
+}
+
+void RknnNpuBackend::Unload() {
+    if (!ctx_) return;
+    for (size_t i = 0; i < inputMems_.size(); ++i) rknn_destroy_mem(ctx_, inputMems_[i]);
+    for (size_t i = 0; i < outputMems_.size(); ++i) {
+        if (outputMems_[i]) rknn_destroy_mem(ctx_, outputMems_[i]);
+    }
+    inputMems_.clear();
+    outputMems_.clear();
+    outputAttrs_.clear();
+    outputs_.clear();
+    boundInput_ = -1;
+    rknn_destroy(ctx_);
+    ctx_ = 0;
+}
+
+int RknnNpuBackend::BindInput(MB_BLK blk) {
+    if (!ctx_) return -1;
+    rknn_tensor_mem *mem = rknn_create_mem_from_mb_blk(ctx_, blk, 0);
+    if (!mem) {
+        printf("RknnNpuBackend: rknn_create_mem_from_mb_blk failed\n");
+        return -1;
+    }
+    inputMems_.push_back(mem);
+    return (int)inputMems_.size() - 1;
+}
+
+bool RknnNpuBackend::Run(int input, const NpuTensor **outputs, int *count) {
+    if (!ctx_ || input < 0 || input >= (int)inputMems_.size()) return false;
+    if (input != boundInput_) {
+        int ret = rknn_set_io_mem(ctx_, inputMems_[input], &inputAttr_);
+        if (ret != RKNN_SUCC) {
+            printf("RknnNpuBackend: set input %d ret=%d\n", input, ret);
+            boundInput_ = -1;
+            return false;
+        }
+        boundInput_ = input;
+    }
+    int ret = rknn_run(ctx_, NULL);
+    if (ret != RKNN_SUCC) {
+        printf("RknnNpuBackend: rknn_run ret=%d\n", ret);
+        return false;
+    }
+    for (size_t i = 0; i < outputMems_.size(); ++i) {
+        rknn_mem_sync(ctx_, outputMems_[i], RKNN_MEMORY_SYNC_FROM_DEVICE);
+    }
+    *outputs = outputs_.data();
+    *count = (int)outputs_.size();
+    return true;
+}
+
+#endif // RV1106_1103
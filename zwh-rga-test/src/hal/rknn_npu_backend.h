@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+#include "npu_backend.h"
+#include "rknn_api.h"
+
+// 板端后端：RKNN（只在定义 RV1106_1103 的板端构建中实现）
+// - 输入：原生 NHWC uint8 属性，每块输入 MB 经 rknn_create_mem_from_mb_blk 注册一次，
+//   Run 换块时才重新 rknn_set_io_mem
+// - 输出：原生 NHWC int8，启动时 rknn_create_mem 分配并绑定，推理后按 FROM_DEVICE 同步缓存再交给解码
+class RknnNpuBackend : public NpuBackend {
+public:
+    ~RknnNpuBackend() override { Unload(); }
+
+    const char *Name() const override { return "rknn"; }
+
+    bool Load(const char *modelPath, NpuModelInfo *info) override;
+    void Unload() override;
+    int BindInput(MB_BLK blk) override;
+    bool Run(int input, const NpuTensor **outputs, int *count) override;
+
+private:
+    rknn_context ctx_ = 0;
+    rknn_tensor_attr inputAttr_;
+    std::vector<rknn_tensor_attr> outputAttrs_;
+    std::vector<rknn_tensor_mem *> inputMems_;
+    std::vector<rknn_tensor_mem *> outputMems_;
+    std::vector<NpuTensor> outputs_;
+    int boundInput_ = -1; // 当前 set_io_mem 绑定的输入句柄
+};
@@ -0,0 +1,170 @@
+#include "rockit_mpi_hal.h"
+
+#ifdef RV1106_1103
+
+#include "rk_mpi_mmz.h"
+#include "utils/luckfox_mpi.h"
+
+bool RockitMpiHal::SysInit() {
+    if (RK_MPI_SYS_Init() != RK_SUCCESS) {
+        printf("rk mpi sys init fail!\n");
+        return false;
+    }
+    return true;
+}
+
+void RockitMpiHal::SysExit() {
+    RK_MPI_SYS_Exit();
+}
+
+bool RockitMpiHal::ViInit(int width, int height, int bufCount, int depth) {
+    if (vi_dev_init() != 0) return false;
+    return vi_chn_init(0, width, height, bufCount, depth) == RK_SUCCESS;
+}
+
+RK_S32 RockitMpiHal::ViGetChnFrame(int pipe, int chn, VIDEO_FRAME_INFO_S *frame, RK_S32 timeoutMs) {
+    return RK_MPI_VI_GetChnFrame(pipe, chn, frame, timeoutMs);
+}
+
+RK_S32 RockitMpiHal::ViReleaseChnFrame(int pipe, int chn, const VIDEO_FRAME_INFO_S *frame) {
+    return RK_MPI_VI_ReleaseChnFrame(pipe, chn, frame);
+}
+
+MB_POOL RockitMpiHal::MbCreatePool(MB_POOL_CONFIG_S *cfg) {
+    return RK_MPI_MB_CreatePool(cfg);
+}
+
+RK_S32 RockitMpiHal::MbDestroyPool(MB_POOL pool) {
+    return RK_MPI_MB_DestroyPool(pool);
+}
+
+MB_BLK RockitMpiHal::MbGetMB(MB_POOL pool, RK_U64 size, RK_BOOL block) {
+    return RK_MPI_MB_GetMB(pool, size, block);
+}
+
+RK_S32 RockitMpiHal::MbReleaseMB(MB_BLK blk) {
+    return RK_MPI_MB_ReleaseMB(blk);
+}
+
+void *RockitMpiHal::MbHandle2VirAddr(MB_BLK blk) {
+    return RK_MPI_MB_Handle2VirAddr(blk);
+}
+
+RK_S32 RockitMpiHal::MbHandle2Fd(MB_BLK blk) {
+    return RK_MPI_MB_Handle2Fd(blk);
+}
+
+MB_POOL RockitMpiHal::MbHandle2PoolId(MB_BLK blk) {
+    return RK_MPI_MB_Handle2PoolId(blk);
+}
+
+RK_S32 RockitMpiHal::MbInquireUserCnt(MB_BLK blk) {
+    return RK_MPI_MB_InquireUserCnt(blk);
+}
+
+RK_S32 RockitMpiHal::SysMmzFlushCache(MB_BLK blk, RK_BOOL readOnly) {
+    return RK_MPI_SYS_MmzFlushCache(blk, readOnly);
+}
+
+// 按范围维护：CPU 写完交给硬件 = 结束 CPU 访问（clean），CPU 读之前 = 开始 CPU 访问（invalidate）；
+// 个别块不支持按范围时退回整块
+RK_S32 RockitMpiHal::SysMmzFlushCacheRange(MB_BLK blk, RK_U32 offset, RK_U32 length, RK_BOOL readOnly) {
+    RK_S32 ret = readOnly ? RK_MPI_MMZ_FlushCacheEnd(blk, offset, length, RK_MMZ_SYNC_WRITEONLY)
+                          : RK_MPI_MMZ_FlushCacheStart(blk, offset, length, RK_MMZ_SYNC_READONLY);
+    if (ret != RK_SUCCESS) ret = RK_MPI_SYS_MmzFlushCache(blk, readOnly);
+    return ret;
+}
+
+RK_S32 RockitMpiHal::VencCreateChn(int chn, const VENC_CHN_ATTR_S *attr) {
+    return RK_MPI_VENC_CreateChn(chn, attr);
+}
+
+RK_S32 RockitMpiHal::VencStartRecvFrame(int chn, const VENC_RECV_PIC_PARAM_S *param) {
+    return RK_MPI_VENC_StartRecvFrame(chn, param);
+}
+
+RK_S32 RockitMpiHal::VencStopRecvFrame(int chn) {
+    return RK_MPI_VENC_StopRecvFrame(chn);
+}
+
+RK_S32 RockitMpiHal::VencGetChnAttr(int chn, VENC_CHN_ATTR_S *attr) {
+    return RK_MPI_VENC_GetChnAttr(chn, attr);
+}
+
+RK_S32 RockitMpiHal::VencSetChnAttr(int chn, const VENC_CHN_ATTR_S *attr) {
+    return RK_MPI_VENC_SetChnAttr(chn, attr);
+}
+
+RK_S32 RockitMpiHal::VencSendFrame(int chn, const VIDEO_FRAME_INFO_S *frame, RK_S32 timeoutMs) {
+    return RK_MPI_VENC_SendFrame(chn, frame, timeoutMs);
+}
+
+RK_S32 RockitMpiHal::VencGetStream(int chn, VENC_STREAM_S *stream, RK_S32 timeoutMs) {
+    return RK_MPI_VENC_GetStream(chn, stream, timeoutMs);
+}
+
+RK_S32 RockitMpiHal::VencReleaseStream(int chn, VENC_STREAM_S *stream) {
+    return RK_MPI_VENC_ReleaseStream(chn, stream);
+}
+
+RK_S32 RockitMpiHal::VencQueryStatus(int chn, VENC_CHN_STATUS_S *status) {
+    return RK_MPI_VENC_QueryStatus(chn, status);
+}
+
+RK_S32 RockitMpiHal::VencGetFd(int chn) {
+    return RK_MPI_VENC_GetFd(chn);
+}
+
+RK_S32 RockitMpiHal::VencCloseFd(int chn) {
+    return RK_MPI_VENC_CloseFd(chn);
+}
+
+RK_S32 RockitMpiHal::VencRequestIDR(int chn, RK_BOOL instant) {
+    return RK_MPI_VENC_RequestIDR(chn, instant);
+}
+
+RK_S32 RockitMpiHal::VencSetIntraRefresh(int chn, const VENC_INTRA_REFRESH_S *refresh) {
+    return RK_MPI_VENC_SetIntraRefresh(chn, refresh);
+}
+
+RK_S32 RockitMpiHal::VpssCreateGrp(int grp, const VPSS_GRP_ATTR_S *attr) {
+    return RK_MPI_VPSS_CreateGrp(grp, attr);
+}
+
+RK_S32 RockitMpiHal::VpssDestroyGrp(int grp) {
+    return RK_MPI_VPSS_DestroyGrp(grp);
+}
+
+RK_S32 RockitMpiHal::VpssStartGrp(int grp) {
+    return RK_MPI_VPSS_StartGrp(grp);
+}
+
+RK_S32 RockitMpiHal::VpssStopGrp(int grp) {
+    return RK_MPI_VPSS_StopGrp(grp);
+}
+
+RK_S32 RockitMpiHal::VpssSetChnAttr(int grp, int chn, const VPSS_CHN_ATTR_S *attr) {
+    return RK_MPI_VPSS_SetChnAttr(grp, chn, attr);
+}
+
+RK_S32 RockitMpiHal::VpssSetChnCrop(int grp, int chn, const VPSS_CROP_INFO_S *crop) {
+    return RK_MPI_VPSS_SetChnCrop(grp, chn, crop);
+}
+
+RK_S32 RockitMpiHal::VpssEnableChn(int grp, int chn) {
+    return RK_MPI_VPSS_EnableChn(grp, chn);
+}
+
+RK_S32 RockitMpiHal::VpssDisableChn(int grp, int chn) {
+    return RK_MPI_VPSS_DisableChn(grp, chn);
+}
+
+RK_S32 RockitMpiHal::SysBind(const MPP_CHN_S *src, const MPP_CHN_S *dst) {
+    return RK_MPI_SYS_Bind(src, dst);
+}
+
+RK_S32 RockitMpiHal::SysUnBind(const MPP_CHN_S *src, const MPP_CHN_S *dst) {
+    return RK_MPI_SYS_UnBind(src, dst);
+}
+
+#endif // RV1106_1103
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "mpi_hal.h"
+
+// 板端后端：逐个转发到 rockit MPI（只在定义 RV1106_1103 的板端构建中实现）
+class RockitMpiHal : public MpiHal {
+public:
+    const char *Name() const override { return "rockit"; }
+
+    bool SysInit() override;
+    void SysExit() override;
+
+    bool ViInit(int width, int height, int bufCount, int depth) override;
+    RK_S32 ViGetChnFrame(int pipe, int chn, VIDEO_FRAME_INFO_S *frame, RK_S32 timeoutMs) override;
+    RK_S32 ViReleaseChnFrame(int pipe, int chn, const VIDEO_FRAME_INFO_S *frame) override;
+
+    MB_POOL MbCreatePool(MB_POOL_CONFIG_S *cfg) override;
+    RK_S32 MbDestroyPool(MB_POOL pool) override;
+    MB_BLK MbGetMB(MB_POOL pool, RK_U64 size, RK_BOOL block) override;
+    RK_S32 MbReleaseMB(MB_BLK blk) override;
+    void *MbHandle2VirAddr(MB_BLK blk) override;
+    RK_S32 MbHandle2Fd(MB_BLK blk) override;
+    MB_POOL MbHandle2PoolId(MB_BLK blk) override;
+    RK_S32 MbInquireUserCnt(MB_BLK blk) override;
+    RK_S32 SysMmzFlushCache(MB_BLK blk, RK_BOOL readOnly) override;
+    RK_S32 SysMmzFlushCacheRange(MB_BLK blk, RK_U32 offset, RK_U32 length, RK_BOOL readOnly) override;
+
+    RK_S32 VencCreateChn(int chn, const VENC_CHN_ATTR_S *attr) override;
+    RK_S32 VencStartRecvFrame(int chn, const VENC_RECV_PIC_PARAM_S *param) override;
+    RK_S32 VencStopRecvFrame(int chn) override;
+    RK_S32 VencGetChnAttr(int chn, VENC_CHN_ATTR_S *attr) override;
+    RK_S32 VencSetChnAttr(int chn, const VENC_CHN_ATTR_S *attr) override;
+    RK_S32 VencSendFrame(int chn, const VIDEO_FRAME_INFO_S *frame, RK_S32 timeoutMs) override;
+    RK_S32 VencGetStream(int chn, VENC_STREAM_S *stream, RK_S32 timeoutMs) override;
+    RK_S32 VencReleaseStream(int chn, VENC_STREAM_S *stream) override;
+    RK_S32 VencQueryStatus(int chn, VENC_CHN_STATUS_S *status) override;
+    RK_S32 VencGetFd(int chn) override;
+    RK_S32 VencCloseFd(int chn) override;
+    RK_S32 VencRequestIDR(int chn, RK_BOOL instant) override;
+    RK_S32 VencSetIntraRefresh(int chn, const VENC_INTRA_REFRESH_S *refresh) override;
+
+    RK_S32 VpssCreateGrp(int grp, const VPSS_GRP_ATTR_S *attr) override;
+    RK_S32 VpssDestroyGrp(int grp) override;
+    RK_S32 VpssStartGrp(int grp) override;
+    RK_S32 VpssStopGrp(int grp) override;
+    RK_S32 VpssSetChnAttr(int grp, int chn, const VPSS_CHN_ATTR_S *attr) override;
+    RK_S32 VpssSetChnCrop(int grp, int chn, const VPSS_CROP_INFO_S *crop) override;
+    RK_S32 VpssEnableChn(int grp, int chn) override;
+    RK_S32 VpssDisableChn(int grp, int chn) override;
+
+    RK_S32 SysBind(const MPP_CHN_S *src, const MPP_CHN_S *dst) override;
+    RK_S32 SysUnBind(const MPP_CHN_S *src, const MPP_CHN_S *dst) override;
+};
@@ -0,0 +1,106 @@
+// 主机构建用的 rtsp_demo 桩实现：不开端口，只统计推送的帧数和字节数
+// 环境变量 ZWH_RTSP_STUB_TX_US 为每次 rtsp_tx_video 的模拟耗时（微秒），用来模拟慢客户端
+// 板端构建链接真正的 librtsp，本文件为空
+#ifndef RV1106_1103
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "rtsp_demo.h"
+
+struct StubSession {
+    std::string path;
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+};
+
+struct StubDemo {
+    int port = 0;
+};
+
+static uint64_t NowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+extern "C" {
+
+rtsp_demo_handle rtsp_new_demo(int port) {
+    StubDemo *demo = new StubDemo();
+    demo->port = port;
+    printf("rtsp stub: demo on port %d (no socket on host)\n", port);
+    return demo;
+}
+
+rtsp_demo_handle create_rtsp_demo(int port) {
+    return rtsp_new_demo(port);
+}
+
+int rtsp_do_event(rtsp_demo_handle demo) {
+    (void)demo;
+    return 0;
+}
+
+rtsp_session_handle rtsp_new_session(rtsp_demo_handle demo, const char *path) {
+    if (!demo || !path) return NULL;
+    StubSession *session = new StubSession();
+    session->path = path;
+    return session;
+}
+
+rtsp_session_handle create_rtsp_session(rtsp_demo_handle demo, const char *path) {
+    return rtsp_new_session(demo, path);
+}
+
+int rtsp_set_video(rtsp_session_handle session, int codec_id, const uint8_t *codec_data, int data_len) {
+    (void)session;
+    (void)codec_id;
+    (void)codec_data;
+    (void)data_len;
+    return 0;
+}
+
+int rtsp_tx_video(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts) {
+    (void)frame;
+    (void)ts;
+    StubSession *s = static_cast<StubSession *>(session);
+    if (!s || len < 0) return -1;
+    static const char *txUs = getenv("ZWH_RTSP_STUB_TX_US");
+    if (txUs && atoi(txUs) > 0) usleep(atoi(txUs));
+    s->frames++;
+    s->bytes += len;
+    return len;
+}
+
+void rtsp_del_session(rtsp_session_handle session) {
+    delete static_cast<StubSession *>(session);
+}
+
+void rtsp_del_demo(rtsp_demo_handle demo) {
+    delete static_cast<StubDemo *>(demo);
+}
+
+uint64_t rtsp_get_reltime(void) {
+    return NowUs();
+}
+
+uint64_t rtsp_get_ntptime(void) {
+    return NowUs();
+}
+
+int rtsp_sync_video_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime) {
+    (void)session;
+    (void)ts;
+    (void)ntptime;
+    return 0;
+}
+
+} // extern "C"
+
+#endif // RV1106_1103
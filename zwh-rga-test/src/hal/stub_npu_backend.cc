@@ -0,0 +1,91 @@
+#include "stub_npu_backend.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static const int kAnchors = 3;
+static const int kProps = 5 + 80; // xywh + objectness + 80 类
+static const int kStrides[3] = {8, 16, 32};
+static const int kMinBrightness = 3 * 160; // 抽样点 R+G+B 低于此值视为画面里没有目标
+
+// [0,1] 概率按 zp=-128、scale=1/255 量化
+static int8_t Quantize(float prob) {
+    return (int8_t)((int)(prob * 255.0f + 0.5f) - 128);
+}
+
+bool StubNpuBackend::Load(const char *modelPath, NpuModelInfo *info) {
+    (void)modelPath; // 桩后端不读模型文件
+    if (options_.width % 32 || options_.height % 32) {
+        printf("StubNpuBackend: input %dx%d must be a multiple of 32\n", options_.width, options_.height);
+        return false;
+    }
+    for (int i = 0; i < kHeads; ++i) {
+        NpuTensor &tensor = outputs_[i];
+        tensor.gridH = options_.height / kStrides[i];
+        tensor.gridW = options_.width / kStrides[i];
+        tensor.channels = kAnchors * kProps;
+        tensor.cellStride = tensor.channels;
+        tensor.zp = -128;
+        tensor.scale = 1.0f / 255.0f;
+        heads_[i].assign((size_t)tensor.gridH * tensor.gridW * tensor.cellStride, Quantize(0.0f));
+        tensor.data = heads_[i].data();
+    }
+    info->width = options_.width;
+    info->height = options_.height;
+    info->wstride = options_.width;
+    info->outputCount = kHeads;
+    inputs_.clear();
+    runs_ = 0;
+    loaded_ = true;
+    printf("StubNpuBackend: input %dx%d, %dus per run\n", options_.width, options_.height, options_.inferUs);
+    return true;
+}
+
+void StubNpuBackend::Unload() {
+    inputs_.clear();
+    loaded_ = false;
+}
+
+int StubNpuBackend::BindInput(MB_BLK blk) {
+    const uint8_t *vir = static_cast<const uint8_t *>(GetMpiHal()->MbHandle2VirAddr(blk));
+    if (!loaded_ || !vir) return -1;
+    inputs_.push_back(vir);
+    return (int)inputs_.size() - 1;
+}
+
+bool StubNpuBackend::Run(int input, const NpuTensor **outputs, int *count) {
+    if (!loaded_ || input < 0 || input >= (int)inputs_.size()) return false;
+    if (options_.inferUs > 0) usleep(options_.inferUs);
+
+    // 步长 32 的格点中心抽样，取 R+G+B 最大的格点
+    const uint8_t *rgb = inputs_[input];
+    const NpuTensor &head = outputs_[kHeads - 1];
+    int bestX = 0;
+    int bestY = 0;
+    int bestSum = -1;
+    for (int gy = 0; gy < head.gridH; ++gy) {
+        for (int gx = 0; gx < head.gridW; ++gx) {
+            const uint8_t *px = rgb + ((size_t)(gy * 32 + 16) * options_.width + gx * 32 + 16) * 3;
+            int sum = px[0] + px[1] + px[2];
+            if (sum > bestSum) {
+                bestSum = sum;
+                bestX = gx;
+                bestY = gy;
+            }
+        }
+    }
+
+    for (int i = 0; i < kHeads; ++i) memset(heads_[i].data(), Quantize(0.0f), heads_[i].size());
+    runs_++;
+    *outputs = outputs_;
+    *count = kHeads;
+    if (bestSum < kMinBrightness) return true;
+
+    // dx=dy=0.5 即格点中心，dw=dh=0.5 即 anchor 原尺寸
+    int8_t *cell = heads_[kHeads - 1].data() + ((size_t)bestY * head.gridW + bestX) * head.cellStride;
+    for (int k = 0; k < 4; ++k) cell[k] = Quantize(0.5f);
+    cell[4] = Quantize(0.9f);
+    cell[5] = Quantize(0.9f);
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "npu_backend.h"
+
+// 桩后端：不依赖 NPU，按 YOLOv5 的三个输出头（步长 8/16/32，每格 3 个 anchor x 85 通道）造输出
+// - 推理耗时用 usleep 模拟（NPU 推理不占 CPU）
+// - 按步长 32 的格点抽样输入 RGB，在最亮的格点放一个 0 类目标，框为该步长的第一个 anchor，
+//   检测结果随画面内容移动，便于确认输入确实来自注册的 MB 块；整幅都暗时不出目标
+// - 量化参数固定为 zp=-128、scale=1/255（sigmoid 输出 [0,1] 映射到 int8 全范围）
+class StubNpuBackend : public NpuBackend {
+public:
+    struct Options {
+        int inferUs = 20000; // 单次推理模拟耗时
+        int width = 640;
+        int height = 640;
+    };
+
+    StubNpuBackend() {}
+    explicit StubNpuBackend(const Options &options) : options_(options) {}
+
+    const char *Name() const override { return "stub"; }
+
+    bool Load(const char *modelPath, NpuModelInfo *info) override;
+    void Unload() override;
+    int BindInput(MB_BLK blk) override;
+    bool Run(int input, const NpuTensor **outputs, int *count) override;
+
+    uint64_t Runs() const { return runs_; }
+
+private:
+    static const int kHeads = 3;
+
+    Options options_;
+    bool loaded_ = false;
+    std::vector<const uint8_t *> inputs_;
+    std::vector<int8_t> heads_[kHeads];
+    NpuTensor outputs_[kHeads];
+    uint64_t runs_ = 0;
+};
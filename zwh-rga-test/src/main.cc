@@ -1,28 +1,154 @@
 /*****************************************************************************
- * RV1106 4x4 多路编码演示流程 (VI -> RGA -> 16x VENC -> 16x RTSP)
- * 说明：演示如何将 1080P 摄像头输入切分为 4x4 共 16 路子画面，
+ * RV1106 多路编码演示流程 (VI -> RGA/VPSS -> Nx VENC -> Nx RTSP)
+ * 说明：演示如何将摄像头输入按网格（默认 1080P 切 4x4 共 16 路）切分为子画面，
  *      依次送入硬件编码器，再通过 RTSP 推流。重点展示 ISP 初始化、
  *      RGA 裁剪、VENC 编码以及 RTSP 会话管理的基本用法。
+ * 用法：zwh-mpi-test [mode] [compositeMode] [tileEndpoint] [--src=WxH] [--grid=CxR]
+ *                    [--tile=WxH] [--config=<file>] [--motion=off|<阈值>[,<刷新帧数>]]
+ *                    [--merge-motion=off|<阈值>[,<刷新帧数>]]
+ *                    [--metrics=off|<导出周期ms>[,<查询 socket 路径>]] [--workers=N] [--vpss=<组数>]
+ *                    [--gop=sync|stagger|refresh[,<gop>]] [--bitrate=off|<总码率kbps>[,<周期ms>[,<轨迹文件>]]]
+ *                    [--rtsp=<每会话积压帧数>[,<积压KB>]] [--lazy=off|<常驻 tile 掩码>]
+ *                    [--record=off|<总MB>[,<段MB>[,<目录>]]]
+ *                    [--pre-event=off|<内存预算KB>[,<事前ms>[,<事后ms>[,<目录>]]]]
+ *                    [--detect=off|<间隔ms>[,frame|tiles[,<模型路径>]]]
+ * --lazy 开启按需编码：只编码被网络接收端订阅的 tile 和常驻掩码中的 tile（RTSP 观看的 tile 须常驻）
+ * 运行中 kill -USR1 让所有 tile 同步出 IDR（接收端需要整体重同步时）
+ * 开启 --pre-event 时 kill -USR2 导出所有 tile 触发前后的片段
+ * --detect 按间隔把缩放后的整帧或轮到的 tile 送 NPU 检测（环境变量 ZWH_NPU=stub 时用桩后端）
+ * --motion 只作用于 tile 流；合并模式（mode 1）默认每帧整幅重写常驻画布，
+ * 显式给出 --merge-motion 时才按变化检测只重写变化的 tile（静止的 tile 不再重画）
  *****************************************************************************/
 
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "hal/mpi_hal.h"
 #include "utils/config.h"
+#include "utils/cache_sync.h"
+#include "utils/pipeline_metrics.h"
+#include "utils/rga_buffer_registry.h"
 #include "utils/rtsp_helper.h"
 #include "utils/pipeline_init.h"
 #include "process/test/process_loop.h"
+#include "process/bind/process_bind_loop.h"
 #include "process/merge/process_merge_loop.h"
 #include "process/net/process_net_loop.h"
 
+// Ctrl+C：让处理循环退出，走完下面的资源释放
+static void HandleSignal(int sig) {
+    (void)sig;
+    RequestPipelineStop();
+}
+
+// SIGUSR1：所有编码通道同步出 IDR，之后调度器重新错开
+static void HandleResync(int sig) {
+    (void)sig;
+    RequestKeyframeResync();
+}
+
+// SIGUSR2：导出事前录像片段
+static void HandlePreEventExport(int sig) {
+    (void)sig;
+    RequestPreEventExport();
+}
+
 int main(int argc, char *argv[]) {
-    // mode: 0=原始16路推流；1=合并推流；2=网络裁剪传输测试
-    int mode = 0;
-    if (argc > 1) {
-        mode = atoi(argv[1]);
-        
+    // "--" 开头的参数是网格 / 变化检测 / 指标配置，其余按位置解析
+    GridConfig grid;
+    TileMotionGate::Options motion;
+    TileMotionGate::Options mergeMotion = TileMotionGate::Off();
+    PipelineMetrics::Options metrics;
+    int tileWorkers = kDefaultTileWorkers;
+    int vpssGroups = kDefaultVpssGroups;
+    GopScheduler::Options gop;
+    BitrateAllocator::Options bitrate;
+    RtspService::Options rtsp;
+    TileSubscriptions::Options lazy;
+    TileRecorder::Options record;
+    PreEventBuffer::Options preEvent;
+    TileDetector::Options detect;
+    const char *args[3] = {NULL, NULL, NULL};
+    int argCnt = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--motion=", 9) == 0) {
+            if (!TileMotionGate::ParseOption(argv[i] + 9, &motion)) {
+                printf("bad option \"%s\"\n", argv[i]);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--merge-motion=", 15) == 0) {
+            if (!TileMotionGate::ParseOption(argv[i] + 15, &mergeMotion)) {
+                printf("bad option \"%s\"\n", argv[i]);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--metrics=", 10) == 0) {
+            if (!PipelineMetrics::ParseOption(argv[i] + 10, &metrics)) {
+                printf("bad option \"%s\"\n", argv[i]);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--workers=", 10) == 0) {
+            tileWorkers = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--gop=", 6) == 0) {
+            if (!GopScheduler::ParseOption(argv[i] + 6, &gop)) {
+                printf("bad option \"%s\"\n", argv[i]);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--bitrate=", 10) == 0) {
+            if (!BitrateAllocator::ParseOption(argv[i] + 10, &bitrate)) {
+                printf("bad option \"%s\"\n", argv[i]);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--rtsp=", 7) == 0) {
+            if (!RtspService::ParseOption(argv[i] + 7, &rtsp)) {
+                printf("bad option \"%s\"\n", argv[i]);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--lazy=", 7) == 0) {
+            if (!TileSubscriptions::ParseOption(argv[i] + 7, &lazy)) {
+                printf("bad option \"%s\"\n", argv[i]);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--record=", 9) == 0) {
+            if (!TileRecorder::ParseOption(argv[i] + 9, &record)) {
+                printf("bad option \"%s\"\n", argv[i]);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--pre-event=", 12) == 0) {
+            if (!PreEventBuffer::ParseOption(argv[i] + 12, &preEvent)) {
+                printf("bad option \"%s\"\n", argv[i]);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--detect=", 9) == 0) {
+            if (!TileDetector::ParseOption(argv[i] + 9, &detect)) {
+                printf("bad option \"%s\"\n", argv[i]);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--vpss=", 7) == 0) {
+            vpssGroups = atoi(argv[i] + 7);
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            if (!ParseGridOption(&grid, argv[i])) return -1;
+        } else if (argCnt < 3) {
+            args[argCnt++] = argv[i];
+        }
     }
-    printf("Run mode: %d (0=16ch, 1=merged, 2=net test)\n", mode);
+    // 网格决定内存池、VENC 通道、RTSP 会话和掩码的规模，须在初始化它们之前确定
+    if (!ApplyGridConfig(grid)) return -1;
+    // 指标默认开启：周期打印一行 [METRICS]，并可经本地 socket 查询
+    if (!GetPipelineMetrics().Start(metrics)) return -1;
+
+    // mode: 0=原始多路推流；1=合并推流；2=网络裁剪传输测试；3=VI->VPSS->VENC 绑定直通
+    int mode = args[0] ? atoi(args[0]) : 0;
+    // 合并模式的画布合成方式：0=CPU memcpy，1=RGA，2=自动（无跳过 tile 时直通 VI 帧）
+    int compositeMode = args[1] ? atoi(args[1]) : COMPOSITE_AUTO;
+    // 可选的 tile 网络目的地址 "[udp://|tcp://]ip:port"（模式 0/2/3 使用）
+    const char *tileEndpoint = args[2];
+    printf("Run mode: %d (0=%dch, 1=merged, 2=net test, 3=vpss bind)\n", mode, TOTAL_CHNS);
+    signal(SIGINT, HandleSignal);
+    signal(SIGTERM, HandleSignal);
+    signal(SIGUSR1, HandleResync);
+    signal(SIGUSR2, HandlePreEventExport);
 
     // 初始化基础 MPI 系统
     if (!InitMpiSys()) {
@@ -33,16 +159,20 @@ int main(int argc, char *argv[]) {
     // 开启 ISP（RKAIQ），确保自动曝光/白平衡等 3A 生效
     StartIsp();
 
-    // 创建 RTSP Server，并为 16 路编码分别建立 session
+    // 创建 RTSP Server 与服务线程，并为每路编码分别建立 session
+    // tile 通道为帧内刷新时，慢客户端丢帧后等下一轮刷新而不是请求 IDR（只有模式 0/3 的 tile 通道受 --gop 影响）
+    if ((mode == 0 || mode == 3) && gop.mode == GopScheduler::GOP_REFRESH) rtsp.refreshFrames = gop.gop;
     RtspContext rtspCtx;
 
-    if (!InitRtsp(rtspCtx)) {
+    if (!InitRtsp(rtspCtx, rtsp)) {
         printf("InitRtsp failed\n");
         return -1;
     }
 
-    // 初始化 VI，打开摄像头并设置 1080P 输入
-    InitViInput();
+    // 初始化 VI，打开摄像头并设置 SRC_WIDTH x SRC_HEIGHT 输入（绑定模式下 VI 同时供给 VPSS）
+    if (!InitViInput(mode == 3)) {
+        return -1;
+    }
 
     MB_POOL subImgPool = MB_INVALID_POOLID;
     if (mode != 1) {
@@ -53,27 +183,49 @@ int main(int argc, char *argv[]) {
     }
 
     if (mode == 1) {
-        // 合并模式：跳过一个 tile 的同时拼回 1080P，推送 /live/merged
-        ProcessMergedFrames(rtspCtx, subImgPool);
+        // 合并模式：跳过一个 tile 的同时拼回整幅画面，推送 /live/merged
+        ProcessMergedFrames(rtspCtx, subImgPool, (CompositeMode)compositeMode, mergeMotion);
     } else if (mode == 2) {
         // 网络裁剪传输测试：裁剪子画面后走 SendTileOverNetwork_Test
-        ProcessNetLoop(rtspCtx, subImgPool);
+        ProcessNetLoop(rtspCtx, subImgPool, tileEndpoint, motion);
     } else {
-        // 原始模式：16 路独立编码 + 推流
-        if (!InitVencChannels()) {
+        // 原始模式：每个 tile 独立编码 + 推流；绑定模式下 VPSS 通道覆盖的 tile 不经用户态
+        // 各路从总预算的平均值起步，之后由 BitrateAllocator 按内容复杂度重新分配
+        if (bitrate.totalKbps <= 0) bitrate.totalKbps = TOTAL_CHNS * BitrateAllocator::kDefaultTileKbps;
+        if (!InitVencChannels(GopScheduler::ChannelGop(gop), bitrate.totalKbps / TOTAL_CHNS)) {
             printf("InitVencChannels failed\n");
             return -1;
         }
-        ProcessFrames(rtspCtx, subImgPool);
+        ProcessOptions options;
+        options.tileEndpoint = tileEndpoint;
+        options.motion = motion;
+        options.tileWorkers = tileWorkers;
+        options.gop = gop;
+        options.bitrate = bitrate;
+        options.lazy = lazy;
+        options.record = record;
+        options.preEvent = preEvent;
+        options.detect = detect;
+        if (mode == 3) {
+            ProcessBindLoop(rtspCtx, subImgPool, options, vpssGroups);
+        } else {
+            ProcessFrames(rtspCtx, subImgPool, options);
+        }
     }
 
+    // 先归还导入 RGA 的 handle 再销毁池；VI 内部池的块在退出 MPI 前一并归还
     if (subImgPool != MB_INVALID_POOLID) {
-        RK_MPI_MB_DestroyPool(subImgPool);
+        GetRgaBufferRegistry().ReleasePool(subImgPool);
+        GetCacheSync().ReleasePool(subImgPool);
+        GetMpiHal()->MbDestroyPool(subImgPool);
     }
+    GetRgaBufferRegistry().ReleaseAll();
+    GetCacheSync().ReleaseAll();
 
-    // 第 6 步：退出前关闭 ISP（正常不会走到这里）
+    // 第 6 步：退出前关闭 ISP（收到 SIGINT/SIGTERM 后走到这里）
     StopIsp();
+    GetPipelineMetrics().Stop();
     CleanupRtsp(rtspCtx);
-    RK_MPI_SYS_Exit();
+    ExitMpiSys();
     return 0;
 }
@@ -0,0 +1,178 @@
+#include "process_bind_loop.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "hal/mpi_hal.h"
+#include "utils/config.h"
+
+// 一个 VPSS 组及其通道对应的 tile
+struct VpssGroupTiles {
+    int grp;
+    std::vector<int> tiles; // 下标为 VPSS 通道号
+};
+
+static MPP_CHN_S MakeChn(MOD_ID_E mod, int dev, int chn) {
+    MPP_CHN_S c;
+    c.enModId = mod;
+    c.s32DevId = dev;
+    c.s32ChnId = chn;
+    return c;
+}
+
+// 功能：配置并启动一个 VPSS 组，组内通道依次裁剪 tiles 中的子画面
+// 返回值：成功启用的通道数（从 0 号通道起连续），0 表示该组不可用且已销毁
+static int SetupVpssGroup(int grp, const std::vector<int> &tiles) {
+    MpiHal *hal = GetMpiHal();
+    VPSS_GRP_ATTR_S grpAttr;
+    memset(&grpAttr, 0, sizeof(grpAttr));
+    grpAttr.u32MaxW = SRC_WIDTH;
+    grpAttr.u32MaxH = SRC_HEIGHT;
+    grpAttr.enPixelFormat = RK_FMT_YUV420SP;
+    grpAttr.stFrameRate.s32SrcFrameRate = -1;
+    grpAttr.stFrameRate.s32DstFrameRate = -1;
+    RK_S32 ret = hal->VpssCreateGrp(grp, &grpAttr);
+    if (ret != RK_SUCCESS) {
+        printf("VpssCreateGrp %d failed, ret=0x%x\n", grp, ret);
+        return 0;
+    }
+
+    int enabled = 0;
+    for (size_t chn = 0; chn < tiles.size(); ++chn) {
+        int tileId = tiles[chn];
+        VPSS_CHN_ATTR_S chnAttr;
+        memset(&chnAttr, 0, sizeof(chnAttr));
+        chnAttr.enChnMode = VPSS_CHN_MODE_USER;
+        chnAttr.u32Width = SUB_WIDTH;
+        chnAttr.u32Height = SUB_HEIGHT;
+        chnAttr.enPixelFormat = RK_FMT_YUV420SP;
+        chnAttr.stFrameRate.s32SrcFrameRate = -1;
+        chnAttr.stFrameRate.s32DstFrameRate = -1;
+        chnAttr.u32Depth = 0; // 绑定输出，不留给用户态取帧
+
+        VPSS_CROP_INFO_S crop;
+        memset(&crop, 0, sizeof(crop));
+        crop.bEnable = RK_TRUE;
+        crop.enCropCoordinate = VPSS_CROP_ABS_COOR;
+        crop.stCropRect.s32X = GetGridConfig().TileX(tileId);
+        crop.stCropRect.s32Y = GetGridConfig().TileY(tileId);
+        crop.stCropRect.u32Width = SUB_WIDTH;
+        crop.stCropRect.u32Height = SUB_HEIGHT;
+
+        ret = hal->VpssSetChnAttr(grp, chn, &chnAttr);
+        if (ret == RK_SUCCESS) ret = hal->VpssSetChnCrop(grp, chn, &crop);
+        if (ret == RK_SUCCESS) ret = hal->VpssEnableChn(grp, chn);
+        if (ret != RK_SUCCESS) {
+            // 通道资源用尽：其余 tile 交给 RGA 路径
+            printf("VPSS grp %d chn %zu (tile %d) unavailable, ret=0x%x\n", grp, chn, tileId, ret);
+            break;
+        }
+        enabled++;
+    }
+
+    if (enabled > 0) ret = hal->VpssStartGrp(grp);
+    if (enabled == 0 || ret != RK_SUCCESS) {
+        for (int chn = 0; chn < enabled; ++chn) hal->VpssDisableChn(grp, chn);
+        hal->VpssDestroyGrp(grp);
+        return 0;
+    }
+    return enabled;
+}
+
+static void TeardownVpssGroup(const VpssGroupTiles &group) {
+    MpiHal *hal = GetMpiHal();
+    hal->VpssStopGrp(group.grp);
+    for (size_t chn = 0; chn < group.tiles.size(); ++chn) hal->VpssDisableChn(group.grp, chn);
+    hal->VpssDestroyGrp(group.grp);
+}
+
+// 功能：VI(0,0) -> VPSS 组，组内各通道 -> 同号 VENC 通道
+// 返回值：成功绑定的 tile 掩码；VI 绑定失败时为 0，已绑定的通道全部解开
+static TileMask BindVpssGroup(const VpssGroupTiles &group) {
+    MpiHal *hal = GetMpiHal();
+    MPP_CHN_S vi = MakeChn(RK_ID_VI, 0, 0);
+    MPP_CHN_S vpssIn = MakeChn(RK_ID_VPSS, group.grp, 0);
+    TileMask bound = 0;
+    for (size_t chn = 0; chn < group.tiles.size(); ++chn) {
+        MPP_CHN_S vpss = MakeChn(RK_ID_VPSS, group.grp, chn);
+        MPP_CHN_S venc = MakeChn(RK_ID_VENC, 0, group.tiles[chn]);
+        RK_S32 ret = hal->SysBind(&vpss, &venc);
+        if (ret != RK_SUCCESS) {
+            printf("bind VPSS(%d,%zu) -> VENC %d failed, ret=0x%x\n", group.grp, chn, group.tiles[chn], ret);
+            continue;
+        }
+        bound |= TILE_BIT(group.tiles[chn]);
+    }
+    if (bound == 0) return 0;
+    RK_S32 ret = hal->SysBind(&vi, &vpssIn);
+    if (ret != RK_SUCCESS) {
+        printf("bind VI -> VPSS grp %d failed, ret=0x%x\n", group.grp, ret);
+        for (size_t chn = 0; chn < group.tiles.size(); ++chn) {
+            if (!(bound & TILE_BIT(group.tiles[chn]))) continue;
+            MPP_CHN_S vpss = MakeChn(RK_ID_VPSS, group.grp, chn);
+            MPP_CHN_S venc = MakeChn(RK_ID_VENC, 0, group.tiles[chn]);
+            hal->SysUnBind(&vpss, &venc);
+        }
+        return 0;
+    }
+    return bound;
+}
+
+static void UnbindVpssGroup(const VpssGroupTiles &group, TileMask bound) {
+    MpiHal *hal = GetMpiHal();
+    MPP_CHN_S vi = MakeChn(RK_ID_VI, 0, 0);
+    MPP_CHN_S vpssIn = MakeChn(RK_ID_VPSS, group.grp, 0);
+    // 先断开输入，再断开各通道到编码器的绑定
+    hal->SysUnBind(&vi, &vpssIn);
+    for (size_t chn = 0; chn < group.tiles.size(); ++chn) {
+        if (!(bound & TILE_BIT(group.tiles[chn]))) continue;
+        MPP_CHN_S vpss = MakeChn(RK_ID_VPSS, group.grp, chn);
+        MPP_CHN_S venc = MakeChn(RK_ID_VENC, 0, group.tiles[chn]);
+        hal->SysUnBind(&vpss, &venc);
+    }
+}
+
+void ProcessBindLoop(const RtspContext &ctx, MB_POOL subImgPool, const ProcessOptions &options, int maxGroups) {
+    std::vector<VpssGroupTiles> groups;
+    std::vector<TileMask> groupBound;
+    TileMask bound = 0;
+    int nextTile = 0;
+    for (int grp = 0; grp < maxGroups && nextTile < TOTAL_CHNS; ++grp) {
+        VpssGroupTiles group;
+        group.grp = grp;
+        for (int chn = 0; chn < VPSS_MAX_CHN_NUM && nextTile + chn < TOTAL_CHNS; ++chn) {
+            group.tiles.push_back(nextTile + chn);
+        }
+        int enabled = SetupVpssGroup(grp, group.tiles);
+        if (enabled == 0) break; // 组资源用尽，后续 tile 全部回退
+        group.tiles.resize(enabled);
+        nextTile += enabled;
+
+        TileMask groupMask = BindVpssGroup(group);
+        if (groupMask == 0) {
+            TeardownVpssGroup(group);
+            break;
+        }
+        groups.push_back(group);
+        groupBound.push_back(groupMask);
+        bound |= groupMask;
+        if (enabled < (int)VPSS_MAX_CHN_NUM && nextTile < TOTAL_CHNS) break;
+    }
+
+    int boundCount = 0;
+    for (int tileId = 0; tileId < TOTAL_CHNS; ++tileId) {
+        if (bound & TILE_BIT(tileId)) boundCount++;
+    }
+    printf("ProcessBindLoop: %d/%d tiles bound VI->VPSS->VENC over %zu groups, %d via RGA\n", boundCount,
+           TOTAL_CHNS, groups.size(), TOTAL_CHNS - boundCount);
+
+    ProcessOptions loopOptions = options;
+    loopOptions.boundTiles = bound;
+    ProcessFrames(ctx, subImgPool, loopOptions);
+
+    for (size_t i = groups.size(); i-- > 0;) {
+        UnbindVpssGroup(groups[i], groupBound[i]);
+        TeardownVpssGroup(groups[i]);
+    }
+}
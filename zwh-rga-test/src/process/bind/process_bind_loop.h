@@ -0,0 +1,18 @@
+#pragma once
+
+#include "utils/luckfox_mpi.h"
+#include "utils/rtsp_helper.h"
+#include "process/test/process_loop.h"
+
+static const int kDefaultVpssGroups = 4;
+
+// 功能：绑定直通模式。每个 VPSS 组接 VI(0,0)，组内每个通道裁剪一个 tile 并绑定到同号 VENC 通道，
+//       tile 全程在媒体框架内流转，用户态只取码流推流；VPSS 通道不够的 tile 仍走 RGA 裁剪送编码
+// 参数：
+//   subImgPool - RGA 回退路径使用的子画面内存池
+//   options    - 同 ProcessFrames，boundTiles 由本函数按实际绑定成功的 tile 填写
+//   maxGroups  - 最多使用的 VPSS 组数（每组 VPSS_MAX_CHN_NUM 个 tile），0 表示全部走 RGA
+// 前置条件：InitViInput(true)、InitVencChannels 已完成
+// 返回值：无；循环到 RequestPipelineStop 后解绑并销毁 VPSS 再返回
+void ProcessBindLoop(const RtspContext &ctx, MB_POOL subImgPool, const ProcessOptions &options = ProcessOptions(),
+                     int maxGroups = kDefaultVpssGroups);
@@ -0,0 +1,241 @@
+#include "canvas_compositor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal/mpi_hal.h"
+#include "utils/cache_sync.h"
+#include "utils/nv12_blit.h"
+#include "utils/rga_buffer_registry.h"
+#ifdef RV1106_1103
+#include "im2d.h"
+#include "rga.h"
+#endif
+
+static const char *kPathNames[] = {"cpu", "rga", "passthrough"};
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+bool CanvasCompositor::Init(CompositeMode mode) {
+    mode_ = mode;
+    const char *env = getenv("ZWH_CANVAS");
+    fullRedraw_ = env && strcmp(env, "full") == 0;
+
+    MB_POOL_CONFIG_S cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.u64MBSize = SRC_WIDTH * SRC_HEIGHT * 3 / 2; // NV12
+    cfg.u32MBCnt = 2;                               // 两块常驻画布轮流使用
+    cfg.enAllocType = MB_ALLOC_TYPE_DMA;
+    canvasPool_ = GetMpiHal()->MbCreatePool(&cfg);
+    if (canvasPool_ == MB_INVALID_POOLID) {
+        printf("CanvasCompositor: create canvas pool failed.\n");
+        return false;
+    }
+    if (!canvases_.Init(canvasPool_)) return false;
+    printf("CanvasCompositor ready: mode=%d (0=cpu, 1=rga, 2=auto), %s\n", (int)mode_,
+           fullRedraw_ ? "full redraw" : "dirty tiles only");
+    return true;
+}
+
+CanvasCompositor::~CanvasCompositor() {
+    if (canvasPool_ != MB_INVALID_POOLID) {
+        GetRgaBufferRegistry().ReleasePool(canvasPool_);
+        GetCacheSync().ReleasePool(canvasPool_);
+        canvases_.Destroy();
+        GetMpiHal()->MbDestroyPool(canvasPool_);
+        canvasPool_ = MB_INVALID_POOLID;
+    }
+}
+
+// 直通：没有需要涂黑的 tile 且 VI 排布与编码器一致时，VI 帧原样交给 VENC
+bool CanvasCompositor::Passthrough(const VIDEO_FRAME_INFO_S &viFrame, TileMask skipMask) const {
+    bool sameLayout = viFrame.stVFrame.u32VirWidth == (RK_U32)SRC_WIDTH &&
+                      viFrame.stVFrame.u32VirHeight == (RK_U32)SRC_HEIGHT;
+    return mode_ == COMPOSITE_AUTO && skipMask == 0 && sameLayout;
+}
+
+bool CanvasCompositor::Compose(const VIDEO_FRAME_INFO_S &viFrame, TileMask skipMask, TileMask changedMask,
+                               VIDEO_FRAME_INFO_S *outFrame) {
+    if (!outFrame || canvasPool_ == MB_INVALID_POOLID) return false;
+    uint64_t startUs = GetUs();
+    const TileMask all = GetGridConfig().AllTilesMask();
+
+    // 直通帧不碰画布，变化累积到两块画布的过期标记里
+    canvases_.MarkChanged(fullRedraw_ ? all : (changedMask & all));
+    if (Passthrough(viFrame, skipMask)) {
+        *outFrame = viFrame;
+        Record(PATH_PASSTHROUGH, GetUs() - startUs);
+        return true;
+    }
+
+    TileCanvasPair::Canvas *canvas = canvases_.Acquire();
+    if (!canvas) return false;
+    skipMask &= all;
+    if (fullRedraw_) canvas->black = 0;
+    // 要显示的 tile：过期的或之前被涂黑的要拷；要涂黑的：之前不是黑的
+    TileMask copyMask = ~skipMask & all & (canvas->stale | canvas->black);
+    TileMask fillMask = skipMask & ~canvas->black;
+
+    Path path = (mode_ == COMPOSITE_CPU) ? PATH_CPU : PATH_RGA;
+    bool ok = true;
+    if (copyMask || fillMask) {
+        ok = (path == PATH_CPU) ? ComposeCpu(viFrame, copyMask, fillMask, canvas->blk)
+                                : ComposeRga(viFrame, copyMask, fillMask, canvas->blk);
+    }
+    if (!ok) {
+        // 画布内容不确定：下次用到时全部重写
+        canvas->stale = all;
+        canvas->black = 0;
+        return false;
+    }
+    canvases_.MarkWritten(canvas, copyMask | fillMask);
+    canvas->black = skipMask;
+
+    memset(outFrame, 0, sizeof(*outFrame));
+    outFrame->stVFrame.u32Width = SRC_WIDTH;
+    outFrame->stVFrame.u32Height = SRC_HEIGHT;
+    outFrame->stVFrame.u32VirWidth = SRC_WIDTH;
+    outFrame->stVFrame.u32VirHeight = SRC_HEIGHT;
+    outFrame->stVFrame.enPixelFormat = RK_FMT_YUV420SP;
+    outFrame->stVFrame.pMbBlk = canvas->blk;
+    outFrame->stVFrame.u64PTS = viFrame.stVFrame.u64PTS;
+    Record(path, GetUs() - startUs);
+    return true;
+}
+
+// 画布常驻，由合成器持有；直通帧属于 VI，由调用方 ReleaseChnFrame
+void CanvasCompositor::Release(VIDEO_FRAME_INFO_S *outFrame) {
+    if (!outFrame) return;
+    outFrame->stVFrame.pMbBlk = NULL;
+}
+
+// CPU 路径：逐 tile 拷贝/涂黑；读 VI 帧前只同步要拷的 tile 所在的行，写完把画布上改过的行 clean 给 VENC
+bool CanvasCompositor::ComposeCpu(const VIDEO_FRAME_INFO_S &viFrame, TileMask copyMask, TileMask fillMask,
+                                  MB_BLK canvasBlk) {
+    void *canvasVir = GetMpiHal()->MbHandle2VirAddr(canvasBlk);
+    void *srcVir = GetMpiHal()->MbHandle2VirAddr(viFrame.stVFrame.pMbBlk);
+    if (!canvasVir || !srcVir) return false;
+
+    int srcStride = viFrame.stVFrame.u32VirWidth ? viFrame.stVFrame.u32VirWidth : SRC_WIDTH;
+    int srcVStride = viFrame.stVFrame.u32VirHeight ? viFrame.stVFrame.u32VirHeight : SRC_HEIGHT;
+    Nv12View src = Nv12At(srcVir, srcStride, srcVStride);
+    Nv12View canvas = Nv12At(canvasVir, SRC_WIDTH, SRC_HEIGHT);
+
+    if (copyMask) {
+        // CPU 读取 VI 帧前同步缓存（Y 与 UV 平面上各一段）
+        int y0, y1;
+        TileCanvasPair::TileRows(copyMask, &y0, &y1);
+        MB_BLK viBlk = viFrame.stVFrame.pMbBlk;
+        GetCacheSync().BeginCpuRead(viBlk, (size_t)y0 * srcStride, (size_t)(y1 - y0) * srcStride);
+        GetCacheSync().BeginCpuRead(viBlk, (size_t)srcStride * srcVStride + (size_t)(y0 / 2) * srcStride,
+                                    (size_t)(y1 - y0) / 2 * srcStride);
+    }
+
+    const GridConfig &grid = GetGridConfig();
+    for (int tileId = 0; tileId < grid.TileCount(); ++tileId) {
+        int x = grid.TileX(tileId);
+        int y = grid.TileY(tileId);
+        if (copyMask & TILE_BIT(tileId)) {
+            Nv12Copy(src, x, y, canvas, x, y, SUB_WIDTH, SUB_HEIGHT);
+        } else if (fillMask & TILE_BIT(tileId)) {
+            Nv12Rect r;
+            r.x = x;
+            r.y = y;
+            r.w = SUB_WIDTH;
+            r.h = SUB_HEIGHT;
+            Nv12Fill(canvas, r, 0, 128, 128);
+        }
+    }
+
+    // 写完画布后，刷新改过的行以供 VENC 读取
+    TileCanvasPair::CpuWroteTiles(canvasBlk, copyMask | fillMask);
+    GetCacheSync().BeginDeviceAccess(canvasBlk);
+    return true;
+}
+
+// RGA 路径：拷贝与涂黑放在同一个 job 里，CPU 不碰像素
+bool CanvasCompositor::ComposeRga(const VIDEO_FRAME_INFO_S &viFrame, TileMask copyMask, TileMask fillMask,
+                                  MB_BLK canvasBlk) {
+#ifndef RV1106_1103
+    // 非板端构建没有 RGA，回退到 CPU 路径（统计仍记在 rga 名下，便于和板端对比）
+    return ComposeCpu(viFrame, copyMask, fillMask, canvasBlk);
+#else
+    int srcWStride = viFrame.stVFrame.u32VirWidth ? viFrame.stVFrame.u32VirWidth : SRC_WIDTH;
+    int srcHStride = viFrame.stVFrame.u32VirHeight ? viFrame.stVFrame.u32VirHeight : SRC_HEIGHT;
+    // VI 块与画布块都只导入一次，之后复用 handle；导入失败时回退到 fd
+    uint32_t srcHandle = GetRgaBufferRegistry().Acquire(viFrame.stVFrame.pMbBlk, ViFrameBytes(viFrame));
+    uint32_t dstHandle = GetRgaBufferRegistry().Acquire(canvasBlk, SRC_WIDTH * SRC_HEIGHT * 3 / 2);
+    rga_buffer_t src = srcHandle
+                           ? wrapbuffer_handle(srcHandle, SRC_WIDTH, SRC_HEIGHT, RK_FORMAT_YCbCr_420_SP,
+                                               srcWStride, srcHStride)
+                           : wrapbuffer_fd(GetMpiHal()->MbHandle2Fd(viFrame.stVFrame.pMbBlk),
+                                           SRC_WIDTH, SRC_HEIGHT, RK_FORMAT_YCbCr_420_SP,
+                                           srcWStride, srcHStride);
+    rga_buffer_t dst = dstHandle
+                           ? wrapbuffer_handle(dstHandle, SRC_WIDTH, SRC_HEIGHT, RK_FORMAT_YCbCr_420_SP)
+                           : wrapbuffer_fd(GetMpiHal()->MbHandle2Fd(canvasBlk),
+                                           SRC_WIDTH, SRC_HEIGHT, RK_FORMAT_YCbCr_420_SP);
+
+    // 画布上一次若由 CPU 写过（初始填黑），先把脏段 clean 掉，免得之后被逐出的脏行盖住 RGA 的结果
+    GetCacheSync().BeginDeviceAccess(canvasBlk);
+
+    im_job_handle_t job = imbeginJob();
+    if (job <= 0) {
+        printf("CanvasCompositor: imbeginJob failed\n");
+        return false;
+    }
+
+    const GridConfig &grid = GetGridConfig();
+    IM_STATUS status = IM_STATUS_SUCCESS;
+    // 网格铺满整帧时整帧 copy 只是一个 task；否则网格外的边保持初始的黑色
+    bool wholeFrame = copyMask == grid.AllTilesMask() && grid.cols * SUB_WIDTH == SRC_WIDTH &&
+                      grid.rows * SUB_HEIGHT == SRC_HEIGHT;
+    if (wholeFrame) status = imcopyTask(job, src, dst);
+    for (int tileId = 0; status == IM_STATUS_SUCCESS && tileId < grid.TileCount(); ++tileId) {
+        im_rect rect = {grid.TileX(tileId), grid.TileY(tileId), SUB_WIDTH, SUB_HEIGHT};
+        if ((copyMask & TILE_BIT(tileId)) && !wholeFrame) {
+            status = improcessTask(job, src, dst, {}, rect, rect, {}, NULL, 0);
+        } else if (fillMask & TILE_BIT(tileId)) {
+            status = imfillTask(job, dst, rect, 0xff000000); // 黑色
+        }
+    }
+    if (status != IM_STATUS_SUCCESS) {
+        printf("CanvasCompositor: add task failed: %s\n", imStrError(status));
+        imcancelJob(job);
+        return false;
+    }
+
+    status = imendJob(job);
+    if (status != IM_STATUS_SUCCESS) {
+        printf("CanvasCompositor: imendJob failed: %s\n", imStrError(status));
+        return false;
+    }
+    GetCacheSync().DeviceWrote(canvasBlk, 0, SRC_WIDTH * SRC_HEIGHT * 3 / 2);
+    return true;
+#endif
+}
+
+void CanvasCompositor::Record(Path path, uint64_t us) {
+    PathStat &stat = stats_[path];
+    stat.lastUs = us;
+    stat.totalUs += us;
+    stat.count++;
+}
+
+void CanvasCompositor::PrintStats() {
+    for (int i = 0; i < PATH_COUNT; ++i) {
+        const PathStat &stat = stats_[i];
+        if (stat.count == 0) continue;
+        printf("[COMPOSITE] %s frames=%llu last=%lluus avg=%lluus\n",
+               kPathNames[i],
+               (unsigned long long)stat.count,
+               (unsigned long long)stat.lastUs,
+               (unsigned long long)(stat.totalUs / stat.count));
+    }
+    canvases_.PrintWindow("merge");
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "utils/config.h"
+#include "utils/luckfox_mpi.h"
+#include "utils/tile_canvas_pair.h"
+
+// 合并模式的画布合成方式
+enum CompositeMode {
+    COMPOSITE_CPU = 0,  // CPU 拷贝过期的 tile、涂黑新跳过的 tile
+    COMPOSITE_RGA = 1,  // 同样的工作放进一个 RGA job（每个 tile 一个 task；全部过期时整帧 imcopyTask）
+    COMPOSITE_AUTO = 2, // 无跳过 tile 时直接把 VI 帧交给 VENC（零拷贝），否则走 RGA
+};
+
+// 把 VI 整帧按 skipMask 合成为待编码画面
+// - 两块常驻画布轮流输出（TileCanvasPair），每块只重写自上次使用以来变化过（changedMask 累积）
+//   或涂黑状态改变的 tile；静止画面或只有少数 tile 变化时合成带宽只占整幅重画的一小部分
+// - 输出 outFrame 可直接送 VENC；送完调用 Release
+// - 每种路径分别统计合成耗时，便于对比 CPU / RGA / 直通
+// - 环境变量 ZWH_CANVAS=full 时每帧整幅重画（用于对比）
+class CanvasCompositor {
+public:
+    bool Init(CompositeMode mode);
+
+    // skipMask 中置位的 tile 在输出中为黑色；changedMask 为自上一帧以来内容变化的 tile
+    bool Compose(const VIDEO_FRAME_INFO_S &viFrame, TileMask skipMask, TileMask changedMask,
+                 VIDEO_FRAME_INFO_S *outFrame);
+    bool Compose(const VIDEO_FRAME_INFO_S &viFrame, TileMask skipMask, VIDEO_FRAME_INFO_S *outFrame) {
+        return Compose(viFrame, skipMask, GetGridConfig().AllTilesMask(), outFrame);
+    }
+
+    // 这一帧会不会直通（直通时不需要算 changedMask）
+    bool Passthrough(const VIDEO_FRAME_INFO_S &viFrame, TileMask skipMask) const;
+
+    // 编码提交后归还画布（直通时为空操作）
+    void Release(VIDEO_FRAME_INFO_S *outFrame);
+
+    // 周期性打印各路径的平均合成耗时与每帧重写的 tile 数
+    void PrintStats();
+
+    ~CanvasCompositor();
+
+private:
+    enum Path { PATH_CPU = 0, PATH_RGA, PATH_PASSTHROUGH, PATH_COUNT };
+
+    struct PathStat {
+        uint64_t lastUs = 0;
+        uint64_t totalUs = 0;
+        uint64_t count = 0;
+    };
+
+    // 把 copyMask 中的 tile 从 VI 帧拷到画布，把 fillMask 中的 tile 涂黑
+    bool ComposeCpu(const VIDEO_FRAME_INFO_S &viFrame, TileMask copyMask, TileMask fillMask, MB_BLK canvasBlk);
+    bool ComposeRga(const VIDEO_FRAME_INFO_S &viFrame, TileMask copyMask, TileMask fillMask, MB_BLK canvasBlk);
+    void Record(Path path, uint64_t us);
+
+    CompositeMode mode_ = COMPOSITE_AUTO;
+    bool fullRedraw_ = false;
+    MB_POOL canvasPool_ = MB_INVALID_POOLID;
+    TileCanvasPair canvases_;
+    PathStat stats_[PATH_COUNT];
+};
@@ -3,9 +3,17 @@
 #include "utils/rtsp_helper.h"
 #include "utils/config.h"
 #include "utils/luckfox_mpi.h"
+#include "process/merge/canvas_compositor.h"
+#include "utils/tile_motion_gate.h"
 
 // 合并 4x4 子画面到单路输出的处理循环：
 // - 当前示例跳过 tile 0，填黑
 // - 其余 15 路按原位置放回 1920x1080 画布
 // - 输出到新 RTSP session (/live/merged) 和新 VENC 通道
-void ProcessMergedFrames(const RtspContext &ctx, MB_POOL subImgPool);
+// - compositeMode 选择画布合成方式（CPU / RGA / 无跳过时直通），便于对比耗时
+// - 默认每帧整幅重写画布；mergeMotion 显式开启时才按 tile 的变化检测决定哪些 tile 要重写，
+//   静止的 tile 沿用画布上已有的内容（与 tile 流的 --motion 互不影响）
+void ProcessMergedFrames(const RtspContext &ctx,
+                         MB_POOL subImgPool,
+                         CompositeMode compositeMode = COMPOSITE_AUTO,
+                         const TileMotionGate::Options &mergeMotion = TileMotionGate::Off());
@@ -5,9 +5,16 @@
 #include <stdint.h>
 #include <sys/time.h>
 
-#include "im2d.h"
-#include "rga.h"
 #include "rtsp_helper.h"
+#include "hal/mpi_hal.h"
+#include "utils/pipeline_init.h"
+#include "utils/cache_sync.h"
+#include "utils/nv12_blit.h"
+#include "utils/pipeline_metrics.h"
+#include "utils/rga_buffer_registry.h"
+#include "utils/tile_canvas_pair.h"
+#include "transport/tile_sender.h"
+#include "utils/tile_slicer.h"
 
 // 功能：获取当前时间（毫秒）
 // 参数：无
@@ -18,39 +25,51 @@ static uint64_t GetMs() {
     return (uint64_t)tv.tv_sec * 1000ULL + tv.tv_usec / 1000ULL;
 }
 
-// 功能：模拟网络发送接口，实际业务可在此接入 socket/RTSP/自定义协议
+// 原始 NV12 tile 的网络发送端（未配置目的地址时不发送）
+static TileSender g_tileSender;
+
+// 功能：网络发送接口，把裁剪后的 NV12 tile 按 MTU 分片后经 TileSender 发出
 // 参数：
-//   tileId - 子画面编号（0~15）
-//   data   - 指向 NV12 数据的指针
-//   size   - 数据字节数
-//   pts    - 时间戳（来自 VI 帧的 PTS）
-// 返回值：无
-static void SendTileOverNetwork(int tileId, const void *data, size_t size, uint64_t pts) {
-    (void)tileId;
-    (void)data;
-    (void)size;
-    (void)pts;
-    // TODO: 在实际场景中将数据通过网络发送出去
+//   tileId   - 子画面编号（0 ~ TOTAL_CHNS-1）
+//   frameSeq - 帧序号，接收端据此聚合一帧
+//   tileMask - 本帧实际发送的 tile 掩码
+//   data     - 指向 NV12 数据的指针
+//   size     - 数据字节数
+//   pts      - 时间戳（来自 VI 帧的 PTS）
+// 返回值：无（本帧全部 tile 入队后由调用方 Flush）
+static void SendTileOverNetwork(int tileId, uint16_t frameSeq, TileMask tileMask,
+                                const void *data, size_t size, uint64_t pts) {
+    if (!g_tileSender.IsOpen()) return;
+    TileInfo info;
+    info.tileId = tileId;
+    info.frameSeq = frameSeq;
+    info.tileMask = tileMask;
+    info.pts = pts;
+    info.size = (uint32_t)size;
+    g_tileSender.QueueTile(info, data);
 }
 
-// 功能：本地测试用的接收端模拟，将收到的 tile 重新拼成 1080P 并推送到 rtsp://<IP>:554/live/0
-// 说明：按照 tileId 的 4x4 网格位置复制到画布，未收到的 tile 保持黑色；帧边界以 PTS 切换
+// 功能：本地测试用的接收端模拟，将收到的 tile 重新拼成整幅画面并推送到 rtsp://<IP>:554/live/0
+// 说明：按照 tileId 的网格位置直接写进轮到的常驻画布（TileCanvasPair，与合并流程相同），
+//       未收到的 tile（静止被跳过或丢失）沿用上一次的内容：这块画布上已是最新的不动，过期的从另一块拷过来；
+//       初始为黑色；帧边界以 PTS 切换，送编码时直接交出这块画布，不再整幅拷贝
 static const RtspContext *g_rtspCtx = nullptr;
+// 两块常驻画布及其内存池；ProcessNetLoop 退出时归还（须在 MPI 退出前）
+static MB_POOL g_testCanvasPool = MB_INVALID_POOLID;
+static TileCanvasPair g_testCanvases;
 
 static void SendTileOverNetwork_Test(int tileId, const void *data, size_t size, uint64_t pts) {
     // 初始化一次 RTSP、VENC 以及画布池
     const int kTestChnId = 0;
     static bool inited = false;
-    static rtsp_demo_handle demo = NULL;
-    static rtsp_session_handle session = NULL;
-    static MB_POOL canvasPool = MB_INVALID_POOLID;
-    static MB_BLK canvasBlk = MB_INVALID_HANDLE;
-    static void *canvasVir = NULL;
+    static RtspService *service = NULL;
+    static int session = -1;
+    static TileCanvasPair::Canvas *canvas = nullptr; // 本帧写入的画布；为空时本帧丢弃
+    static TileMask received = 0;                    // 本帧已写进画布的 tile
     static uint64_t currentPts = 0;
     static bool hasPts = false;
     static uint64_t lastFlushMs = 0;
-    static VENC_STREAM_S stStream;
-    static bool streamInited = false;
+    static VencStreamReader streamReader;
 
     // 初始化辅助：失败时打印一次并直接返回
     if (!inited) {
@@ -71,62 +90,77 @@ static void SendTileOverNetwork_Test(int tileId, const void *data, size_t size,
         attr.stRcAttr.stH264Cbr.fr32DstFrameRateNum = 25;
         attr.stRcAttr.stH264Cbr.fr32DstFrameRateDen = 1;
 
-        if (RK_MPI_VENC_CreateChn(kTestChnId, &attr) != RK_SUCCESS) {
+        if (GetMpiHal()->VencCreateChn(kTestChnId, &attr) != RK_SUCCESS) {
             printf("SendTileOverNetwork_Test: create VENC failed\n");
             return;
         }
         VENC_RECV_PIC_PARAM_S recv;
         memset(&recv, 0, sizeof(recv));
         recv.s32RecvPicNum = -1;
-        RK_MPI_VENC_StartRecvFrame(kTestChnId, &recv);
+        GetMpiHal()->VencStartRecvFrame(kTestChnId, &recv);
 
         MB_POOL_CONFIG_S cfg;
         memset(&cfg, 0, sizeof(cfg));
         cfg.u64MBSize = SRC_WIDTH * SRC_HEIGHT * 3 / 2;
         cfg.u32MBCnt = 2;
         cfg.enAllocType = MB_ALLOC_TYPE_DMA;
-        canvasPool = RK_MPI_MB_CreatePool(&cfg);
-        if (canvasPool == MB_INVALID_POOLID) {
+        g_testCanvasPool = GetMpiHal()->MbCreatePool(&cfg);
+        if (g_testCanvasPool == MB_INVALID_POOLID) {
             printf("SendTileOverNetwork_Test: create canvas pool failed\n");
             return;
         }
+        // 两块画布常驻持有，初始整幅填黑
+        if (!g_testCanvases.Init(g_testCanvasPool)) {
+            GetMpiHal()->MbDestroyPool(g_testCanvasPool);
+            g_testCanvasPool = MB_INVALID_POOLID;
+            return;
+        }
 
-        // 复用外部 RTSP demo/session，避免重复开端口
-        if (g_rtspCtx && g_rtspCtx->demo) {
-            demo = g_rtspCtx->demo;
+        // 复用外部 RTSP 服务与 /live/0 会话，避免重复开端口
+        if (g_rtspCtx && g_rtspCtx->service) {
+            service = g_rtspCtx->service.get();
             if (g_rtspCtx->sessions.size() > 0) {
                 session = g_rtspCtx->sessions[0];
             }
+            if (session < 0) {
+                session = service->NewSession("/live/0", kTestChnId);
+            }
         }
-        if (!session && demo) {
-            session = rtsp_new_session(demo, "/live/0");
-        }
-        // 确保会话配置好视频属性
-        if (session) {
-            rtsp_set_video(session, RTSP_CODEC_ID_VIDEO_H264, NULL, 0);
-            rtsp_sync_video_ts(session, rtsp_get_reltime(), rtsp_get_ntptime());
-        }
-        if (session) {
+        if (session >= 0) {
             printf("SendTileOverNetwork_Test: rtsp://<IP>:554/live/0 ready\n");
         } else {
             printf("SendTileOverNetwork_Test: RTSP session not ready\n");
         }
 
-        if (!streamInited) {
-            stStream.pstPack = (VENC_PACK_S *)malloc(sizeof(VENC_PACK_S));
-            streamInited = true;
-        }
-
         inited = true;
     }
 
-    if (!streamInited || canvasPool == MB_INVALID_POOLID) return;
-    if (tileId < 0 || tileId >= TOTAL_CHNS || !data || size < SUB_WIDTH * SUB_HEIGHT * 3 / 2) return;
+    if (g_testCanvasPool == MB_INVALID_POOLID) return;
+    if (tileId < 0 || tileId >= TOTAL_CHNS || !data || size < (size_t)(SUB_WIDTH * SUB_HEIGHT * 3 / 2)) return;
 
-    // 辅助 lambda：将当前画布送入编码并推 RTSP，然后清空画布句柄
+    // 辅助 lambda：补齐本帧画布上过期而未收到的 tile，整块画布送入编码并推 RTSP
     auto flushAndSend = [&]() {
-        if (canvasBlk == MB_INVALID_HANDLE) return;
-        RK_MPI_SYS_MmzFlushCache(canvasBlk, RK_TRUE);
+        lastFlushMs = GetMs();
+        if (!canvas) return;
+        TileMask carried = canvas->stale & ~received;
+        if (carried) {
+            const TileCanvasPair::Canvas *peer = g_testCanvases.Peer(canvas);
+            GetCacheSync().BeginCpuRead(peer->blk, 0, SRC_WIDTH * SRC_HEIGHT * 3 / 2);
+            Nv12View src = Nv12At(peer->vir, SRC_WIDTH, SRC_HEIGHT);
+            Nv12View dst = Nv12At(canvas->vir, SRC_WIDTH, SRC_HEIGHT);
+            for (int i = 0; i < TOTAL_CHNS; ++i) {
+                if ((carried & TILE_BIT(i)) == 0) continue;
+                int x = GetGridConfig().TileX(i);
+                int y = GetGridConfig().TileY(i);
+                Nv12Copy(src, x, y, dst, x, y, SUB_WIDTH, SUB_HEIGHT);
+            }
+        }
+        g_testCanvases.MarkChanged(received);
+        g_testCanvases.MarkWritten(canvas, received | carried);
+        MB_BLK canvasBlk = canvas->blk;
+        TileCanvasPair::CpuWroteTiles(canvasBlk, received | carried);
+        GetCacheSync().BeginDeviceAccess(canvasBlk);
+        canvas = nullptr;
 
         VIDEO_FRAME_INFO_S frame;
         memset(&frame, 0, sizeof(frame));
@@ -138,31 +172,26 @@ static void SendTileOverNetwork_Test(int tileId, const void *data, size_t size,
         frame.stVFrame.pMbBlk = canvasBlk;
         frame.stVFrame.u64PTS = currentPts;
 
-        RK_S32 sendRet = RK_MPI_VENC_SendFrame(kTestChnId, &frame, -1);
+        RK_S32 sendRet = GetMpiHal()->VencSendFrame(kTestChnId, &frame, -1);
         if (sendRet != RK_SUCCESS) {
             printf("[NET] VENC_SendFrame ret=0x%x pts=%llu\n", sendRet, (unsigned long long)currentPts);
         }
-        RK_MPI_MB_ReleaseMB(canvasBlk);
-        canvasBlk = MB_INVALID_HANDLE;
-        canvasVir = NULL;
-
-        if (RK_MPI_VENC_GetStream(kTestChnId, &stStream, 0) == RK_SUCCESS) {
-            void *pData = RK_MPI_MB_Handle2VirAddr(stStream.pstPack->pMbBlk);
-            if (session) {
-                rtsp_tx_video(session, (uint8_t *)pData, stStream.pstPack->u32Len, stStream.pstPack->u64PTS);
-            }
+
+        if (streamReader.Get(kTestChnId, 0) == RK_SUCCESS) {
+            const StreamFrame &stream = streamReader.Frame();
+            if (service) service->Submit(session, stream);
             static uint64_t pushCnt = 0;
             pushCnt++;
             if (pushCnt % 30 == 0) {
-                printf("[NET] push #%llu len=%u pts=%llu\n",
+                printf("[NET] push #%llu len=%u packs=%d pts=%llu\n",
                        (unsigned long long)pushCnt,
-                       stStream.pstPack->u32Len,
-                       (unsigned long long)stStream.pstPack->u64PTS);
+                       stream.bytes,
+                       stream.packCount,
+                       (unsigned long long)stream.pts);
             }
-            RK_MPI_VENC_ReleaseStream(kTestChnId, &stStream);
-            if (demo) rtsp_do_event(demo);
+            streamReader.Release(kTestChnId);
+            if (pushCnt % 300 == 0) g_testCanvases.PrintWindow("net test");
         }
-        lastFlushMs = GetMs();
     };
 
     // 新的 PTS 或超时（同一 PTS 未刷新超过 100ms）到来，先把上一帧送出
@@ -171,114 +200,156 @@ static void SendTileOverNetwork_Test(int tileId, const void *data, size_t size,
         hasPts = false;
     }
 
-    // 为当前 PTS 准备画布
+    // 开始新的一帧：取轮到的画布，两块都还被 VENC 引用时本帧的 tile 全部丢弃
     if (!hasPts) {
-        canvasBlk = RK_MPI_MB_GetMB(canvasPool, SRC_WIDTH * SRC_HEIGHT * 3 / 2, RK_TRUE);
-        canvasVir = RK_MPI_MB_Handle2VirAddr(canvasBlk);
-        memset(canvasVir, 0, SRC_WIDTH * SRC_HEIGHT * 3 / 2); // 未收到的 tile 保持黑色
         currentPts = pts;
         hasPts = true;
         lastFlushMs = GetMs();
+        canvas = g_testCanvases.Acquire();
+        received = 0;
     }
+    if (!canvas) return;
 
-    // 按 tileId 的行列位置复制到画布
-    int row = tileId / SPLIT_COL;
-    int col = tileId % SPLIT_COL;
-    int x = col * SUB_WIDTH;
-    int y = row * SUB_HEIGHT;
-    const uint8_t *src = static_cast<const uint8_t *>(data);
-    uint8_t *dst = static_cast<uint8_t *>(canvasVir);
-    int dstStride = SRC_WIDTH;
-    int srcStride = SUB_WIDTH;
-
-    for (int r = 0; r < SUB_HEIGHT; ++r) {
-        memcpy(dst + (y + r) * dstStride + x, src + r * srcStride, SUB_WIDTH);
-    }
-
-    const uint8_t *srcUV = src + SUB_WIDTH * SUB_HEIGHT;
-    uint8_t *dstUV = dst + SRC_WIDTH * SRC_HEIGHT;
-    int uvY = y / 2;
-    for (int r = 0; r < SUB_HEIGHT / 2; ++r) {
-        memcpy(dstUV + (uvY + r) * dstStride + x, srcUV + r * srcStride, SUB_WIDTH);
-    }
+    // 按 tileId 的行列位置直接写进本帧的画布
+    Nv12Copy(Nv12At(data, SUB_WIDTH, SUB_HEIGHT), 0, 0, Nv12At(canvas->vir, SRC_WIDTH, SRC_HEIGHT),
+             GetGridConfig().TileX(tileId), GetGridConfig().TileY(tileId), SUB_WIDTH, SUB_HEIGHT);
+    received |= TILE_BIT(tileId);
 }
 
 // 功能：裁剪并发送子画面到网络（跳过当前秒对应的 tile）
 // 参数：
 //   subImgPool - 供裁剪输出使用的 NV12 内存池
 // 返回值：无（内部死循环）
-void ProcessNetLoop(const RtspContext &ctx, MB_POOL subImgPool) {
+void ProcessNetLoop(const RtspContext &ctx, MB_POOL subImgPool, const char *tileEndpoint,
+                    const TileMotionGate::Options &motion) {
     if (subImgPool == MB_INVALID_POOLID) {
         printf("ProcessNetLoop: subImgPool invalid\n");
         return;
     }
 
+    if (tileEndpoint) {
+        char host[64];
+        uint16_t port = 0;
+        TileTransport transport = TILE_TRANSPORT_UDP;
+        if (!ParseTileEndpoint(tileEndpoint, host, sizeof(host), &port, &transport) ||
+            !g_tileSender.Open(host, port, transport)) {
+            printf("ProcessNetLoop: tile endpoint %s unusable, network send disabled\n", tileEndpoint);
+        }
+    }
+    uint16_t frameSeq = 0;
+
     g_rtspCtx = &ctx;
     printf("ProcessNetLoop start: subImgPool=%p\n", subImgPool);
 
     static uint64_t startMs = GetMs();
 
+    // 网格几何只在启动时校验一次
+    static TileSlicer slicer;
+    if (!slicer.Init(GetGridConfig())) {
+        printf("ProcessNetLoop: TileSlicer init failed\n");
+        return;
+    }
+    static TileMotionGate motionGate;
+    if (!motionGate.Init(GetGridConfig(), motion)) {
+        printf("ProcessNetLoop: TileMotionGate init failed\n");
+        return;
+    }
+    uint64_t windowStartMs = GetMs();
+    uint64_t windowFrames = 0;
+
+    MB_BLK dstBlks[MAX_TILES];
+    Nv12Image dstImgs[MAX_TILES];
+
     VIDEO_FRAME_INFO_S stViFrame;
 
-    while (1) {
+    while (!PipelineStopRequested()) {
         // 从 VI 获取一帧 1080P 原始图像
-        RK_S32 s32Ret = RK_MPI_VI_GetChnFrame(0, 0, &stViFrame, 1000);
+        RK_S32 s32Ret = GetMpiHal()->ViGetChnFrame(0, 0, &stViFrame, 1000);
         if (s32Ret != RK_SUCCESS) {
             continue;
         }
 
-        // 计算本秒需要跳过的 tile（0~15 循环）
+        // 计算本秒需要跳过的 tile（0 ~ TOTAL_CHNS-1 循环）
         uint64_t elapsedMs = GetMs() - startMs;
         int skipTile = (elapsedMs / 1000) % TOTAL_CHNS;
 
-        int vi_fd = RK_MPI_MB_Handle2Fd(stViFrame.stVFrame.pMbBlk);
-
-        // 源图封装成 RGA buffer
-        rga_buffer_t src_img;
-        src_img = wrapbuffer_fd(vi_fd, SRC_WIDTH, SRC_HEIGHT, RK_FORMAT_YCbCr_420_SP, SRC_WIDTH, SRC_HEIGHT);
-
-        // 按网格裁剪
-        for (int r = 0; r < SPLIT_ROW; r++) {
-            for (int c = 0; c < SPLIT_COL; c++) {
-                int tileId = r * SPLIT_COL + c;
-                if (tileId == skipTile) continue;
-
-                MB_BLK dst_Blk = RK_MPI_MB_GetMB(subImgPool, SUB_WIDTH * SUB_HEIGHT * 3 / 2, RK_TRUE);
-                int dst_fd = RK_MPI_MB_Handle2Fd(dst_Blk);
-
-                rga_buffer_t dst_img;
-                dst_img = wrapbuffer_fd(dst_fd, SUB_WIDTH, SUB_HEIGHT, RK_FORMAT_YCbCr_420_SP, SUB_WIDTH, SUB_HEIGHT);
+        frameSeq++;
+        GetCacheSync().DeviceWrote(stViFrame.stVFrame.pMbBlk, 0, ViFrameBytes(stViFrame));
+        GetPipelineMetrics().FrameCaptured(frameSeq, stViFrame.stVFrame.u64PTS, MetricsNowUs());
+        TileMask tileMask = GetGridConfig().AllTilesMask() & ~TILE_BIT(skipTile);
+
+        // 源图描述为切分源
+        Nv12Image srcImg;
+        srcImg.handle = GetRgaBufferRegistry().Acquire(stViFrame.stVFrame.pMbBlk, ViFrameBytes(stViFrame));
+        if (!srcImg.handle) srcImg.fd = GetMpiHal()->MbHandle2Fd(stViFrame.stVFrame.pMbBlk);
+        srcImg.vir = GetMpiHal()->MbHandle2VirAddr(stViFrame.stVFrame.pMbBlk);
+        srcImg.width = SRC_WIDTH;
+        srcImg.height = SRC_HEIGHT;
+
+        // 只发送画面有变化（或到了强制刷新）的 tile
+        if (motionGate.Enabled() && srcImg.vir) {
+            int stride = stViFrame.stVFrame.u32VirWidth ? stViFrame.stVFrame.u32VirWidth : SRC_WIDTH;
+            GetCacheSync().BeginCpuRead(stViFrame.stVFrame.pMbBlk, 0, (size_t)stride * SRC_HEIGHT);
+            tileMask = motionGate.Select(static_cast<const uint8_t *>(srcImg.vir), stride, tileMask);
+        }
 
-                // 裁剪区域
-                im_rect src_rect;
-                src_rect.x = c * SUB_WIDTH;
-                src_rect.y = r * SUB_HEIGHT;
-                src_rect.width = SUB_WIDTH;
-                src_rect.height = SUB_HEIGHT;
+        // 为需要发送的 tile 取子画面缓冲，整帧一次性提交裁剪
+        for (int tileId = 0; tileId < TOTAL_CHNS; tileId++) {
+            if ((tileMask & TILE_BIT(tileId)) == 0) continue;
+            dstBlks[tileId] = GetMpiHal()->MbGetMB(subImgPool, SUB_WIDTH * SUB_HEIGHT * 3 / 2, RK_TRUE);
+            dstImgs[tileId].handle = GetRgaBufferRegistry().Acquire(dstBlks[tileId], SUB_WIDTH * SUB_HEIGHT * 3 / 2);
+            dstImgs[tileId].fd = dstImgs[tileId].handle ? -1 : GetMpiHal()->MbHandle2Fd(dstBlks[tileId]);
+            dstImgs[tileId].vir = GetMpiHal()->MbHandle2VirAddr(dstBlks[tileId]);
+            dstImgs[tileId].width = SUB_WIDTH;
+            dstImgs[tileId].height = SUB_HEIGHT;
+        }
 
-                if (imcheck(src_img, dst_img, src_rect, {}) == IM_STATUS_NOERROR) {
-                    imcrop(src_img, dst_img, src_rect);
-                }
+        // 变化检测必须先于裁剪（决定裁哪些 tile），裁完紧接着发出，没有可与 RGA 重叠的工作，同步提交
+        bool sliced = slicer.Slice(srcImg, dstImgs, tileMask, nullptr);
+        GetPipelineMetrics().FrameCropped(frameSeq, MetricsNowUs());
 
-                // 缓存同步，确保 CPU 读取裁剪结果前刷新
-                RK_MPI_SYS_MmzFlushCache(dst_Blk, RK_FALSE);
+        for (int tileId = 0; tileId < TOTAL_CHNS; tileId++) {
+            if ((tileMask & TILE_BIT(tileId)) == 0) continue;
+            MB_BLK dst_Blk = dstBlks[tileId];
 
-                // NV12 数据指针与大小
-                void *data = RK_MPI_MB_Handle2VirAddr(dst_Blk);
+            if (sliced) {
+                // NV12 数据指针与大小；RGA 刚写完，CPU 读之前作废这一段的旧缓存
+                void *data = dstImgs[tileId].vir;
                 size_t size = SUB_WIDTH * SUB_HEIGHT * 3 / 2;
+                GetCacheSync().DeviceWrote(dst_Blk, 0, size);
+                GetCacheSync().BeginCpuRead(dst_Blk, 0, size);
 
-                // 发送到模拟网络
+                // 发送到模拟网络；配置了目的地址时同时走真实网络
                 SendTileOverNetwork_Test(tileId, data, size, stViFrame.stVFrame.u64PTS);
-
-                // 释放子画面缓冲
-                RK_MPI_MB_ReleaseMB(dst_Blk);
+                SendTileOverNetwork(tileId, frameSeq, tileMask, data, size, stViFrame.stVFrame.u64PTS);
+                motionGate.RecordEncoded(tileId, (uint32_t)size, 0); // 网络模式按原始 NV12 字节估算节省
+                GetPipelineMetrics().TileSent(frameSeq, tileId, (uint32_t)size, 0, MetricsNowUs());
             }
+
+            // 释放子画面缓冲
+            GetMpiHal()->MbReleaseMB(dst_Blk);
         }
 
-        // 处理完一帧，释放 VI 帧
-        RK_MPI_VI_ReleaseChnFrame(0, 0, &stViFrame);
+        // 整帧的 tile 一次发出
+        g_tileSender.Flush();
+
+        // 处理完一帧，释放 VI 帧（RTSP 事件由服务线程处理）
+        GetMpiHal()->ViReleaseChnFrame(0, 0, &stViFrame);
+
+        if (++windowFrames % 150 == 0) {
+            uint64_t nowMs = GetMs();
+            printf("[SLICE] avg=%lluus crop=%lluns\n", (unsigned long long)slicer.AvgSliceUs(),
+                   (unsigned long long)slicer.AvgCropNs());
+            GetRgaBufferRegistry().PrintStats();
+            GetCacheSync().PrintWindow();
+            motionGate.PrintWindow(nowMs - windowStartMs);
+            windowStartMs = nowMs;
+        }
+    }
 
-        // 统一处理 RTSP 事件
-        if (ctx.demo) rtsp_do_event(ctx.demo);
+    g_testCanvases.Destroy();
+    if (g_testCanvasPool != MB_INVALID_POOLID) {
+        GetMpiHal()->MbDestroyPool(g_testCanvasPool);
+        g_testCanvasPool = MB_INVALID_POOLID;
     }
 }
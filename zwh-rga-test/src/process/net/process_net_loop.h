@@ -3,10 +3,14 @@
 #include "utils/luckfox_mpi.h"
 #include "utils/config.h"
 #include "utils/rtsp_helper.h"
+#include "utils/tile_motion_gate.h"
 
-// 功能：采集一帧 1080P，按 4x4 网格裁剪为子画面，跳过当前秒对应的 tile，
+// 功能：采集一帧，按网格裁剪为子画面，跳过当前秒对应的 tile 以及未变化的 tile，
 //       将其余子画面的码流（NV12 原始数据）交给模拟的网络发送函数。
 // 参数：
-//   subImgPool - 供裁剪输出使用的 NV12 内存池（尺寸需满足 480x270，一般复用 CreateSubImgPool 创建的池）
-// 返回值：无；内部为死循环，除非发生致命错误（当前实现直接继续或返回）
-void ProcessNetLoop(const RtspContext &ctx, MB_POOL subImgPool);
+//   subImgPool   - 供裁剪输出使用的 NV12 内存池（块大小需满足 SUB_WIDTH x SUB_HEIGHT，一般复用 CreateSubImgPool 创建的池）
+//   tileEndpoint - 可选，"[udp://|tcp://]ip:port"，非空时子画面同时经 TileSender 发往该地址
+//   motion       - 变化检测参数，静止 tile 降频发送，接收端沿用上一次的画面
+// 返回值：无；循环到 RequestPipelineStop 后返回
+void ProcessNetLoop(const RtspContext &ctx, MB_POOL subImgPool, const char *tileEndpoint = NULL,
+                    const TileMotionGate::Options &motion = TileMotionGate::Options());
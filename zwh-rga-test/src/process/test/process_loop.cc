@@ -1,15 +1,31 @@
 // 采集-裁剪-编码-推流核心循环实现
 // - 从 VI 通道抓取一帧 1080P NV12 原始图
-// - 使用 RGA 将大画面按 4x4 网格裁剪成 16 个子画面
-// - 逐路送入对应 VENC 编码，再推送到各自的 RTSP 会话
+// - 使用 RGA 将大画面按网格配置（默认 4x4）裁剪成若干子画面（整帧一个 job 批量提交）
+// - 逐路送入对应 VENC 编码；码流由独立回收线程 poll 取出，再推送到各自的 RTSP 会话
+// - 按需编码时只处理被订阅的 tile，没人看的通道停止接收，不占 RGA/VENC/带宽
+// - 开启检测时按自身间隔把整帧或一个 tile 交给检测线程送 NPU，结果按 tile 发布
 #include "process_loop.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
 
-#include "im2d.h"
-#include "rga.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "hal/mpi_hal.h"
+#include "hal/npu_backend.h"
+#include "transport/tile_sender.h"
+#include "utils/cache_sync.h"
+#include "utils/pipeline_metrics.h"
+#include "utils/rga_buffer_registry.h"
+#include "utils/tile_slicer.h"
+#include "utils/tile_subscriptions.h"
+#include "utils/tile_worker_pool.h"
+#include "utils/venc_drain.h"
 
 // 获取当前时间（毫秒），用于统计窗口
 static uint64_t GetMs() {
@@ -18,66 +34,219 @@ static uint64_t GetMs() {
     return (uint64_t)tv.tv_sec * 1000ULL + tv.tv_usec / 1000ULL;
 }
 
-// 全局统计变量
-static uint64_t sentCnt[TOTAL_CHNS] = {0};
-static const uint64_t kStatWindowMs = 500; // 修改此值即可调整统计粒度
-static uint64_t statStartMs = 0;
-static uint64_t statTile0Bytes = 0;
-static uint64_t statTotalBytes = 0;
+// 全局统计变量（码流相关的只在回收线程中访问）；分阶段时延与各路码率见 PipelineMetrics
+static uint64_t sentCnt[MAX_TILES] = {0};
 static VIDEO_FRAME_INFO_S viFrame;
-static VENC_STREAM_S stream;
 static uint16_t frameSeq = 0;      // 本地帧序号，发送时带上供接收端聚合
-static uint16_t tileMask = 0xFFFF; // 如果未来只发部分 tile，请更新掩码位
-static bool isIdrFrame = false;    // 本帧是否为 I/IDR 帧
+static TileMask tileMask = 0;      // 每帧按网格配置置满，如果未来只发部分 tile，请更新掩码位
 static uint64_t framePts = 0;
 
-// 仅用于占位的“网络发送”接口，未来会将编码好的 tile 送往另一台设备
+// 变化检测：决定每帧哪些 tile 需要处理，并统计跳过带来的节省
+static TileMotionGate motionGate;
+static std::atomic<uint64_t> encodeStartUs[MAX_TILES]; // 各路最近一次送编码的时间
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+// 帧元信息：采集线程按 PTS 登记，回收线程拿到码流后按 PTS 查回 frameSeq/tileMask
+// 绑定模式下 VPSS 直通的 tile 可能比采集线程先拿到同一帧，此时由回收线程按 PTS 先登记
+struct FrameMeta {
+    uint64_t pts;
+    uint16_t seq;
+    TileMask mask;
+};
+static const int kFrameMetaDepth = 8; // 允许编码落后采集的帧数
+static FrameMeta frameMetas[kFrameMetaDepth];
+static uint16_t lastMetaSeq = 0;
+static std::mutex frameMetaMtx;
+static bool seqFromStream = false; // 绑定模式：回收线程遇到未登记的 PTS 时分配帧序号
+static TileMask streamMask = 0;    // 绑定模式下每帧固定发送的掩码
+
+static bool FindFrameMetaLocked(uint64_t pts, FrameMeta *out) {
+    for (int i = 0; i < kFrameMetaDepth; ++i) {
+        if (frameMetas[i].seq != 0 && frameMetas[i].pts == pts) {
+            *out = frameMetas[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool LookupFrameMeta(uint64_t pts, FrameMeta *out) {
+    std::lock_guard<std::mutex> lk(frameMetaMtx);
+    return FindFrameMetaLocked(pts, out);
+}
+
+// 取 PTS 对应的帧元信息，未登记则分配下一个帧序号（跳过 0）；*created 表示本次新登记
+static FrameMeta AcquireFrameMeta(uint64_t pts, TileMask mask, bool *created) {
+    std::lock_guard<std::mutex> lk(frameMetaMtx);
+    FrameMeta meta;
+    *created = !FindFrameMetaLocked(pts, &meta);
+    if (*created) {
+        if (++lastMetaSeq == 0) lastMetaSeq = 1;
+        meta.pts = pts;
+        meta.seq = lastMetaSeq;
+        meta.mask = mask;
+        frameMetas[meta.seq % kFrameMetaDepth] = meta;
+    }
+    return meta;
+}
+
+// 码率分配：回收线程按周期汇总各路产出，重新分配总预算（只在回收线程中访问）
+static BitrateAllocator bitrateAllocator;
+static bool bitrateEnabled = false;
+static std::vector<BitrateAllocator::TileSample> rateSamples;
+static uint64_t rateQpSum[MAX_TILES] = {0};
+static uint64_t rateWindowStartUs = 0;
+static FILE *rateTrace = NULL; // 每周期一行各路产出码率（kbps，逗号分隔），bench_bitrate 可回放
+
+static void RecordTileRate(int chnId, const VENC_STREAM_S &stream, const StreamFrame &frame) {
+    BitrateAllocator::TileSample &sample = rateSamples[chnId];
+    sample.bytes += frame.bytes;
+    sample.frames++;
+    rateQpSum[chnId] += stream.stH264Info.u32MeanQp;
+}
+
+// 周期到了就按本窗口各路产出重新分配，变化的路经 SetVencBitrate 下发
+static void UpdateBitrates(uint64_t nowUs) {
+    uint64_t windowMs = (nowUs - rateWindowStartUs) / 1000;
+    if (windowMs < (uint64_t)bitrateAllocator.PeriodMs()) return;
+    rateWindowStartUs = nowUs;
+
+    int tiles = (int)rateSamples.size();
+    for (int i = 0; i < tiles; ++i) {
+        BitrateAllocator::TileSample &sample = rateSamples[i];
+        sample.meanQp = sample.frames ? (uint32_t)(rateQpSum[i] / sample.frames) : 0;
+        if (rateTrace) fprintf(rateTrace, i ? ",%llu" : "%llu", (unsigned long long)(sample.bytes * 8 / windowMs));
+    }
+    if (rateTrace) {
+        fputc('\n', rateTrace);
+        fflush(rateTrace);
+    }
+
+    const std::vector<BitrateAllocator::Allocation> &allocs = bitrateAllocator.Update(rateSamples, windowMs);
+    char perTile[16 * MAX_TILES];
+    int len = 0;
+    int used = 0;
+    int changed = 0;
+    for (int i = 0; i < tiles; ++i) {
+        const BitrateAllocator::Allocation &a = allocs[i];
+        bool avbr = a.mode == BitrateAllocator::RC_AVBR;
+        if (a.changed && SetVencBitrate(i, a.kbps, avbr)) changed++;
+        used += a.kbps;
+        if (len < (int)sizeof(perTile)) {
+            len += snprintf(perTile + len, sizeof(perTile) - len, " %d:%d%s", i, a.kbps, avbr ? "a" : "");
+        }
+        rateSamples[i] = BitrateAllocator::TileSample();
+        rateQpSum[i] = 0;
+    }
+    printf("[RATE] budget=%dkbps allocated=%dkbps changed=%d:%s\n", bitrateAllocator.TotalKbps(), used, changed,
+           perTile);
+}
+
+// 编码后的 tile 网络发送端（未配置目的地址时不发送）
+static TileSender tileSender;
+static uint16_t queuedSeq = 0; // 发送端当前攒批的帧序号
+static int queuedTiles = 0;    // 该帧已入队的 tile 数
+
+// 网络发送接口：将编码好的 tile 送往另一台设备
 // 关键元信息：
 // - tileId：当前子画面编号
 // - frameSeq：当前帧的序号（本地递增，接收端据此聚合一帧）
 // - tileMask：本帧实际发送的 tile 掩码，接收端可据此判断缺失的 tile 并补黑
 // - pts：沿用 VI 帧 PTS，保证时间对齐
-// - data/size：编码后的码流数据
-static void SendTileOverNetworkPlaceholder(int tileId,
-                                           uint16_t frameSeq,
-                                           uint16_t tileMask,
-                                           uint64_t pts,
-                                           const void *data,
-                                           size_t size) {
-    (void)tileId;
-    (void)frameSeq;
-    (void)tileMask;
-    (void)pts;
-    (void)data;
-    (void)size;
-    // TODO: 未来在此封装协议/传输，携带 frameSeq+tileMask 让接收端按帧拼接
+// - stream：编码后的整帧码流，各 pack 直接从 MB 聚集拷入发送暂存区
+// 同一帧的 tile 先在发送端攒批，tileMask 中的 tile 全部入队后一次 sendmmsg 发出
+static void SendTileOverNetwork(int tileId,
+                                uint16_t frameSeq,
+                                TileMask tileMask,
+                                const StreamFrame &stream) {
+    if (!tileSender.IsOpen()) return;
+
+    TileInfo info;
+    info.tileId = tileId;
+    info.frameSeq = frameSeq;
+    info.tileMask = tileMask;
+    info.pts = stream.pts;
+    info.keyframe = stream.keyframe;
+    info.size = stream.bytes;
+    tileSender.QueueTile(info, stream.iov, stream.packCount);
+
+    if (frameSeq != queuedSeq) {
+        queuedSeq = frameSeq;
+        queuedTiles = 0;
+    }
+    if (++queuedTiles == __builtin_popcountll(tileMask)) {
+        tileSender.Flush();
+        queuedTiles = 0;
+    }
 }
 
-// 处理单个 tile 的裁剪、编码、发送及统计
-static void ProcessSingleTile(int r,
-                              int c,
-                              int chnId,
-                              const RtspContext &ctx,
-                              MB_POOL subImgPool,
-                              const rga_buffer_t &src_img,
-                              uint64_t pts) {
-    MB_BLK dst_Blk = RK_MPI_MB_GetMB(subImgPool, SUB_WIDTH * SUB_HEIGHT * 3 / 2, RK_TRUE);
-    int dst_fd = RK_MPI_MB_Handle2Fd(dst_Blk);
+// 按需编码：回收线程收订阅、定期通告，采集线程每帧按订阅启停各路编码器
+static TileSubscriptions subscriptions;
+static uint64_t lastAnnounceUs = 0;
+static const uint64_t kAnnounceIntervalUs = 1000000; // 接收端据通告发现发送端并立即订阅
 
-    rga_buffer_t dst_img;
-    dst_img = wrapbuffer_fd(dst_fd, SUB_WIDTH, SUB_HEIGHT, RK_FORMAT_YCbCr_420_SP, SUB_WIDTH, SUB_HEIGHT);
+// 回收线程 idle 回调：取走接收端回发的订阅续租，并按周期通告当前在编码的 tile
+static void PollSubscriptions() {
+    if (!subscriptions.Enabled() || !tileSender.IsOpen()) return;
+    uint64_t nowUs = GetUs();
+    TileMask mask = 0;
+    uint32_t leaseMs = 0;
+    while (tileSender.PollSubscription(&mask, &leaseMs)) subscriptions.Renew(mask, leaseMs, nowUs);
+    if (nowUs - lastAnnounceUs >= kAnnounceIntervalUs) {
+        tileSender.Announce(queuedSeq, subscriptions.Active(nowUs));
+        lastAnnounceUs = nowUs;
+    }
+}
 
-    im_rect src_rect;
-    src_rect.x = c * SUB_WIDTH;
-    src_rect.y = r * SUB_HEIGHT;
-    src_rect.width = SUB_WIDTH;
-    src_rect.height = SUB_HEIGHT;
+// 编码通道启停：与该路的帧在同一工作线程排序；重新开始接收时立即出 IDR，新订阅者不必等 GOP
+static void ControlTile(int chnId, TileWorkerPool::JobKind kind) {
+    RK_S32 ret;
+    if (kind == TileWorkerPool::JOB_START) {
+        VENC_RECV_PIC_PARAM_S recv;
+        memset(&recv, 0, sizeof(recv));
+        recv.s32RecvPicNum = -1;
+        ret = GetMpiHal()->VencStartRecvFrame(chnId, &recv);
+        if (ret == RK_SUCCESS) ret = GetMpiHal()->VencRequestIDR(chnId, RK_TRUE);
+    } else {
+        ret = GetMpiHal()->VencStopRecvFrame(chnId);
+    }
+    if (ret != RK_SUCCESS) {
+        printf("ControlTile: %s ch%d ret=0x%x\n", kind == TileWorkerPool::JOB_START ? "start" : "stop", chnId, ret);
+    }
+}
 
-    if (imcheck(src_img, dst_img, src_rect, {}) == IM_STATUS_NOERROR) {
-        imcrop(src_img, dst_img, src_rect);
+// 本地录制：回收线程把码流拷入录制暂存区，写盘在录制线程
+static TileRecorder recorder;
+// 事前录像：回收线程追加，导出在其自身线程
+static PreEventBuffer preEvent;
+
+// 目标检测：采集线程到点提交，推理与结果分发在检测线程
+static TileDetector detector;
+static TileMask occupiedTiles = 0; // 最近一次检测有目标的 tile（只在检测线程中访问）
+
+// 检测线程回调：tile 从无目标变为有目标时打印一次并触发该路事前录像导出
+static void OnDetection(const TileDetector::Result &result) {
+    TileMask bit = TILE_BIT(result.tileId);
+    if (result.count > 0 && (occupiedTiles & bit) == 0) {
+        const DetectBox &box = result.boxes[0];
+        printf("[DETECT] tile %d seq=%u: %d objects, cls=%d prop=%.2f at (%d,%d)-(%d,%d) latency=%lluus\n",
+               result.tileId, (unsigned int)result.frameSeq, result.count, box.clsId, box.prop, box.left, box.top,
+               box.right, box.bottom, (unsigned long long)result.latencyUs);
+        preEvent.Trigger(bit);
     }
+    occupiedTiles = result.count > 0 ? (occupiedTiles | bit) : (occupiedTiles & ~bit);
+}
 
-    RK_MPI_SYS_MmzFlushCache(dst_Blk, RK_TRUE);
+// 处理单个 tile 的编码提交（裁剪已由 TileSlicer 按整帧批量完成，码流由回收线程取走）
+// 在工作线程中执行，同一路只会在同一线程里调用
+static void ProcessSingleTile(int chnId, MB_BLK dst_Blk, uint64_t pts) {
+    // 子画面由 RGA 写入、CPU 没碰过，交给 VENC 通常无需缓存维护
+    GetCacheSync().BeginDeviceAccess(dst_Blk);
 
     VIDEO_FRAME_INFO_S stVencFrame;
     memset(&stVencFrame, 0, sizeof(VIDEO_FRAME_INFO_S));
@@ -89,121 +258,321 @@ static void ProcessSingleTile(int r,
     stVencFrame.stVFrame.pMbBlk = dst_Blk; 
     stVencFrame.stVFrame.u64PTS = pts;
 
-    RK_S32 sendRet = RK_MPI_VENC_SendFrame(chnId, &stVencFrame, -1);
+    encodeStartUs[chnId].store(GetUs(), std::memory_order_relaxed);
+    RK_S32 sendRet = GetMpiHal()->VencSendFrame(chnId, &stVencFrame, -1);
     if (sendRet != RK_SUCCESS) {
         printf("VENC_SendFrame ch%d ret=0x%x\n", chnId, sendRet);
     }
-    RK_MPI_MB_ReleaseMB(dst_Blk);
+    GetMpiHal()->MbReleaseMB(dst_Blk);
+}
 
-    if (RK_MPI_VENC_GetStream(chnId, &stream, 0) == RK_SUCCESS) {
-        void *pData = RK_MPI_MB_Handle2VirAddr(stream.pstPack->pMbBlk);
+// 回收线程回调：单路码流推 RTSP、交给网络发送，并做统计
+static void OnTileStream(const RtspContext &ctx, int chnId, const VENC_STREAM_S &stream, const StreamFrame &frame) {
+    uint64_t streamUs = MetricsNowUs();
 
-        // 将编码后的码流送入对应的 RTSP 会话
-        if (ctx.demo && chnId < (int)ctx.sessions.size() && ctx.sessions[chnId]) {
-            rtsp_tx_video(ctx.sessions[chnId],
-                          (uint8_t *)pData,
-                          stream.pstPack->u32Len,
-                          stream.pstPack->u64PTS);
-        }
-        
-        sentCnt[chnId]++;
-        SendTileOverNetworkPlaceholder(chnId,
-                                       frameSeq,
-                                       tileMask,
-                                       stream.pstPack->u64PTS,
-                                       pData,
-                                       stream.pstPack->u32Len);
-
-        statTotalBytes += stream.pstPack->u32Len;
-        if (chnId == 0) {
-            statTile0Bytes += stream.pstPack->u32Len;
-        }
-        
-        if (stream.pstPack->DataType.enH264EType == H264E_NALU_IDRSLICE ||
-            stream.pstPack->DataType.enH264EType == H264E_NALU_ISLICE) {
-            isIdrFrame = true;
-        }
-        uint64_t nowMs = GetMs();
-        if (nowMs - statStartMs >= kStatWindowMs) {
-            double ratio = (statTotalBytes > 0) ? (statTile0Bytes * 100.0 / statTotalBytes) : 0.0;
-            // printf("[STAT %.1fms] tile0=%llu bytes, total=%llu bytes, ratio=%.2f%%\n",
-            //        kStatWindowMs * 1.0,
-            //        (unsigned long long)statTile0Bytes,
-            //        (unsigned long long)statTotalBytes,
-            //        ratio);
-            statTile0Bytes = 0;
-            statTotalBytes = 0;
-            statStartMs = nowMs;
-        }
-        RK_MPI_VENC_ReleaseStream(chnId, &stream);
-    } else {
-        static uint64_t failCnt[TOTAL_CHNS] = {0};
-        failCnt[chnId]++;
-        if (failCnt[chnId] % 30 == 0) {
-            printf("VENC_GetStream ch%d fail cnt=%llu\n", chnId, (unsigned long long)failCnt[chnId]);
-        }
+    // 将编码后的码流（整帧所有 pack）投递给 RTSP 服务线程，由其发往对应会话
+    if (ctx.service && chnId < (int)ctx.sessions.size()) {
+        ctx.service->Submit(ctx.sessions[chnId], frame);
+    }
+
+    // 编码可能落后采集若干帧，元信息按 PTS 回查；绑定模式下查不到就由这里登记，否则退回当前值
+    FrameMeta meta;
+    if (seqFromStream) {
+        bool created = false;
+        meta = AcquireFrameMeta(frame.pts, streamMask, &created);
+        if (created) GetPipelineMetrics().FrameCaptured(meta.seq, meta.pts, streamUs);
+    } else if (!LookupFrameMeta(frame.pts, &meta)) {
+        meta.pts = frame.pts;
+        meta.seq = frameSeq;
+        meta.mask = tileMask;
+    }
+
+    if (recorder.Running()) recorder.Submit(chnId, frame);
+    if (preEvent.Running()) preEvent.Append(chnId, frame);
+
+    sentCnt[chnId]++;
+    motionGate.RecordEncoded(chnId, frame.bytes, GetUs() - encodeStartUs[chnId].load(std::memory_order_relaxed));
+    SendTileOverNetwork(chnId, meta.seq, meta.mask, frame);
+
+    GetPipelineMetrics().TileSent(meta.seq, chnId, frame.bytes, streamUs, MetricsNowUs());
+
+    // I 帧错开/重同步，并统计单帧内的 I 帧路数（见 [GOP] 日志）
+    GetGopScheduler().OnStream(chnId, meta.seq, frame.keyframe, frame.bytes);
+
+    if (bitrateEnabled) {
+        RecordTileRate(chnId, stream, frame);
+        UpdateBitrates(streamUs);
     }
 }
 
-// 核心流程入口：把一帧 1080P 原始视频拆成 16 份、分别编码并推流
+// 核心流程入口：把一帧原始视频按网格配置拆成 TOTAL_CHNS 份（默认 1080P 拆 16 份）、分别编码并推流
 // 设计思路：
-// 1) VI 拉一帧 NV12 原始图（1920x1080）
-// 2) 用 RGA 硬件按 4x4 网格裁剪，得到 16 个小块（每块 SUB_WIDTH x SUB_HEIGHT）
-// 3) 16 个 VENC 通道一一对应，每块送入对应通道编码
-// 4) 取出每个通道的码流，推到对应 RTSP session；同时调用占位的“网络发送”接口
+// 1) VI 拉一帧 NV12 原始图（SRC_WIDTH x SRC_HEIGHT）
+// 2) 用 RGA 硬件按网格裁剪，全部 crop 作为一个 job 批量提交（每块 SUB_WIDTH x SUB_HEIGHT）
+// 3) 裁剪完成即释放 VI 帧，各 tile 交给工作线程送入对应 VENC 通道，采集线程去取下一帧
+// 4) 回收线程 poll 全部编码器 fd，取出码流推到对应 RTSP session，同时交给网络发送端
 // 这样做的好处：每个 tile 有独立码率/通道，便于统计和按需传输
-void ProcessFrames(const RtspContext &ctx, MB_POOL subImgPool) {
+void ProcessFrames(const RtspContext &ctx, MB_POOL subImgPool, const ProcessOptions &options) {
     printf("ProcessFrames start: subImgPool=%p\n", subImgPool);
+    const char *tileEndpoint = options.tileEndpoint;
+    TileMask userTiles = GetGridConfig().AllTilesMask() & ~options.boundTiles;
+    seqFromStream = options.boundTiles != 0;
+    streamMask = GetGridConfig().AllTilesMask();
+
+    // 配置了目的地址时，编码后的 tile 同时经网络发送
+    if (tileEndpoint) {
+        char host[64];
+        uint16_t port = 0;
+        TileTransport transport = TILE_TRANSPORT_UDP;
+        if (!ParseTileEndpoint(tileEndpoint, host, sizeof(host), &port, &transport) ||
+            !tileSender.Open(host, port, transport)) {
+            printf("ProcessFrames: tile endpoint %s unusable, network send disabled\n", tileEndpoint);
+        }
+    }
+
+    // 网格几何只在启动时校验一次
+    static TileSlicer slicer;
+    if (!slicer.Init(GetGridConfig())) {
+        printf("ProcessFrames: TileSlicer init failed\n");
+        return;
+    }
+
+    TileMotionGate::Options motion = options.motion;
+    if (seqFromStream && motion.enabled) {
+        printf("ProcessFrames: %d tiles bound to VPSS, motion gating disabled\n",
+               __builtin_popcountll(options.boundTiles));
+        motion.enabled = false;
+    }
+    if (!motionGate.Init(GetGridConfig(), motion)) {
+        printf("ProcessFrames: TileMotionGate init failed\n");
+        return;
+    }
+
+    if (!GetGopScheduler().Start(options.gop, TOTAL_CHNS, SUB_HEIGHT)) {
+        printf("ProcessFrames: GopScheduler start failed\n");
+        return;
+    }
+
+    bitrateEnabled = options.bitrate.enabled && bitrateAllocator.Init(options.bitrate, TOTAL_CHNS);
+    if (bitrateEnabled) {
+        rateSamples.assign(TOTAL_CHNS, BitrateAllocator::TileSample());
+        rateWindowStartUs = MetricsNowUs();
+        if (!options.bitrate.tracePath.empty()) {
+            rateTrace = fopen(options.bitrate.tracePath.c_str(), "a");
+            if (!rateTrace) printf("ProcessFrames: cannot open rate trace %s\n", options.bitrate.tracePath.c_str());
+        }
+        printf("ProcessFrames: bitrate budget %dkbps over %d tiles, period %dms\n", bitrateAllocator.TotalKbps(),
+               TOTAL_CHNS, options.bitrate.periodMs);
+    }
+
+    // 码流回收放到回收线程，RTSP 收发与事件在 RTSP 服务线程，采集线程只负责裁剪和送编码
+    static VencStreamDrainer drainer;
+    if (options.record.enabled && !recorder.Start(options.record, TOTAL_CHNS)) {
+        printf("ProcessFrames: TileRecorder start failed, recording disabled\n");
+    }
+
+    if (options.preEvent.enabled && !preEvent.Start(options.preEvent, TOTAL_CHNS)) {
+        printf("ProcessFrames: PreEventBuffer start failed, pre-event clips disabled\n");
+    }
+
+    if (options.detect.enabled) {
+        if (userTiles == 0) {
+            printf("ProcessFrames: all tiles bound, no frames reach user space for detection\n");
+        } else if (!detector.Start(options.detect, GetGridConfig(), GetNpuBackend(), OnDetection)) {
+            printf("ProcessFrames: TileDetector start failed, detection disabled\n");
+        }
+    }
 
-    // stViFrame：从 VI 拿到的一帧原始图，stStream：从 VENC 拿到的一帧码流
-    stream.pstPack = (VENC_PACK_S *)malloc(sizeof(VENC_PACK_S));
+    subscriptions.Init(options.lazy, userTiles);
+    if (subscriptions.Enabled()) {
+        printf("ProcessFrames: lazy encoding, pinned tiles 0x%llx%s\n", (unsigned long long)options.lazy.pinned,
+               tileSender.IsOpen() ? "" : " (no tile endpoint, only pinned tiles are encoded)");
+    }
+
+    bool drainerOk = drainer.Start(0, TOTAL_CHNS,
+                                   [&ctx](int chnId, const VENC_STREAM_S &stream, const StreamFrame &frame) {
+                                       OnTileStream(ctx, chnId, stream, frame);
+                                   },
+                                   PollSubscriptions);
+    if (!drainerOk) {
+        printf("ProcessFrames: VencStreamDrainer start failed\n");
+        return;
+    }
+
+    // 送编码交给工作线程；每个线程最多积压两帧的量，再多说明编码跟不上，让采集线程等待
+    static TileWorkerPool workers;
+    int workerCount = options.tileWorkers < TOTAL_CHNS ? options.tileWorkers : TOTAL_CHNS;
+    int tilesPerWorker = workerCount > 0 ? (TOTAL_CHNS + workerCount - 1) / workerCount : TOTAL_CHNS;
+    workers.Start(workerCount,
+                  [](const TileWorkerPool::Job &job) {
+                      if (job.kind != TileWorkerPool::JOB_ENCODE) {
+                          ControlTile(job.tileId, job.kind);
+                          return;
+                      }
+                      // PTS 应沿用 VI 帧，写入到 stVencFrame 时传递
+                      ProcessSingleTile(job.tileId, job.blk, job.pts);
+                      GetPipelineMetrics().TileSubmitted(job.frameSeq, job.tileId, MetricsNowUs());
+                  },
+                  2 * tilesPerWorker);
 
-    while(1) {
+    MB_BLK dstBlks[MAX_TILES];
+    Nv12Image dstImgs[MAX_TILES];
+    uint64_t fpsStartMs = GetMs();
+    uint64_t fpsStartStreams = 0;
+    uint64_t capturedFrames = 0;
+    TileMask activeTiles = userTiles; // 编码器正在接收的 tile（启动时全部已 StartRecvFrame）
+
+    // 全部 tile 都已绑定：帧不经过用户态，本线程只等待退出，码流由回收线程取
+    if (userTiles == 0) {
+        printf("ProcessFrames: all %d tiles bound, capture thread idle\n", TOTAL_CHNS);
+        for (int ticks = 1; !PipelineStopRequested(); ++ticks) {
+            usleep(100 * 1000);
+            if (ticks % 50 == 0) GetGopScheduler().PrintWindow();
+        }
+    }
+
+    while (userTiles != 0 && !PipelineStopRequested()) {
         
         // STEP 1: 从 VI 拉取一帧图像（NV12，1080P），超时 1000ms
-        RK_S32 s32Ret = RK_MPI_VI_GetChnFrame(0, 0, &viFrame, 1000);
+        RK_S32 s32Ret = GetMpiHal()->ViGetChnFrame(0, 0, &viFrame, 1000);
         // printf("test\n");
         if(s32Ret == RK_SUCCESS) {
-            if (statStartMs == 0) {
-                statStartMs = GetMs();
+            uint64_t gotUs = MetricsNowUs();
+            GetCacheSync().DeviceWrote(viFrame.stVFrame.pMbBlk, 0, ViFrameBytes(viFrame));
+            // 将 VI 帧描述为切分源（RGA 直接用该块导入过的 handle，导入失败时走 dma-buf fd）
+            Nv12Image srcImg;
+            srcImg.handle = GetRgaBufferRegistry().Acquire(viFrame.stVFrame.pMbBlk, ViFrameBytes(viFrame));
+            if (!srcImg.handle) srcImg.fd = GetMpiHal()->MbHandle2Fd(viFrame.stVFrame.pMbBlk);
+            srcImg.vir = GetMpiHal()->MbHandle2VirAddr(viFrame.stVFrame.pMbBlk);
+            srcImg.width = SRC_WIDTH;
+            srcImg.height = SRC_HEIGHT;
+
+            // 订阅有变化的 tile 先经工作线程启停编码器（排在该路后续帧之前）
+            TileMask started = 0;
+            if (subscriptions.Enabled()) {
+                TileMask active = subscriptions.Active(GetUs()) & userTiles;
+                started = active & ~activeTiles;
+                TileMask stopped = activeTiles & ~active;
+                for (int chnId = 0; chnId < TOTAL_CHNS && (started | stopped); chnId++) {
+                    if (((started | stopped) & TILE_BIT(chnId)) == 0) continue;
+                    TileWorkerPool::Job job;
+                    job.kind = (started & TILE_BIT(chnId)) ? TileWorkerPool::JOB_START : TileWorkerPool::JOB_STOP;
+                    job.tileId = chnId;
+                    workers.Submit(job);
+                }
+                if (started | stopped) {
+                    printf("[LAZY] active=0x%llx started=0x%llx stopped=0x%llx\n", (unsigned long long)active,
+                           (unsigned long long)started, (unsigned long long)stopped);
+                }
+                activeTiles = active;
             }
-            // 每取到一帧源图，递增帧序号；tileMask 默认认为 16 个 tile 都会发送
-            frameSeq++;
-            tileMask = 0xFFFF; // 如果未来只发部分 tile，请更新掩码位
-            isIdrFrame = false;    // 本帧是否为 I/IDR 帧
+
+            // tileMask 只包含本线程负责、被订阅且检测到变化（或到了刷新周期）的 tile；刚开始接收的 tile 本帧必编
             framePts = viFrame.stVFrame.u64PTS;
-            int vi_fd = RK_MPI_MB_Handle2Fd(viFrame.stVFrame.pMbBlk); // 获取VI的句柄
-
-            // 将 VI 帧封装成 RGA 可识别的源 buffer
-            rga_buffer_t src_img;
-            src_img = wrapbuffer_fd(vi_fd, SRC_WIDTH, SRC_HEIGHT, RK_FORMAT_YCbCr_420_SP, SRC_WIDTH, SRC_HEIGHT);
-            // STEP 2/3: 循环遍历 4x4 网格，对每个 tile 进行裁剪+编码
-            for (int r = 0; r < SPLIT_ROW; r++) {
-                for (int c = 0; c < SPLIT_COL; c++) {
-                    int chnId = r * SPLIT_COL + c;
-                    // PTS 应沿用 VI 帧，写入到 stVencFrame 时传递
-                    ProcessSingleTile(r,
-                                      c,
-                                      chnId,
-                                      ctx,
-                                      subImgPool,
-                                      src_img,
-                                      framePts);
+            tileMask = activeTiles;
+            if (motionGate.Enabled() && srcImg.vir) {
+                // CPU 抽样读 Y 平面前只同步 Y 平面
+                int stride = viFrame.stVFrame.u32VirWidth ? viFrame.stVFrame.u32VirWidth : SRC_WIDTH;
+                GetCacheSync().BeginCpuRead(viFrame.stVFrame.pMbBlk, 0, (size_t)stride * SRC_HEIGHT);
+                tileMask = motionGate.Select(static_cast<const uint8_t *>(srcImg.vir), stride, tileMask);
+            }
+            tileMask |= started;
+
+            // 登记帧序号；绑定模式下该帧可能已由先到的直通 tile 登记过
+            bool created = false;
+            frameSeq = AcquireFrameMeta(framePts, seqFromStream ? streamMask : tileMask, &created).seq;
+            if (created) GetPipelineMetrics().FrameCaptured(frameSeq, framePts, gotUs);
+
+            // STEP 2: 为本帧要处理的 tile 取子画面缓冲，整帧一次性提交裁剪
+            for (int chnId = 0; chnId < TOTAL_CHNS; chnId++) {
+                if ((tileMask & TILE_BIT(chnId)) == 0) continue;
+                dstBlks[chnId] = GetMpiHal()->MbGetMB(subImgPool, SUB_WIDTH * SUB_HEIGHT * 3 / 2, RK_TRUE);
+                dstImgs[chnId].handle = GetRgaBufferRegistry().Acquire(dstBlks[chnId], SUB_WIDTH * SUB_HEIGHT * 3 / 2);
+                dstImgs[chnId].fd = dstImgs[chnId].handle ? -1 : GetMpiHal()->MbHandle2Fd(dstBlks[chnId]);
+                dstImgs[chnId].vir = GetMpiHal()->MbHandle2VirAddr(dstBlks[chnId]);
+                dstImgs[chnId].width = SUB_WIDTH;
+                dstImgs[chnId].height = SUB_HEIGHT;
+            }
+
+            // 要裁哪些 tile 取决于上面的订阅与变化检测，裁完马上交给检测和工作线程，中间没有可与 RGA 重叠的工作，同步提交
+            bool sliced = slicer.Slice(srcImg, dstImgs, tileMask, nullptr);
+            GetPipelineMetrics().FrameCropped(frameSeq, MetricsNowUs());
+            for (int chnId = 0; sliced && chnId < TOTAL_CHNS; chnId++) {
+                if (tileMask & TILE_BIT(chnId)) GetCacheSync().DeviceWrote(dstBlks[chnId], 0, SUB_WIDTH * SUB_HEIGHT * 3 / 2);
+            }
+
+            // 检测按自身间隔取样：整帧模式由 RGA 直接读 VI 帧，逐 tile 模式读刚裁好的子画面，都须在归还 VI 帧之前
+            if (detector.Running()) detector.Offer(srcImg, dstImgs, sliced ? tileMask : 0, frameSeq, framePts);
+
+            // 裁剪完成后子画面已独立，VI 帧不再需要，立即还给 VI（只有 2 块缓冲）
+            GetMpiHal()->ViReleaseChnFrame(0, 0, &viFrame);
+
+            // STEP 3: 各路交给工作线程送编码；裁剪失败的帧直接丢弃，未变化的 tile 本帧不编码
+            for (int chnId = 0; chnId < TOTAL_CHNS; chnId++) {
+                if ((tileMask & TILE_BIT(chnId)) == 0) continue;
+                if (sliced) {
+                    TileWorkerPool::Job job;
+                    job.tileId = chnId;
+                    job.frameSeq = frameSeq;
+                    job.pts = framePts;
+                    job.blk = dstBlks[chnId];
+                    workers.Submit(job);
+                } else {
+                    GetMpiHal()->MbReleaseMB(dstBlks[chnId]);
                 }
             }
 
-            if(isIdrFrame){
-                printf("[FRAME] seq=%u mod15=%u isI=%d\n",
-                        (unsigned int)frameSeq,
-                        (unsigned int)(frameSeq % 15),
-                        isIdrFrame ? 1 : 0);
+            if (++capturedFrames % 150 == 0) {
+                uint64_t nowMs = GetMs();
+                uint64_t streams = drainer.StreamCount();
+                double secs = (nowMs - fpsStartMs) / 1000.0;
+                printf("[SLICE] seq=%u last=%lluus avg=%lluus crop=%lluns fps=%.1f encoded=%.1f/s worker stalls=%llu "
+                       "active=%d\n",
+                       (unsigned int)frameSeq,
+                       (unsigned long long)slicer.LastSliceUs(),
+                       (unsigned long long)slicer.AvgSliceUs(),
+                       (unsigned long long)slicer.AvgCropNs(),
+                       secs > 0 ? 150 / secs : 0.0,
+                       secs > 0 ? (streams - fpsStartStreams) / secs : 0.0,
+                       (unsigned long long)workers.Stalls(),
+                       __builtin_popcountll(activeTiles));
+                GetRgaBufferRegistry().PrintStats();
+                GetCacheSync().PrintWindow();
+                motionGate.PrintWindow(nowMs - fpsStartMs);
+                GetGopScheduler().PrintWindow();
+                preEvent.PrintBudget();
+                detector.PrintWindow();
+                fpsStartMs = nowMs;
+                fpsStartStreams = streams;
             }
-            
-            
-            if (ctx.demo) rtsp_do_event(ctx.demo);
-            RK_MPI_VI_ReleaseChnFrame(0, 0, &viFrame);
         }
     }
 
-    free(stream.pstPack);
+    // 先让工作线程把已入队的 tile 送完，再停回收线程；按需停掉的通道恢复接收，保持与启动时一致
+    for (int chnId = 0; chnId < TOTAL_CHNS; chnId++) {
+        if ((userTiles & ~activeTiles & TILE_BIT(chnId)) == 0) continue;
+        TileWorkerPool::Job job;
+        job.kind = TileWorkerPool::JOB_START;
+        job.tileId = chnId;
+        workers.Submit(job);
+    }
+    if (detector.Running()) {
+        detector.PrintWindow();
+        detector.Stop();
+    }
+    workers.Stop();
+    drainer.Stop();
+    preEvent.Stop();
+    if (recorder.Running()) {
+        recorder.Stop();
+        TileRecorder::Stats rec = recorder.GetStats();
+        printf("[REC] frames=%llu written=%.1fMB drops=%llu skipped=%llu segments=%llu max write=%lluus\n",
+               (unsigned long long)rec.frames, rec.bytesWritten / 1048576.0, (unsigned long long)rec.drops,
+               (unsigned long long)rec.skipped, (unsigned long long)rec.segments,
+               (unsigned long long)rec.maxWriteUs);
+    }
+    if (rateTrace) {
+        fclose(rateTrace);
+        rateTrace = NULL;
+    }
 }
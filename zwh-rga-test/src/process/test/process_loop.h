@@ -2,6 +2,39 @@
 
 #include "utils/rtsp_helper.h"
 #include "utils/pipeline_init.h"
+#include "utils/bitrate_allocator.h"
+#include "utils/gop_scheduler.h"
+#include "utils/pre_event_buffer.h"
+#include "utils/tile_detector.h"
+#include "utils/tile_motion_gate.h"
+#include "utils/tile_recorder.h"
+#include "utils/tile_subscriptions.h"
 
-// 主处理循环：采集 -> 裁剪 -> 编码 -> RTSP 推流
-void ProcessFrames(const RtspContext &ctx, MB_POOL subImgPool);
+static const int kDefaultTileWorkers = 4;
+
+struct ProcessOptions {
+    // 非空时（"[udp://|tcp://]ip:port"），编码后的 tile 同时经网络发送
+    const char *tileEndpoint = NULL;
+    // 静止 tile 的降频/跳过，未变化的 tile 不裁剪、不编码、不发送
+    TileMotionGate::Options motion;
+    // 送编码的工作线程数，0 表示在采集线程内串行送编码
+    int tileWorkers = kDefaultTileWorkers;
+    // 各路 I 帧的调度方式（编码通道须已按 GopScheduler::ChannelGop 创建）
+    GopScheduler::Options gop;
+    // 总码率预算在各路之间的动态分配（编码通道须已按 InitialTileKbps 创建）
+    BitrateAllocator::Options bitrate;
+    // 已由 VPSS 绑定直通编码的 tile：采集线程不再裁剪/送编码，只和其余 tile 一起取码流；
+    // 非 0 时帧序号改由先到的码流按 PTS 分配，变化检测关闭（网络发送的掩码须固定）
+    TileMask boundTiles = 0;
+    // 按需编码：只裁剪/编码被接收端订阅或常驻的 tile，其余通道停止接收（只作用于非绑定的 tile）
+    TileSubscriptions::Options lazy;
+    // 各路码流同时写入本地分段录制（后台线程写盘，暂存区满时丢帧而不阻塞回收线程）
+    TileRecorder::Options record;
+    // 各路最近若干秒码流留在内存中，触发时导出为片段文件
+    PreEventBuffer::Options preEvent;
+    // 按固定间隔对整帧或轮到的 tile 做 NPU 目标检测，与编码帧率解耦；有 tile 新出现目标时触发事前录像导出
+    TileDetector::Options detect;
+};
+
+// 主处理循环：采集 -> 变化检测 -> 裁剪 -> 编码 -> RTSP 推流
+void ProcessFrames(const RtspContext &ctx, MB_POOL subImgPool, const ProcessOptions &options = ProcessOptions());
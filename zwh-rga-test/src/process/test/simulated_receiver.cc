@@ -2,12 +2,16 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <vector>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <sys/time.h>
 
+#include "hal/mpi_hal.h"
+#include "transport/tile_jitter_buffer.h"
+#include "utils/cache_sync.h"
+#include "utils/nv12_blit.h"
+#include "utils/tile_canvas_pair.h"
 #include "utils/luckfox_mpi.h"
 
 static uint64_t GetMs() {
@@ -27,57 +31,35 @@ public:
         return true;
     }
 
+    // 可能在多个线程中并发调用：只写抖动缓冲，不加锁
     void ReceiveTile(int tileId,
                      uint16_t frameSeq,
-                     uint16_t mask,
+                     TileMask mask,
                      uint64_t pts,
                      const void *data,
                      size_t size) {
-        if (!ctx_ || ctx_->sessions.empty() || !ctx_->sessions[0]) return;
-        if ((mask & (1 << tileId)) == 0) return; // 根据 tileMask 跳过
+        if (!ctx_ || !ctx_->service || ctx_->sessions.empty() || ctx_->sessions[0] < 0) return;
+        if ((mask & TILE_BIT(tileId)) == 0) return; // 根据 tileMask 跳过
         if (!inited_) return;
 
-        std::unique_lock<std::mutex> lk(mtx_);
-        if (frameSeq != frame_.seq) {
-            // 新帧到来，将上一帧（即便缺块）标记待合成
-            if (frame_.expectedMask) frame_.dirty = true;
-            ResetFrameLocked(frameSeq, mask, pts);
+        if (jitter_.Push(tileId, frameSeq, mask, pts, data, size, GetMs()) == TileJitterBuffer::PUSH_COMPLETE) {
+            cv_.notify_one();
         }
-
-        if (frame_.expectedMask == 0) return; // 全部被跳过
-
-        frame_.tiles[tileId].data.assign(static_cast<const uint8_t *>(data),
-                                         static_cast<const uint8_t *>(data) + size);
-        frame_.receivedMask |= (1 << tileId);
-        frame_.dirty = true;
-        frame_.lastUpdateMs = GetMs();
-        cv_.notify_one();
     }
 
 private:
-    static constexpr int kMergedChnId = TOTAL_CHNS; // 使用未占用的通道 ID
-
-    struct TileBuffer {
-        std::vector<uint8_t> data;
-    };
+    static constexpr int kMergedChnId = MAX_TILES; // 使用 tile 不会占用的通道 ID
 
-    struct FrameState {
-        uint16_t seq = 0;
-        uint16_t expectedMask = 0;
-        uint16_t receivedMask = 0;
-        uint64_t pts = 0;
-        bool dirty = false;
-        uint64_t lastUpdateMs = 0;
-        std::vector<TileBuffer> tiles;
-    };
+    static constexpr int kJitterSlots = 4;   // 容忍的乱序深度（帧）
+    static constexpr uint64_t kIdlePollMs = 5; // 合成线程无通知时的轮询间隔
 
     bool EnsureInited() {
         if (inited_) return true;
         if (!InitMergedVenc()) return false;
         if (!CreateCanvasPool()) return false;
-        mergedStream_.pstPack = (VENC_PACK_S *)malloc(sizeof(VENC_PACK_S));
-        memset(mergedStream_.pstPack, 0, sizeof(VENC_PACK_S));
-        frame_.tiles.assign(TOTAL_CHNS, TileBuffer());
+        if (!jitter_.Init(kJitterSlots, SUB_WIDTH * SUB_HEIGHT * 3 / 2)) return false;
+        // 两块常驻画布，初始为 NV12 黑色（Y=0，UV=128）
+        if (!canvases_.Init(canvasPool_)) return false;
         inited_ = true;
         return true;
     }
@@ -100,7 +82,7 @@ private:
         attr.stRcAttr.stH264Cbr.fr32DstFrameRateNum = 25;
         attr.stRcAttr.stH264Cbr.fr32DstFrameRateDen = 1;
 
-        RK_S32 ret = RK_MPI_VENC_CreateChn(kMergedChnId, &attr);
+        RK_S32 ret = GetMpiHal()->VencCreateChn(kMergedChnId, &attr);
         if (ret != RK_SUCCESS) {
             printf("Create merged VENC Chn %d failed: 0x%x\n", kMergedChnId, ret);
             return false;
@@ -109,7 +91,7 @@ private:
         VENC_RECV_PIC_PARAM_S recv;
         memset(&recv, 0, sizeof(recv));
         recv.s32RecvPicNum = -1;
-        RK_MPI_VENC_StartRecvFrame(kMergedChnId, &recv);
+        GetMpiHal()->VencStartRecvFrame(kMergedChnId, &recv);
         return true;
     }
 
@@ -119,7 +101,7 @@ private:
         cfg.u64MBSize = SRC_WIDTH * SRC_HEIGHT * 3 / 2;
         cfg.u32MBCnt = 2;
         cfg.enAllocType = MB_ALLOC_TYPE_DMA;
-        canvasPool_ = RK_MPI_MB_CreatePool(&cfg);
+        canvasPool_ = GetMpiHal()->MbCreatePool(&cfg);
         if (canvasPool_ == MB_INVALID_POOLID) {
             printf("Create canvas pool failed.\n");
             return false;
@@ -127,48 +109,54 @@ private:
         return true;
     }
 
-    void ResetFrameLocked(uint16_t seq, uint16_t mask, uint64_t pts) {
-        frame_.seq = seq;
-        frame_.expectedMask = mask;
-        frame_.receivedMask = 0;
-        frame_.pts = pts;
-        frame_.dirty = false;
-        frame_.lastUpdateMs = GetMs();
-        for (auto &tile : frame_.tiles) tile.data.clear();
-    }
-
+    // 生产者只在帧收齐时通知；残缺帧靠超时轮询交出（通知丢失最多延迟 kIdlePollMs）
     void MergeLoop() {
         std::unique_lock<std::mutex> lk(mtx_);
+        TileJitterBuffer::FrameView view;
         while (true) {
-            cv_.wait_for(lk, std::chrono::milliseconds(flushIntervalMs_), [&]{ return frame_.dirty; });
-            uint64_t now = GetMs();
-            bool shouldFlush = frame_.dirty &&
-                               ((frame_.receivedMask & frame_.expectedMask) == frame_.expectedMask ||
-                                (frame_.expectedMask && now - frame_.lastUpdateMs >= flushIntervalMs_));
-            if (!shouldFlush) continue;
-            FrameState local = frame_; // 拷贝元信息
-            frame_.dirty = false;
-            lk.unlock();
-            EncodeAndSend(local);
-            lk.lock();
+            cv_.wait_for(lk, std::chrono::milliseconds(kIdlePollMs));
+            while (jitter_.AcquireFrame(GetMs(), flushIntervalMs_, &view)) {
+                EncodeAndSend(view);
+                jitter_.ReleaseFrame(view);
+            }
         }
     }
 
-    void EncodeAndSend(const FrameState &state) {
-        if (!ctx_ || !ctx_->sessions[0]) return;
+    // 收到的 tile 直接写进轮到的画布；未收到的（发送端判定静止而跳过，或丢失）沿用上一次的内容：
+    // 这块画布上已是最新的不动，过期的从另一块画布拷过来
+    void EncodeAndSend(const TileJitterBuffer::FrameView &view) {
+        if (!ctx_ || !ctx_->service || ctx_->sessions.empty() || ctx_->sessions[0] < 0) return;
         if (canvasPool_ == MB_INVALID_POOLID) return;
 
-        MB_BLK canvasBlk = RK_MPI_MB_GetMB(canvasPool_, SRC_WIDTH * SRC_HEIGHT * 3 / 2, RK_TRUE);
-        void *canvasVir = RK_MPI_MB_Handle2VirAddr(canvasBlk);
-        memset(canvasVir, 0, SRC_WIDTH * SRC_HEIGHT * 3 / 2);
-
+        TileCanvasPair::Canvas *canvas = canvases_.Acquire();
+        if (!canvas) return;
+        TileMask received = 0;
         for (int i = 0; i < TOTAL_CHNS; ++i) {
-            if (state.expectedMask & (1 << i)) {
-                BlitTile(i, state.tiles[i].data, canvasVir);
+            if ((view.receivedMask & TILE_BIT(i)) &&
+                BlitTile(i, jitter_.TileData(view, i), jitter_.TileSize(view, i), canvas->vir)) {
+                received |= TILE_BIT(i);
             }
         }
+        TileMask carried = canvas->stale & ~received;
+        if (carried) {
+            const TileCanvasPair::Canvas *peer = canvases_.Peer(canvas);
+            GetCacheSync().BeginCpuRead(peer->blk, 0, SRC_WIDTH * SRC_HEIGHT * 3 / 2);
+            Nv12View src = Nv12At(peer->vir, SRC_WIDTH, SRC_HEIGHT);
+            Nv12View dst = Nv12At(canvas->vir, SRC_WIDTH, SRC_HEIGHT);
+            for (int i = 0; i < TOTAL_CHNS; ++i) {
+                if ((carried & TILE_BIT(i)) == 0) continue;
+                int x = GetGridConfig().TileX(i);
+                int y = GetGridConfig().TileY(i);
+                Nv12Copy(src, x, y, dst, x, y, SUB_WIDTH, SUB_HEIGHT);
+            }
+        }
+        canvases_.MarkChanged(received);
+        canvases_.MarkWritten(canvas, received | carried);
+        if (++frameCnt_ % 300 == 0) canvases_.PrintWindow("receiver");
 
-        RK_MPI_SYS_MmzFlushCache(canvasBlk, RK_TRUE);
+        MB_BLK canvasBlk = canvas->blk;
+        TileCanvasPair::CpuWroteTiles(canvasBlk, received | carried);
+        GetCacheSync().BeginDeviceAccess(canvasBlk);
 
         VIDEO_FRAME_INFO_S vencFrame;
         memset(&vencFrame, 0, sizeof(vencFrame));
@@ -178,54 +166,34 @@ private:
         vencFrame.stVFrame.u32VirHeight = SRC_HEIGHT;
         vencFrame.stVFrame.enPixelFormat = RK_FMT_YUV420SP;
         vencFrame.stVFrame.pMbBlk = canvasBlk;
-        vencFrame.stVFrame.u64PTS = state.pts;
+        vencFrame.stVFrame.u64PTS = view.pts;
 
-        RK_MPI_VENC_SendFrame(kMergedChnId, &vencFrame, -1);
-        RK_MPI_MB_ReleaseMB(canvasBlk);
+        GetMpiHal()->VencSendFrame(kMergedChnId, &vencFrame, -1);
 
-        if (RK_MPI_VENC_GetStream(kMergedChnId, &mergedStream_, 0) == RK_SUCCESS) {
-            void *pData = RK_MPI_MB_Handle2VirAddr(mergedStream_.pstPack->pMbBlk);
-            rtsp_tx_video(ctx_->sessions[0],
-                          static_cast<uint8_t *>(pData),
-                          mergedStream_.pstPack->u32Len,
-                          mergedStream_.pstPack->u64PTS);
-            RK_MPI_VENC_ReleaseStream(kMergedChnId, &mergedStream_);
-            if (ctx_ && ctx_->demo) rtsp_do_event(ctx_->demo);
+        if (streamReader_.Get(kMergedChnId, 0) == RK_SUCCESS) {
+            ctx_->service->Submit(ctx_->sessions[0], streamReader_.Frame());
+            streamReader_.Release(kMergedChnId);
         }
     }
 
-    void BlitTile(int tileId, const std::vector<uint8_t> &tile, void *canvasVir) {
-        if (tile.size() < SUB_WIDTH * SUB_HEIGHT * 3 / 2) return;
-        int r = tileId / SPLIT_COL;
-        int c = tileId % SPLIT_COL;
-        int x = c * SUB_WIDTH;
-        int y = r * SUB_HEIGHT;
-        const uint8_t *src = tile.data();
-        uint8_t *dst = static_cast<uint8_t *>(canvasVir);
-        int dstStride = SRC_WIDTH;
-
-        // Y 平面
-        for (int row = 0; row < SUB_HEIGHT; ++row) {
-            memcpy(dst + (y + row) * dstStride + x, src + row * SUB_WIDTH, SUB_WIDTH);
-        }
-
-        // UV 平面
-        const uint8_t *srcUV = src + SUB_WIDTH * SUB_HEIGHT;
-        uint8_t *dstUV = dst + SRC_WIDTH * SRC_HEIGHT;
-        int uvY = y / 2;
-        for (int row = 0; row < SUB_HEIGHT / 2; ++row) {
-            memcpy(dstUV + (uvY + row) * dstStride + x, srcUV + row * SUB_WIDTH, SUB_WIDTH);
-        }
+    bool BlitTile(int tileId, const uint8_t *tile, size_t size, void *canvasVir) {
+        if (!tile || size < (size_t)(SUB_WIDTH * SUB_HEIGHT * 3 / 2)) return false;
+        // 紧凑排列的 tile（stride 即 tile 宽）按原位置拷进画布
+        Nv12Copy(Nv12At(tile, SUB_WIDTH, SUB_HEIGHT), 0, 0, Nv12At(canvasVir, SRC_WIDTH, SRC_HEIGHT),
+                 GetGridConfig().TileX(tileId), GetGridConfig().TileY(tileId), SUB_WIDTH, SUB_HEIGHT);
+        return true;
     }
 
     const RtspContext *ctx_ = nullptr;
-    FrameState frame_;
+    TileJitterBuffer jitter_;
     bool inited_ = false;
     const uint64_t flushIntervalMs_ = 30;
     MB_POOL canvasPool_ = MB_INVALID_POOLID;
-    VENC_STREAM_S mergedStream_;
+    TileCanvasPair canvases_; // 合成线程独占
+    uint64_t frameCnt_ = 0;
+    VencStreamReader streamReader_;
     std::thread worker_;
-    std::mutex mtx_;
+    std::mutex mtx_; // 只配合 cv_ 使用，生产者不持有
     std::condition_variable cv_;
 };
 
@@ -237,7 +205,7 @@ bool InitSimulatedReceiver(const RtspContext *ctx) {
     if (gReady) {
         printf("SimulatedReceiver inited, merged stream -> /live/0\n");
     } else {
-        printf("SimulatedReceiver init failed, keep 16-way streaming.\n");
+        printf("SimulatedReceiver init failed, keep %d-way streaming.\n", TOTAL_CHNS);
     }
     return gReady;
 }
@@ -248,7 +216,7 @@ bool SimulatedReceiverReady() {
 
 void SendTileToSimulatedReceiver(int tileId,
                                  uint16_t frameSeq,
-                                 uint16_t tileMask,
+                                 TileMask tileMask,
                                  uint64_t pts,
                                  const void *data,
                                  size_t size) {
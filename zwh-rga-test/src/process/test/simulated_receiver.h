@@ -15,7 +15,7 @@ bool SimulatedReceiverReady();
 // 将单个 tile 的 NV12 数据送入接收端，内部按位置拼成 1080P 再推一路 /live/0。
 void SendTileToSimulatedReceiver(int tileId,
                                  uint16_t frameSeq,
-                                 uint16_t tileMask,
+                                 TileMask tileMask,
                                  uint64_t pts,
                                  const void *data,
                                  size_t size);
@@ -0,0 +1,175 @@
+#include "tile_jitter_buffer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+bool TileJitterBuffer::Init(int slotCount, size_t maxTileSize) {
+    if (slotCount < 2 || maxTileSize == 0) {
+        printf("TileJitterBuffer: invalid slotCount=%d maxTileSize=%zu\n", slotCount, maxTileSize);
+        return false;
+    }
+    slots_.reset(new Slot[slotCount]);
+    slotCount_ = slotCount;
+    tileCount_ = TOTAL_CHNS;
+    maxTileSize_ = maxTileSize;
+    for (int i = 0; i < slotCount; ++i) slots_[i].data.resize(tileCount_ * maxTileSize);
+    lastEmittedSeq_.store(-1, std::memory_order_relaxed);
+    return true;
+}
+
+// 在槽位上登记一个写者；需要时把槽位从旧帧回收给 frameSeq
+bool TileJitterBuffer::EnterSlot(Slot &slot, uint16_t frameSeq, TileMask tileMask, uint64_t pts,
+                                 uint64_t nowMs, PushResult *reject) {
+    while (true) {
+        uint32_t w = slot.word.load(std::memory_order_acquire);
+        uint32_t state = WordState(w);
+        int16_t diff = (int16_t)(frameSeq - WordSeq(w));
+
+        if (state == SLOT_RESETTING) continue; // 另一个生产者正在清空，马上结束
+        if (state != SLOT_EMPTY && diff < 0) {
+            *reject = PUSH_LATE;
+            return false;
+        }
+        if (diff == 0 && state == SLOT_FILLING) {
+            if (WordWriters(w) == 0xFF) continue;
+            if (slot.word.compare_exchange_weak(w, w + (1u << 16), std::memory_order_acq_rel)) return true;
+            continue;
+        }
+        if (diff == 0 && (state == SLOT_MERGING || state == SLOT_DONE)) {
+            *reject = PUSH_LATE;
+            return false;
+        }
+        // 槽位空闲或属于更早的帧：旧帧仍在写入或正被合成时不能覆盖
+        if (WordWriters(w) != 0 || state == SLOT_MERGING) {
+            *reject = PUSH_OVERRUN;
+            return false;
+        }
+        if (!slot.word.compare_exchange_weak(w, MakeWord(frameSeq, 0, SLOT_RESETTING),
+                                             std::memory_order_acq_rel)) {
+            continue;
+        }
+        if (state == SLOT_FILLING) framesEvicted_.fetch_add(1, std::memory_order_relaxed);
+        slot.tileMask.store(tileMask, std::memory_order_relaxed);
+        slot.claimMask.store(0, std::memory_order_relaxed);
+        slot.receivedMask.store(0, std::memory_order_relaxed);
+        slot.pts.store(pts, std::memory_order_relaxed);
+        slot.firstMs.store(nowMs, std::memory_order_relaxed);
+        slot.word.store(MakeWord(frameSeq, 1, SLOT_FILLING), std::memory_order_release);
+        return true;
+    }
+}
+
+TileJitterBuffer::PushResult TileJitterBuffer::Push(int tileId, uint16_t frameSeq, TileMask tileMask,
+                                                    uint64_t pts, const void *data, size_t size,
+                                                    uint64_t nowMs) {
+    if (!slots_ || tileId < 0 || tileId >= tileCount_ || !(tileMask & TILE_BIT(tileId)) ||
+        size > maxTileSize_) {
+        return PUSH_INVALID;
+    }
+
+    // 比已交出的帧更早的 tile 不再占用槽位
+    int32_t lastEmitted = lastEmittedSeq_.load(std::memory_order_relaxed);
+    if (lastEmitted >= 0 && (int16_t)(frameSeq - (uint16_t)lastEmitted) <= 0) {
+        tilesLate_.fetch_add(1, std::memory_order_relaxed);
+        return PUSH_LATE;
+    }
+
+    Slot &slot = slots_[frameSeq % slotCount_];
+    PushResult reject = PUSH_INVALID;
+    if (!EnterSlot(slot, frameSeq, tileMask, pts, nowMs, &reject)) {
+        if (reject == PUSH_LATE) tilesLate_.fetch_add(1, std::memory_order_relaxed);
+        if (reject == PUSH_OVERRUN) tilesOverrun_.fetch_add(1, std::memory_order_relaxed);
+        return reject;
+    }
+
+    TileMask bit = TILE_BIT(tileId);
+    PushResult result;
+    if (slot.claimMask.fetch_or(bit, std::memory_order_relaxed) & bit) {
+        tilesDuplicate_.fetch_add(1, std::memory_order_relaxed);
+        result = PUSH_DUPLICATE;
+    } else {
+        memcpy(slot.data.data() + tileId * maxTileSize_, data, size);
+        slot.sizes[tileId] = (uint32_t)size;
+        TileMask got = slot.receivedMask.fetch_or(bit, std::memory_order_release) | bit;
+        tilesAccepted_.fetch_add(1, std::memory_order_relaxed);
+        TileMask expected = slot.tileMask.load(std::memory_order_relaxed);
+        result = ((got & expected) == expected) ? PUSH_COMPLETE : PUSH_ACCEPTED;
+    }
+    slot.word.fetch_sub(1u << 16, std::memory_order_release);
+    return result;
+}
+
+bool TileJitterBuffer::AcquireFrame(uint64_t nowMs, uint64_t maxWaitMs, FrameView *out) {
+    if (!slots_) return false;
+
+    int32_t lastEmitted = lastEmittedSeq_.load(std::memory_order_relaxed);
+    int oldest = -1;
+    uint16_t oldestSeq = 0;
+    uint16_t newestSeq = 0;
+    for (int i = 0; i < slotCount_; ++i) {
+        Slot &slot = slots_[i];
+        uint32_t w = slot.word.load(std::memory_order_acquire);
+        if (WordState(w) != SLOT_FILLING) continue;
+        uint16_t seq = WordSeq(w);
+        if (lastEmitted >= 0 && (int16_t)(seq - (uint16_t)lastEmitted) <= 0) {
+            // 比已交出的帧还旧：乱序太多，整帧放弃（失败说明还有写者，下次再试）
+            if (WordWriters(w) == 0 &&
+                slot.word.compare_exchange_strong(w, MakeWord(seq, 0, SLOT_DONE), std::memory_order_acq_rel)) {
+                framesEvicted_.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        if (oldest < 0) {
+            oldest = i;
+            oldestSeq = newestSeq = seq;
+        } else if ((int16_t)(seq - oldestSeq) < 0) {
+            oldest = i;
+            oldestSeq = seq;
+        } else if ((int16_t)(seq - newestSeq) > 0) {
+            newestSeq = seq;
+        }
+    }
+    if (oldest < 0) return false;
+
+    Slot &slot = slots_[oldest];
+    TileMask expected = slot.tileMask.load(std::memory_order_relaxed);
+    TileMask got = slot.receivedMask.load(std::memory_order_acquire);
+    bool complete = (got & expected) == expected;
+    bool timedOut = nowMs - slot.firstMs.load(std::memory_order_relaxed) >= maxWaitMs;
+    bool crowded = (int)(uint16_t)(newestSeq - oldestSeq) >= slotCount_ - 1;
+    if (!complete && !timedOut && !crowded) return false;
+
+    uint32_t w = MakeWord(oldestSeq, 0, SLOT_FILLING);
+    if (!slot.word.compare_exchange_strong(w, MakeWord(oldestSeq, 0, SLOT_MERGING), std::memory_order_acq_rel)) {
+        return false; // 仍有生产者在写，下一轮再取
+    }
+
+    got = slot.receivedMask.load(std::memory_order_acquire);
+    out->slot = oldest;
+    out->frameSeq = oldestSeq;
+    out->tileMask = expected;
+    out->receivedMask = got & expected;
+    out->pts = slot.pts.load(std::memory_order_relaxed);
+    lastEmittedSeq_.store(oldestSeq, std::memory_order_relaxed);
+    if (out->receivedMask == expected) {
+        framesComplete_++;
+    } else {
+        framesPartial_++;
+    }
+    return true;
+}
+
+void TileJitterBuffer::ReleaseFrame(const FrameView &view) {
+    if (view.slot < 0 || view.slot >= slotCount_) return;
+    slots_[view.slot].word.store(MakeWord(view.frameSeq, 0, SLOT_DONE), std::memory_order_release);
+}
+
+const uint8_t *TileJitterBuffer::TileData(const FrameView &view, int tileId) const {
+    if (view.slot < 0 || !(view.receivedMask & TILE_BIT(tileId))) return nullptr;
+    return slots_[view.slot].data.data() + tileId * maxTileSize_;
+}
+
+size_t TileJitterBuffer::TileSize(const FrameView &view, int tileId) const {
+    if (view.slot < 0 || !(view.receivedMask & TILE_BIT(tileId))) return 0;
+    return slots_[view.slot].sizes[tileId];
+}
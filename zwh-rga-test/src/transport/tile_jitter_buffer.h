@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "utils/config.h"
+
+// 接收端抖动缓冲：N 个帧槽按 frameSeq % N 索引，tile 存储在 Init 时一次性分配
+// - 生产者（收包线程，可多个）Push 时不加锁、不分配内存：
+//   槽位状态字 = seq | 写者计数 | 状态，用 CAS 认领/回收槽位；
+//   每个 tile 先在 claimMask 上占位（去重），拷贝完成后再置 receivedMask（release）
+// - 消费者（合成线程，只能一个）AcquireFrame 按 frameSeq 顺序取帧：
+//   帧收齐、等待超时或后续帧堆积到槽位将满时交出，交出期间槽位不会被覆盖
+// - 迟到的 tile 只要其帧还在槽内、尚未交出，就能落到正确的帧
+class TileJitterBuffer {
+public:
+    enum PushResult {
+        PUSH_ACCEPTED = 0,  // 已写入
+        PUSH_COMPLETE,      // 已写入，且该帧已收齐
+        PUSH_DUPLICATE,     // 同一 tile 重复到达
+        PUSH_LATE,          // 所属帧已交出或已被更新的帧覆盖
+        PUSH_OVERRUN,       // 槽位仍被旧帧占用（正在写入或合成），丢弃
+        PUSH_INVALID,       // tileId/tileMask/size 非法
+    };
+
+    // 交给消费者的一帧，ReleaseFrame 前 TileData 指向的数据保持有效
+    struct FrameView {
+        int slot = -1;
+        uint16_t frameSeq = 0;
+        TileMask tileMask = 0;     // 发送端声明本帧包含的 tile
+        TileMask receivedMask = 0; // 实际收齐的 tile
+        uint64_t pts = 0;
+    };
+
+    bool Init(int slotCount, size_t maxTileSize);
+
+    PushResult Push(int tileId, uint16_t frameSeq, TileMask tileMask, uint64_t pts,
+                    const void *data, size_t size, uint64_t nowMs);
+
+    // 取出下一帧（按 frameSeq 顺序）；没有可交出的帧时返回 false
+    bool AcquireFrame(uint64_t nowMs, uint64_t maxWaitMs, FrameView *out);
+    void ReleaseFrame(const FrameView &view);
+
+    const uint8_t *TileData(const FrameView &view, int tileId) const;
+    size_t TileSize(const FrameView &view, int tileId) const;
+
+    int SlotCount() const { return slotCount_; }
+    uint64_t TilesAccepted() const { return tilesAccepted_.load(std::memory_order_relaxed); }
+    uint64_t TilesDuplicate() const { return tilesDuplicate_.load(std::memory_order_relaxed); }
+    uint64_t TilesLate() const { return tilesLate_.load(std::memory_order_relaxed); }
+    uint64_t TilesOverrun() const { return tilesOverrun_.load(std::memory_order_relaxed); }
+    uint64_t FramesEvicted() const { return framesEvicted_.load(std::memory_order_relaxed); }
+    uint64_t FramesComplete() const { return framesComplete_; }
+    uint64_t FramesPartial() const { return framesPartial_; }
+
+private:
+    enum SlotState {
+        SLOT_EMPTY = 0,
+        SLOT_RESETTING, // 生产者正在为新帧清空槽位
+        SLOT_FILLING,
+        SLOT_MERGING,   // 消费者持有
+        SLOT_DONE,      // 已交出或已放弃，保留 seq 以识别迟到 tile
+    };
+
+    struct Slot {
+        std::atomic<uint32_t> word{0}; // [31:24] 状态 [23:16] 写者数 [15:0] frameSeq
+        std::atomic<TileMask> tileMask{0};
+        std::atomic<TileMask> claimMask{0};
+        std::atomic<TileMask> receivedMask{0};
+        std::atomic<uint64_t> pts{0};
+        std::atomic<uint64_t> firstMs{0};
+        uint32_t sizes[MAX_TILES] = {0};
+        std::vector<uint8_t> data; // tileCount_ * maxTileSize_
+    };
+
+    static uint32_t MakeWord(uint16_t seq, uint32_t writers, uint32_t state) {
+        return (state << 24) | (writers << 16) | seq;
+    }
+    static uint16_t WordSeq(uint32_t w) { return (uint16_t)w; }
+    static uint32_t WordWriters(uint32_t w) { return (w >> 16) & 0xFF; }
+    static uint32_t WordState(uint32_t w) { return w >> 24; }
+
+    bool EnterSlot(Slot &slot, uint16_t frameSeq, TileMask tileMask, uint64_t pts, uint64_t nowMs,
+                   PushResult *reject);
+
+    std::unique_ptr<Slot[]> slots_;
+    int slotCount_ = 0;
+    int tileCount_ = 0; // Init 时按当前网格配置确定
+    size_t maxTileSize_ = 0;
+
+    // 最近交出的 frameSeq（-1 表示尚未交出），只由消费者写，生产者据此提前拒绝迟到 tile
+    std::atomic<int32_t> lastEmittedSeq_{-1};
+
+    // 仅消费者线程访问
+    uint64_t framesComplete_ = 0;
+    uint64_t framesPartial_ = 0;
+
+    std::atomic<uint64_t> tilesAccepted_{0};
+    std::atomic<uint64_t> tilesDuplicate_{0};
+    std::atomic<uint64_t> tilesLate_{0};
+    std::atomic<uint64_t> tilesOverrun_{0};
+    std::atomic<uint64_t> framesEvicted_{0};
+};
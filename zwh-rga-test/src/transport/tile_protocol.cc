@@ -0,0 +1,94 @@
+#include "tile_protocol.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void Put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void Put32(uint8_t *p, uint32_t v) {
+    Put16(p, (uint16_t)(v >> 16));
+    Put16(p + 2, (uint16_t)v);
+}
+
+static void Put64(uint8_t *p, uint64_t v) {
+    Put32(p, (uint32_t)(v >> 32));
+    Put32(p + 4, (uint32_t)v);
+}
+
+static uint16_t Get16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t Get32(const uint8_t *p) {
+    return ((uint32_t)Get16(p) << 16) | Get16(p + 2);
+}
+
+static uint64_t Get64(const uint8_t *p) {
+    return ((uint64_t)Get32(p) << 32) | Get32(p + 4);
+}
+
+void EncodeTileHeader(const TilePacketHeader &hdr, uint8_t *out) {
+    Put16(out + 0, kTileMagic);
+    out[2] = kTileProtoVersion;
+    out[3] = hdr.flags;
+    Put16(out + 4, hdr.frameSeq);
+    out[6] = hdr.tileId;
+    out[7] = 0;
+    Put16(out + 8, hdr.fragIdx);
+    Put16(out + 10, hdr.fragCnt);
+    Put32(out + 12, hdr.tileSize);
+    Put32(out + 16, hdr.fragOffset);
+    Put64(out + 20, hdr.tileMask);
+    Put64(out + 28, hdr.pts);
+}
+
+bool DecodeTileHeader(const uint8_t *in, size_t len, TilePacketHeader *hdr) {
+    if (len < kTileHeaderSize || Get16(in) != kTileMagic || in[2] != kTileProtoVersion) return false;
+    hdr->flags = in[3];
+    hdr->frameSeq = Get16(in + 4);
+    hdr->tileId = in[6];
+    hdr->fragIdx = Get16(in + 8);
+    hdr->fragCnt = Get16(in + 10);
+    hdr->tileSize = Get32(in + 12);
+    hdr->fragOffset = Get32(in + 16);
+    hdr->tileMask = Get64(in + 20);
+    hdr->pts = Get64(in + 28);
+    return hdr->fragCnt > 0 && hdr->fragIdx < hdr->fragCnt && hdr->fragOffset <= hdr->tileSize;
+}
+
+void EncodeTileSubscribe(TileMask mask, uint32_t leaseMs, uint8_t *out) {
+    Put16(out + 0, kTileSubscribeMagic);
+    out[2] = kTileProtoVersion;
+    out[3] = 0;
+    Put32(out + 4, leaseMs);
+    Put64(out + 8, mask);
+}
+
+bool DecodeTileSubscribe(const uint8_t *in, size_t len, TileMask *mask, uint32_t *leaseMs) {
+    if (len < kTileSubscribeSize || Get16(in) != kTileSubscribeMagic || in[2] != kTileProtoVersion) return false;
+    *leaseMs = Get32(in + 4);
+    *mask = Get64(in + 8);
+    return true;
+}
+
+bool ParseTileEndpoint(const char *endpoint, char *host, size_t hostLen, uint16_t *port, TileTransport *transport) {
+    if (!endpoint || !host || !port || !transport) return false;
+    *transport = TILE_TRANSPORT_UDP;
+    if (strncmp(endpoint, "tcp://", 6) == 0) {
+        *transport = TILE_TRANSPORT_TCP;
+        endpoint += 6;
+    } else if (strncmp(endpoint, "udp://", 6) == 0) {
+        endpoint += 6;
+    }
+    const char *colon = strrchr(endpoint, ':');
+    if (!colon || colon == endpoint || (size_t)(colon - endpoint) >= hostLen) return false;
+    int value = atoi(colon + 1);
+    if (value <= 0 || value > 65535) return false;
+    memcpy(host, endpoint, colon - endpoint);
+    host[colon - endpoint] = '\0';
+    *port = (uint16_t)value;
+    return true;
+}
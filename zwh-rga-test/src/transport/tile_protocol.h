@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/config.h"
+
+// tile 传输协议：每个报文 = 固定长度头 + 一段 tile 码流
+// - UDP：按 MTU 把一个 tile 切成若干分片，每片一个报文，接收端按 frameSeq/tileId 重组
+// - TCP：一个 tile 一条记录（fragCnt = 1），头后紧跟完整负载
+// 所有多字节字段按网络字节序编码，不依赖结构体内存布局
+//
+//  0      2    3     4         6      7     8        10       12         16           20         28      36
+//  | magic| ver|flags| frameSeq|tileId| rsv | fragIdx| fragCnt| tileSize | fragOffset | tileMask | pts   |
+//
+// v2：tileMask 扩为 64 位以支持运行期配置的网格（最多 MAX_TILES 个 tile），与 v1 不兼容
+//
+// 反向订阅（接收端 -> 发送端，同一 socket/连接）：接收端声明要看的 tile，发送端只编码有订阅的 tile
+//  0      2    3     4         8          16
+//  | magic| ver| rsv | leaseMs | tileMask |
+// 订阅在 leaseMs 后过期，接收端须周期性续订；发送端定期发只有头的通告报文（kTileFlagAnnounce），
+// UDP 接收端据此得知发送端地址并立即回复订阅
+
+static const uint16_t kTileMagic = 0x5A54; // "ZT"
+static const uint8_t kTileProtoVersion = 2;
+static const size_t kTileHeaderSize = 36;
+static const uint16_t kTileSubscribeMagic = 0x5A53; // "ZS"
+static const size_t kTileSubscribeSize = 16;
+
+// flags 位定义
+static const uint8_t kTileFlagKeyframe = 1 << 0;
+static const uint8_t kTileFlagAnnounce = 1 << 1; // 通告报文，无负载，tileMask 为发送端当前在编码的 tile
+
+enum TileTransport {
+    TILE_TRANSPORT_UDP = 0,
+    TILE_TRANSPORT_TCP = 1,
+};
+
+// 一个 tile 的元信息（与 process_loop 中占位接口的参数一一对应）
+struct TileInfo {
+    int tileId = 0;
+    uint16_t frameSeq = 0;
+    TileMask tileMask = 0;
+    uint64_t pts = 0;
+    bool keyframe = false;
+    uint32_t size = 0;
+};
+
+// 单个报文头（解码后的形式）
+struct TilePacketHeader {
+    uint8_t flags = 0;
+    uint16_t frameSeq = 0;
+    TileMask tileMask = 0;
+    uint8_t tileId = 0;
+    uint16_t fragIdx = 0;
+    uint16_t fragCnt = 0;
+    uint32_t tileSize = 0;
+    uint32_t fragOffset = 0;
+    uint64_t pts = 0;
+};
+
+// 编码到 out（至少 kTileHeaderSize 字节）
+void EncodeTileHeader(const TilePacketHeader &hdr, uint8_t *out);
+
+// 从 in 解码，magic/版本不符时返回 false
+bool DecodeTileHeader(const uint8_t *in, size_t len, TilePacketHeader *hdr);
+
+// 订阅报文：out 至少 kTileSubscribeSize 字节
+void EncodeTileSubscribe(TileMask mask, uint32_t leaseMs, uint8_t *out);
+bool DecodeTileSubscribe(const uint8_t *in, size_t len, TileMask *mask, uint32_t *leaseMs);
+
+// 解析 "[udp://|tcp://]ip:port"，缺省协议为 UDP，成功返回 true
+bool ParseTileEndpoint(const char *endpoint, char *host, size_t hostLen, uint16_t *port, TileTransport *transport);
@@ -0,0 +1,293 @@
+#include "tile_receiver.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static const unsigned int kRecvBatch = 32;  // 单次 recvmmsg 的报文数上限
+static const size_t kMaxDatagram = 9216;    // 兼容巨型帧 MTU
+static const int kSocketBufBytes = 4 * 1024 * 1024;
+
+static uint64_t NowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000ULL;
+}
+
+bool TileReceiver::Open(uint16_t port, TileTransport transport, size_t maxTileSize) {
+    Close();
+    transport_ = transport;
+    maxTileSize_ = maxTileSize;
+    tileCount_ = TOTAL_CHNS;
+
+    int type = (transport == TILE_TRANSPORT_TCP) ? SOCK_STREAM : SOCK_DGRAM;
+    listenFd_ = socket(AF_INET, type | SOCK_NONBLOCK, 0);
+    if (listenFd_ < 0) {
+        printf("TileReceiver: socket failed: %s\n", strerror(errno));
+        return false;
+    }
+    int one = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(listenFd_, SOL_SOCKET, SO_RCVBUF, &kSocketBufBytes, sizeof(kSocketBufBytes));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        (transport == TILE_TRANSPORT_TCP && listen(listenFd_, 1) != 0)) {
+        printf("TileReceiver: bind/listen port %u failed: %s\n", port, strerror(errno));
+        Close();
+        return false;
+    }
+
+    // 所有重组缓冲一次性按实际 tile 数分配，收包过程中不再分配内存
+    size_t maxFrags = maxTileSize / 256 + 1;
+    for (auto &frame : frames_) {
+        frame.active = false;
+        frame.tiles.assign(tileCount_, TileSlot());
+        for (auto &tile : frame.tiles) {
+            tile.active = false;
+            tile.data.resize(maxTileSize);
+            tile.fragSeen.assign(maxFrags, 0);
+        }
+    }
+    rxBuf_.resize(transport == TILE_TRANSPORT_TCP ? kTileHeaderSize + maxTileSize
+                                                  : kRecvBatch * kMaxDatagram);
+    rxUsed_ = 0;
+    printf("TileReceiver: listening on %s port %u\n", transport == TILE_TRANSPORT_TCP ? "tcp" : "udp", port);
+    return true;
+}
+
+void TileReceiver::Close() {
+    if (connFd_ >= 0) close(connFd_);
+    if (listenFd_ >= 0) close(listenFd_);
+    connFd_ = -1;
+    listenFd_ = -1;
+    havePeer_ = false;
+}
+
+void TileReceiver::SetCallbacks(TileCallback onTile, FrameCallback onFrame) {
+    onTile_ = onTile;
+    onFrame_ = onFrame;
+}
+
+void TileReceiver::SetSubscription(TileMask mask, uint32_t leaseMs) {
+    subMask_ = mask;
+    subLeaseMs_ = leaseMs;
+    subscribeNow_ = true;
+}
+
+int TileReceiver::Poll(int timeoutMs) {
+    if (listenFd_ < 0) return -1;
+    int completed = (transport_ == TILE_TRANSPORT_TCP) ? PollTcp(timeoutMs) : PollUdp(timeoutMs);
+    MaybeSubscribe();
+    return completed;
+}
+
+void TileReceiver::MaybeSubscribe() {
+    if (subLeaseMs_ == 0) return;
+    uint64_t nowMs = NowMs();
+    if (!subscribeNow_ && nowMs - lastSubMs_ < subLeaseMs_ / 3) return;
+    uint8_t msg[kTileSubscribeSize];
+    EncodeTileSubscribe(subMask_, subLeaseMs_, msg);
+    ssize_t n = -1;
+    if (transport_ == TILE_TRANSPORT_TCP) {
+        if (connFd_ >= 0) n = send(connFd_, msg, sizeof(msg), MSG_DONTWAIT | MSG_NOSIGNAL);
+    } else if (havePeer_) {
+        n = sendto(listenFd_, msg, sizeof(msg), MSG_DONTWAIT, (struct sockaddr *)&peer_, sizeof(peer_));
+    }
+    if (n == (ssize_t)sizeof(msg)) {
+        lastSubMs_ = nowMs;
+        subscribeNow_ = false;
+    }
+}
+
+int TileReceiver::PollUdp(int timeoutMs) {
+    struct pollfd pfd = {listenFd_, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeoutMs);
+    if (ready <= 0) return (ready < 0 && errno != EINTR) ? -1 : 0;
+
+    struct mmsghdr msgs[kRecvBatch];
+    struct iovec iovs[kRecvBatch];
+    struct sockaddr_in addrs[kRecvBatch];
+    int completed = 0;
+    while (true) {
+        for (unsigned int i = 0; i < kRecvBatch; ++i) {
+            iovs[i].iov_base = rxBuf_.data() + i * kMaxDatagram;
+            iovs[i].iov_len = kMaxDatagram;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        }
+        int n = recvmmsg(listenFd_, msgs, kRecvBatch, MSG_DONTWAIT, NULL);
+        if (n <= 0) break;
+        for (int i = 0; i < n; ++i) {
+            packetsReceived_++;
+            const uint8_t *pkt = static_cast<const uint8_t *>(iovs[i].iov_base);
+            TilePacketHeader hdr;
+            if (!DecodeTileHeader(pkt, msgs[i].msg_len, &hdr)) {
+                badPackets_++;
+                continue;
+            }
+            peer_ = addrs[i];
+            havePeer_ = true;
+            if (hdr.flags & kTileFlagAnnounce) {
+                subscribeNow_ = true; // 通告报文不含 tile 数据，收到后立即回复订阅
+                continue;
+            }
+            if (Ingest(hdr, pkt + kTileHeaderSize, msgs[i].msg_len - kTileHeaderSize)) completed++;
+        }
+        if ((unsigned int)n < kRecvBatch) break;
+    }
+    return completed;
+}
+
+int TileReceiver::PollTcp(int timeoutMs) {
+    struct pollfd pfd;
+    pfd.fd = connFd_ >= 0 ? connFd_ : listenFd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ready = poll(&pfd, 1, timeoutMs);
+    if (ready <= 0) return (ready < 0 && errno != EINTR) ? -1 : 0;
+
+    if (connFd_ < 0) {
+        connFd_ = accept4(listenFd_, NULL, NULL, SOCK_NONBLOCK);
+        rxUsed_ = 0;
+        return 0;
+    }
+
+    int completed = 0;
+    while (true) {
+        ssize_t n = recv(connFd_, rxBuf_.data() + rxUsed_, rxBuf_.size() - rxUsed_, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+            // 对端关闭，等待下一个连接
+            close(connFd_);
+            connFd_ = -1;
+            break;
+        }
+        if (n < 0) break;
+        rxUsed_ += n;
+        int parsed = ParseTcpBuffer();
+        if (parsed < 0) {
+            close(connFd_);
+            connFd_ = -1;
+            break;
+        }
+        completed += parsed;
+    }
+    return completed;
+}
+
+// 从 TCP 接收缓冲中取出完整记录，剩余半条记录挪到缓冲开头
+int TileReceiver::ParseTcpBuffer() {
+    int completed = 0;
+    size_t offset = 0;
+    while (rxUsed_ - offset >= kTileHeaderSize) {
+        TilePacketHeader hdr;
+        if (!DecodeTileHeader(rxBuf_.data() + offset, rxUsed_ - offset, &hdr) ||
+            hdr.tileSize > maxTileSize_) {
+            badPackets_++;
+            return -1; // 流已错位，断开重连
+        }
+        size_t payloadLen = hdr.tileSize - hdr.fragOffset;
+        if (rxUsed_ - offset < kTileHeaderSize + payloadLen) break;
+        packetsReceived_++;
+        if (hdr.flags & kTileFlagAnnounce) {
+            subscribeNow_ = true;
+        } else if (Ingest(hdr, rxBuf_.data() + offset + kTileHeaderSize, payloadLen)) completed++;
+        offset += kTileHeaderSize + payloadLen;
+    }
+    if (offset > 0) {
+        memmove(rxBuf_.data(), rxBuf_.data() + offset, rxUsed_ - offset);
+        rxUsed_ -= offset;
+    }
+    return completed;
+}
+
+bool TileReceiver::Ingest(const TilePacketHeader &hdr, const uint8_t *payload, size_t len) {
+    if (hdr.tileId >= tileCount_ || hdr.tileSize > maxTileSize_ ||
+        hdr.fragOffset + len > hdr.tileSize) {
+        badPackets_++;
+        return false;
+    }
+
+    FrameSlot &frame = frames_[hdr.frameSeq % kInflightFrames];
+    if (!frame.active || frame.frameSeq != hdr.frameSeq) {
+        // 槽位被更早的帧占用：比它新则挤出旧帧，否则是已过期的迟到分片
+        if (frame.active && (int16_t)(hdr.frameSeq - frame.frameSeq) < 0) {
+            latePackets_++;
+            return false;
+        }
+        if (frame.active) RetireFrame(frame);
+        frame.active = true;
+        frame.reported = false;
+        frame.frameSeq = hdr.frameSeq;
+        frame.tileMask = hdr.tileMask;
+        frame.doneMask = 0;
+        for (auto &tile : frame.tiles) tile.active = false;
+    }
+
+    TileSlot &tile = frame.tiles[hdr.tileId];
+    if (tile.active && tile.done) return false; // 重复包
+    if (!tile.active) {
+        size_t frags = hdr.fragCnt;
+        if (frags > tile.fragSeen.size()) {
+            badPackets_++;
+            return false;
+        }
+        tile.active = true;
+        tile.done = false;
+        tile.first = hdr;
+        tile.receivedBytes = 0;
+        memset(tile.fragSeen.data(), 0, frags);
+    }
+    if (hdr.fragCnt != tile.first.fragCnt || hdr.tileSize != tile.first.tileSize) {
+        badPackets_++;
+        return false;
+    }
+    if (tile.fragSeen[hdr.fragIdx]) return false;
+    tile.fragSeen[hdr.fragIdx] = 1;
+    memcpy(tile.data.data() + hdr.fragOffset, payload, len);
+    tile.receivedBytes += len;
+    if (tile.receivedBytes < hdr.tileSize) return false;
+
+    tile.done = true;
+    tilesCompleted_++;
+    frame.doneMask |= TILE_BIT(hdr.tileId);
+    if (onTile_) {
+        TileInfo info;
+        info.tileId = hdr.tileId;
+        info.frameSeq = hdr.frameSeq;
+        info.tileMask = frame.tileMask;
+        info.pts = tile.first.pts;
+        info.keyframe = (tile.first.flags & kTileFlagKeyframe) != 0;
+        info.size = hdr.tileSize;
+        onTile_(info, tile.data.data());
+    }
+    if ((frame.doneMask & frame.tileMask) == frame.tileMask && !frame.reported) {
+        frame.reported = true;
+        if (onFrame_) onFrame_(frame.frameSeq, frame.tileMask, frame.doneMask);
+    }
+    return true;
+}
+
+// 帧被挤出：统计未完成的 tile，未上报过的帧以残缺掩码上报
+void TileReceiver::RetireFrame(FrameSlot &frame) {
+    for (int i = 0; i < tileCount_; ++i) {
+        if ((frame.tileMask & TILE_BIT(i)) && !(frame.doneMask & TILE_BIT(i))) tilesDropped_++;
+    }
+    if (!frame.reported && onFrame_) onFrame_(frame.frameSeq, frame.tileMask, frame.doneMask);
+    frame.reported = true;
+    frame.active = false;
+}
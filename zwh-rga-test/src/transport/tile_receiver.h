@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <functional>
+#include <vector>
+
+#include "tile_protocol.h"
+#include "utils/config.h"
+
+// tile 接收端：与 TileSender 配对，按 frameSeq/tileId 重组分片
+// - UDP 用 recvmmsg 批量收包；TCP 接受单个连接并按记录解析
+// - 同时保留最近 kInflightFrames 帧的重组状态，乱序/迟到的分片仍能落到正确的帧
+// - 回调在调用 Poll 的线程中触发；data 仅在回调期间有效
+// - SetSubscription 后在 Poll 中向发送端续订（周期为租期的 1/3，收到通告时立即回复）
+class TileReceiver {
+public:
+    typedef std::function<void(const TileInfo &info, const uint8_t *data)> TileCallback;
+    // 一帧结束（tileMask 全部到齐，或被更新的帧挤出）时回调
+    typedef std::function<void(uint16_t frameSeq, TileMask tileMask, TileMask receivedMask)> FrameCallback;
+
+    ~TileReceiver() { Close(); }
+
+    bool Open(uint16_t port, TileTransport transport, size_t maxTileSize = SUB_WIDTH * SUB_HEIGHT * 3 / 2);
+    void Close();
+    void SetCallbacks(TileCallback onTile, FrameCallback onFrame = FrameCallback());
+    // 订阅 mask 中的 tile，leaseMs 为 0 表示不发订阅
+    void SetSubscription(TileMask mask, uint32_t leaseMs);
+
+    // 等待并处理到达的数据，最多阻塞 timeoutMs；返回本次完成的 tile 数，出错返回 -1
+    int Poll(int timeoutMs);
+
+    uint64_t PacketsReceived() const { return packetsReceived_; }
+    uint64_t TilesCompleted() const { return tilesCompleted_; }
+    uint64_t TilesDropped() const { return tilesDropped_; }
+    uint64_t BadPackets() const { return badPackets_; }
+    uint64_t LatePackets() const { return latePackets_; }
+
+private:
+    static const int kInflightFrames = 4;
+
+    struct TileSlot {
+        bool active = false;
+        bool done = false;
+        TilePacketHeader first;       // 首个到达分片的头，提供 tile 元信息
+        uint32_t receivedBytes = 0;
+        std::vector<uint8_t> fragSeen; // 分片去重
+        std::vector<uint8_t> data;
+    };
+
+    struct FrameSlot {
+        bool active = false;
+        bool reported = false; // 已通过 onFrame 上报
+        uint16_t frameSeq = 0;
+        TileMask tileMask = 0;
+        TileMask doneMask = 0;
+        std::vector<TileSlot> tiles; // Open 时按当前网格的 tile 数分配
+    };
+
+    int PollUdp(int timeoutMs);
+    int PollTcp(int timeoutMs);
+    int ParseTcpBuffer();
+    bool Ingest(const TilePacketHeader &hdr, const uint8_t *payload, size_t len);
+    void RetireFrame(FrameSlot &frame);
+    void MaybeSubscribe();
+
+    int listenFd_ = -1;
+    int connFd_ = -1;
+    TileTransport transport_ = TILE_TRANSPORT_UDP;
+    size_t maxTileSize_ = 0;
+    int tileCount_ = 0; // Open 时按当前网格配置确定
+    FrameSlot frames_[kInflightFrames];
+    std::vector<uint8_t> rxBuf_;
+    size_t rxUsed_ = 0;
+    TileMask subMask_ = 0;
+    uint32_t subLeaseMs_ = 0;
+    uint64_t lastSubMs_ = 0;
+    bool subscribeNow_ = false;
+    struct sockaddr_in peer_; // UDP 发送端地址，收到第一个报文后有效
+    bool havePeer_ = false;
+    TileCallback onTile_;
+    FrameCallback onFrame_;
+
+    uint64_t packetsReceived_ = 0;
+    uint64_t tilesCompleted_ = 0;
+    uint64_t tilesDropped_ = 0;
+    uint64_t badPackets_ = 0;
+    uint64_t latePackets_ = 0;
+};
@@ -0,0 +1,323 @@
+#include "tile_sender.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static const size_t kStagingBytes = 512 * 1024; // 一帧编码后的 16 个 tile 远小于此
+static const int kUdpOverhead = 28;              // IPv4 + UDP 头
+static const unsigned int kMaxBatch = 64;        // 单次 sendmmsg 的报文数上限
+static const int kSocketBufBytes = 1024 * 1024;
+static const size_t kTcpBacklogBytes = 1024 * 1024; // 约等于又一个 socket 发送缓冲，超出后丢整条记录
+static const int kCloseDrainMs = 200;
+
+bool TileSender::Open(const char *host, uint16_t port, TileTransport transport, int mtu) {
+    Close();
+    if (!host || mtu <= kUdpOverhead + (int)kTileHeaderSize) return false;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        printf("TileSender: invalid address %s\n", host);
+        return false;
+    }
+
+    int type = (transport == TILE_TRANSPORT_TCP) ? SOCK_STREAM : SOCK_DGRAM;
+    fd_ = socket(AF_INET, type, 0);
+    if (fd_ < 0) {
+        printf("TileSender: socket failed: %s\n", strerror(errno));
+        return false;
+    }
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &kSocketBufBytes, sizeof(kSocketBufBytes));
+    if (transport == TILE_TRANSPORT_TCP) {
+        int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    // UDP 也 connect，之后 sendmmsg 不必逐条带地址
+    if (connect(fd_, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        printf("TileSender: connect %s:%u failed: %s\n", host, port, strerror(errno));
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    // TCP 连上之后改为非阻塞，Flush 不会因接收端慢而阻塞
+    if (transport == TILE_TRANSPORT_TCP) {
+        int flags = fcntl(fd_, F_GETFL, 0);
+        if (flags >= 0) fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    transport_ = transport;
+    maxPayload_ = (transport == TILE_TRANSPORT_TCP) ? kStagingBytes - kTileHeaderSize
+                                                    : (size_t)(mtu - kUdpOverhead) - kTileHeaderSize;
+    staging_.resize(kStagingBytes);
+    stagingUsed_ = 0;
+    records_.clear();
+    records_.reserve(kMaxBatch * 4);
+    queuedTiles_ = 0;
+    subUsed_ = 0;
+    backlog_.clear();
+    backlog_.reserve(transport == TILE_TRANSPORT_TCP ? kTcpBacklogBytes + kStagingBytes : 0);
+    printf("TileSender: %s -> %s:%u, max payload %zu bytes/packet\n",
+           transport == TILE_TRANSPORT_TCP ? "tcp" : "udp", host, port, maxPayload_);
+    return true;
+}
+
+void TileSender::Close() {
+    if (fd_ < 0) return;
+    Flush();
+    // 关闭前给 backlog 一点时间写完，接收端不会在流尾收到半条记录
+    for (int waitedMs = 0; !backlog_.empty() && waitedMs < kCloseDrainMs; ++waitedMs) {
+        if (!SendBacklog()) break;
+        if (!backlog_.empty()) usleep(1000);
+    }
+    backlog_.clear();
+    close(fd_);
+    fd_ = -1;
+}
+
+bool TileSender::QueueTile(const TileInfo &info, const void *data) {
+    struct iovec iov;
+    iov.iov_base = const_cast<void *>(data);
+    iov.iov_len = info.size;
+    return QueueTile(info, &iov, 1);
+}
+
+bool TileSender::QueueTile(const TileInfo &info, const struct iovec *iov, int iovcnt) {
+    if (fd_ < 0 || iovcnt < 0 || (!iov && iovcnt > 0)) return false;
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (!iov[i].iov_base && iov[i].iov_len > 0) return false;
+        total += iov[i].iov_len;
+    }
+    if (total != info.size) return false;
+
+    // 新的一帧：先把上一帧攒下的报文发出去
+    if (queuedTiles_ > 0 && info.frameSeq != queuedSeq_) {
+        Flush();
+    }
+
+    uint32_t fragCnt = info.size ? (uint32_t)((info.size + maxPayload_ - 1) / maxPayload_) : 1;
+    if (fragCnt > 0xFFFF) {
+        printf("TileSender: tile %d too large (%u bytes)\n", info.tileId, info.size);
+        return false;
+    }
+    size_t need = info.size + fragCnt * kTileHeaderSize;
+    if (need > staging_.size()) {
+        printf("TileSender: tile %d exceeds staging (%zu bytes)\n", info.tileId, need);
+        return false;
+    }
+    if (stagingUsed_ + need > staging_.size()) {
+        Flush();
+    }
+
+    TilePacketHeader hdr;
+    hdr.flags = info.keyframe ? kTileFlagKeyframe : 0;
+    hdr.frameSeq = info.frameSeq;
+    hdr.tileMask = info.tileMask;
+    hdr.tileId = (uint8_t)info.tileId;
+    hdr.fragCnt = (uint16_t)fragCnt;
+    hdr.tileSize = info.size;
+    hdr.pts = info.pts;
+
+    int seg = 0;        // 当前读到的段
+    size_t segPos = 0;  // 段内偏移
+    for (uint32_t i = 0; i < fragCnt; ++i) {
+        size_t offset = (size_t)i * maxPayload_;
+        size_t len = info.size - offset < maxPayload_ ? info.size - offset : maxPayload_;
+        hdr.fragIdx = (uint16_t)i;
+        hdr.fragOffset = (uint32_t)offset;
+
+        uint8_t *dst = staging_.data() + stagingUsed_;
+        EncodeTileHeader(hdr, dst);
+        // 分片负载可能跨越多个段
+        for (size_t copied = 0; copied < len;) {
+            size_t avail = iov[seg].iov_len - segPos;
+            if (avail == 0) {
+                seg++;
+                segPos = 0;
+                continue;
+            }
+            size_t n = len - copied < avail ? len - copied : avail;
+            memcpy(dst + kTileHeaderSize + copied, static_cast<const uint8_t *>(iov[seg].iov_base) + segPos, n);
+            copied += n;
+            segPos += n;
+        }
+        records_.push_back({stagingUsed_, kTileHeaderSize + len});
+        stagingUsed_ += kTileHeaderSize + len;
+    }
+
+    queuedSeq_ = info.frameSeq;
+    queuedTiles_++;
+    tilesSent_++;
+    return true;
+}
+
+bool TileSender::Flush() {
+    if (fd_ < 0 || records_.empty()) return true;
+    bool ok = (transport_ == TILE_TRANSPORT_TCP) ? FlushTcp() : FlushUdp();
+    records_.clear();
+    stagingUsed_ = 0;
+    queuedTiles_ = 0;
+    return ok;
+}
+
+bool TileSender::Announce(uint16_t frameSeq, TileMask activeMask) {
+    if (fd_ < 0) return false;
+    if (stagingUsed_ + kTileHeaderSize > staging_.size()) {
+        Flush();
+    }
+    TilePacketHeader hdr;
+    hdr.flags = kTileFlagAnnounce;
+    hdr.frameSeq = frameSeq;
+    hdr.tileMask = activeMask;
+    hdr.fragCnt = 1;
+    EncodeTileHeader(hdr, staging_.data() + stagingUsed_);
+    records_.push_back({stagingUsed_, kTileHeaderSize});
+    stagingUsed_ += kTileHeaderSize;
+    // 与已暂存的 tile 记录一起经 Flush 发出：TCP 下和 tile 记录一样整条写出或整条丢弃
+    return Flush();
+}
+
+bool TileSender::PollSubscription(TileMask *mask, uint32_t *leaseMs) {
+    if (fd_ < 0) return false;
+    while (true) {
+        if (transport_ == TILE_TRANSPORT_UDP) {
+            uint8_t msg[kTileSubscribeSize];
+            ssize_t n = recv(fd_, msg, sizeof(msg), MSG_DONTWAIT);
+            if (n < 0 && errno == ECONNREFUSED) continue; // 接收端未起时的 ICMP 端口不可达
+            if (n <= 0) return false;
+            if (DecodeTileSubscribe(msg, (size_t)n, mask, leaseMs)) return true;
+            continue;
+        }
+        // TCP：先消费已缓冲的完整记录，不够一条再读
+        if (subUsed_ >= kTileSubscribeSize) {
+            bool ok = DecodeTileSubscribe(subBuf_, kTileSubscribeSize, mask, leaseMs);
+            subUsed_ -= kTileSubscribeSize;
+            memmove(subBuf_, subBuf_ + kTileSubscribeSize, subUsed_);
+            if (ok) return true;
+            continue;
+        }
+        ssize_t n = recv(fd_, subBuf_ + subUsed_, sizeof(subBuf_) - subUsed_, MSG_DONTWAIT);
+        if (n <= 0) return false;
+        subUsed_ += (size_t)n;
+    }
+}
+
+// UDP：每个记录一个报文，最多 kMaxBatch 个一组 sendmmsg；发送缓冲满时丢弃而不阻塞
+bool TileSender::FlushUdp() {
+    struct mmsghdr msgs[kMaxBatch];
+    struct iovec iovs[kMaxBatch];
+    bool ok = true;
+
+    size_t next = 0;
+    while (next < records_.size()) {
+        unsigned int batch = 0;
+        for (; batch < kMaxBatch && next + batch < records_.size(); ++batch) {
+            const Record &rec = records_[next + batch];
+            iovs[batch].iov_base = staging_.data() + rec.offset;
+            iovs[batch].iov_len = rec.len;
+            memset(&msgs[batch], 0, sizeof(msgs[batch]));
+            msgs[batch].msg_hdr.msg_iov = &iovs[batch];
+            msgs[batch].msg_hdr.msg_iovlen = 1;
+        }
+
+        int sent = sendmmsg(fd_, msgs, batch, MSG_DONTWAIT);
+        syscalls_++;
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            sendErrors_ += batch;
+            ok = false;
+            next += batch;
+            continue;
+        }
+        for (int i = 0; i < sent; ++i) {
+            bytesSent_ += msgs[i].msg_len;
+        }
+        packetsSent_ += sent;
+        // sendmmsg 可能只发出一部分，剩余的下一轮继续；0 表示缓冲区已满
+        if (sent == 0) {
+            sendErrors_ += batch;
+            ok = false;
+            next += batch;
+        } else {
+            next += sent;
+        }
+    }
+    return ok;
+}
+
+ssize_t TileSender::SendSome(const uint8_t *data, size_t len) {
+    size_t offset = 0;
+    while (offset < len) {
+        ssize_t n = send(fd_, data + offset, len - offset, MSG_DONTWAIT | MSG_NOSIGNAL);
+        syscalls_++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            printf("TileSender: tcp send failed: %s\n", strerror(errno));
+            return -1;
+        }
+        offset += n;
+        bytesSent_ += n;
+    }
+    return (ssize_t)offset;
+}
+
+bool TileSender::SendBacklog() {
+    if (backlog_.empty()) return true;
+    ssize_t n = SendSome(backlog_.data(), backlog_.size());
+    if (n < 0) {
+        backlog_.clear();
+        return false;
+    }
+    backlog_.erase(backlog_.begin(), backlog_.begin() + n);
+    return true;
+}
+
+// TCP：接收端按记录头里的长度切分字节流，所以只能整条丢弃
+// - backlog 为空时暂存区（记录连续存放）一次 send 写出，写出一部分的那条记录剩余必须进 backlog（不受上限约束）
+// - 其余没写出的记录排在 backlog 后面保序；放不下的整条丢弃并计入 SendErrors
+bool TileSender::FlushTcp() {
+    if (!SendBacklog()) {
+        sendErrors_ += records_.size();
+        return false;
+    }
+    size_t sent = 0;
+    if (backlog_.empty()) {
+        ssize_t n = SendSome(staging_.data(), stagingUsed_);
+        if (n < 0) {
+            sendErrors_ += records_.size();
+            return false;
+        }
+        sent = (size_t)n;
+    }
+    bool ok = true;
+    for (size_t i = 0; i < records_.size(); ++i) {
+        const Record &rec = records_[i];
+        size_t begin = rec.offset > sent ? rec.offset : sent;
+        size_t end = rec.offset + rec.len;
+        if (begin >= end) {
+            packetsSent_++;
+            continue;
+        }
+        if (begin == rec.offset && backlog_.size() + rec.len > kTcpBacklogBytes) {
+            sendErrors_++;
+            ok = false;
+            continue;
+        }
+        backlog_.insert(backlog_.end(), staging_.data() + begin, staging_.data() + end);
+        packetsSent_++;
+    }
+    return ok;
+}
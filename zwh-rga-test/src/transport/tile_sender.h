@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <vector>
+
+#include "tile_protocol.h"
+
+// tile 发送端
+// - QueueTile 把 tile 按 MTU 切片，连同报文头一起拷入预分配的暂存区（编码码流可立即释放）；
+//   多段版本直接从各段（如编码器的多个 pack）聚集拷贝，分片可跨段，不需要先拼成连续缓冲
+// - Flush 把暂存的所有报文一次发出：UDP 走 sendmmsg，发送缓冲满时丢报文；
+//   TCP 为非阻塞 send，写不完的留在有界 backlog 里下次先发，backlog 满时丢弃整条记录（不会写出半条），
+//   慢接收端不会卡住调用 Flush 的取流线程
+// - 同一帧的 16 个 tile 通常只需 1~2 次系统调用；frameSeq 变化时自动 Flush 上一帧
+// - 按需编码时定期 Announce，并用 PollSubscription 读接收端经同一 socket 发回的订阅
+class TileSender {
+public:
+    ~TileSender() { Close(); }
+
+    // mtu 为链路 MTU，单个 UDP 报文不超过 mtu - 28（IP+UDP 头）
+    bool Open(const char *host, uint16_t port, TileTransport transport, int mtu = 1500);
+    void Close();
+    bool IsOpen() const { return fd_ >= 0; }
+
+    bool QueueTile(const TileInfo &info, const void *data);
+    // info.size 须等于各段长度之和
+    bool QueueTile(const TileInfo &info, const struct iovec *iov, int iovcnt);
+    bool Flush();
+
+    // 追加一个只有头的通告报文并立即 Flush（连同已暂存的 tile），activeMask 为当前在编码的 tile
+    bool Announce(uint16_t frameSeq, TileMask activeMask);
+    // 非阻塞读取接收端发回的订阅，每次取一条；没有待读的订阅时返回 false
+    bool PollSubscription(TileMask *mask, uint32_t *leaseMs);
+
+    uint64_t TilesSent() const { return tilesSent_; }
+    uint64_t PacketsSent() const { return packetsSent_; }
+    uint64_t BytesSent() const { return bytesSent_; }
+    uint64_t Syscalls() const { return syscalls_; }
+    uint64_t SendErrors() const { return sendErrors_; }
+
+private:
+    struct Record {
+        size_t offset;
+        size_t len;
+    };
+
+    bool FlushUdp();
+    bool FlushTcp();
+    // 非阻塞地尽量写出 [data, data + len)，返回写出的字节数；连接出错返回 -1
+    ssize_t SendSome(const uint8_t *data, size_t len);
+    // 先发 backlog 里上次没写完的字节；连接出错返回 false
+    bool SendBacklog();
+
+    int fd_ = -1;
+    TileTransport transport_ = TILE_TRANSPORT_UDP;
+    size_t maxPayload_ = 0; // 单报文可承载的 tile 负载字节数
+    std::vector<uint8_t> staging_;
+    size_t stagingUsed_ = 0;
+    std::vector<Record> records_;
+    std::vector<uint8_t> backlog_; // TCP 已接受但 socket 暂时写不进去的字节，开头可能是半条记录
+    uint8_t subBuf_[kTileSubscribeSize * 8]; // TCP 订阅记录的接收缓冲
+    size_t subUsed_ = 0;
+    uint16_t queuedSeq_ = 0;
+    size_t queuedTiles_ = 0;
+
+    uint64_t tilesSent_ = 0;
+    uint64_t packetsSent_ = 0;
+    uint64_t bytesSent_ = 0;
+    uint64_t syscalls_ = 0;
+    uint64_t sendErrors_ = 0;
+};
@@ -0,0 +1,129 @@
+#include "bitrate_allocator.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool BitrateAllocator::ParseOption(const char *text, Options *out) {
+    if (!text || !out) return false;
+    if (strcmp(text, "off") == 0 || strcmp(text, "0") == 0) {
+        out->enabled = false;
+        return true;
+    }
+    char *end = NULL;
+    long total = strtol(text, &end, 10);
+    if (end == text || total <= 0) return false;
+    long period = out->periodMs;
+    if (*end == ',') {
+        const char *next = end + 1;
+        period = strtol(next, &end, 10);
+        if (end == next || period < 100) return false;
+    }
+    std::string trace = out->tracePath;
+    if (*end == ',') {
+        trace = end + 1;
+        end += strlen(end);
+    }
+    if (*end != '\0') return false;
+    out->enabled = true;
+    out->totalKbps = (int)total;
+    out->periodMs = (int)period;
+    out->tracePath = trace;
+    return true;
+}
+
+bool BitrateAllocator::Init(const Options &options, int tileCount) {
+    if (tileCount <= 0) return false;
+    options_ = options;
+    tileCount_ = tileCount;
+    if (options_.totalKbps <= 0) options_.totalKbps = tileCount * kDefaultTileKbps;
+    if (options_.minKbps * tileCount > options_.totalKbps) {
+        printf("BitrateAllocator: budget %dkbps below %d tiles x min %dkbps\n", options_.totalKbps, tileCount,
+               options_.minKbps);
+        return false;
+    }
+    hasHistory_ = false;
+    complexity_.assign(tileCount, 0.0);
+    Allocation initial;
+    initial.kbps = options_.totalKbps / tileCount;
+    allocs_.assign(tileCount, initial);
+    return true;
+}
+
+// 注水：按复杂度比例分配，低于下限的固定在下限、高于上限的固定在上限，剩余预算在其余路之间重分，直到没有路越界
+void BitrateAllocator::Distribute(std::vector<int> *kbps) const {
+    std::vector<bool> fixed(tileCount_, false);
+    std::vector<double> share(tileCount_, 0.0);
+    double budget = options_.totalKbps;
+    for (int pass = 0; pass < tileCount_; ++pass) {
+        double weight = 0;
+        for (int i = 0; i < tileCount_; ++i) {
+            if (!fixed[i]) weight += complexity_[i];
+        }
+        bool clamped = false;
+        for (int i = 0; i < tileCount_; ++i) {
+            if (fixed[i]) continue;
+            share[i] = weight > 0 ? budget * complexity_[i] / weight : budget / tileCount_;
+            double bound = share[i] < options_.minKbps ? options_.minKbps
+                           : share[i] > options_.maxKbps ? options_.maxKbps
+                                                         : -1;
+            if (bound >= 0) {
+                share[i] = bound;
+                fixed[i] = true;
+                budget -= bound;
+                clamped = true;
+            }
+        }
+        if (!clamped) break;
+    }
+    for (int i = 0; i < tileCount_; ++i) (*kbps)[i] = (int)share[i];
+}
+
+const std::vector<BitrateAllocator::Allocation> &BitrateAllocator::Update(const std::vector<TileSample> &samples,
+                                                                          uint64_t windowMs) {
+    if ((int)samples.size() < tileCount_ || windowMs == 0) return allocs_;
+
+    double mean = 0;
+    for (int i = 0; i < tileCount_; ++i) {
+        const TileSample &s = samples[i];
+        double observedKbps = s.bytes * 8.0 / windowMs;
+        double sample = observedKbps;
+        if (s.meanQp > 0) sample *= pow(2.0, ((int)s.meanQp - options_.refQp) / 6.0);
+        if (s.frames > 0 && observedKbps >= options_.saturateRatio * allocs_[i].kbps) {
+            sample *= options_.saturateBoost;
+        }
+        if (sample < 1.0) sample = 1.0; // 整窗没有编码的路仍保留最小份额
+        complexity_[i] = hasHistory_ ? (1 - options_.smoothing) * complexity_[i] + options_.smoothing * sample : sample;
+        mean += complexity_[i];
+    }
+    hasHistory_ = true;
+    mean /= tileCount_;
+
+    std::vector<int> target(tileCount_, 0);
+    Distribute(&target);
+
+    int applied = 0;
+    for (int i = 0; i < tileCount_; ++i) {
+        Allocation &a = allocs_[i];
+        RcMode mode = complexity_[i] < options_.avbrRatio * mean ? RC_AVBR : RC_CBR;
+        int delta = abs(target[i] - a.kbps);
+        a.changed = mode != a.mode || delta * 100 >= options_.hysteresisPct * a.kbps;
+        if (a.changed) {
+            a.kbps = target[i];
+            a.mode = mode;
+        }
+        applied += a.kbps;
+    }
+    // 沿用旧值的路可能让总和略超预算，此时全部按新目标下发
+    if (applied > options_.totalKbps) {
+        for (int i = 0; i < tileCount_; ++i) {
+            Allocation &a = allocs_[i];
+            if (a.kbps != target[i]) {
+                a.kbps = target[i];
+                a.changed = true;
+            }
+        }
+    }
+    return allocs_;
+}
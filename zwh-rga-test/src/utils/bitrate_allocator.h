@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// 各 tile 编码器之间的总码率分配（纯计算，不依赖 MPI，主机上可直接回放码流轨迹测试）
+// - 每个周期输入各路实际产出的字节数、帧数和平均 QP（未知为 0），估计各路的复杂度：
+//   产出码率 x 2^((QP - refQp) / 6)，即折算到同一 QP 下需要的码率（QP 每升 6 码率约减半）；
+//   产出已顶到分配值（利用率 >= saturateRatio）的路说明还想要更多，复杂度再乘 saturateBoost
+// - 复杂度指数平滑后按比例分配总预算，每路夹在 [minKbps, maxKbps]（注水法），各路之和不超过总预算
+// - 复杂度低于平均值 avbrRatio 倍的路改用 AVBR：画面静止时编码器自行降码率，上限仍是分配值
+// - 变化不到 hysteresisPct% 且码控模式不变的路沿用原值，不必每个周期都改编码器参数
+class BitrateAllocator {
+public:
+    enum RcMode {
+        RC_CBR = 0,
+        RC_AVBR,
+    };
+
+    struct Options {
+        bool enabled = true;
+        int totalKbps = 0;   // 总上行预算，0 表示 tile 数 x kDefaultTileKbps
+        int periodMs = 2000; // 调整周期
+        int minKbps = 32;
+        int maxKbps = 4096;
+        int refQp = 30;
+        double smoothing = 0.5; // 新观测所占权重
+        double saturateRatio = 0.9;
+        double saturateBoost = 1.25;
+        double avbrRatio = 0.5;
+        int hysteresisPct = 10;
+        std::string tracePath; // 调用方使用：非空时把每周期各路产出码率追加写入，供 bench_bitrate 回放
+    };
+
+    struct TileSample {
+        uint64_t bytes = 0;
+        uint32_t frames = 0;
+        uint32_t meanQp = 0; // 0 表示编码器未给出
+    };
+
+    struct Allocation {
+        int kbps = 0;
+        RcMode mode = RC_CBR;
+        bool changed = false; // 本周期需要下发到编码器
+    };
+
+    static const int kDefaultTileKbps = 256;
+
+    // 解析 "off" 或 "<总码率 kbps>[,<周期 ms>[,<轨迹文件>]]"
+    static bool ParseOption(const char *text, Options *out);
+
+    // 所有路以 CBR、平均分配起步（与编码器初始配置一致）
+    bool Init(const Options &options, int tileCount);
+
+    // samples 覆盖 windowMs 毫秒，返回各路新的分配
+    const std::vector<Allocation> &Update(const std::vector<TileSample> &samples, uint64_t windowMs);
+
+    const std::vector<Allocation> &Current() const { return allocs_; }
+    int PeriodMs() const { return options_.periodMs; }
+    int TotalKbps() const { return options_.totalKbps; }
+    int InitialTileKbps() const { return tileCount_ > 0 ? options_.totalKbps / tileCount_ : 0; }
+    double Complexity(int tileId) const { return complexity_[tileId]; }
+
+private:
+    void Distribute(std::vector<int> *kbps) const;
+
+    Options options_;
+    int tileCount_ = 0;
+    bool hasHistory_ = false;
+    std::vector<double> complexity_;
+    std::vector<Allocation> allocs_;
+};
@@ -0,0 +1,292 @@
+#include "cache_sync.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+CacheSync &GetCacheSync() {
+    static CacheSync sync;
+    return sync;
+}
+
+CacheSync::CacheSync() {
+    const char *env = getenv("ZWH_CACHE_SYNC");
+    if (env && strcmp(env, "full") == 0) fullFlush_ = true;
+}
+
+static bool Overlaps(size_t alo, size_t ahi, size_t blo, size_t bhi) {
+    return alo < bhi && blo < ahi;
+}
+
+// a 去掉与 r 重叠的部分；两侧都有剩余时保守地留较大的一侧
+static void Subtract(size_t *lo, size_t *hi, size_t rlo, size_t rhi) {
+    if (!Overlaps(*lo, *hi, rlo, rhi)) return;
+    size_t leftHi = rlo > *lo ? rlo : *lo;
+    size_t rightLo = rhi < *hi ? rhi : *hi;
+    if (leftHi - *lo >= *hi - rightLo) {
+        *hi = leftHi;
+    } else {
+        *lo = rightLo;
+    }
+}
+
+CacheSync::State &CacheSync::LookupLocked(MB_BLK blk) {
+    auto it = states_.find(blk);
+    if (it != states_.end()) return it->second;
+    EvictLocked();
+    State &st = states_[blk];
+    st.pool = GetMpiHal()->MbHandle2PoolId(blk);
+    return st;
+}
+
+CacheSync::State &CacheSync::LookupLocked(const DmaBuf &buf) {
+    auto it = states_.find(buf.vir);
+    if (it != states_.end()) return it->second;
+    EvictLocked();
+    State &st = states_[buf.vir];
+    st.size = buf.capacity;
+    st.cached = buf.cached;
+    st.fd = buf.fd;
+    st.heap = buf.heap;
+    return st;
+}
+
+// 登记数到上限时全部忘掉（块句柄意外地一直在变）；忘掉之前把脏段刷给内存
+void CacheSync::EvictLocked() {
+    if (states_.size() < kMaxEntries) return;
+    printf("CacheSync: %zu buffers tracked, forgetting all\n", states_.size());
+    for (auto &kv : states_) BeginDeviceAccessLocked(kv.first, kv.second);
+    states_.clear();
+}
+
+CacheSync::Range CacheSync::Clip(const State &st, size_t offset, size_t length) {
+    Range r;
+    r.lo = offset;
+    r.hi = offset + length;
+    if (st.heap && r.hi > st.size) r.hi = st.size; // DmaBuf 大小已知
+    return r;
+}
+
+void CacheSync::SyncLocked(const void *key, State &st, Range r, bool toDevice) {
+    if (r.Empty()) return;
+    if (st.heap) {
+        // dma-buf 的同步 ioctl 作用于整块；uncached 堆不需要
+        if (!st.cached) return;
+        if (toDevice) {
+            st.heap->SyncForDevice(st.fd);
+        } else {
+            st.heap->SyncForCpu(st.fd);
+        }
+        r.lo = 0;
+        r.hi = st.size;
+    } else {
+        GetMpiHal()->SysMmzFlushCacheRange(static_cast<MB_BLK>(const_cast<void *>(key)), (RK_U32)r.lo,
+                                           (RK_U32)(r.hi - r.lo), toDevice ? RK_TRUE : RK_FALSE);
+    }
+    stats_.syncs++;
+    stats_.syncBytes += r.hi - r.lo;
+    window_.syncs++;
+    window_.syncBytes += r.hi - r.lo;
+    if (!toDevice && st.heap) st.valid = r;
+}
+
+// 旧行为：整块刷新（MB 块走 SysMmzFlushCache，不依赖见过的范围）
+void CacheSync::FullSyncLocked(const void *key, State &st, bool toDevice) {
+    Range whole;
+    whole.hi = st.size;
+    if (st.heap) {
+        SyncLocked(key, st, whole, toDevice);
+    } else {
+        GetMpiHal()->SysMmzFlushCache(static_cast<MB_BLK>(const_cast<void *>(key)), toDevice ? RK_TRUE : RK_FALSE);
+        stats_.syncs++;
+        stats_.syncBytes += st.size;
+        window_.syncs++;
+        window_.syncBytes += st.size;
+    }
+    st.dirty = Range();
+    if (!toDevice) st.valid = whole;
+}
+
+void CacheSync::DeviceWroteLocked(State &st, Range r) {
+    if (r.hi > st.size && !st.heap) st.size = r.hi;
+    Subtract(&st.valid.lo, &st.valid.hi, r.lo, r.hi);
+    // 硬件覆盖了 CPU 的脏段：调用方应先 BeginDeviceAccess，这里只能不再把它当脏
+    Subtract(&st.dirty.lo, &st.dirty.hi, r.lo, r.hi);
+}
+
+void CacheSync::CpuWroteLocked(State &st, Range r) {
+    if (r.Empty()) return;
+    if (r.hi > st.size && !st.heap) st.size = r.hi;
+    if (st.dirty.Empty()) {
+        st.dirty = r;
+    } else {
+        // 脏段取并集的外包：多 clean 几行干净的缓存没有副作用
+        if (r.lo < st.dirty.lo) st.dirty.lo = r.lo;
+        if (r.hi > st.dirty.hi) st.dirty.hi = r.hi;
+    }
+    // CPU 刚写的一段在 CPU 视图里是新的
+    if (st.valid.Empty() || r.lo > st.valid.hi || r.hi < st.valid.lo) {
+        if (r.hi - r.lo > st.valid.hi - st.valid.lo || st.valid.Empty()) st.valid = r;
+    } else {
+        if (r.lo < st.valid.lo) st.valid.lo = r.lo;
+        if (r.hi > st.valid.hi) st.valid.hi = r.hi;
+    }
+}
+
+void CacheSync::BeginCpuReadLocked(const void *key, State &st, Range r) {
+    if (r.Empty()) return;
+    if (r.hi > st.size && !st.heap) st.size = r.hi;
+    stats_.requests++;
+    stats_.fullBytes += st.size;
+    window_.requests++;
+    window_.fullBytes += st.size;
+
+    if (fullFlush_) {
+        FullSyncLocked(key, st, false);
+        return;
+    }
+    if (st.valid.lo <= r.lo && r.hi <= st.valid.hi) return;
+
+    // 只补上尚未同步的一端；有效段落在 r 中间时整段重新同步
+    Range need = r;
+    if (!st.valid.Empty()) {
+        if (st.valid.lo <= r.lo && r.lo < st.valid.hi) {
+            need.lo = st.valid.hi;
+        } else if (st.valid.lo < r.hi && r.hi <= st.valid.hi) {
+            need.hi = st.valid.lo;
+        }
+    }
+    if (!st.dirty.Empty() && Overlaps(st.dirty.lo, st.dirty.hi, need.lo, need.hi)) {
+        SyncLocked(key, st, st.dirty, true);
+        st.dirty = Range();
+    }
+    SyncLocked(key, st, need, false);
+    if (st.heap) return; // 整块已同步，SyncLocked 已更新有效段
+    if (!st.valid.Empty() && r.lo <= st.valid.hi && st.valid.lo <= r.hi) {
+        if (r.lo < st.valid.lo) st.valid.lo = r.lo;
+        if (r.hi > st.valid.hi) st.valid.hi = r.hi;
+    } else {
+        st.valid = r;
+    }
+}
+
+void CacheSync::BeginDeviceAccessLocked(const void *key, State &st) {
+    if (fullFlush_) {
+        FullSyncLocked(key, st, true);
+        return;
+    }
+    if (st.dirty.Empty()) return;
+    SyncLocked(key, st, st.dirty, true);
+    st.dirty = Range();
+}
+
+void CacheSync::DeviceWrote(MB_BLK blk, size_t offset, size_t length) {
+    if (!blk) return;
+    std::lock_guard<std::mutex> lk(mtx_);
+    State &st = LookupLocked(blk);
+    DeviceWroteLocked(st, Clip(st, offset, length));
+}
+
+void CacheSync::CpuWrote(MB_BLK blk, size_t offset, size_t length) {
+    if (!blk) return;
+    std::lock_guard<std::mutex> lk(mtx_);
+    State &st = LookupLocked(blk);
+    CpuWroteLocked(st, Clip(st, offset, length));
+}
+
+void CacheSync::BeginCpuRead(MB_BLK blk, size_t offset, size_t length) {
+    if (!blk) return;
+    std::lock_guard<std::mutex> lk(mtx_);
+    State &st = LookupLocked(blk);
+    BeginCpuReadLocked(blk, st, Clip(st, offset, length));
+}
+
+void CacheSync::BeginDeviceAccess(MB_BLK blk) {
+    if (!blk) return;
+    std::lock_guard<std::mutex> lk(mtx_);
+    State &st = LookupLocked(blk);
+    stats_.requests++;
+    stats_.fullBytes += st.size;
+    window_.requests++;
+    window_.fullBytes += st.size;
+    BeginDeviceAccessLocked(blk, st);
+}
+
+void CacheSync::DeviceWrote(const DmaBuf &buf, size_t offset, size_t length) {
+    if (!buf.vir) return;
+    std::lock_guard<std::mutex> lk(mtx_);
+    State &st = LookupLocked(buf);
+    DeviceWroteLocked(st, Clip(st, offset, length));
+}
+
+void CacheSync::CpuWrote(const DmaBuf &buf, size_t offset, size_t length) {
+    if (!buf.vir) return;
+    std::lock_guard<std::mutex> lk(mtx_);
+    State &st = LookupLocked(buf);
+    CpuWroteLocked(st, Clip(st, offset, length));
+}
+
+void CacheSync::BeginCpuRead(const DmaBuf &buf, size_t offset, size_t length) {
+    if (!buf.vir) return;
+    std::lock_guard<std::mutex> lk(mtx_);
+    State &st = LookupLocked(buf);
+    BeginCpuReadLocked(buf.vir, st, Clip(st, offset, length));
+}
+
+void CacheSync::BeginDeviceAccess(const DmaBuf &buf) {
+    if (!buf.vir) return;
+    std::lock_guard<std::mutex> lk(mtx_);
+    State &st = LookupLocked(buf);
+    stats_.requests++;
+    stats_.fullBytes += st.size;
+    window_.requests++;
+    window_.fullBytes += st.size;
+    BeginDeviceAccessLocked(buf.vir, st);
+}
+
+void CacheSync::ReleasePool(MB_POOL pool) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (auto it = states_.begin(); it != states_.end();) {
+        if (!it->second.heap && it->second.pool == pool) {
+            BeginDeviceAccessLocked(it->first, it->second);
+            it = states_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CacheSync::Forget(const DmaBuf &buf) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = states_.find(buf.vir);
+    if (it == states_.end()) return;
+    BeginDeviceAccessLocked(it->first, it->second);
+    states_.erase(it);
+}
+
+void CacheSync::ReleaseAll() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (auto &kv : states_) BeginDeviceAccessLocked(kv.first, kv.second);
+    states_.clear();
+}
+
+CacheSync::Stats CacheSync::GetStats() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    Stats stats = stats_;
+    stats.entries = states_.size();
+    return stats;
+}
+
+void CacheSync::PrintWindow() {
+    Stats w;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        w = window_;
+        window_ = Stats();
+    }
+    if (w.requests == 0) return;
+    printf("[CACHE] %s: requests=%llu syncs=%llu synced=%.1fMB (full flush would be %.1fMB, %.0f%% avoided)\n",
+           fullFlush_ ? "full" : "tracked", (unsigned long long)w.requests, (unsigned long long)w.syncs,
+           w.syncBytes / 1048576.0, w.fullBytes / 1048576.0,
+           w.fullBytes ? 100.0 - w.syncBytes * 100.0 / w.fullBytes : 0.0);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <unordered_map>
+
+#include "dma_buf_pool.h"
+#include "hal/mpi_hal.h"
+
+// 按缓冲归属做缓存维护：每块缓冲记下"谁最后写过、CPU 视图哪一段是新的"，只在确有需要时、
+// 只对用到的那一段做同步，取代各处无条件的整块 SysMmzFlushCache
+// - 归属：硬件写入（DeviceWrote）后 CPU 视图过期；CPU 写入（CpuWrote）后该段为脏，交给硬件前需 clean；
+//   CPU 读前同步过（BeginCpuRead）的一段保持有效，直到硬件再写
+// - BeginCpuRead：只作废尚未同步的部分（例如变化检测已同步过 Y 平面，合成时只补 UV）；
+//   若与 CPU 脏段重叠先 clean，避免作废时丢掉 CPU 的写入
+// - BeginDeviceAccess：硬件读或写这块缓冲之前调用，只在有 CPU 脏段时 clean 脏段；
+//   硬件到硬件（RGA -> VENC/NPU）的缓冲从不产生同步
+// - MB 块按范围走 SysMmzFlushCacheRange；DmaBuf 走 dma_sync_*（dma-buf 的同步 ioctl 不分范围，按整块），
+//   uncached 堆上的 DmaBuf 从不同步
+// - 每段只记一个区间（不相邻时保守地取较大的一段），判断偏保守：宁可多同步，不会漏同步
+// - 环境变量 ZWH_CACHE_SYNC=full 时退回旧行为（每次调用都整块刷新），用于对比
+// - 以 MB_BLK / DmaBuf 映射地址为键，池销毁前 ReleasePool；可多线程调用
+class CacheSync {
+public:
+    struct Stats {
+        uint64_t requests = 0;   // Begin* 调用次数
+        uint64_t syncs = 0;      // 实际发出的同步次数
+        uint64_t syncBytes = 0;  // 实际同步的字节数
+        uint64_t fullBytes = 0;  // 同样的调用若每次整块刷新的字节数
+        uint64_t entries = 0;
+    };
+
+    static const size_t kMaxEntries = 256;
+
+    CacheSync();
+
+    bool FullFlush() const { return fullFlush_; }
+    void SetFullFlush(bool full) { fullFlush_ = full; }
+
+    // 硬件（VI/RGA/VENC/NPU）写完 [offset, offset + length)
+    void DeviceWrote(MB_BLK blk, size_t offset, size_t length);
+    // CPU 写完 [offset, offset + length)
+    void CpuWrote(MB_BLK blk, size_t offset, size_t length);
+    // CPU 将要读 [offset, offset + length)
+    void BeginCpuRead(MB_BLK blk, size_t offset, size_t length);
+    // 硬件将要读或写整块
+    void BeginDeviceAccess(MB_BLK blk);
+
+    void DeviceWrote(const DmaBuf &buf, size_t offset, size_t length);
+    void CpuWrote(const DmaBuf &buf, size_t offset, size_t length);
+    void BeginCpuRead(const DmaBuf &buf, size_t offset, size_t length);
+    void BeginDeviceAccess(const DmaBuf &buf);
+
+    // 忘掉某个池（MbDestroyPool 之前）、某块 DmaBuf（归还之前）或全部缓冲的归属；有脏段的先 clean
+    void ReleasePool(MB_POOL pool);
+    void Forget(const DmaBuf &buf);
+    void ReleaseAll();
+
+    Stats GetStats() const;
+    // 打印一行统计，随后清零窗口计数
+    void PrintWindow();
+
+private:
+    struct Range {
+        size_t lo = 0;
+        size_t hi = 0;
+        bool Empty() const { return lo >= hi; }
+    };
+
+    struct State {
+        MB_POOL pool = MB_INVALID_POOLID;
+        size_t size = 0;      // 见过的最大范围，整块刷新时的字节数
+        bool cached = true;   // DmaBuf 在 uncached 堆上时为 false
+        int fd = -1;          // DmaBuf 的 fd 与所在堆；MB 块时 heap 为空，键即 MB_BLK
+        DmaHeap *heap = nullptr;
+        Range valid;          // CPU 视图与内存一致的一段
+        Range dirty;          // CPU 写过尚未 clean 的一段
+    };
+
+    State &LookupLocked(MB_BLK blk);
+    State &LookupLocked(const DmaBuf &buf);
+    void EvictLocked();
+    static Range Clip(const State &st, size_t offset, size_t length);
+    void DeviceWroteLocked(State &st, Range r);
+    void CpuWroteLocked(State &st, Range r);
+    void BeginCpuReadLocked(const void *key, State &st, Range r);
+    void BeginDeviceAccessLocked(const void *key, State &st);
+    void SyncLocked(const void *key, State &st, Range r, bool toDevice);
+    void FullSyncLocked(const void *key, State &st, bool toDevice);
+
+    bool fullFlush_ = false;
+    mutable std::mutex mtx_;
+    std::unordered_map<const void *, State> states_;
+    Stats stats_;
+    Stats window_;
+};
+
+CacheSync &GetCacheSync();
@@ -0,0 +1,97 @@
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+GridConfig g_gridConfig;
+
+// 解析 "<a>x<b>"
+static bool ParsePair(const char *text, int *a, int *b) {
+    char *end = NULL;
+    long first = strtol(text, &end, 10);
+    if (end == text || (*end != 'x' && *end != 'X')) return false;
+    const char *second = end + 1;
+    long value = strtol(second, &end, 10);
+    if (end == second || *end != '\0' || first <= 0 || value <= 0) return false;
+    *a = (int)first;
+    *b = (int)value;
+    return true;
+}
+
+bool ParseGridOption(GridConfig *cfg, const char *option) {
+    if (!cfg || !option) return false;
+    while (*option == '-') option++;
+    const char *eq = strchr(option, '=');
+    if (!eq) {
+        printf("GridConfig: expected key=value, got \"%s\"\n", option);
+        return false;
+    }
+    size_t keyLen = eq - option;
+    const char *value = eq + 1;
+    bool ok = false;
+    if (keyLen == 3 && strncmp(option, "src", 3) == 0) {
+        ok = ParsePair(value, &cfg->srcWidth, &cfg->srcHeight);
+    } else if (keyLen == 4 && strncmp(option, "grid", 4) == 0) {
+        ok = ParsePair(value, &cfg->cols, &cfg->rows);
+    } else if (keyLen == 4 && strncmp(option, "tile", 4) == 0) {
+        ok = ParsePair(value, &cfg->tileWidth, &cfg->tileHeight);
+        cfg->tileFixed = ok;
+    } else if (keyLen == 6 && strncmp(option, "config", 6) == 0) {
+        return LoadGridConfigFile(cfg, value);
+    }
+    if (!ok) printf("GridConfig: bad option \"%s\"\n", option);
+    return ok;
+}
+
+bool LoadGridConfigFile(GridConfig *cfg, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        printf("GridConfig: open %s failed\n", path);
+        return false;
+    }
+    char line[256];
+    int lineNo = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp)) {
+        lineNo++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        // 去掉空白，允许 "grid = 4x4" 的写法
+        char *w = line;
+        for (char *r = line; *r; ++r) {
+            if (*r != ' ' && *r != '\t' && *r != '\r' && *r != '\n') *w++ = *r;
+        }
+        *w = '\0';
+        if (line[0] == '\0') continue;
+        ok = strncmp(line, "config=", 7) != 0 && ParseGridOption(cfg, line);
+        if (!ok) printf("GridConfig: %s:%d rejected\n", path, lineNo);
+    }
+    fclose(fp);
+    return ok;
+}
+
+bool ApplyGridConfig(const GridConfig &in) {
+    GridConfig cfg = in;
+    if (cfg.srcWidth <= 0 || cfg.srcHeight <= 0 || cfg.rows <= 0 || cfg.cols <= 0 ||
+        cfg.TileCount() > MAX_TILES) {
+        printf("GridConfig: invalid grid %dx%d over %dx%d (max %d tiles)\n",
+               cfg.cols, cfg.rows, cfg.srcWidth, cfg.srcHeight, MAX_TILES);
+        return false;
+    }
+    if (!cfg.tileFixed) {
+        cfg.tileWidth = cfg.srcWidth / cfg.cols;
+        cfg.tileHeight = cfg.srcHeight / cfg.rows;
+    }
+    if (cfg.tileWidth < 16 || cfg.tileHeight < 2 || (cfg.tileWidth & 15) || (cfg.tileHeight & 1) ||
+        cfg.tileWidth * cfg.cols != cfg.srcWidth || cfg.tileHeight * cfg.rows != cfg.srcHeight) {
+        printf("GridConfig: %dx%d grid of %dx%d tiles does not cover %dx%d exactly "
+               "(tile width must be 16-aligned, height even)\n",
+               cfg.cols, cfg.rows, cfg.tileWidth, cfg.tileHeight, cfg.srcWidth, cfg.srcHeight);
+        return false;
+    }
+    g_gridConfig = cfg;
+    printf("GridConfig: %dx%d -> %dx%d grid, %d tiles of %dx%d\n", cfg.srcWidth, cfg.srcHeight,
+           cfg.cols, cfg.rows, cfg.TileCount(), cfg.tileWidth, cfg.tileHeight);
+    return true;
+}
@@ -1,10 +1,57 @@
 #pragma once
 
-// 输入源与切分配置
-#define SRC_WIDTH   1920
-#define SRC_HEIGHT  1080
-#define SPLIT_ROW   4
-#define SPLIT_COL   4
-#define TOTAL_CHNS  (SPLIT_ROW * SPLIT_COL) // 16 路子通道
-#define SUB_WIDTH   (SRC_WIDTH / SPLIT_COL) // 子画面宽度 480
-#define SUB_HEIGHT  (SRC_HEIGHT / SPLIT_ROW) // 子画面高度 270
+#include <stddef.h>
+#include <stdint.h>
+
+// tile 数量上限：掩码按 64 位存放；VENC 共 64 路，保留一路给接收端合并输出
+#define MAX_TILES   63
+
+// 每个 tile 一位，bit i 对应 tileId i（行优先）
+typedef uint64_t TileMask;
+#define TILE_BIT(id) ((TileMask)1 << (id))
+
+// 输入源与切分配置，启动时从配置文件 / 命令行载入，之后只读
+// - tile 宽度须按 16 像素对齐（VENC 行跨度与 RGA 输出地址要求），高度按 2 对齐（NV12）
+// - 网格必须正好铺满源画面：所有 tile 同尺寸，余下的像素没有 tile 能承载，
+//   因此不能整除或对齐后铺不满的网格直接拒绝，而不是丢掉右侧/底部的画面
+struct GridConfig {
+    int srcWidth = 1920;
+    int srcHeight = 1080;
+    int rows = 4;
+    int cols = 4;
+    int tileWidth = 480;    // 未用 tile= 指定时由 ApplyGridConfig 按源分辨率与网格推算
+    int tileHeight = 270;
+    bool tileFixed = false; // tile= 显式指定了尺寸
+
+    int TileCount() const { return rows * cols; }
+    int TileX(int tileId) const { return (tileId % cols) * tileWidth; }
+    int TileY(int tileId) const { return (tileId / cols) * tileHeight; }
+    TileMask AllTilesMask() const {
+        return TileCount() >= 64 ? ~(TileMask)0 : TILE_BIT(TileCount()) - 1;
+    }
+};
+
+// 解析一项 "key=value"（可带前导 "--"），key 取 src / grid / tile / config：
+//   src=1920x1080   源分辨率
+//   grid=4x4        列数x行数
+//   tile=480x270    指定 tile 尺寸（可选）
+//   config=<path>   从文件载入，文件内每行一项，'#' 起为注释
+bool ParseGridOption(GridConfig *cfg, const char *option);
+bool LoadGridConfigFile(GridConfig *cfg, const char *path);
+
+// 补全自动尺寸并校验，通过后成为全局配置；须在创建内存池/VENC/RTSP 之前调用
+bool ApplyGridConfig(const GridConfig &cfg);
+
+extern GridConfig g_gridConfig;
+inline const GridConfig &GetGridConfig() {
+    return g_gridConfig;
+}
+
+// 兼容原来的编译期常量名，现均为运行期值
+#define SRC_WIDTH   (GetGridConfig().srcWidth)
+#define SRC_HEIGHT  (GetGridConfig().srcHeight)
+#define SPLIT_ROW   (GetGridConfig().rows)
+#define SPLIT_COL   (GetGridConfig().cols)
+#define TOTAL_CHNS  (GetGridConfig().TileCount()) // 子通道数（默认 16 路）
+#define SUB_WIDTH   (GetGridConfig().tileWidth)   // 子画面宽度（默认 480）
+#define SUB_HEIGHT  (GetGridConfig().tileHeight)  // 子画面高度（默认 270）
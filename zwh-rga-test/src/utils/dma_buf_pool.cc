@@ -0,0 +1,240 @@
+#include "dma_buf_pool.h"
+
+#include <stdio.h>
+
+#include "dma_alloc.h"
+
+DmaBufPool &GetDmaBufPool() {
+    static DmaBufPool pool;
+    return pool;
+}
+
+const char *DmaBufRoleName(DmaBufRole role) {
+    static const char *kNames[DMA_ROLE_COUNT] = {"cpu", "device", "contig"};
+    return role >= 0 && role < DMA_ROLE_COUNT ? kNames[role] : "?";
+}
+
+#ifdef RV1106_1103
+// 各用途按顺序尝试的堆；RV1106 的内核通常只有 rk_dma_heap 的 CMA 堆（带 cache）
+struct HeapChoice {
+    const char *path;
+    bool cached;
+};
+
+static const HeapChoice kCpuHeaps[] = {
+    {DMA_HEAP_PATH, true}, {DMA_HEAP_DMA32_PATCH, true}, {RV1106_CMA_HEAP_PATH, true}, {NULL, false}};
+static const HeapChoice kDeviceHeaps[] = {
+    {DMA_HEAP_UNCACHE_PATH, false}, {DMA_HEAP_DMA32_UNCACHE_PATCH, false}, {CMA_HEAP_UNCACHE_PATH, false},
+    {DMA_HEAP_PATH, true}, {RV1106_CMA_HEAP_PATH, true}, {NULL, false}};
+static const HeapChoice kContigHeaps[] = {
+    {RV1106_CMA_HEAP_PATH, true}, {CMA_HEAP_UNCACHE_PATH, false}, {NULL, false}};
+
+static std::unique_ptr<DmaHeap> OpenDefaultHeap(DmaBufRole role) {
+    const HeapChoice *choices = role == DMA_ROLE_CPU ? kCpuHeaps : role == DMA_ROLE_DEVICE ? kDeviceHeaps : kContigHeaps;
+    for (const HeapChoice *c = choices; c->path; ++c) {
+        std::unique_ptr<DeviceDmaHeap> heap(new DeviceDmaHeap(c->path, c->cached));
+        if (heap->Open()) return std::unique_ptr<DmaHeap>(heap.release());
+    }
+    return std::unique_ptr<DmaHeap>();
+}
+#else
+// 主机：memfd 替身，DEVICE 用途按 uncached 堆的语义（不需要 Sync）
+static std::unique_ptr<DmaHeap> OpenDefaultHeap(DmaBufRole role) {
+    return std::unique_ptr<DmaHeap>(new MemfdDmaHeap(role != DMA_ROLE_DEVICE));
+}
+#endif
+
+// 每个 2 的幂区间 (2^s, 2^(s+1)] 按 2^(s-2) 的步长分四档，步长不小于一页
+size_t DmaBufPool::ClassBytes(size_t size) {
+    if (size <= kMinClassBytes) return kMinClassBytes;
+    int shift = 63 - __builtin_clzll((unsigned long long)(size - 1));
+    size_t step = (size_t)1 << (shift - 2);
+    if (step < kMinClassBytes) step = kMinClassBytes;
+    return (size + step - 1) & ~(step - 1);
+}
+
+bool DmaBufPool::Init(const Options &options) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    options_ = options;
+    shutdown_ = false;
+    bool any = false;
+    for (int r = 0; r < DMA_ROLE_COUNT; ++r) {
+        RoleState &state = roles_[r];
+        if (!state.heap) {
+            state.owned = OpenDefaultHeap((DmaBufRole)r);
+            state.heap = state.owned.get();
+            state.stats.heap = state.heap ? state.heap->Name() : "";
+            if (state.heap) {
+                printf("DmaBufPool: %s buffers from %s (%s)\n", DmaBufRoleName((DmaBufRole)r), state.heap->Name(),
+                       state.heap->Cached() ? "cached" : "uncached");
+            } else {
+                printf("DmaBufPool: no heap for %s buffers\n", DmaBufRoleName((DmaBufRole)r));
+            }
+        }
+        any = any || state.heap;
+    }
+    return any;
+}
+
+void DmaBufPool::SetHeap(DmaBufRole role, DmaHeap *heap) {
+    if (role < 0 || role >= DMA_ROLE_COUNT) return;
+    std::lock_guard<std::mutex> lk(mtx_);
+    RoleState &state = roles_[role];
+    TrimLocked(state);
+    // 自有堆上还有借出的缓冲或在途的分配时不能析构，先挂到 retired，等该用途空闲时再释放
+    if (Idle(state)) state.retired.clear();
+    if (state.owned && state.owned.get() != heap) {
+        if (Idle(state)) {
+            state.owned.reset();
+        } else {
+            state.retired.push_back(std::move(state.owned));
+        }
+    }
+    state.heap = heap;
+    state.stats.heap = heap ? heap->Name() : "";
+}
+
+DmaHeap *DmaBufPool::Heap(DmaBufRole role) const {
+    if (role < 0 || role >= DMA_ROLE_COUNT) return nullptr;
+    std::lock_guard<std::mutex> lk(mtx_);
+    return roles_[role].heap;
+}
+
+bool DmaBufPool::Alloc(size_t size, DmaBufRole role, DmaBuf *out) {
+    if (!out || size == 0 || role < 0 || role >= DMA_ROLE_COUNT) return false;
+    size_t capacity = ClassBytes(size);
+    std::unique_lock<std::mutex> lk(mtx_);
+    RoleState &state = roles_[role];
+    Stats &st = state.stats;
+    st.allocs++;
+
+    auto it = state.free.find(capacity);
+    if (it != state.free.end() && !it->second.empty()) {
+        *out = it->second.back();
+        it->second.pop_back();
+        st.hits++;
+        st.cachedBufs--;
+        st.cachedBytes -= capacity;
+    } else {
+        DmaHeap *heap = state.heap;
+        if (!heap) {
+            st.failures++;
+            return false;
+        }
+        // 堆分配（ioctl + mmap）不持锁，其他用途与命中的借还不被阻塞
+        state.allocsInFlight++;
+        lk.unlock();
+        DmaBuf buf;
+        bool ok = heap->Alloc(capacity, &buf.fd, &buf.vir);
+        lk.lock();
+        state.allocsInFlight--;
+        if (!ok) {
+            st.failures++;
+            return false;
+        }
+        st.heapAllocs++;
+        buf.capacity = capacity;
+        buf.role = role;
+        buf.cached = heap->Cached();
+        buf.heap = heap;
+        *out = buf;
+    }
+    out->size = size;
+    st.inUseBufs++;
+    st.inUseBytes += capacity;
+    if (st.inUseBytes > st.highWaterBytes) st.highWaterBytes = st.inUseBytes;
+    return true;
+}
+
+void DmaBufPool::Free(DmaBuf *buf) {
+    if (!buf || buf->fd < 0 || !buf->heap || buf->role < 0 || buf->role >= DMA_ROLE_COUNT) return;
+    DmaBuf released = *buf;
+    *buf = DmaBuf();
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        RoleState &state = roles_[released.role];
+        Stats &st = state.stats;
+        st.inUseBufs--;
+        st.inUseBytes -= released.capacity;
+        // 堆已被替换、池已关闭或缓存已满时直接还给堆
+        if (!shutdown_ && released.heap == state.heap &&
+            st.cachedBytes + released.capacity <= options_.maxCachedBytes) {
+            released.size = 0;
+            state.free[released.capacity].push_back(released);
+            st.cachedBufs++;
+            st.cachedBytes += released.capacity;
+            return;
+        }
+        st.heapFrees++;
+        // 放锁还给堆期间这块缓冲仍算在途，换堆 / 关闭不能析构它所属的堆
+        state.freesInFlight++;
+    }
+    released.heap->Free(released.capacity, released.fd, released.vir);
+    std::lock_guard<std::mutex> lk(mtx_);
+    roles_[released.role].freesInFlight--;
+}
+
+bool DmaBufPool::Reserve(size_t size, DmaBufRole role, int count) {
+    std::vector<DmaBuf> bufs(count > 0 ? count : 0);
+    bool ok = true;
+    for (size_t i = 0; i < bufs.size() && ok; ++i) ok = Alloc(size, role, &bufs[i]);
+    for (size_t i = 0; i < bufs.size(); ++i) Free(&bufs[i]);
+    return ok;
+}
+
+void DmaBufPool::TrimLocked(RoleState &state) {
+    for (auto &kv : state.free) {
+        for (size_t i = 0; i < kv.second.size(); ++i) {
+            const DmaBuf &buf = kv.second[i];
+            buf.heap->Free(buf.capacity, buf.fd, buf.vir);
+            state.stats.heapFrees++;
+        }
+    }
+    state.free.clear();
+    state.stats.cachedBufs = 0;
+    state.stats.cachedBytes = 0;
+}
+
+void DmaBufPool::Trim() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (int r = 0; r < DMA_ROLE_COUNT; ++r) TrimLocked(roles_[r]);
+}
+
+void DmaBufPool::Shutdown() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    shutdown_ = true;
+    for (int r = 0; r < DMA_ROLE_COUNT; ++r) {
+        RoleState &state = roles_[r];
+        TrimLocked(state);
+        if (!Idle(state)) {
+            printf("DmaBufPool: %llu %s buffers still in use at shutdown\n",
+                   (unsigned long long)state.stats.inUseBufs, DmaBufRoleName((DmaBufRole)r));
+            continue;
+        }
+        if (state.owned && state.heap == state.owned.get()) {
+            state.heap = nullptr;
+            state.stats.heap = "";
+        }
+        state.owned.reset();
+        state.retired.clear();
+    }
+}
+
+DmaBufPool::Stats DmaBufPool::GetStats(DmaBufRole role) const {
+    if (role < 0 || role >= DMA_ROLE_COUNT) return Stats();
+    std::lock_guard<std::mutex> lk(mtx_);
+    return roles_[role].stats;
+}
+
+void DmaBufPool::PrintStats() const {
+    for (int r = 0; r < DMA_ROLE_COUNT; ++r) {
+        Stats s = GetStats((DmaBufRole)r);
+        if (s.allocs == 0) continue;
+        printf("[DMA] %s(%s) allocs=%llu hits=%llu heap alloc/free=%llu/%llu failed=%llu in use=%llu (%.1fMB) "
+               "peak=%.1fMB cached=%llu (%.1fMB)\n",
+               DmaBufRoleName((DmaBufRole)r), s.heap, (unsigned long long)s.allocs, (unsigned long long)s.hits,
+               (unsigned long long)s.heapAllocs, (unsigned long long)s.heapFrees, (unsigned long long)s.failures,
+               (unsigned long long)s.inUseBufs, s.inUseBytes / 1048576.0, s.highWaterBytes / 1048576.0,
+               (unsigned long long)s.cachedBufs, s.cachedBytes / 1048576.0);
+    }
+}
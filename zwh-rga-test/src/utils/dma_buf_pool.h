@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "hal/dma_heap.h"
+
+// 缓冲用途，决定从哪个堆分配
+enum DmaBufRole {
+    DMA_ROLE_CPU = 0,  // CPU 读写为主（软件合成、打包发送）：带 cache 的 system 堆，交给硬件前后需 Sync
+    DMA_ROLE_DEVICE,   // 硬件之间传递、CPU 至多顺序写一遍（RGA/VENC/NPU 的输入输出）：uncached 堆，免缓存维护
+    DMA_ROLE_CONTIG,   // 要求物理连续（不经 IOMMU 的外设）：CMA 堆
+    DMA_ROLE_COUNT
+};
+
+// 从池中借出的 dma-buf；归还前 fd/vir 一直有效
+struct DmaBuf {
+    int fd = -1;
+    void *vir = nullptr;
+    size_t size = 0;      // 申请的字节数
+    size_t capacity = 0;  // 实际映射的字节数（所在尺寸档）
+    DmaBufRole role = DMA_ROLE_CPU;
+    bool cached = false;  // 所在堆的映射是否带 CPU cache
+    DmaHeap *heap = nullptr;
+};
+
+// dma-buf 池：按用途选堆，按尺寸档缓存已映射的 dma-buf，临时缓冲反复借还时不再 open/ioctl/mmap/munmap
+// - 尺寸档：不足 4KB 的按 4KB，其余每个 2 的幂区间再四等分（按页对齐），浪费不超过 1/4
+// - 用途到堆：CPU -> system（cached），DEVICE -> system-uncached，CONTIG -> RV1106 CMA 堆；
+//   首选堆不存在时按表回退（RV1106 上通常只有 CMA 堆），主机构建全部用 memfd 替身
+// - 每种用途空闲链表上最多保留 maxCachedBytes，超出时归还的缓冲直接释放
+// - 统计：按用途的借出次数/命中/向堆分配与释放次数、在用与缓存字节数、在用字节数的高水位
+// - 可多线程借还
+class DmaBufPool {
+public:
+    struct Options {
+        size_t maxCachedBytes = 32 << 20; // 每种用途
+    };
+
+    struct Stats {
+        const char *heap = "";     // 所用堆，空表示该用途不可用
+        uint64_t allocs = 0;       // 借出次数
+        uint64_t hits = 0;         // 由空闲链表满足的次数
+        uint64_t heapAllocs = 0;   // 向堆分配（ioctl + mmap）次数
+        uint64_t heapFrees = 0;    // 向堆释放（munmap + close）次数
+        uint64_t failures = 0;
+        uint64_t inUseBufs = 0;
+        uint64_t inUseBytes = 0;
+        uint64_t highWaterBytes = 0;
+        uint64_t cachedBufs = 0;
+        uint64_t cachedBytes = 0;
+    };
+
+    static const size_t kMinClassBytes = 4096;
+
+    ~DmaBufPool() { Shutdown(); }
+
+    // 按用途打开默认的堆；至少一种用途可用时返回 true。可重复调用（已打开的用途不变）
+    bool Init(const Options &options);
+    bool Init() { return Init(Options()); }
+    // 为某用途指定堆（不转交所有权，须比池活得久），先释放该用途已缓存的缓冲
+    void SetHeap(DmaBufRole role, DmaHeap *heap);
+    DmaHeap *Heap(DmaBufRole role) const;
+
+    bool Alloc(size_t size, DmaBufRole role, DmaBuf *out);
+    // 归还：放回对应尺寸档的空闲链表（或超出上限时直接释放），*buf 被清空
+    void Free(DmaBuf *buf);
+
+    // 预先分配 count 块 size 字节的缓冲放进空闲链表，避免首帧时集中分配
+    bool Reserve(size_t size, DmaBufRole role, int count);
+    // 释放全部空闲缓冲（在用的不受影响）
+    void Trim();
+    // Trim 并关闭自己打开的堆（仍有缓冲在用的用途保留其堆，等缓冲归还时直接释放）
+    void Shutdown();
+
+    Stats GetStats(DmaBufRole role) const;
+    void PrintStats() const;
+
+    static size_t ClassBytes(size_t size);
+
+private:
+    struct RoleState {
+        DmaHeap *heap = nullptr;
+        std::unique_ptr<DmaHeap> owned;
+        std::vector<std::unique_ptr<DmaHeap> > retired; // 换下时仍有缓冲或分配在途的自有堆
+        int allocsInFlight = 0;                         // 已放锁、正在向堆分配的次数
+        int freesInFlight = 0;                          // 已放锁、正在还给堆的次数
+        std::map<size_t, std::vector<DmaBuf> > free; // 尺寸档 -> 空闲缓冲
+        Stats stats;
+    };
+
+    void TrimLocked(RoleState &state);
+    static bool Idle(const RoleState &state) {
+        return state.stats.inUseBufs == 0 && state.allocsInFlight == 0 && state.freesInFlight == 0;
+    }
+
+    Options options_;
+    bool shutdown_ = false;
+    mutable std::mutex mtx_;
+    RoleState roles_[DMA_ROLE_COUNT];
+};
+
+DmaBufPool &GetDmaBufPool();
+
+const char *DmaBufRoleName(DmaBufRole role);
@@ -0,0 +1,159 @@
+#include "gop_scheduler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal/mpi_hal.h"
+
+static std::atomic<bool> g_resyncRequested(false);
+
+void RequestKeyframeResync() {
+    g_resyncRequested.store(true, std::memory_order_relaxed);
+}
+
+GopScheduler &GetGopScheduler() {
+    static GopScheduler scheduler;
+    return scheduler;
+}
+
+static const char *kModeNames[] = {"sync", "stagger", "refresh"};
+
+const char *GopScheduler::ModeName(Mode mode) {
+    return mode >= GOP_SYNC && mode <= GOP_REFRESH ? kModeNames[mode] : "?";
+}
+
+bool GopScheduler::ParseOption(const char *text, Options *out) {
+    if (!text || !out) return false;
+    Options parsed = *out;
+    const char *rest = text;
+    for (int m = GOP_SYNC; m <= GOP_REFRESH; ++m) {
+        size_t len = strlen(kModeNames[m]);
+        if (strncmp(text, kModeNames[m], len) == 0 && (text[len] == '\0' || text[len] == ',')) {
+            parsed.mode = (Mode)m;
+            rest = text[len] == ',' ? text + len + 1 : NULL;
+            break;
+        }
+    }
+    if (rest) {
+        char *end = NULL;
+        long gop = strtol(rest, &end, 10);
+        if (end == rest || *end != '\0' || gop <= 0 || gop > 1000) return false;
+        parsed.gop = (int)gop;
+    }
+    *out = parsed;
+    return true;
+}
+
+int GopScheduler::ChannelGop(const Options &options) {
+    return options.mode == GOP_REFRESH ? options.gop * kRefreshGopFactor : options.gop;
+}
+
+bool GopScheduler::Start(const Options &options, int tileCount, int tileHeight) {
+    options_ = options;
+    tileCount_ = tileCount;
+    phaseGop_ = options.mode == GOP_SYNC ? 0 : ChannelGop(options);
+    phases_.assign(tileCount, TilePhase());
+    unseeded_ = phaseGop_ > 0 ? tileCount : 0;
+    for (int i = 0; i < kFrameSlots; ++i) slots_[i] = FrameSlot();
+    g_resyncRequested.store(false, std::memory_order_relaxed);
+
+    if (options.mode == GOP_REFRESH) {
+        // 每帧刷新若干宏块行，gop 帧刷完一轮
+        int mbRows = (tileHeight + 15) / 16;
+        VENC_INTRA_REFRESH_S refresh;
+        memset(&refresh, 0, sizeof(refresh));
+        refresh.bRefreshEnable = RK_TRUE;
+        refresh.enIntraRefreshMode = INTRA_REFRESH_ROW;
+        refresh.u32RefreshNum = (mbRows + options.gop - 1) / options.gop;
+        refresh.u32ReqIQp = 30;
+        for (int tileId = 0; tileId < tileCount; ++tileId) {
+            RK_S32 ret = GetMpiHal()->VencSetIntraRefresh(tileId, &refresh);
+            if (ret != RK_SUCCESS) {
+                printf("GopScheduler: SetIntraRefresh ch%d failed, ret=0x%x\n", tileId, ret);
+                return false;
+            }
+        }
+    }
+    printf("GopScheduler: mode=%s gop=%d channel gop=%d tiles=%d\n", ModeName(options.mode), options.gop,
+           ChannelGop(options), tileCount);
+    return true;
+}
+
+void GopScheduler::Resync() {
+    int requested = 0;
+    for (int tileId = 0; tileId < tileCount_; ++tileId) {
+        if (GetMpiHal()->VencRequestIDR(tileId, RK_TRUE) == RK_SUCCESS) requested++;
+        // 同步 IDR 之后重新错开
+        phases_[tileId] = TilePhase();
+    }
+    unseeded_ = phaseGop_ > 0 ? tileCount_ : 0;
+    idrRequests_ += requested;
+    resyncs_++;
+    printf("[GOP] resync: IDR requested on %d/%d tiles\n", requested, tileCount_);
+}
+
+void GopScheduler::OnStream(int tileId, uint16_t frameSeq, bool keyframe, uint32_t bytes) {
+    if (tileId < 0 || tileId >= tileCount_) return;
+    if (g_resyncRequested.exchange(false, std::memory_order_relaxed)) Resync();
+
+    FrameSlot &slot = slots_[frameSeq % kFrameSlots];
+    if (slot.seq != frameSeq) {
+        CloseFrame(slot);
+        slot.seq = frameSeq;
+    }
+    slot.bytes += bytes;
+    if (keyframe) {
+        slot.keyframes++;
+        keyframes_++;
+        winKeyframes_++;
+    }
+
+    if (phaseGop_ <= 0) return;
+    TilePhase &phase = phases_[tileId];
+    if (keyframe && phase.waitIdr) {
+        phase.waitIdr = false;
+        phase.sinceIdr = 0;
+    } else if (!phase.waitIdr) {
+        phase.sinceIdr++;
+    }
+    // 第 0 路不挪；其余各路在相位起点后第 tileId * gop / tileCount 帧请求一次 IDR
+    uint32_t offset = (uint32_t)((int64_t)tileId * phaseGop_ / tileCount_);
+    if (!phase.waitIdr && !phase.seeded && phase.sinceIdr >= offset) {
+        phase.seeded = true;
+        unseeded_--;
+        if (offset > 0 && GetMpiHal()->VencRequestIDR(tileId, RK_TRUE) == RK_SUCCESS) idrRequests_++;
+    }
+}
+
+void GopScheduler::CloseFrame(FrameSlot &slot) {
+    if (slot.seq == 0 && slot.bytes == 0) return;
+    winFrames_++;
+    winBytes_ += slot.bytes;
+    if (unseeded_ == 0) {
+        frames_++;
+        frameBytes_ += slot.bytes;
+        if (slot.keyframes > peakKeyframes_.load(std::memory_order_relaxed)) peakKeyframes_ = slot.keyframes;
+        if (slot.bytes > peakFrameBytes_.load(std::memory_order_relaxed)) peakFrameBytes_ = slot.bytes;
+    }
+    if (slot.keyframes > winPeakKeyframes_.load(std::memory_order_relaxed)) winPeakKeyframes_ = slot.keyframes;
+    if (slot.bytes > winPeakBytes_.load(std::memory_order_relaxed)) winPeakBytes_ = slot.bytes;
+    slot = FrameSlot();
+}
+
+double GopScheduler::PeakToAvgFrameBytes() const {
+    uint64_t frames = frames_.load();
+    return frames ? (double)peakFrameBytes_.load() * frames / frameBytes_.load() : 0.0;
+}
+
+void GopScheduler::PrintWindow() {
+    uint64_t frames = winFrames_.exchange(0);
+    uint64_t bytes = winBytes_.exchange(0);
+    uint64_t keyframes = winKeyframes_.exchange(0);
+    int peakKeyframes = winPeakKeyframes_.exchange(0);
+    uint64_t peakBytes = winPeakBytes_.exchange(0);
+    if (frames == 0) return;
+    printf("[GOP] mode=%s frames=%llu I=%llu peak I/frame=%d peak/avg frame bytes=%.2f\n", ModeName(options_.mode),
+           (unsigned long long)frames, (unsigned long long)keyframes, peakKeyframes,
+           bytes ? (double)peakBytes * frames / bytes : 0.0);
+}
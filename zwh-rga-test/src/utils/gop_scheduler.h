@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "config.h"
+
+// 各 tile 编码器的 I 帧调度：避免所有通道在同一帧出 IDR 造成周期性的码率尖峰
+// - sync：保持原状，所有通道同一帧出 IDR
+// - stagger：通道 GOP 不变，按 tileId 把 IDR 相位均匀错开；每个通道出第一个 IDR 后，
+//   数到 tileId * gop / tileCount 帧时请求一次 IDR（请求会让 GOP 从该帧重新计数），之后自然保持错开
+// - refresh：开启逐行帧内刷新，每 gop 帧刷完一轮；周期 IDR 拉长为 gop * kRefreshGopFactor 作兜底，同样错开
+// - RequestKeyframeResync 可在任意线程（含信号处理函数）调用：下一路码流到来时所有通道同步请求 IDR，
+//   供接收端丢包/新接入时整体重同步，之后重新错开
+// 调度在码流回收线程中执行（OnStream），裁剪送编码路径和 VPSS 绑定直通路径都适用
+class GopScheduler {
+public:
+    enum Mode {
+        GOP_SYNC = 0,
+        GOP_STAGGER,
+        GOP_REFRESH,
+    };
+
+    struct Options {
+        Mode mode = GOP_STAGGER;
+        int gop = 15; // 30fps 下每秒 2 个 I 帧（refresh 模式下为一轮刷新的帧数）
+    };
+
+    static const int kRefreshGopFactor = 20;
+
+    // 解析 "sync|stagger|refresh[,<gop>]" 或只给 "<gop>"（模式不变）
+    static bool ParseOption(const char *text, Options *out);
+    static const char *ModeName(Mode mode);
+
+    // 创建编码通道时使用的 GOP
+    static int ChannelGop(const Options &options);
+
+    // 编码通道创建后、开始取码流前调用；refresh 模式在此开启各通道的帧内刷新
+    bool Start(const Options &options, int tileCount, int tileHeight);
+
+    // 回收线程：每取到一路码流调用一次
+    void OnStream(int tileId, uint16_t frameSeq, bool keyframe, uint32_t bytes);
+
+    // 打印本窗口的 I 帧分布：单帧最多几路 I 帧、单帧码流峰值与均值之比，随后清零窗口
+    void PrintWindow();
+
+    // 累计值，供基准程序在结束后读取；峰值只统计错开完成后的帧（启动与重同步时的整帧 IDR 不计）
+    uint64_t Keyframes() const { return keyframes_.load(); }
+    uint64_t IdrRequests() const { return idrRequests_.load(); }
+    uint64_t Resyncs() const { return resyncs_.load(); }
+    int PeakKeyframesPerFrame() const { return peakKeyframes_.load(); }
+    double PeakToAvgFrameBytes() const;
+
+private:
+    struct TilePhase {
+        bool waitIdr = true;  // 等待该通道的下一个 IDR 作为相位起点
+        bool seeded = false;  // 已为本轮错开请求过 IDR
+        uint32_t sinceIdr = 0;
+    };
+
+    // 按帧序号聚合一帧内各路的 I 帧数与字节数，帧序号换代时结算
+    struct FrameSlot {
+        uint16_t seq = 0;
+        int keyframes = 0;
+        uint64_t bytes = 0;
+    };
+    static const int kFrameSlots = 8;
+
+    void Resync();
+    void CloseFrame(FrameSlot &slot);
+
+    Options options_;
+    int tileCount_ = 0;
+    int phaseGop_ = 0; // 错开所依据的通道 GOP，0 表示不错开
+    int unseeded_ = 0; // 尚未错开完毕的通道数
+    std::vector<TilePhase> phases_;
+    FrameSlot slots_[kFrameSlots];
+
+    std::atomic<uint64_t> keyframes_{0};
+    std::atomic<uint64_t> idrRequests_{0};
+    std::atomic<uint64_t> resyncs_{0};
+    std::atomic<int> peakKeyframes_{0};
+    std::atomic<uint64_t> peakFrameBytes_{0};
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> frameBytes_{0};
+    // 窗口值（回收线程写，采集线程 PrintWindow 时取走）
+    std::atomic<int> winPeakKeyframes_{0};
+    std::atomic<uint64_t> winPeakBytes_{0};
+    std::atomic<uint64_t> winFrames_{0};
+    std::atomic<uint64_t> winBytes_{0};
+    std::atomic<uint64_t> winKeyframes_{0};
+};
+
+// 进程内唯一实例
+GopScheduler &GetGopScheduler();
+
+// 请求所有通道同步出 IDR（只置标志，可在信号处理函数中调用）
+void RequestKeyframeResync();
@@ -31,7 +31,7 @@ RK_S32 test_rgn_overlay_line_process(int sX ,int sY,int type, int group);
 RK_S32 rgn_overlay_release(int group);
 
 int vi_dev_init();
-int vi_chn_init(int channelId, int width, int height);
+int vi_chn_init(int channelId, int width, int height, int buf_cnt = 2, int depth = 2);
 int vpss_init(int VpssChn, int width, int height);
 int venc_init(int chnId, int width, int height, RK_CODEC_ID_E enType);
 
@@ -0,0 +1,239 @@
+#include "nv12_blit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NV12_BLIT_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define NV12_BLIT_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NV12_BLIT_SSE2 1
+#endif
+
+// 预取提前的行数：tile 一行只有几百字节，提前一行来不及盖住 DDR 延迟。
+// 只在板端（Cortex-A7 的硬件预取跟不上跨 stride 的行）使用；x86 的硬件预取更好，软件预取反而更慢
+#if defined(NV12_BLIT_NEON)
+static const int kPrefetchRows = 2;
+#else
+static const int kPrefetchRows = 0;
+#endif
+static const int kCacheLine = 64;
+
+static bool UseMemcpy() {
+    static const bool memcpyOnly = [] {
+        const char *env = getenv("ZWH_NV12_BLIT");
+        return env && strcmp(env, "memcpy") == 0;
+    }();
+    return memcpyOnly;
+}
+
+const char *Nv12BlitKernel() {
+    if (UseMemcpy()) return "memcpy";
+#if defined(NV12_BLIT_NEON)
+    return "neon";
+#elif defined(NV12_BLIT_AVX2)
+    return "avx2";
+#elif defined(NV12_BLIT_SSE2)
+    return "sse2";
+#else
+    return "memcpy";
+#endif
+}
+
+Nv12View Nv12At(void *base, int stride, int vstride) {
+    Nv12View view;
+    view.y = static_cast<uint8_t *>(base);
+    view.uv = view.y ? view.y + (size_t)stride * vstride : nullptr;
+    view.stride = stride;
+    return view;
+}
+
+Nv12View Nv12At(const void *base, int stride, int vstride) {
+    return Nv12At(const_cast<void *>(base), stride, vstride);
+}
+
+// 一行：64 字节一块；NEON 下先预取 pf 处（后面第 kPrefetchRows 行的同一位置）
+static inline void CopyRow(uint8_t *dst, const uint8_t *src, int n, ptrdiff_t pf) {
+    int i = 0;
+#if defined(NV12_BLIT_NEON)
+    for (; i + 64 <= n; i += 64) {
+        __builtin_prefetch(src + i + pf);
+        uint8x16_t a = vld1q_u8(src + i);
+        uint8x16_t b = vld1q_u8(src + i + 16);
+        uint8x16_t c = vld1q_u8(src + i + 32);
+        uint8x16_t d = vld1q_u8(src + i + 48);
+        vst1q_u8(dst + i, a);
+        vst1q_u8(dst + i + 16, b);
+        vst1q_u8(dst + i + 32, c);
+        vst1q_u8(dst + i + 48, d);
+    }
+    for (; i + 16 <= n; i += 16) vst1q_u8(dst + i, vld1q_u8(src + i));
+#elif defined(NV12_BLIT_AVX2)
+    for (; i + 64 <= n; i += 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), a);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i + 32), b);
+    }
+    for (; i + 16 <= n; i += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+    }
+#elif defined(NV12_BLIT_SSE2)
+    for (; i + 64 <= n; i += 64) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 32));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 48));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), a);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 16), b);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 32), c);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 48), d);
+    }
+    for (; i + 16 <= n; i += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+    }
+#endif
+    (void)pf;
+    if (i < n) memcpy(dst + i, src + i, n - i);
+}
+
+// 一行填成两字节图样 lo/hi 交替（Y 平面 lo == hi，UV 平面为 u/v）；n 为偶数
+static inline void FillRow(uint8_t *dst, int n, uint8_t lo, uint8_t hi) {
+    int i = 0;
+#if defined(NV12_BLIT_NEON)
+    uint8x16_t p = vreinterpretq_u8_u16(vdupq_n_u16((uint16_t)(lo | (hi << 8))));
+    for (; i + 64 <= n; i += 64) {
+        vst1q_u8(dst + i, p);
+        vst1q_u8(dst + i + 16, p);
+        vst1q_u8(dst + i + 32, p);
+        vst1q_u8(dst + i + 48, p);
+    }
+    for (; i + 16 <= n; i += 16) vst1q_u8(dst + i, p);
+#elif defined(NV12_BLIT_AVX2) || defined(NV12_BLIT_SSE2)
+    __m128i p = _mm_set1_epi16((short)(lo | (hi << 8)));
+    for (; i + 64 <= n; i += 64) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), p);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 16), p);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 32), p);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 48), p);
+    }
+    for (; i + 16 <= n; i += 16) _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), p);
+#endif
+    if (lo == hi) {
+        if (i < n) memset(dst + i, lo, n - i);
+        return;
+    }
+    for (; i + 1 < n; i += 2) {
+        dst[i] = lo;
+        dst[i + 1] = hi;
+    }
+}
+
+static void CopyRows(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int rows) {
+    if (width <= 0 || rows <= 0) return;
+    if (UseMemcpy()) {
+        for (int row = 0; row < rows; ++row) memcpy(dst + (size_t)row * dstStride, src + (size_t)row * srcStride, width);
+        return;
+    }
+    ptrdiff_t pf = (ptrdiff_t)kPrefetchRows * srcStride;
+    // 前 kPrefetchRows 行在进入循环前预取
+    for (int row = 0; row < kPrefetchRows && row < rows; ++row) {
+        for (int off = 0; off < width; off += kCacheLine) __builtin_prefetch(src + (size_t)row * srcStride + off);
+    }
+    for (int row = 0; row < rows; ++row) {
+        // 最后几行不再越过区域预取
+        CopyRow(dst + (size_t)row * dstStride, src + (size_t)row * srcStride, width, row + kPrefetchRows < rows ? pf : 0);
+    }
+}
+
+static void FillRows(uint8_t *dst, int stride, int width, int rows, uint8_t lo, uint8_t hi) {
+    if (width <= 0 || rows <= 0) return;
+    if (UseMemcpy() && lo == hi) {
+        for (int row = 0; row < rows; ++row) memset(dst + (size_t)row * stride, lo, width);
+        return;
+    }
+    for (int row = 0; row < rows; ++row) FillRow(dst + (size_t)row * stride, width, lo, hi);
+}
+
+void Nv12Copy(const Nv12View &src, int sx, int sy, const Nv12View &dst, int dx, int dy, int w, int h) {
+    if (!src.y || !dst.y || w <= 0 || h <= 0) return;
+    CopyRows(src.y + (size_t)sy * src.stride + sx, src.stride, dst.y + (size_t)dy * dst.stride + dx, dst.stride, w, h);
+    CopyRows(src.uv + (size_t)(sy / 2) * src.stride + sx, src.stride, dst.uv + (size_t)(dy / 2) * dst.stride + dx,
+             dst.stride, w, h / 2);
+}
+
+void Nv12Fill(const Nv12View &dst, const Nv12Rect &rect, uint8_t y, uint8_t u, uint8_t v) {
+    if (!dst.y || rect.w <= 0 || rect.h <= 0) return;
+    FillRows(dst.y + (size_t)rect.y * dst.stride + rect.x, dst.stride, rect.w, rect.h, y, y);
+    FillRows(dst.uv + (size_t)(rect.y / 2) * dst.stride + rect.x, dst.stride, rect.w, rect.h / 2, u, v);
+}
+
+// 按所有矩形的上下边切成水平带：带内每个矩形要么整带覆盖要么不沾边，逐带按 x 排序后填补空隙
+size_t Nv12FillUncovered(const Nv12View &dst, int width, int height, const Nv12Rect *covered, int count, uint8_t y,
+                         uint8_t u, uint8_t v) {
+    if (!dst.y || width <= 0 || height <= 0) return 0;
+    if (count > kMaxCoveredRects) count = kMaxCoveredRects;
+    if (count < 0 || !covered) count = 0;
+
+    Nv12Rect rects[kMaxCoveredRects];
+    int edges[kMaxCoveredRects * 2 + 2];
+    int n = 0;
+    int e = 0;
+    edges[e++] = 0;
+    edges[e++] = height;
+    for (int i = 0; i < count; ++i) {
+        Nv12Rect r = covered[i];
+        int x1 = std::min(r.x + r.w, width);
+        int y1 = std::min(r.y + r.h, height);
+        r.x = std::max(r.x, 0);
+        r.y = std::max(r.y, 0);
+        if (x1 <= r.x || y1 <= r.y) continue;
+        r.w = x1 - r.x;
+        r.h = y1 - r.y;
+        rects[n++] = r;
+        edges[e++] = r.y;
+        edges[e++] = y1;
+    }
+    std::sort(edges, edges + e);
+    e = (int)(std::unique(edges, edges + e) - edges);
+    std::sort(rects, rects + n, [](const Nv12Rect &a, const Nv12Rect &b) { return a.x < b.x; });
+
+    size_t bytes = 0;
+    for (int b = 0; b + 1 < e; ++b) {
+        int y0 = edges[b];
+        int y1 = edges[b + 1];
+        int x = 0;
+        for (int i = 0; i < n; ++i) {
+            const Nv12Rect &r = rects[i];
+            if (r.y > y0 || r.y + r.h < y1) continue;
+            if (r.x > x) {
+                Nv12Rect gap;
+                gap.x = x;
+                gap.y = y0;
+                gap.w = r.x - x;
+                gap.h = y1 - y0;
+                Nv12Fill(dst, gap, y, u, v);
+                bytes += (size_t)gap.w * gap.h * 3 / 2;
+            }
+            x = std::max(x, r.x + r.w);
+        }
+        if (x < width) {
+            Nv12Rect gap;
+            gap.x = x;
+            gap.y = y0;
+            gap.w = width - x;
+            gap.h = y1 - y0;
+            Nv12Fill(dst, gap, y, u, v);
+            bytes += (size_t)gap.w * gap.h * 3 / 2;
+        }
+    }
+    return bytes;
+}
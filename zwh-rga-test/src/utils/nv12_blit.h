@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// NV12 区域拷贝/裁剪/填充的 CPU 内核，取代各处按行 memcpy/整幅 memset 的循环
+// - Y 与交织的 UV 平面共用一个 stride，源/目标 stride 任意；坐标与宽高按 NV12 要求取偶数
+// - 行内按 64 字节块用 NEON（板端）或 SSE2/AVX2（主机）搬运；板端每行预取两行之后的源数据
+// - Nv12FillUncovered 只清理没有被任何矩形覆盖的部分，画布上马上要被 tile 覆盖的像素不再先清零
+// - 环境变量 ZWH_NV12_BLIT=memcpy 时退回逐行 memcpy/memset（用于对比）
+struct Nv12View {
+    uint8_t *y = nullptr;
+    uint8_t *uv = nullptr;
+    int stride = 0; // 行跨度（字节），Y 与 UV 相同
+};
+
+struct Nv12Rect {
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+};
+
+// base 处的 NV12 图像：Y 平面 vstride 行，UV 平面紧随其后
+Nv12View Nv12At(void *base, int stride, int vstride);
+// 只读的源图像（内核不会写 src）
+Nv12View Nv12At(const void *base, int stride, int vstride);
+
+// 把 src 中 (sx, sy) 起 w x h 的区域拷到 dst 的 (dx, dy)；拷整块 tile 即 blit，源偏移非零即裁剪
+void Nv12Copy(const Nv12View &src, int sx, int sy, const Nv12View &dst, int dx, int dy, int w, int h);
+
+// 把 dst 中的矩形填成 (y, u, v)
+void Nv12Fill(const Nv12View &dst, const Nv12Rect &rect, uint8_t y, uint8_t u, uint8_t v);
+
+// 把 width x height 的 dst 中不被 covered 里任何矩形覆盖的部分填成 (y, u, v)，返回写入的字节数
+// covered 至多 kMaxCoveredRects 个（多出的忽略，视为未覆盖）
+static const int kMaxCoveredRects = 64;
+size_t Nv12FillUncovered(const Nv12View &dst, int width, int height, const Nv12Rect *covered, int count, uint8_t y,
+                         uint8_t u, uint8_t v);
+
+// 当前使用的内核名（"neon" / "avx2" / "sse2" / "memcpy"）
+const char *Nv12BlitKernel();
@@ -3,14 +3,29 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <atomic>
+
+#include "hal/mpi_hal.h"
+
+static std::atomic<bool> g_stopRequested(false);
+
+void RequestPipelineStop() {
+    g_stopRequested = true;
+}
+
+bool PipelineStopRequested() {
+    return g_stopRequested.load(std::memory_order_relaxed);
+}
+
 bool InitMpiSys() {
-    if (RK_MPI_SYS_Init() != RK_SUCCESS) {
-        printf("rk mpi sys init fail!\n");
-        return false;
-    }
-    return true;
+    return GetMpiHal()->SysInit();
+}
+
+void ExitMpiSys() {
+    GetMpiHal()->SysExit();
 }
 
+#ifdef RV1106_1103
 bool StartIsp() {
     RK_BOOL multi_sensor = RK_FALSE;
     const char *iq_dir = "/etc/iqfiles"; // 板端需预置 IQ 文件目录
@@ -24,13 +39,52 @@ bool StartIsp() {
 void StopIsp() {
     SAMPLE_COMM_ISP_Stop(0);
 }
+#else
+// 主机构建没有 ISP，仿真 VI 直接输出 NV12
+bool StartIsp() {
+    printf("ISP skipped on host build.\n");
+    return true;
+}
 
-void InitViInput() {
-    vi_dev_init();
-    vi_chn_init(0, SRC_WIDTH, SRC_HEIGHT);
+void StopIsp() {}
+#endif
+
+bool InitViInput(bool bound) {
+    // 绑定到 VPSS 时 VI 缓冲同时被下游持有，加大缓冲数并保证 depth < bufCount
+    int bufCount = bound ? 4 : 2;
+    int depth = bound ? 1 : 2;
+    if (!GetMpiHal()->ViInit(SRC_WIDTH, SRC_HEIGHT, bufCount, depth)) {
+        printf("VI init failed\n");
+        return false;
+    }
+    return true;
 }
 
-bool InitVencChannels() {
+// 30fps 编码的码控参数；AVBR 以 kbps 为上限，画面静止时可降到 1/4
+static void FillRcAttr(VENC_RC_ATTR_S *rc, int gop, int kbps, bool avbr) {
+    memset(rc, 0, sizeof(*rc));
+    if (avbr) {
+        rc->enRcMode = VENC_RC_MODE_H264AVBR;
+        rc->stH264Avbr.u32Gop = gop;
+        rc->stH264Avbr.u32BitRate = kbps;
+        rc->stH264Avbr.u32MaxBitRate = kbps;
+        rc->stH264Avbr.u32MinBitRate = kbps / 4 > 2 ? kbps / 4 : 2;
+        rc->stH264Avbr.u32SrcFrameRateDen = 1;
+        rc->stH264Avbr.u32SrcFrameRateNum = 30;
+        rc->stH264Avbr.fr32DstFrameRateNum = 30;
+        rc->stH264Avbr.fr32DstFrameRateDen = 1;
+        return;
+    }
+    rc->enRcMode = VENC_RC_MODE_H264CBR;
+    rc->stH264Cbr.u32Gop = gop;
+    rc->stH264Cbr.u32BitRate = kbps;
+    rc->stH264Cbr.u32SrcFrameRateDen = 1;
+    rc->stH264Cbr.u32SrcFrameRateNum = 30;
+    rc->stH264Cbr.fr32DstFrameRateNum = 30;
+    rc->stH264Cbr.fr32DstFrameRateDen = 1;
+}
+
+bool InitVencChannels(int gop, int kbps) {
     for (int i = 0; i < TOTAL_CHNS; i++) {
         VENC_CHN_ATTR_S stVencChnAttr;
         memset(&stVencChnAttr, 0, sizeof(VENC_CHN_ATTR_S));
@@ -44,16 +98,11 @@ bool InitVencChannels() {
         stVencChnAttr.stVencAttr.u32VirHeight = SUB_HEIGHT;
         stVencChnAttr.stVencAttr.u32BufSize = SUB_WIDTH * SUB_HEIGHT * 2;
         
-        stVencChnAttr.stRcAttr.enRcMode = VENC_RC_MODE_H264CBR;
-        // 设置 30fps 编码，并将 GOP 调整为 15（30fps 下每秒 2 个 I 帧）
-        stVencChnAttr.stRcAttr.stH264Cbr.u32Gop = 15;
-        stVencChnAttr.stRcAttr.stH264Cbr.u32BitRate = 256; 
-        stVencChnAttr.stRcAttr.stH264Cbr.u32SrcFrameRateDen = 1;
-        stVencChnAttr.stRcAttr.stH264Cbr.u32SrcFrameRateNum = 30;
-        stVencChnAttr.stRcAttr.stH264Cbr.fr32DstFrameRateNum = 30;
-        stVencChnAttr.stRcAttr.stH264Cbr.fr32DstFrameRateDen = 1;
-
-        RK_S32 s32Ret = RK_MPI_VENC_CreateChn(i, &stVencChnAttr);
+        // 设置 30fps CBR 编码，GOP 默认 15（30fps 下每秒 2 个 I 帧）；各路 I 帧相位由 GopScheduler 错开，
+        // 运行中码率由 BitrateAllocator 经 SetVencBitrate 重新分配
+        FillRcAttr(&stVencChnAttr.stRcAttr, gop, kbps, false);
+
+        RK_S32 s32Ret = GetMpiHal()->VencCreateChn(i, &stVencChnAttr);
         if (s32Ret != RK_SUCCESS) {
             printf("Create VENC Chn %d failed: 0x%x\n", i, s32Ret);
             return false;
@@ -62,10 +111,28 @@ bool InitVencChannels() {
         VENC_RECV_PIC_PARAM_S stRecvParam;
         memset(&stRecvParam, 0, sizeof(VENC_RECV_PIC_PARAM_S));
         stRecvParam.s32RecvPicNum = -1;
-        RK_MPI_VENC_StartRecvFrame(i, &stRecvParam);
+        GetMpiHal()->VencStartRecvFrame(i, &stRecvParam);
     }
     
-    printf("Init 16 VENC Channels Success.\n");
+    printf("Init %d VENC Channels Success.\n", TOTAL_CHNS);
+    return true;
+}
+
+bool SetVencBitrate(int chn, int kbps, bool avbr) {
+    VENC_CHN_ATTR_S attr;
+    RK_S32 ret = GetMpiHal()->VencGetChnAttr(chn, &attr);
+    if (ret != RK_SUCCESS) {
+        printf("Get VENC Chn %d attr failed: 0x%x\n", chn, ret);
+        return false;
+    }
+    int gop = attr.stRcAttr.enRcMode == VENC_RC_MODE_H264AVBR ? attr.stRcAttr.stH264Avbr.u32Gop
+                                                               : attr.stRcAttr.stH264Cbr.u32Gop;
+    FillRcAttr(&attr.stRcAttr, gop, kbps, avbr);
+    ret = GetMpiHal()->VencSetChnAttr(chn, &attr);
+    if (ret != RK_SUCCESS) {
+        printf("Set VENC Chn %d bitrate %dkbps failed: 0x%x\n", chn, kbps, ret);
+        return false;
+    }
     return true;
 }
 
@@ -75,7 +142,7 @@ bool CreateSubImgPool(MB_POOL &pool) {
     PoolCfg.u64MBSize = SUB_WIDTH * SUB_HEIGHT * 3 / 2; // NV12 size
     PoolCfg.u32MBCnt = TOTAL_CHNS * 2; 
     PoolCfg.enAllocType = MB_ALLOC_TYPE_DMA; 
-    pool = RK_MPI_MB_CreatePool(&PoolCfg);
+    pool = GetMpiHal()->MbCreatePool(&PoolCfg);
     if (pool == MB_INVALID_POOLID) {
         printf("Create Pool Failed!\n");
         return false;
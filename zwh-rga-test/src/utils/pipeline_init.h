@@ -3,18 +3,26 @@
 #include "luckfox_mpi.h"
 #include "config.h"
 
-// 初始化 MPI 系统
+// 初始化 / 退出 MPI 系统（经 GetMpiHal() 选定的后端）
 bool InitMpiSys();
+void ExitMpiSys();
 
 // 开启 ISP（3A）
 bool StartIsp();
 void StopIsp();
 
-// 初始化 VI 输入
-void InitViInput();
+// 初始化 VI 输入；bound 为 true 时 VI 还要绑定到 VPSS（绑定模式）
+bool InitViInput(bool bound = false);
 
-// 初始化 16 路编码器
-bool InitVencChannels();
+// 初始化 16 路编码器；gop 一般取 GopScheduler::ChannelGop，kbps 为每路初始 CBR 码率
+bool InitVencChannels(int gop = 15, int kbps = 256);
+
+// 运行中改单路码率（保留 GOP/帧率），avbr 为 true 时切到 AVBR、以 kbps 为上限
+bool SetVencBitrate(int chn, int kbps, bool avbr);
 
 // 创建子画面内存池
 bool CreateSubImgPool(MB_POOL &pool);
+
+// 请求各处理循环退出（信号处理函数或基准程序调用），循环在当前帧处理完后返回
+void RequestPipelineStop();
+bool PipelineStopRequested();
@@ -0,0 +1,337 @@
+#include "pipeline_metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *kStageNames[PipelineMetrics::STAGE_COUNT] = {"vi", "crop", "venc", "stream", "tx"};
+static const int kTraceDumpFrames = 16; // "trace" 查询返回的帧数
+
+uint64_t MetricsNowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+PipelineMetrics &GetPipelineMetrics() {
+    static PipelineMetrics metrics;
+    return metrics;
+}
+
+bool PipelineMetrics::ParseOption(const char *text, Options *out) {
+    if (!text || !out) return false;
+    if (strcmp(text, "off") == 0 || strcmp(text, "0") == 0) {
+        out->enabled = false;
+        return true;
+    }
+    char *end = NULL;
+    long period = strtol(text, &end, 10);
+    if (end == text || period < 100) return false;
+    if (*end == ',') {
+        out->socketPath = end + 1;
+    } else if (*end != '\0') {
+        return false;
+    }
+    out->enabled = true;
+    out->periodMs = (int)period;
+    return true;
+}
+
+// 小于 4us 每微秒一个桶，之后每倍频 4 个桶
+int PipelineMetrics::BucketOf(uint64_t us) {
+    if (us < 4) return (int)us;
+    int msb = 63 - __builtin_clzll(us);
+    int bucket = (msb - 1) * 4 + (int)((us >> (msb - 2)) & 3);
+    return bucket < kBuckets ? bucket : kBuckets - 1;
+}
+
+uint64_t PipelineMetrics::BucketUpperUs(int bucket) {
+    if (bucket < 4) return (uint64_t)bucket;
+    int msb = bucket / 4 + 1;
+    uint64_t width = 1ULL << (msb - 2);
+    return (uint64_t)(4 + bucket % 4) * width + width - 1;
+}
+
+bool PipelineMetrics::Start(const Options &options) {
+    Stop();
+    options_ = options;
+    if (!options_.enabled) {
+        printf("PipelineMetrics: disabled\n");
+        return true;
+    }
+    tileCount_ = TOTAL_CHNS;
+
+    if (!options_.socketPath.empty()) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (options_.socketPath.size() >= sizeof(addr.sun_path)) {
+            printf("PipelineMetrics: socket path too long: %s\n", options_.socketPath.c_str());
+            return false;
+        }
+        strcpy(addr.sun_path, options_.socketPath.c_str());
+        unlink(addr.sun_path);
+        listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0 || bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            listen(listenFd_, 4) != 0) {
+            // 查询口开不了不影响记录与周期导出
+            printf("PipelineMetrics: listen on %s failed: %s\n", addr.sun_path, strerror(errno));
+            if (listenFd_ >= 0) close(listenFd_);
+            listenFd_ = -1;
+        }
+    }
+
+    enabled_ = true;
+    running_ = true;
+    worker_ = std::thread(&PipelineMetrics::ExportLoop, this);
+    printf("PipelineMetrics: export every %d ms, query socket %s\n", options_.periodMs,
+           listenFd_ >= 0 ? options_.socketPath.c_str() : "(none)");
+    return true;
+}
+
+void PipelineMetrics::Stop() {
+    if (running_.exchange(false) && worker_.joinable()) {
+        worker_.join();
+    }
+    if (listenFd_ >= 0) {
+        close(listenFd_);
+        listenFd_ = -1;
+        unlink(options_.socketPath.c_str());
+    }
+    enabled_ = false;
+}
+
+PipelineMetrics::FrameTrace *PipelineMetrics::TraceFor(uint16_t seq) {
+    FrameTrace &trace = traces_[seq & (kTraceDepth - 1)];
+    return trace.tag.load(std::memory_order_acquire) == (seq | kTagValid) ? &trace : NULL;
+}
+
+void PipelineMetrics::FrameCaptured(uint16_t seq, uint64_t pts, uint64_t nowUs) {
+    if (!enabled_) return;
+    bool ptsValid = pts != 0 && pts <= nowUs;
+    uint64_t startUs = ptsValid ? pts : nowUs;
+    if (ptsValid) Record(stages_[STAGE_VI], nowUs - pts);
+    frames_.fetch_add(1, std::memory_order_relaxed);
+
+    // 先作废槽位再改写，读者据 tag 前后一致判断是否读到了完整的一帧
+    FrameTrace &trace = traces_[seq & (kTraceDepth - 1)];
+    trace.tag.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    trace.startUs.store(startUs, std::memory_order_relaxed);
+    trace.viUs.store(nowUs, std::memory_order_relaxed);
+    trace.cropUs.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < tileCount_; ++i) {
+        trace.submitUs[i].store(0, std::memory_order_relaxed);
+        trace.sentUs[i].store(0, std::memory_order_relaxed);
+    }
+    trace.tag.store(seq | kTagValid, std::memory_order_release);
+    lastSeq_.store(seq, std::memory_order_relaxed);
+}
+
+void PipelineMetrics::FrameCropped(uint16_t seq, uint64_t nowUs) {
+    if (!enabled_) return;
+    FrameTrace *trace = TraceFor(seq);
+    if (!trace) return;
+    uint64_t viUs = trace->viUs.load(std::memory_order_relaxed);
+    if (nowUs >= viUs) Record(stages_[STAGE_CROP], nowUs - viUs);
+    trace->cropUs.store(nowUs, std::memory_order_relaxed);
+}
+
+void PipelineMetrics::TileSubmitted(uint16_t seq, int tileId, uint64_t nowUs) {
+    if (!enabled_ || tileId < 0 || tileId >= tileCount_) return;
+    FrameTrace *trace = TraceFor(seq);
+    if (!trace) return;
+    uint64_t cropUs = trace->cropUs.load(std::memory_order_relaxed);
+    if (cropUs && nowUs >= cropUs) Record(stages_[STAGE_VENC], nowUs - cropUs);
+    trace->submitUs[tileId].store(nowUs, std::memory_order_relaxed);
+}
+
+void PipelineMetrics::TileSent(uint16_t seq, int tileId, uint32_t bytes, uint64_t streamUs, uint64_t nowUs) {
+    if (!enabled_ || tileId < 0 || tileId >= tileCount_) return;
+    tileFrames_[tileId].fetch_add(1, std::memory_order_relaxed);
+    tileBytes_[tileId].fetch_add(bytes, std::memory_order_relaxed);
+
+    FrameTrace *trace = TraceFor(seq);
+    if (!trace) return; // 编码落后超过 kTraceDepth 帧，时间轴已被覆盖
+    uint64_t startUs = trace->startUs.load(std::memory_order_relaxed);
+    uint64_t submitUs = trace->submitUs[tileId].load(std::memory_order_relaxed);
+    uint64_t cropUs = trace->cropUs.load(std::memory_order_relaxed);
+    trace->sentUs[tileId].store(nowUs, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (trace->tag.load(std::memory_order_relaxed) != (seq | kTagValid)) return;
+
+    if (streamUs) {
+        if (submitUs && streamUs >= submitUs) Record(stages_[STAGE_STREAM], streamUs - submitUs);
+        Record(stages_[STAGE_TX], nowUs - streamUs);
+    } else if (cropUs && nowUs >= cropUs) {
+        Record(stages_[STAGE_TX], nowUs - cropUs);
+    }
+    if (nowUs >= startUs) Record(glassToWire_[tileId], nowUs - startUs);
+}
+
+// 本进程累计占用的 CPU 时间（用户态 + 内核态）
+static uint64_t ProcessCpuUs() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// 直方图窗口差值的分位数，quantiles 为千分比
+static void Percentiles(const uint32_t *delta, int buckets, uint64_t (*upper)(int),
+                        const int *quantiles, int count, uint64_t *out) {
+    uint64_t total = 0;
+    for (int b = 0; b < buckets; ++b) total += delta[b];
+    int q = 0;
+    uint64_t seen = 0;
+    for (int b = 0; b < buckets && q < count; ++b) {
+        seen += delta[b];
+        while (q < count && total > 0 && seen * 1000 >= total * quantiles[q]) {
+            out[q++] = upper(b);
+        }
+    }
+    for (; q < count; ++q) out[q] = 0;
+}
+
+void PipelineMetrics::Export(uint64_t windowMs) {
+    static const int kQuantiles[] = {500, 900, 990};
+    const int qn = sizeof(kQuantiles) / sizeof(kQuantiles[0]);
+    double secs = windowMs / 1000.0;
+    uint32_t delta[kBuckets];
+    uint32_t g2wTotal[kBuckets] = {0};
+    uint64_t pct[qn];
+    char buf[256];
+
+    uint64_t frames = frames_.load(std::memory_order_relaxed);
+    uint64_t cpuUs = ProcessCpuUs();
+    std::string line;
+    line.reserve(1024 + 48 * tileCount_);
+    // cpu 为本进程占用单核的百分比
+    snprintf(buf, sizeof(buf), "{\"ts\":%llu,\"win_ms\":%llu,\"fps\":%.1f,\"cpu\":%.1f,\"stage_us\":{",
+             (unsigned long long)(MetricsNowUs() / 1000), (unsigned long long)windowMs,
+             (frames - prevFrames_) / secs, prevCpuUs_ ? (cpuUs - prevCpuUs_) / 10.0 / windowMs : 0.0);
+    line += buf;
+    prevFrames_ = frames;
+    prevCpuUs_ = cpuUs;
+
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        for (int b = 0; b < kBuckets; ++b) {
+            uint32_t cur = stages_[s][b].load(std::memory_order_relaxed);
+            delta[b] = cur - prevStages_[s][b];
+            prevStages_[s][b] = cur;
+        }
+        Percentiles(delta, kBuckets, BucketUpperUs, kQuantiles, qn, pct);
+        snprintf(buf, sizeof(buf), "%s\"%s\":[%llu,%llu,%llu]", s ? "," : "", kStageNames[s],
+                 (unsigned long long)pct[0], (unsigned long long)pct[1], (unsigned long long)pct[2]);
+        line += buf;
+    }
+    line += "},\"tiles\":[";
+
+    for (int t = 0; t < tileCount_; ++t) {
+        for (int b = 0; b < kBuckets; ++b) {
+            uint32_t cur = glassToWire_[t][b].load(std::memory_order_relaxed);
+            delta[b] = cur - prevGlassToWire_[t][b];
+            prevGlassToWire_[t][b] = cur;
+            g2wTotal[b] += delta[b];
+        }
+        Percentiles(delta, kBuckets, BucketUpperUs, kQuantiles + 2, 1, pct);
+        uint64_t tileFrames = tileFrames_[t].load(std::memory_order_relaxed);
+        uint64_t tileBytes = tileBytes_[t].load(std::memory_order_relaxed);
+        // 每个 tile：[fps, kbps, glass-to-wire p99]
+        snprintf(buf, sizeof(buf), "%s[%.1f,%.0f,%llu]", t ? "," : "",
+                 (tileFrames - prevTileFrames_[t]) / secs,
+                 (tileBytes - prevTileBytes_[t]) * 8 / 1000.0 / secs, (unsigned long long)pct[0]);
+        line += buf;
+        prevTileFrames_[t] = tileFrames;
+        prevTileBytes_[t] = tileBytes;
+    }
+
+    Percentiles(g2wTotal, kBuckets, BucketUpperUs, kQuantiles, qn, pct);
+    snprintf(buf, sizeof(buf), "],\"g2w_us\":[%llu,%llu,%llu]}", (unsigned long long)pct[0],
+             (unsigned long long)pct[1], (unsigned long long)pct[2]);
+    line += buf;
+
+    printf("[METRICS] %s\n", line.c_str());
+    std::lock_guard<std::mutex> lk(snapshotMtx_);
+    snapshot_.swap(line);
+}
+
+std::string PipelineMetrics::Snapshot() {
+    std::lock_guard<std::mutex> lk(snapshotMtx_);
+    return snapshot_;
+}
+
+// 最近若干帧的时间轴，各时间点为相对该帧起点（PTS）的微秒数，0 表示尚未发生
+std::string PipelineMetrics::TraceDump() {
+    std::string out;
+    char buf[64];
+    uint16_t last = lastSeq_.load(std::memory_order_relaxed);
+    for (int i = kTraceDumpFrames - 1; i >= 0; --i) {
+        uint16_t seq = (uint16_t)(last - i);
+        FrameTrace *trace = TraceFor(seq);
+        if (!trace) continue;
+        uint64_t startUs = trace->startUs.load(std::memory_order_relaxed);
+        auto rel = [startUs](uint64_t us) { return (unsigned long long)(us > startUs ? us - startUs : 0); };
+        std::string line;
+        snprintf(buf, sizeof(buf), "{\"seq\":%u,\"vi\":%llu,\"crop\":%llu,\"tiles\":[", (unsigned int)seq,
+                 rel(trace->viUs.load(std::memory_order_relaxed)),
+                 rel(trace->cropUs.load(std::memory_order_relaxed)));
+        line += buf;
+        for (int t = 0; t < tileCount_; ++t) {
+            snprintf(buf, sizeof(buf), "%s[%llu,%llu]", t ? "," : "",
+                     rel(trace->submitUs[t].load(std::memory_order_relaxed)),
+                     rel(trace->sentUs[t].load(std::memory_order_relaxed)));
+            line += buf;
+        }
+        line += "]}\n";
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (trace->tag.load(std::memory_order_relaxed) == (seq | kTagValid)) out += line;
+    }
+    return out;
+}
+
+void PipelineMetrics::ServeClient(int fd) {
+    // 客户端可以不发任何内容（直接取统计行），最多等 50ms 看是否请求 trace
+    char req[16] = {0};
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, 50) > 0) {
+        ssize_t n = read(fd, req, sizeof(req) - 1);
+        if (n < 0) req[0] = '\0';
+    }
+    std::string reply = strncmp(req, "trace", 5) == 0 ? TraceDump() : Snapshot() + "\n";
+    size_t off = 0;
+    while (off < reply.size()) {
+        ssize_t n = write(fd, reply.data() + off, reply.size() - off);
+        if (n <= 0) break;
+        off += (size_t)n;
+    }
+    close(fd);
+}
+
+void PipelineMetrics::ExportLoop() {
+    uint64_t windowStartMs = MetricsNowUs() / 1000;
+    while (running_.load()) {
+        if (listenFd_ >= 0) {
+            struct pollfd pfd = {listenFd_, POLLIN, 0};
+            if (poll(&pfd, 1, 200) > 0) {
+                int fd = accept4(listenFd_, NULL, NULL, SOCK_CLOEXEC);
+                if (fd >= 0) ServeClient(fd);
+            }
+        } else {
+            usleep(200 * 1000);
+        }
+        uint64_t nowMs = MetricsNowUs() / 1000;
+        if (nowMs - windowStartMs >= (uint64_t)options_.periodMs) {
+            Export(nowMs - windowStartMs);
+            windowStartMs = nowMs;
+        }
+    }
+}
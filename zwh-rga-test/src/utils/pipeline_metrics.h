@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "config.h"
+
+// 采集-裁剪-编码-发送流水线的帧级指标
+// - 时间轴按帧序号记入无锁环形缓冲：VI 帧 PTS -> 拿到 VI 帧 -> 裁剪完成 -> 各 tile 送编码返回
+//   -> 取到码流 -> 推流/网络发送完成；相邻两点之差即各阶段耗时，PTS 到发送完成即 glass-to-wire
+// - 阶段耗时与每个 tile 的 glass-to-wire 落入对数直方图（每倍频 4 个桶），只做 relaxed 原子加
+// - 导出线程按周期对计数取差（含本进程 CPU 占用），打印一行 "[METRICS] {json}"，同时经本地 unix socket 提供查询：
+//   连上即返回最近一行；先发 "trace" 则返回最近若干帧的逐帧时间轴
+// - VI 阶段与 glass-to-wire 假设 PTS 为 CLOCK_MONOTONIC 微秒（rockit 与主机仿真后端均如此），
+//   PTS 为 0 或晚于当前时间时改以拿到 VI 帧的时刻为起点
+class PipelineMetrics {
+public:
+    enum Stage {
+        STAGE_VI = 0,   // PTS -> ViGetChnFrame 返回
+        STAGE_CROP,     // -> 整帧裁剪完成
+        STAGE_VENC,     // -> 该 tile 的 VencSendFrame 返回
+        STAGE_STREAM,   // -> 取到该 tile 的码流（编码耗时）
+        STAGE_TX,       // -> RTSP/网络发送完成
+        STAGE_COUNT
+    };
+
+    struct Options {
+        bool enabled = true;
+        int periodMs = 5000;                              // 导出周期
+        std::string socketPath = "/tmp/zwh-metrics.sock"; // 为空则不开查询 socket
+    };
+
+    // 解析 "off" 或 "<periodMs>[,<socket 路径>]"
+    static bool ParseOption(const char *text, Options *out);
+
+    ~PipelineMetrics() { Stop(); }
+
+    // 启动导出线程；未启动时各记录接口直接返回
+    bool Start(const Options &options);
+    void Stop();
+    bool Enabled() const { return enabled_; }
+
+    // 采集线程
+    void FrameCaptured(uint16_t seq, uint64_t pts, uint64_t nowUs);
+    void FrameCropped(uint16_t seq, uint64_t nowUs);
+    void TileSubmitted(uint16_t seq, int tileId, uint64_t nowUs);
+    // 发送线程：streamUs 为 0 表示该路径不经编码（网络裁剪测试直接发原始 tile）
+    void TileSent(uint16_t seq, int tileId, uint32_t bytes, uint64_t streamUs, uint64_t nowUs);
+
+    // 最近一次导出的 JSON 行
+    std::string Snapshot();
+
+private:
+    static const int kTraceDepth = 64; // 环形缓冲帧数，须为 2 的幂
+    static const int kBuckets = 104;   // 覆盖到 2^26 us
+
+    typedef std::atomic<uint32_t> Histogram[kBuckets];
+
+    struct FrameTrace {
+        std::atomic<uint32_t> tag{0}; // seq | kTagValid，写完其它字段后 release 发布
+        std::atomic<uint64_t> startUs{0};
+        std::atomic<uint64_t> viUs{0};
+        std::atomic<uint64_t> cropUs{0};
+        std::atomic<uint64_t> submitUs[MAX_TILES];
+        std::atomic<uint64_t> sentUs[MAX_TILES];
+    };
+
+    static const uint32_t kTagValid = 0x10000;
+
+    static int BucketOf(uint64_t us);
+    static uint64_t BucketUpperUs(int bucket);
+    static void Record(Histogram &hist, uint64_t us) {
+        hist[BucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    }
+    FrameTrace *TraceFor(uint16_t seq);
+
+    void ExportLoop();
+    void Export(uint64_t windowMs);
+    void ServeClient(int fd);
+    std::string TraceDump();
+
+    bool enabled_ = false;
+    Options options_;
+    int tileCount_ = 0;
+
+    FrameTrace traces_[kTraceDepth];
+    std::atomic<uint16_t> lastSeq_{0};
+    Histogram stages_[STAGE_COUNT] = {};
+    Histogram glassToWire_[MAX_TILES] = {};
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> tileFrames_[MAX_TILES] = {};
+    std::atomic<uint64_t> tileBytes_[MAX_TILES] = {};
+
+    // 导出线程独占：上一窗口的累计值
+    uint32_t prevStages_[STAGE_COUNT][kBuckets] = {};
+    uint32_t prevGlassToWire_[MAX_TILES][kBuckets] = {};
+    uint64_t prevFrames_ = 0;
+    uint64_t prevCpuUs_ = 0;
+    uint64_t prevTileFrames_[MAX_TILES] = {};
+    uint64_t prevTileBytes_[MAX_TILES] = {};
+
+    std::mutex snapshotMtx_;
+    std::string snapshot_;
+    int listenFd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread worker_;
+};
+
+// 进程内唯一实例，供各处理循环记录
+PipelineMetrics &GetPipelineMetrics();
+
+// 与 VI 帧 PTS 同一时钟（CLOCK_MONOTONIC）的微秒时间戳
+uint64_t MetricsNowUs();
@@ -0,0 +1,288 @@
+#include "pre_event_buffer.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+static const int kExportPollMs = 50;
+
+static std::atomic<bool> g_exportRequested(false);
+
+void RequestPreEventExport() {
+    g_exportRequested.store(true, std::memory_order_relaxed);
+}
+
+static uint64_t NowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+bool PreEventBuffer::ParseOption(const char *text, Options *out) {
+    if (!text || !out) return false;
+    if (strcmp(text, "off") == 0) {
+        out->enabled = false;
+        return true;
+    }
+    Options parsed = *out;
+    char *end = NULL;
+    long budget = strtol(text, &end, 10);
+    if (end == text || budget < 64) return false;
+    parsed.budgetKB = (int)budget;
+    int *fields[2] = {&parsed.preMs, &parsed.postMs};
+    for (int i = 0; i < 2 && *end == ',' && end[1] >= '0' && end[1] <= '9'; ++i) {
+        const char *next = end + 1;
+        long ms = strtol(next, &end, 10);
+        if (end == next || ms < 0) return false;
+        *fields[i] = (int)ms;
+    }
+    if (*end == ',') {
+        parsed.dir = end + 1;
+        end += strlen(end);
+    }
+    if (*end != '\0' || parsed.dir.empty() || parsed.preMs <= 0) return false;
+    parsed.enabled = true;
+    *out = parsed;
+    return true;
+}
+
+bool PreEventBuffer::Start(const Options &options, int tileCount) {
+    if (running_) return true;
+    if (tileCount <= 0 || tileCount > MAX_TILES) return false;
+    if (mkdir(options.dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        printf("PreEventBuffer: mkdir %s failed: %s\n", options.dir.c_str(), strerror(errno));
+        return false;
+    }
+    options_ = options;
+    tileCount_ = tileCount;
+    uint32_t perTile = (uint32_t)((uint64_t)options.budgetKB * 1024 / tileCount) & ~3u;
+    rings_.reset(new TileRing[tileCount]);
+    for (int i = 0; i < tileCount; ++i) {
+        rings_[i].data.reset(new uint8_t[perTile]);
+        rings_[i].capacity = perTile;
+    }
+    {
+        std::lock_guard<std::mutex> lk(triggerMtx_);
+        pendingMask_ = 0;
+    }
+    g_exportRequested.store(false, std::memory_order_relaxed);
+    stopping_ = false;
+    running_ = true;
+    worker_ = std::thread(&PreEventBuffer::ExportLoop, this);
+    printf("PreEventBuffer: %dKB over %d tiles (%uKB each), clips %dms before + %dms after -> %s\n",
+           options.budgetKB, tileCount, perTile / 1024, options.preMs, options.postMs, options.dir.c_str());
+    return true;
+}
+
+void PreEventBuffer::Stop() {
+    if (!running_) return;
+    stopping_ = true;
+    if (worker_.joinable()) worker_.join();
+    running_ = false;
+    rings_.reset();
+}
+
+void PreEventBuffer::Append(int tileId, const StreamFrame &frame) {
+    if (!running_ || tileId < 0 || tileId >= tileCount_) return;
+    TileRing &ring = rings_[tileId];
+    std::lock_guard<std::mutex> lk(ring.mtx);
+
+    // 环中第一帧必须是关键帧；单帧超过该路预算只能丢弃
+    if ((ring.waitKeyframe && !frame.keyframe) || frame.bytes > ring.capacity) {
+        ring.waitKeyframe = true;
+        skipped_++;
+        return;
+    }
+    ring.waitKeyframe = false;
+    while (ring.count > 0 && (ring.used + frame.bytes > ring.capacity || ring.count == kMaxFrames)) {
+        DropOldestGop(ring);
+    }
+    // 当前 GOP 本身被淘汰了：剩下的 P 帧没有参考，等下一个关键帧
+    if (ring.count == 0 && !frame.keyframe) {
+        ring.waitKeyframe = true;
+        skipped_++;
+        return;
+    }
+
+    uint32_t offset = (ring.head + ring.used) % ring.capacity;
+    uint32_t pos = offset;
+    for (int i = 0; i < frame.packCount; ++i) {
+        const uint8_t *src = static_cast<const uint8_t *>(frame.iov[i].iov_base);
+        size_t len = frame.iov[i].iov_len;
+        while (len > 0) {
+            size_t n = std::min(len, (size_t)(ring.capacity - pos));
+            memcpy(ring.data.get() + pos, src, n);
+            src += n;
+            len -= n;
+            pos = (pos + (uint32_t)n) % ring.capacity;
+        }
+    }
+    if (ring.count == 0) ring.head = offset;
+    FrameDesc &desc = ring.frames[(ring.first + ring.count) % kMaxFrames];
+    desc.pts = frame.pts;
+    desc.offset = offset;
+    desc.len = frame.bytes;
+    desc.keyframe = frame.keyframe;
+    ring.count++;
+    ring.used += frame.bytes;
+    frames_++;
+    bytes_ += frame.bytes;
+}
+
+// 从队首连同其后的非关键帧一起淘汰，直到下一个关键帧
+void PreEventBuffer::DropOldestGop(TileRing &ring) {
+    do {
+        const FrameDesc &desc = ring.frames[ring.first];
+        ring.used -= desc.len;
+        ring.first = (ring.first + 1) % kMaxFrames;
+        ring.count--;
+    } while (ring.count > 0 && !ring.frames[ring.first].keyframe);
+    if (ring.count > 0) ring.head = ring.frames[ring.first].offset;
+    evictedGops_++;
+}
+
+void PreEventBuffer::CopyOut(const TileRing &ring, uint32_t offset, uint32_t len, uint8_t *out) const {
+    uint32_t n = std::min(len, ring.capacity - offset);
+    memcpy(out, ring.data.get() + offset, n);
+    if (n < len) memcpy(out + n, ring.data.get(), len - n);
+}
+
+void PreEventBuffer::Trigger(TileMask mask, uint64_t nowPts) {
+    if (!running_) return;
+    if (nowPts == 0) nowPts = NowUs();
+    std::lock_guard<std::mutex> lk(triggerMtx_);
+    // 导出前再次触发：合并到同一段，时间窗以第一次触发为准
+    if (pendingMask_ == 0) pendingPts_ = nowPts;
+    pendingMask_ |= mask;
+}
+
+int PreEventBuffer::ExportClip(TileMask mask, uint64_t startPts, uint64_t endPts, const std::string &tag) {
+    if (!running_) return 0;
+    int files = 0;
+    std::vector<uint8_t> clip;
+    for (int tileId = 0; tileId < tileCount_; ++tileId) {
+        if ((mask & TILE_BIT(tileId)) == 0) continue;
+        TileRing &ring = rings_[tileId];
+        clip.clear();
+        {
+            std::lock_guard<std::mutex> lk(ring.mtx);
+            // 起点：startPts 之前（含）最近的关键帧；环中最早的帧已晚于 startPts 时从第一帧开始
+            int begin = 0;
+            for (int i = 0; i < ring.count; ++i) {
+                const FrameDesc &desc = ring.frames[(ring.first + i) % kMaxFrames];
+                if (desc.pts > startPts) break;
+                if (desc.keyframe) begin = i;
+            }
+            // 先算出总长一次性分配，持锁期间只做拷贝
+            int end = begin;
+            size_t total = 0;
+            for (; end < ring.count; ++end) {
+                const FrameDesc &desc = ring.frames[(ring.first + end) % kMaxFrames];
+                if (desc.pts > endPts) break;
+                total += desc.len;
+            }
+            clip.resize(total);
+            size_t at = 0;
+            for (int i = begin; i < end; ++i) {
+                const FrameDesc &desc = ring.frames[(ring.first + i) % kMaxFrames];
+                CopyOut(ring, desc.offset, desc.len, clip.data() + at);
+                at += desc.len;
+            }
+        }
+        if (clip.empty()) continue;
+
+        char name[64];
+        snprintf(name, sizeof(name), "/%s_t%02d.h264", tag.c_str(), tileId);
+        std::string path = options_.dir + name;
+        FILE *fp = fopen(path.c_str(), "wb");
+        if (!fp || fwrite(clip.data(), 1, clip.size(), fp) != clip.size()) {
+            printf("PreEventBuffer: write %s failed: %s\n", path.c_str(), strerror(errno));
+            if (fp) fclose(fp);
+            continue;
+        }
+        fclose(fp);
+        files++;
+        exportedBytes_ += clip.size();
+    }
+    exports_++;
+    return files;
+}
+
+PreEventBuffer::TileUsage PreEventBuffer::Usage(int tileId) {
+    TileUsage usage;
+    if (!running_ || tileId < 0 || tileId >= tileCount_) return usage;
+    TileRing &ring = rings_[tileId];
+    std::lock_guard<std::mutex> lk(ring.mtx);
+    usage.bytes = ring.used;
+    usage.frames = (uint32_t)ring.count;
+    if (ring.count > 1) {
+        usage.spanUs = ring.frames[(ring.first + ring.count - 1) % kMaxFrames].pts - ring.frames[ring.first].pts;
+    }
+    return usage;
+}
+
+PreEventBuffer::Stats PreEventBuffer::GetStats() const {
+    Stats stats;
+    stats.frames = frames_.load();
+    stats.bytes = bytes_.load();
+    stats.evictedGops = evictedGops_.load();
+    stats.skipped = skipped_.load();
+    stats.exports = exports_.load();
+    stats.exportedBytes = exportedBytes_.load();
+    return stats;
+}
+
+void PreEventBuffer::PrintBudget() {
+    if (!running_) return;
+    uint64_t used = 0;
+    uint64_t minSpan = UINT64_MAX;
+    uint64_t sumSpan = 0;
+    for (int i = 0; i < tileCount_; ++i) {
+        TileUsage usage = Usage(i);
+        used += usage.bytes;
+        minSpan = std::min(minSpan, usage.spanUs);
+        sumSpan += usage.spanUs;
+    }
+    printf("[PRE] budget=%dKB used=%lluKB retained min=%.1fs avg=%.1fs (want %.1fs) evicted gops=%llu "
+           "exports=%llu\n",
+           options_.budgetKB, (unsigned long long)(used / 1024), minSpan / 1e6, sumSpan / 1e6 / tileCount_,
+           options_.preMs / 1000.0, (unsigned long long)evictedGops_.load(), (unsigned long long)exports_.load());
+}
+
+void PreEventBuffer::ExportLoop() {
+    while (true) {
+        bool stopping = stopping_.load();
+        if (g_exportRequested.exchange(false, std::memory_order_relaxed)) Trigger(~(TileMask)0);
+
+        uint64_t nowUs = NowUs();
+        TileMask mask = 0;
+        uint64_t triggerPts = 0;
+        {
+            std::lock_guard<std::mutex> lk(triggerMtx_);
+            // 等够触发后的时长再导出；退出时有多少导出多少
+            if (pendingMask_ && (stopping || nowUs >= pendingPts_ + (uint64_t)options_.postMs * 1000)) {
+                mask = pendingMask_;
+                triggerPts = pendingPts_;
+                pendingMask_ = 0;
+            }
+        }
+        if (mask) {
+            uint64_t startPts = triggerPts > (uint64_t)options_.preMs * 1000 ? triggerPts - options_.preMs * 1000ULL : 0;
+            char tag[32];
+            snprintf(tag, sizeof(tag), "clip_%llu", (unsigned long long)(triggerPts / 1000));
+            uint64_t exportedBefore = exportedBytes_.load();
+            int files = ExportClip(mask & (tileCount_ >= 64 ? ~(TileMask)0 : TILE_BIT(tileCount_) - 1), startPts,
+                                   triggerPts + options_.postMs * 1000ULL, tag);
+            printf("[PRE] exported %s: %d files %.1fKB in %lluus\n", tag, files,
+                   (exportedBytes_.load() - exportedBefore) / 1024.0, (unsigned long long)(NowUs() - nowUs));
+        }
+        if (stopping) break;
+        usleep(kExportPollMs * 1000);
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "venc_drain.h"
+
+// 各 tile 最近若干秒码流的内存环形缓冲（事前录像），事件触发时把一段时间窗导出为可播放文件，平时不写 SD 卡
+// - 内存：总预算按 tile 均分，每路一块定长字节环 + 定长帧描述环，运行中不再分配
+// - 追加：回收线程直接从各 pack 的 iov 拷入字节环（一次拷贝，不经中间缓冲）；空间或描述符不够时
+//   从队首整 GOP 淘汰，环中第一帧始终是关键帧；单个 GOP 超过该路预算时清空并等下一个关键帧
+// - 导出：导出线程按 PTS 取 [触发时刻 - preMs, 触发时刻 + postMs]，起点向前对齐到关键帧，
+//   每路写一个 Annex-B .h264 文件（各 pack 本身即带起始码的 NAL），可直接播放
+// - 触发：Trigger 由检测等事件在任意线程调用；RequestPreEventExport 只置标志，可在信号处理函数中调用，
+//   导出全部 tile
+// - 每路持锁只在追加一帧与导出时拷出该路数据期间，导出不会让回收线程等待写文件
+class PreEventBuffer {
+public:
+    struct Options {
+        bool enabled = false;
+        int budgetKB = 8192;  // 所有 tile 合计的内存预算
+        int preMs = 10000;    // 导出触发前多长时间
+        int postMs = 2000;    // 触发后再等多长时间一并导出
+        std::string dir = "/tmp/zwh-clips";
+    };
+
+    // 解析 "off" 或 "<budgetKB>[,<preMs>[,<postMs>[,<目录>]]]"
+    static bool ParseOption(const char *text, Options *out);
+
+    struct TileUsage {
+        uint32_t bytes = 0;
+        uint32_t frames = 0;
+        uint64_t spanUs = 0; // 环中首尾帧 PTS 之差，即可回看的时长
+    };
+
+    struct Stats {
+        uint64_t frames = 0;       // 已追加帧数
+        uint64_t bytes = 0;
+        uint64_t evictedGops = 0;
+        uint64_t skipped = 0;      // 等关键帧跳过的帧数
+        uint64_t exports = 0;
+        uint64_t exportedBytes = 0;
+    };
+
+    ~PreEventBuffer() { Stop(); }
+
+    bool Start(const Options &options, int tileCount);
+    // 处理完已触发的导出后退出
+    void Stop();
+    bool Running() const { return running_; }
+
+    // 回收线程：追加一帧；返回后即可释放码流
+    void Append(int tileId, const StreamFrame &frame);
+
+    // 任意线程：导出 mask 中各路 [nowPts - preMs, nowPts + postMs] 的码流（nowPts 为 0 时取当前时间）
+    void Trigger(TileMask mask, uint64_t nowPts = 0);
+
+    // 立即导出 [startPts, endPts]；返回写出的文件数
+    int ExportClip(TileMask mask, uint64_t startPts, uint64_t endPts, const std::string &tag);
+
+    TileUsage Usage(int tileId);
+    Stats GetStats() const;
+
+    // 打印一行内存预算与各路可回看时长
+    void PrintBudget();
+
+private:
+    static const int kMaxFrames = 2048; // 每路帧描述环长度（30fps 下约 68 秒）
+
+    struct FrameDesc {
+        uint64_t pts;
+        uint32_t offset; // 在字节环中的起始位置
+        uint32_t len;
+        bool keyframe;
+    };
+
+    struct TileRing {
+        std::mutex mtx;
+        std::unique_ptr<uint8_t[]> data;
+        uint32_t capacity = 0;
+        uint32_t head = 0; // 最旧一帧在字节环中的位置
+        uint32_t used = 0;
+        FrameDesc frames[kMaxFrames];
+        int first = 0;     // 最旧一帧在描述环中的下标
+        int count = 0;
+        bool waitKeyframe = true;
+    };
+
+    void DropOldestGop(TileRing &ring);
+    void CopyOut(const TileRing &ring, uint32_t offset, uint32_t len, uint8_t *out) const;
+    void ExportLoop();
+
+    Options options_;
+    bool running_ = false;
+    int tileCount_ = 0;
+    std::unique_ptr<TileRing[]> rings_;
+
+    std::mutex triggerMtx_;
+    TileMask pendingMask_ = 0;
+    uint64_t pendingPts_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::thread worker_;
+
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> evictedGops_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> exports_{0};
+    std::atomic<uint64_t> exportedBytes_{0};
+};
+
+// 请求把全部 tile 的事前录像导出一次（只置标志，可在信号处理函数中调用）
+void RequestPreEventExport();
@@ -0,0 +1,162 @@
+#include "rga_buffer_registry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+
+#ifdef RV1106_1103
+#include "im2d.h"
+#endif
+
+RgaBufferRegistry &GetRgaBufferRegistry() {
+    static RgaBufferRegistry registry;
+    return registry;
+}
+
+static uint64_t NowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+uint64_t ViFrameBytes(const VIDEO_FRAME_INFO_S &frame) {
+    uint64_t wstride = frame.stVFrame.u32VirWidth ? frame.stVFrame.u32VirWidth : SRC_WIDTH;
+    uint64_t hstride = frame.stVFrame.u32VirHeight ? frame.stVFrame.u32VirHeight : SRC_HEIGHT;
+    return wstride * hstride * 3 / 2;
+}
+
+static uint32_t DefaultImport(int fd, uint64_t size) {
+#ifdef RV1106_1103
+    if (fd < 0 || size == 0) return 0;
+    rga_buffer_handle_t handle = importbuffer_fd(fd, (int)size);
+    if (handle == 0) printf("RgaBufferRegistry: importbuffer_fd(%d, %llu) failed\n", fd, (unsigned long long)size);
+    return handle;
+#else
+    // 主机上没有 dma-buf，也没有 RGA
+    (void)fd;
+    (void)size;
+    return 0;
+#endif
+}
+
+static void DefaultRelease(uint32_t handle) {
+#ifdef RV1106_1103
+    releasebuffer_handle(handle);
+#else
+    (void)handle;
+#endif
+}
+
+RgaBufferRegistry::RgaBufferRegistry() : import_(DefaultImport), release_(DefaultRelease) {
+    const char *env = getenv("ZWH_RGA_IMPORT");
+    if (env && strcmp(env, "0") == 0) enabled_ = false;
+}
+
+void RgaBufferRegistry::SetEnabled(bool enabled) {
+    if (!enabled) ReleaseAll();
+    std::lock_guard<std::mutex> lk(mtx_);
+    enabled_ = enabled;
+}
+
+void RgaBufferRegistry::SetImporter(const ImportFn &importFn, const ReleaseFn &releaseFn) {
+    ReleaseAll();
+    std::lock_guard<std::mutex> lk(mtx_);
+    import_ = importFn ? importFn : ImportFn(DefaultImport);
+    release_ = releaseFn ? releaseFn : ReleaseFn(DefaultRelease);
+}
+
+void RgaBufferRegistry::ReleaseLocked(const Entry &entry) {
+    if (entry.handle == 0) return;
+    release_(entry.handle);
+    stats_.releases++;
+}
+
+uint32_t RgaBufferRegistry::Acquire(MB_BLK blk, uint64_t size) {
+    if (!blk) return 0;
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (!enabled_) return 0;
+
+    uint64_t nowUs = NowUs();
+    auto it = entries_.find(blk);
+    if (it != entries_.end()) {
+        if (it->second.size >= size) {
+            stats_.hits++;
+            it->second.lastUseUs = nowUs;
+            return it->second.handle;
+        }
+        // 同一块以更大的尺寸使用：按新尺寸重新导入
+        ReleaseLocked(it->second);
+        entries_.erase(it);
+    }
+
+    if (entries_.size() >= kMaxEntries) EvictLocked(nowUs);
+
+    Entry entry;
+    entry.pool = GetMpiHal()->MbHandle2PoolId(blk);
+    entry.size = size;
+    entry.lastUseUs = nowUs;
+    entry.handle = import_(GetMpiHal()->MbHandle2Fd(blk), size);
+    if (entry.handle) {
+        stats_.imports++;
+    } else {
+        stats_.failures++;
+    }
+    entries_[blk] = entry;
+    return entry.handle;
+}
+
+void RgaBufferRegistry::EvictLocked(uint64_t nowUs) {
+    while (entries_.size() >= kMaxEntries) {
+        auto oldest = entries_.begin();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->second.lastUseUs < oldest->second.lastUseUs) oldest = it;
+        }
+        if (nowUs - oldest->second.lastUseUs < kEvictIdleUs) {
+            if (stats_.overflows++ == 0) {
+                printf("RgaBufferRegistry: %zu blocks registered and all in recent use, growing past %zu\n",
+                       entries_.size(), kMaxEntries);
+            }
+            return;
+        }
+        ReleaseLocked(oldest->second);
+        entries_.erase(oldest);
+        stats_.evictions++;
+    }
+}
+
+void RgaBufferRegistry::ReleasePool(MB_POOL pool) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.pool == pool) {
+            ReleaseLocked(it->second);
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RgaBufferRegistry::ReleaseAll() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (auto &kv : entries_) ReleaseLocked(kv.second);
+    entries_.clear();
+}
+
+RgaBufferRegistry::Stats RgaBufferRegistry::GetStats() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    Stats stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+void RgaBufferRegistry::PrintStats() const {
+    if (!Enabled()) return;
+    Stats s = GetStats();
+    printf("[RGA] handles=%llu imports=%llu failed=%llu hits=%llu releases=%llu evictions=%llu overflows=%llu\n",
+           (unsigned long long)s.entries, (unsigned long long)s.imports, (unsigned long long)s.failures,
+           (unsigned long long)s.hits, (unsigned long long)s.releases, (unsigned long long)s.evictions,
+           (unsigned long long)s.overflows);
+}
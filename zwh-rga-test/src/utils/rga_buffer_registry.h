@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include "hal/mpi_hal.h"
+
+// RGA buffer 注册表：每个 MB 块只向 librga 导入一次（importbuffer_fd），之后按块复用 handle，
+// 裁剪/转色时用 wrapbuffer_handle 描述 buffer，不再每个 tile 都 Handle2Fd + wrapbuffer_fd 让 librga 重新映射 dma-buf
+// - 以 MB_BLK 为键，同时记下所属池；池销毁前由持有者调用 ReleasePool 归还该池的全部 handle，
+//   VI 内部池的块在管线退出时由 ReleaseAll 统一归还
+// - 导入失败（包括主机上没有 dma-buf fd）的块也登记为 handle 0，调用方回退到 fd/虚拟地址，不再反复尝试
+// - 调用方每次用到 handle 都要 Acquire，不要自己缓存：handle 只保证在最近一次 Acquire 之后 kEvictIdleUs 内有效
+// - 登记数达到 kMaxEntries（块句柄意外地一直在变）时按最久未用归还，但只归还闲置超过 kEvictIdleUs 的
+//   （异步提交的 RGA job 可能还在用最近取到的 handle）；都不闲置时暂时超出上限
+// - 环境变量 ZWH_RGA_IMPORT=0 时关闭（Acquire 恒返回 0），用于板端对比导入前后的单次裁剪耗时
+// - 导入/归还函数可替换，主机上用假 handle 验证登记逻辑；可多线程调用
+class RgaBufferRegistry {
+public:
+    typedef std::function<uint32_t(int fd, uint64_t size)> ImportFn;
+    typedef std::function<void(uint32_t handle)> ReleaseFn;
+
+    struct Stats {
+        uint64_t entries = 0;    // 当前登记的块数
+        uint64_t imports = 0;    // 成功导入次数
+        uint64_t failures = 0;   // 导入失败（登记为 handle 0）次数
+        uint64_t hits = 0;       // 命中已登记块的次数
+        uint64_t releases = 0;   // 归还的 handle 数
+        uint64_t evictions = 0;  // 因达到上限按最久未用归还的 handle 数
+        uint64_t overflows = 0;  // 达到上限但没有可归还的闲置 handle、只能继续登记的次数
+    };
+
+    static const size_t kMaxEntries = 256;
+    static const uint64_t kEvictIdleUs = 1000000;
+
+    RgaBufferRegistry();
+    ~RgaBufferRegistry() { ReleaseAll(); }
+
+    bool Enabled() const { return enabled_; }
+    void SetEnabled(bool enabled);
+
+    // 替换导入/归还函数（先归还已登记的 handle）；传空函数恢复默认的 librga 实现
+    void SetImporter(const ImportFn &importFn, const ReleaseFn &releaseFn);
+
+    // 取块 blk 的 RGA handle，未登记时按 size 字节导入；返回 0 表示只能用 fd/虚拟地址
+    uint32_t Acquire(MB_BLK blk, uint64_t size);
+
+    // 归还某个池（MbDestroyPool 之前）或全部块的 handle
+    void ReleasePool(MB_POOL pool);
+    void ReleaseAll();
+
+    Stats GetStats() const;
+
+    // 打印一行登记统计
+    void PrintStats() const;
+
+private:
+    struct Entry {
+        MB_POOL pool;
+        uint32_t handle;
+        uint64_t size;
+        uint64_t lastUseUs;
+    };
+
+    void ReleaseLocked(const Entry &entry);
+    // 登记数达到上限时归还最久未用且已闲置的 handle
+    void EvictLocked(uint64_t nowUs);
+
+    bool enabled_ = true;
+    ImportFn import_;
+    ReleaseFn release_;
+
+    mutable std::mutex mtx_;
+    std::unordered_map<MB_BLK, Entry> entries_;
+    Stats stats_;
+};
+
+RgaBufferRegistry &GetRgaBufferRegistry();
+
+// VI 帧 NV12 数据的字节数（按虚宽高，未填时按源尺寸），用作导入 VI 块的大小
+uint64_t ViFrameBytes(const VIDEO_FRAME_INFO_S &frame);
@@ -1,17 +1,21 @@
 #pragma once
 
+#include <stddef.h>
+#include <memory>
 #include <vector>
 #include "rtsp_demo.h"
 #include "config.h"
+#include "rtsp_service.h"
 
 // RTSP 相关上下文
 struct RtspContext {
     rtsp_demo_handle demo = NULL;
-    std::vector<rtsp_session_handle> sessions;
+    std::vector<int> sessions;            // 各 tile 在 service 中的会话编号，创建失败为 -1
+    std::unique_ptr<RtspService> service; // 码流经 service->Submit 投递，rtsp_demo 只在服务线程中调用
 };
 
-// 初始化 RTSP 服务与会话
-bool InitRtsp(RtspContext &ctx);
+// 初始化 RTSP 服务与会话，并启动 RTSP 服务线程
+bool InitRtsp(RtspContext &ctx, const RtspService::Options &options = RtspService::Options());
 
-// 释放 RTSP 资源
+// 停止服务线程并释放 RTSP 资源
 void CleanupRtsp(RtspContext &ctx);
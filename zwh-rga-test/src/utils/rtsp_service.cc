@@ -0,0 +1,329 @@
+#include "rtsp_service.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hal/mpi_hal.h"
+
+static uint64_t NowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+bool RtspService::ParseOption(const char *text, Options *out) {
+    if (!text || !out) return false;
+    char *end = NULL;
+    long frames = strtol(text, &end, 10);
+    if (end == text || frames <= 0) return false;
+    long kb = out->queueKB;
+    if (*end == ',') {
+        const char *next = end + 1;
+        kb = strtol(next, &end, 10);
+        if (end == next || kb <= 0) return false;
+    }
+    if (*end != '\0') return false;
+    out->queueFrames = (int)frames;
+    out->queueKB = (int)kb;
+    return true;
+}
+
+bool RtspService::Start(rtsp_demo_handle demo, const Options &options) {
+    if (running_) return true;
+    if (!demo || options.ringSlots <= 0) return false;
+
+    demo_ = demo;
+    options_ = options;
+
+    size_t slots = 1;
+    while (slots < (size_t)options.ringSlots) slots <<= 1;
+    ring_.reset(new Slot[slots]);
+    for (size_t i = 0; i < slots; ++i) ring_[i].seq.store(i, std::memory_order_relaxed);
+    ringMask_ = slots - 1;
+    tail_.store(0);
+    head_ = 0;
+
+    eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = eventFd_;
+    if (eventFd_ < 0 || epollFd_ < 0 || epoll_ctl(epollFd_, EPOLL_CTL_ADD, eventFd_, &ev) != 0) {
+        printf("RtspService: epoll setup failed: %s\n", strerror(errno));
+        if (eventFd_ >= 0) close(eventFd_);
+        if (epollFd_ >= 0) close(epollFd_);
+        eventFd_ = epollFd_ = -1;
+        return false;
+    }
+
+    running_ = true;
+    worker_ = std::thread(&RtspService::ServiceLoop, this);
+    printf("RtspService: ring %zu slots, per-session queue %d frames / %d KB\n", slots, options_.queueFrames,
+           options_.queueKB);
+    return true;
+}
+
+void RtspService::Stop() {
+    if (!running_) return;
+    running_ = false;
+    uint64_t one = 1;
+    if (write(eventFd_, &one, sizeof(one)) != sizeof(one)) {
+        // 写失败时服务线程最迟 pollMs 后自行退出
+    }
+    if (worker_.joinable()) worker_.join();
+    close(epollFd_);
+    close(eventFd_);
+    epollFd_ = eventFd_ = -1;
+    for (int i = 0; i < sessionCount_.load(); ++i) {
+        sessions_[i]->queue.clear();
+        sessions_[i]->queuedBytes = 0;
+    }
+    spares_.clear();
+}
+
+int RtspService::NewSession(const char *path, int vencChn) {
+    std::lock_guard<std::mutex> lk(apiMtx_);
+    int id = sessionCount_.load();
+    if (!demo_ || !path || id >= kMaxSessions) return -1;
+    rtsp_session_handle handle = rtsp_new_session(demo_, path);
+    if (!handle) return -1;
+    rtsp_set_video(handle, RTSP_CODEC_ID_VIDEO_H264, NULL, 0);
+    rtsp_sync_video_ts(handle, rtsp_get_reltime(), rtsp_get_ntptime());
+    sessions_[id].reset(new Session());
+    sessions_[id]->handle = handle;
+    sessions_[id]->vencChn = vencChn;
+    sessionCount_.store(id + 1, std::memory_order_release); // 发布后生产者才可能投递到该会话
+    return id;
+}
+
+bool RtspService::Submit(int session, const StreamFrame &frame) {
+    if (!running_ || session < 0 || session >= sessionCount_.load(std::memory_order_acquire)) return false;
+
+    // 有界多生产者队列：槽位 seq 等于 pos 表示空闲，等于 pos + 1 表示已写入待取
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+        slot = &ring_[pos & ringMask_];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // 服务线程跟不上：丢弃本帧，该会话之后从关键帧恢复
+            sessions_[session]->lost.store(true, std::memory_order_relaxed);
+            ringDrops_++;
+            return false;
+        } else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->session = session;
+    slot->pts = frame.pts;
+    slot->keyframe = frame.keyframe;
+    slot->data.clear();
+    for (int i = 0; i < frame.packCount; ++i) {
+        const uint8_t *base = static_cast<const uint8_t *>(frame.iov[i].iov_base);
+        slot->data.insert(slot->data.end(), base, base + frame.iov[i].iov_len);
+    }
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    // 服务线程已被唤醒且尚未取队列时不必重复写 eventfd
+    if (!wakePending_.exchange(true, std::memory_order_acq_rel)) {
+        uint64_t one = 1;
+        if (write(eventFd_, &one, sizeof(one)) != sizeof(one)) {
+            // eventfd 计数溢出才会失败，服务线程仍会在 pollMs 内取走
+        }
+    }
+    return true;
+}
+
+RtspService::Stats RtspService::GetStats() const {
+    Stats stats;
+    stats.frames = frames_.load();
+    stats.bytes = bytes_.load();
+    stats.ringDrops = ringDrops_.load();
+    stats.gopDrops = gopDrops_.load();
+    stats.droppedFrames = droppedFrames_.load();
+    stats.keyframeRequests = keyframeRequests_.load();
+    stats.keyframeThrottled = keyframeThrottled_.load();
+    stats.refreshSkips = refreshSkips_.load();
+    return stats;
+}
+
+void RtspService::ServiceLoop() {
+    struct epoll_event ev;
+    lastReportUs_ = NowUs();
+    while (running_) {
+        int n = epoll_wait(epollFd_, &ev, 1, options_.pollMs);
+        if (n < 0 && errno != EINTR) {
+            printf("RtspService: epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+        if (n > 0) {
+            uint64_t cnt;
+            ssize_t r = read(eventFd_, &cnt, sizeof(cnt));
+            (void)r;
+        }
+        wakePending_.store(false, std::memory_order_release);
+        DrainRing();
+
+        // 每轮每个会话最多发一帧，轮间处理 RTSP 事件并收新帧：一个会话积压不会饿死其它会话和握手
+        bool pending = true;
+        while (pending && running_) {
+            pending = false;
+            int count = sessionCount_.load(std::memory_order_acquire);
+            for (int i = 0; i < count; ++i) {
+                Session &s = *sessions_[i];
+                if (s.queue.empty()) continue;
+                Packet &pkt = s.queue.front();
+                {
+                    std::lock_guard<std::mutex> lk(apiMtx_);
+                    rtsp_tx_video(s.handle, pkt.data.data(), (int)pkt.data.size(), pkt.pts);
+                }
+                frames_++;
+                bytes_ += pkt.data.size();
+                s.queuedBytes -= pkt.data.size();
+                Recycle(pkt.data);
+                s.queue.pop_front();
+                pending = pending || !s.queue.empty();
+            }
+            {
+                std::lock_guard<std::mutex> lk(apiMtx_);
+                rtsp_do_event(demo_);
+            }
+            if (DrainRing()) pending = true;
+            Report(NowUs());
+        }
+    }
+}
+
+// 把环形队列中已写入的帧全部转入各会话队列；返回是否取到了帧
+bool RtspService::DrainRing() {
+    bool got = false;
+    while (true) {
+        Slot &slot = ring_[head_ & ringMask_];
+        if (slot.seq.load(std::memory_order_acquire) != head_ + 1) break;
+        Packet pkt;
+        pkt.pts = slot.pts;
+        pkt.keyframe = slot.keyframe;
+        // 与空闲缓冲交换，槽位和会话队列都不必重新分配
+        if (!spares_.empty()) {
+            pkt.data.swap(spares_.back());
+            spares_.pop_back();
+        }
+        pkt.data.swap(slot.data);
+        Session &s = *sessions_[slot.session];
+        slot.seq.store(head_ + ringMask_ + 1, std::memory_order_release);
+        head_++;
+        Enqueue(s, pkt);
+        got = true;
+    }
+    return got;
+}
+
+void RtspService::Enqueue(Session &s, Packet &pkt) {
+    s.sinceKeyframe = pkt.keyframe ? 0 : s.sinceKeyframe + 1;
+    // 生产者丢过帧：之后的帧参考关系已断
+    if (s.lost.exchange(false, std::memory_order_relaxed) && !s.waitKeyframe && !s.waitRefresh) Resync(s);
+    if (s.waitRefresh) {
+        bool cycleStart = options_.refreshFrames > 0 && s.sinceKeyframe % options_.refreshFrames == 0;
+        if (!pkt.keyframe && !cycleStart) {
+            droppedFrames_++;
+            Recycle(pkt.data);
+            return;
+        }
+        s.waitRefresh = false;
+    }
+    if (s.waitKeyframe) {
+        if (!pkt.keyframe) {
+            droppedFrames_++;
+            Recycle(pkt.data);
+            return;
+        }
+        s.waitKeyframe = false;
+    }
+
+    bool overflow = (int)s.queue.size() + 1 > options_.queueFrames ||
+                    s.queuedBytes + pkt.data.size() > (size_t)options_.queueKB * 1024;
+    if (overflow && options_.refreshFrames > 0 && !pkt.keyframe) {
+        // 帧内刷新：已排队的帧保持连续，丢掉本帧及之后的帧直到下一轮刷新
+        droppedFrames_++;
+        Recycle(pkt.data);
+        s.waitRefresh = true;
+        refreshSkips_++;
+        return;
+    }
+    s.queuedBytes += pkt.data.size();
+    s.queue.push_back(std::move(pkt));
+    while (!s.queue.empty() && ((int)s.queue.size() > options_.queueFrames ||
+                                s.queuedBytes > (size_t)options_.queueKB * 1024)) {
+        DropOldestGop(s);
+    }
+}
+
+// 丢掉队首所在的整个 GOP：队首之后直到下一个关键帧的帧都依赖它
+void RtspService::DropOldestGop(Session &s) {
+    do {
+        s.queuedBytes -= s.queue.front().data.size();
+        Recycle(s.queue.front().data);
+        s.queue.pop_front();
+        droppedFrames_++;
+    } while (!s.queue.empty() && !s.queue.front().keyframe);
+    gopDrops_++;
+    if (s.queue.empty()) Resync(s);
+}
+
+void RtspService::Resync(Session &s) {
+    if (options_.refreshFrames > 0) {
+        s.waitRefresh = true;
+        refreshSkips_++;
+    } else {
+        WaitKeyframe(s);
+    }
+}
+
+// 每次进入等关键帧状态最多请求一次，且同一会话 idrIntervalMs 内只请求一次：编码通道由所有观看者共用，
+// 一个持续跟不上的客户端不能让整路频繁出 IDR。tile 通道的额外 IDR 会让该路 GOP 重新计数，错开相位随之偏移一次
+void RtspService::WaitKeyframe(Session &s) {
+    s.waitKeyframe = true;
+    if (s.vencChn < 0) return;
+    uint64_t nowUs = NowUs();
+    if (s.lastIdrRequestUs && nowUs - s.lastIdrRequestUs < (uint64_t)options_.idrIntervalMs * 1000) {
+        keyframeThrottled_++;
+        return;
+    }
+    if (GetMpiHal()->VencRequestIDR(s.vencChn, RK_TRUE) == RK_SUCCESS) {
+        keyframeRequests_++;
+        s.lastIdrRequestUs = nowUs;
+    }
+}
+
+void RtspService::Recycle(std::vector<uint8_t> &data) {
+    if (data.capacity() == 0) return;
+    spares_.emplace_back();
+    spares_.back().swap(data);
+}
+
+// 有丢帧时按周期打印一行，正常运行不输出
+void RtspService::Report(uint64_t nowUs) {
+    if (nowUs - lastReportUs_ < kReportIntervalUs) return;
+    lastReportUs_ = nowUs;
+    uint64_t drops = ringDrops_.load() + droppedFrames_.load();
+    if (drops == reportedDrops_) return;
+    reportedDrops_ = drops;
+    Stats stats = GetStats();
+    printf("[RTSP] sent=%llu ring drops=%llu gop drops=%llu dropped frames=%llu idr requests=%llu "
+           "(throttled %llu) refresh skips=%llu\n",
+           (unsigned long long)stats.frames, (unsigned long long)stats.ringDrops,
+           (unsigned long long)stats.gopDrops, (unsigned long long)stats.droppedFrames,
+           (unsigned long long)stats.keyframeRequests, (unsigned long long)stats.keyframeThrottled,
+           (unsigned long long)stats.refreshSkips);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rtsp_demo.h"
+#include "config.h"
+#include "venc_drain.h"
+
+// RTSP 服务线程：采集/回收线程只把码流投进无锁队列，rtsp_demo 的所有调用都在本线程（或持同一把锁）进行，
+// 客户端握手、RTCP 和慢客户端的发送都不再拖住采集
+// - 投递：多生产者有界环形队列（按槽位序号的 CAS），槽位缓冲复用；队列满时丢弃本帧并记下该会话丢帧，
+//   之后该会话等到下一个关键帧再继续，从不阻塞生产者
+// - 服务线程：epoll 等待生产者的 eventfd，超时（pollMs）也醒来调用 rtsp_do_event，RTSP 响应不再依赖帧率；
+//   从环形队列取出的帧按会话进入各自的有界队列，再轮流每个会话发一帧
+// - 会话队列超过帧数或字节上限时丢弃最旧的整个 GOP（直到下一个关键帧）；整队丢空时进入等关键帧状态，
+//   并请求该会话对应的编码通道出 IDR。编码通道被多个观看者共用，同一会话两次请求至少间隔 idrIntervalMs，
+//   间隔内只等自然出现的关键帧
+// - 帧内刷新模式（refreshFrames > 0）下 GOP 比会话队列长得多，按 GOP 丢会整队清空：改为丢弃最新的帧，
+//   直到下一轮刷新开始（距上个关键帧的帧数整除 refreshFrames）再继续，之后一轮刷新内画面自行恢复，不请求 IDR
+// rtsp_demo 不暴露内部 socket，因此 epoll 只能等生产者事件，客户端事件由 rtsp_do_event 按 pollMs 轮询
+class RtspService {
+public:
+    struct Options {
+        int queueFrames = 30;  // 每个会话最多积压的帧数
+        int queueKB = 2048;    // 每个会话最多积压的字节数（KB）
+        int ringSlots = 256;   // 生产者到服务线程的环形队列槽位数，向上取 2 的幂
+        int pollMs = 10;       // 无码流时调用 rtsp_do_event 的间隔
+        int idrIntervalMs = 2000; // 同一会话两次请求 IDR 的最小间隔
+        int refreshFrames = 0;    // 编码器为帧内刷新模式时一轮刷新的帧数（GopScheduler 的 gop），0 表示普通 GOP
+    };
+
+    // 解析 "<queueFrames>[,<queueKB>]"
+    static bool ParseOption(const char *text, Options *out);
+
+    struct Stats {
+        uint64_t frames = 0;       // 已发送帧数
+        uint64_t bytes = 0;
+        uint64_t ringDrops = 0;    // 环形队列满而丢弃的帧数
+        uint64_t gopDrops = 0;     // 因会话积压丢弃的 GOP 数
+        uint64_t droppedFrames = 0; // 积压丢弃与等关键帧跳过的帧数
+        uint64_t keyframeRequests = 0;
+        uint64_t keyframeThrottled = 0; // 因间隔限制没有发出的 IDR 请求
+        uint64_t refreshSkips = 0;      // 帧内刷新模式下进入"丢到下一轮刷新"的次数
+    };
+
+    ~RtspService() { Stop(); }
+
+    bool Start(rtsp_demo_handle demo, const Options &options);
+    // 退出服务线程，未发出的帧直接丢弃；demo 与会话由调用方释放
+    void Stop();
+
+    // 新建会话（H264），任意线程可调用；vencChn 为供流的编码通道，丢帧后向它请求 IDR（-1 不请求）
+    // 返回会话编号，失败返回 -1
+    int NewSession(const char *path, int vencChn);
+
+    // 生产者：把一帧所有 pack 拷入环形队列，调用返回后即可释放码流；队列满返回 false
+    bool Submit(int session, const StreamFrame &frame);
+
+    Stats GetStats() const;
+
+private:
+    static const int kMaxSessions = MAX_TILES + 2;
+    static const uint64_t kReportIntervalUs = 5000000;
+
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        int session = 0;
+        uint64_t pts = 0;
+        bool keyframe = false;
+        std::vector<uint8_t> data;
+    };
+
+    struct Packet {
+        uint64_t pts;
+        bool keyframe;
+        std::vector<uint8_t> data;
+    };
+
+    struct Session {
+        rtsp_session_handle handle = NULL;
+        int vencChn = -1;
+        std::atomic<bool> lost{false}; // 生产者因环形队列满丢过帧
+        // 以下只在服务线程中访问
+        std::deque<Packet> queue;
+        size_t queuedBytes = 0;
+        bool waitKeyframe = false;
+        bool waitRefresh = false;      // 帧内刷新模式：丢帧直到下一轮刷新开始
+        uint32_t sinceKeyframe = 0;    // 距上个关键帧到达的帧数（含丢弃的帧）
+        uint64_t lastIdrRequestUs = 0;
+    };
+
+    void ServiceLoop();
+    bool DrainRing();
+    void Enqueue(Session &s, Packet &pkt);
+    void DropOldestGop(Session &s);
+    // 参考关系已断：普通 GOP 等关键帧（限频请求 IDR），帧内刷新模式等下一轮刷新
+    void Resync(Session &s);
+    void WaitKeyframe(Session &s);
+    void Recycle(std::vector<uint8_t> &data);
+    void Report(uint64_t nowUs);
+
+    rtsp_demo_handle demo_ = NULL;
+    Options options_;
+    std::mutex apiMtx_; // 保护所有 rtsp_demo 调用
+
+    std::unique_ptr<Slot[]> ring_;
+    size_t ringMask_ = 0;
+    std::atomic<size_t> tail_{0};
+    size_t head_ = 0; // 服务线程独占
+
+    std::unique_ptr<Session> sessions_[kMaxSessions];
+    std::atomic<int> sessionCount_{0};
+    std::vector<std::vector<uint8_t>> spares_; // 服务线程独占的空闲缓冲
+
+    int epollFd_ = -1;
+    int eventFd_ = -1;
+    std::atomic<bool> wakePending_{false};
+    std::atomic<bool> running_{false};
+    std::thread worker_;
+
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> ringDrops_{0};
+    std::atomic<uint64_t> gopDrops_{0};
+    std::atomic<uint64_t> droppedFrames_{0};
+    std::atomic<uint64_t> keyframeRequests_{0};
+    std::atomic<uint64_t> keyframeThrottled_{0};
+    std::atomic<uint64_t> refreshSkips_{0};
+    uint64_t lastReportUs_ = 0;
+    uint64_t reportedDrops_ = 0;
+};
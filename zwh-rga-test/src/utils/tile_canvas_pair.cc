@@ -0,0 +1,125 @@
+#include "tile_canvas_pair.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "cache_sync.h"
+#include "nv12_blit.h"
+
+static int PopCount(TileMask mask) {
+    return __builtin_popcountll((unsigned long long)mask);
+}
+
+bool TileCanvasPair::Init(MB_POOL pool) {
+    Destroy();
+    const size_t frameBytes = SRC_WIDTH * SRC_HEIGHT * 3 / 2;
+    for (int i = 0; i < 2; ++i) {
+        Canvas &c = canvases_[i];
+        c.blk = GetMpiHal()->MbGetMB(pool, frameBytes, RK_TRUE);
+        c.vir = c.blk != MB_INVALID_HANDLE ? static_cast<uint8_t *>(GetMpiHal()->MbHandle2VirAddr(c.blk)) : nullptr;
+        if (!c.vir) {
+            printf("TileCanvasPair: get canvas %d failed\n", i);
+            Destroy();
+            return false;
+        }
+        Nv12Rect whole;
+        whole.w = SRC_WIDTH;
+        whole.h = SRC_HEIGHT;
+        Nv12Fill(Nv12At(c.vir, SRC_WIDTH, SRC_HEIGHT), whole, 0, 128, 128);
+        GetCacheSync().CpuWrote(c.blk, 0, frameBytes);
+        GetCacheSync().BeginDeviceAccess(c.blk);
+        c.stale = 0;
+        c.black = GetGridConfig().AllTilesMask();
+    }
+    last_ = 1;
+    return true;
+}
+
+void TileCanvasPair::Destroy() {
+    for (int i = 0; i < 2; ++i) {
+        Canvas &c = canvases_[i];
+        if (c.blk != MB_INVALID_HANDLE && c.blk) GetMpiHal()->MbReleaseMB(c.blk);
+        c = Canvas();
+    }
+}
+
+// 我们自己持有一份引用；多出来的是 VENC 还没编完
+bool TileCanvasPair::Busy(const Canvas &canvas) const {
+    return GetMpiHal()->MbInquireUserCnt(canvas.blk) > 1;
+}
+
+TileCanvasPair::Canvas *TileCanvasPair::Acquire() {
+    if (!Ready()) return nullptr;
+    int next = last_ ^ 1;
+    if (Busy(canvases_[next])) {
+        if (!Busy(canvases_[last_])) {
+            next = last_;
+        } else {
+            stats_.busyWaits++;
+            window_.busyWaits++;
+            int waitedMs = 0;
+            while (Busy(canvases_[next]) && waitedMs < kBusyWaitMs) {
+                usleep(1000);
+                waitedMs++;
+            }
+            // 等满仍被引用：不能改写 VENC 正在读的画布，本帧丢弃
+            if (Busy(canvases_[next])) {
+                stats_.busyTimeouts++;
+                window_.busyTimeouts++;
+                return nullptr;
+            }
+        }
+    }
+    last_ = next;
+    stats_.frames++;
+    window_.frames++;
+    return &canvases_[next];
+}
+
+TileCanvasPair::Canvas *TileCanvasPair::Peer(const Canvas *canvas) {
+    return canvas == &canvases_[0] ? &canvases_[1] : &canvases_[0];
+}
+
+void TileCanvasPair::MarkChanged(TileMask tiles) {
+    canvases_[0].stale |= tiles;
+    canvases_[1].stale |= tiles;
+}
+
+void TileCanvasPair::MarkWritten(Canvas *canvas, TileMask tiles) {
+    if (!canvas) return;
+    canvas->stale &= ~tiles;
+    stats_.tilesWritten += PopCount(tiles);
+    window_.tilesWritten += PopCount(tiles);
+}
+
+void TileCanvasPair::TileRows(TileMask tiles, int *y0, int *y1) {
+    const GridConfig &grid = GetGridConfig();
+    *y0 = SRC_HEIGHT;
+    *y1 = 0;
+    for (int tileId = 0; tileId < grid.TileCount(); ++tileId) {
+        if ((tiles & TILE_BIT(tileId)) == 0) continue;
+        if (grid.TileY(tileId) < *y0) *y0 = grid.TileY(tileId);
+        if (grid.TileY(tileId) + SUB_HEIGHT > *y1) *y1 = grid.TileY(tileId) + SUB_HEIGHT;
+    }
+}
+
+void TileCanvasPair::CpuWroteTiles(MB_BLK blk, TileMask tiles) {
+    int y0, y1;
+    TileRows(tiles, &y0, &y1);
+    if (y0 >= y1) return;
+    GetCacheSync().CpuWrote(blk, (size_t)y0 * SRC_WIDTH, (size_t)(y1 - y0) * SRC_WIDTH);
+    GetCacheSync().CpuWrote(blk, (size_t)SRC_WIDTH * SRC_HEIGHT + (size_t)(y0 / 2) * SRC_WIDTH,
+                            (size_t)(y1 - y0) / 2 * SRC_WIDTH);
+}
+
+void TileCanvasPair::PrintWindow(const char *tag) {
+    Stats w = window_;
+    window_ = Stats();
+    if (w.frames == 0) return;
+    double tiles = (double)w.tilesWritten / w.frames;
+    double tileMB = SUB_WIDTH * SUB_HEIGHT * 3 / 2 / 1048576.0;
+    printf("[CANVAS] %s: %.1f/%d tiles rewritten per frame, %.2fMB/frame (full redraw %.2fMB), busy waits=%llu "
+           "dropped=%llu\n",
+           tag, tiles, TOTAL_CHNS, tiles * tileMB, SRC_WIDTH * SRC_HEIGHT * 3 / 2 / 1048576.0,
+           (unsigned long long)w.busyWaits, (unsigned long long)w.busyTimeouts);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "config.h"
+#include "hal/mpi_hal.h"
+
+// 两块常驻的 NV12 整幅画布，轮流交给 VENC；每块画布记着哪些 tile 已过期（dirty mask），
+// 合成时只重写过期或需要改涂黑的 tile，其余像素原样保留
+// - MarkChanged：这些 tile 有了新内容，两块画布都标记过期；MarkWritten：这块画布上这些 tile 已是最新
+// - 两块画布时，一块上过期的 tile 在另一块上一定是最新的（写哪块就只清哪块的标记），
+//   没有新数据可写的过期 tile 可以从另一块拷过来
+// - Acquire 优先换另一块；两块都还被 VENC 引用时等它释放（代替原来 MbGetMB 阻塞的反压），
+//   等满 kBusyWaitMs 仍未释放则返回 nullptr 并计数，调用方丢弃本帧
+// - 初始时整幅填黑（Y=0，UV=128）
+// - 只在合成线程内使用，不加锁
+class TileCanvasPair {
+public:
+    struct Canvas {
+        MB_BLK blk = MB_INVALID_HANDLE;
+        uint8_t *vir = nullptr;
+        TileMask stale = 0; // 内容已不是最新的 tile
+        TileMask black = 0; // 当前涂黑的 tile
+    };
+
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t tilesWritten = 0; // 重写的 tile 数（拷贝与涂黑）
+        uint64_t busyWaits = 0;    // 等 VENC 释放画布的次数
+        uint64_t busyTimeouts = 0; // 等满仍未释放而丢帧的次数
+    };
+
+    static const int kBusyWaitMs = 100;
+
+    ~TileCanvasPair() { Destroy(); }
+
+    // 从 pool 取两块画布常驻持有（pool 至少两块，块大小不小于整幅 NV12）
+    bool Init(MB_POOL pool);
+    // 归还两块画布（销毁 pool 之前调用）
+    void Destroy();
+    bool Ready() const { return canvases_[0].vir && canvases_[1].vir; }
+
+    // 取下一块用于本帧合成的画布；两块都等不到 VENC 释放时返回 nullptr
+    Canvas *Acquire();
+    // 另一块画布
+    Canvas *Peer(const Canvas *canvas);
+
+    void MarkChanged(TileMask tiles);
+    void MarkWritten(Canvas *canvas, TileMask tiles);
+
+    // tiles 覆盖的行范围 [*y0, *y1)；tiles 为空时 *y0 >= *y1
+    static void TileRows(TileMask tiles, int *y0, int *y1);
+    // 向 CacheSync 登记 CPU 改写了整幅画布 blk 上 tiles 所在的行（Y 与 UV 平面各一段）
+    static void CpuWroteTiles(MB_BLK blk, TileMask tiles);
+
+    Stats GetStats() const { return stats_; }
+    // 打印本窗口每帧重写的 tile 数与字节数（对比整幅重画），随后清零窗口计数
+    void PrintWindow(const char *tag);
+
+private:
+    bool Busy(const Canvas &canvas) const;
+
+    Canvas canvases_[2];
+    int last_ = 1;
+    Stats stats_;
+    Stats window_;
+};
@@ -0,0 +1,376 @@
+#include "tile_detector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "rga_buffer_registry.h"
+
+#ifdef RV1106_1103
+#include "im2d.h"
+#include "rga.h"
+#endif
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+bool TileDetector::ParseOption(const char *text, Options *out) {
+    if (!text || !out) return false;
+    if (strcmp(text, "off") == 0) {
+        out->enabled = false;
+        return true;
+    }
+    Options parsed = *out;
+    char *end = NULL;
+    long interval = strtol(text, &end, 10);
+    if (end == text || interval <= 0) return false;
+    parsed.intervalMs = (int)interval;
+    if (*end == ',') {
+        const char *source = end + 1;
+        const char *comma = strchr(source, ',');
+        size_t len = comma ? (size_t)(comma - source) : strlen(source);
+        if (len == 5 && strncmp(source, "frame", 5) == 0) {
+            parsed.perTile = false;
+        } else if (len == 5 && strncmp(source, "tiles", 5) == 0) {
+            parsed.perTile = true;
+        } else {
+            return false;
+        }
+        end = const_cast<char *>(source + len);
+        if (*end == ',') {
+            parsed.model = end + 1;
+            end += strlen(end);
+        }
+    }
+    if (*end != '\0' || parsed.model.empty()) return false;
+    parsed.enabled = true;
+    *out = parsed;
+    return true;
+}
+
+bool TileDetector::Start(const Options &options, const GridConfig &grid, NpuBackend *backend,
+                         const Callback &callback) {
+    if (running_) return true;
+    if (!backend || grid.TileCount() <= 0 || grid.TileCount() > MAX_TILES) return false;
+    if (!backend->Load(options.model.c_str(), &model_)) {
+        printf("TileDetector: load %s on %s failed\n", options.model.c_str(), backend->Name());
+        return false;
+    }
+
+    // 输入块按模型行跨度分配 RGB888，整块注册给 NPU
+    MB_POOL_CONFIG_S cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.u64MBSize = (RK_U64)model_.wstride * model_.height * 3;
+    cfg.u32MBCnt = kInputBlocks;
+    cfg.enAllocType = MB_ALLOC_TYPE_DMA;
+    pool_ = GetMpiHal()->MbCreatePool(&cfg);
+    if (pool_ == MB_INVALID_POOLID) {
+        printf("TileDetector: create input pool failed\n");
+        backend->Unload();
+        return false;
+    }
+    free_.clear();
+    inputBytes_ = cfg.u64MBSize;
+    for (int i = 0; i < kInputBlocks; ++i) {
+        blks_[i] = GetMpiHal()->MbGetMB(pool_, cfg.u64MBSize, RK_TRUE);
+        virs_[i] = blks_[i] ? GetMpiHal()->MbHandle2VirAddr(blks_[i]) : NULL;
+        fds_[i] = blks_[i] ? GetMpiHal()->MbHandle2Fd(blks_[i]) : -1;
+        handles_[i] = blks_[i] ? backend->BindInput(blks_[i]) : -1;
+        if (handles_[i] < 0) {
+            printf("TileDetector: input block %d unusable\n", i);
+            backend->Unload();
+            for (int k = 0; k <= i; ++k) {
+                if (blks_[k]) GetMpiHal()->MbReleaseMB(blks_[k]);
+            }
+            GetRgaBufferRegistry().ReleasePool(pool_);
+            GetMpiHal()->MbDestroyPool(pool_);
+            pool_ = MB_INVALID_POOLID;
+            return false;
+        }
+        free_.push_back(i);
+    }
+
+    options_ = options;
+    grid_ = grid;
+    backend_ = backend;
+    callback_ = callback;
+    latest_.assign(grid.TileCount(), Result());
+    dumpPath_ = getenv("ZWH_NPU_DUMP") ? getenv("ZWH_NPU_DUMP") : "";
+    pending_.clear();
+    nextDueUs_ = 0;
+    nextTile_ = 0;
+    stopping_ = false;
+    running_ = true;
+    worker_ = std::thread(&TileDetector::DetectLoop, this);
+    printf("TileDetector: %s every %dms on %s, model input %dx%d\n", options.perTile ? "tiles" : "frame",
+           options.intervalMs, backend->Name(), model_.width, model_.height);
+    return true;
+}
+
+void TileDetector::Stop() {
+    if (!running_) return;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+    running_ = false;
+    // 先注销 NPU 侧的输入，再归还 MB
+    backend_->Unload();
+    GetRgaBufferRegistry().ReleasePool(pool_);
+    for (int i = 0; i < kInputBlocks; ++i) GetMpiHal()->MbReleaseMB(blks_[i]);
+    GetMpiHal()->MbDestroyPool(pool_);
+    pool_ = MB_INVALID_POOLID;
+}
+
+#ifdef RV1106_1103
+static rga_buffer_t WrapNv12(const Nv12Image &img) {
+    int wstride = img.wstride ? img.wstride : img.width;
+    int hstride = img.hstride ? img.hstride : img.height;
+    if (img.handle) {
+        return wrapbuffer_handle(img.handle, img.width, img.height, RK_FORMAT_YCbCr_420_SP, wstride, hstride);
+    }
+    if (img.fd >= 0) {
+        return wrapbuffer_fd(img.fd, img.width, img.height, RK_FORMAT_YCbCr_420_SP, wstride, hstride);
+    }
+    return wrapbuffer_virtualaddr(img.vir, img.width, img.height, RK_FORMAT_YCbCr_420_SP, wstride, hstride);
+}
+#else
+static uint8_t Clip(int v) {
+    return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+#endif
+
+// NV12 源整幅缩放到模型输入尺寸并转 RGB888（拉伸，不保持宽高比；框按两个方向各自的比例映射回去）
+bool TileDetector::Convert(const Nv12Image &src, int input) {
+#ifdef RV1106_1103
+    rga_buffer_t srcBuf = WrapNv12(src);
+    // 每次都向注册表取 handle：注册表可能已归还闲置的 handle，缓存的值不再可靠
+    uint32_t dstHandle = GetRgaBufferRegistry().Acquire(blks_[input], inputBytes_);
+    rga_buffer_t dstBuf = dstHandle
+                              ? wrapbuffer_handle(dstHandle, model_.width, model_.height, RK_FORMAT_RGB_888,
+                                                  model_.wstride, model_.height)
+                              : wrapbuffer_fd(fds_[input], model_.width, model_.height, RK_FORMAT_RGB_888,
+                                              model_.wstride, model_.height);
+    im_rect srcRect = {0, 0, src.width, src.height};
+    im_rect dstRect = {0, 0, model_.width, model_.height};
+    IM_STATUS status = improcess(srcBuf, dstBuf, {}, srcRect, dstRect, {}, -1, NULL, NULL, IM_SYNC);
+    if (status != IM_STATUS_SUCCESS) {
+        printf("TileDetector: improcess failed: %s\n", imStrError(status));
+        return false;
+    }
+    return true;
+#else
+    if (!src.vir || !virs_[input]) return false;
+    int wstride = src.wstride ? src.wstride : src.width;
+    int hstride = src.hstride ? src.hstride : src.height;
+    const uint8_t *y = static_cast<const uint8_t *>(src.vir);
+    const uint8_t *uv = y + (size_t)wstride * hstride;
+    uint8_t *dst = static_cast<uint8_t *>(virs_[input]);
+    for (int row = 0; row < model_.height; ++row) {
+        int sy = row * src.height / model_.height;
+        const uint8_t *yRow = y + (size_t)sy * wstride;
+        const uint8_t *uvRow = uv + (size_t)(sy / 2) * wstride;
+        uint8_t *out = dst + (size_t)row * model_.wstride * 3;
+        for (int col = 0; col < model_.width; ++col) {
+            int sx = col * src.width / model_.width;
+            int c = 298 * (yRow[sx] - 16);
+            int d = uvRow[sx & ~1] - 128;
+            int e = uvRow[(sx & ~1) + 1] - 128;
+            out[col * 3 + 0] = Clip((c + 409 * e + 128) >> 8);
+            out[col * 3 + 1] = Clip((c - 100 * d - 208 * e + 128) >> 8);
+            out[col * 3 + 2] = Clip((c + 516 * d + 128) >> 8);
+        }
+    }
+    return true;
+#endif
+}
+
+bool TileDetector::Offer(const Nv12Image &frame, const Nv12Image *tiles, TileMask tileMask, uint16_t frameSeq,
+                         uint64_t pts) {
+    if (!running_) return false;
+    uint64_t nowUs = GetUs();
+    if (nowUs < nextDueUs_) return false;
+
+    // 逐 tile 模式轮流挑本帧裁剪过的 tile
+    int tileId = -1;
+    const Nv12Image *src = &frame;
+    if (options_.perTile) {
+        int tileCount = grid_.TileCount();
+        for (int i = 0; i < tileCount && tiles; ++i) {
+            int id = (nextTile_ + i) % tileCount;
+            if (tileMask & TILE_BIT(id)) {
+                tileId = id;
+                break;
+            }
+        }
+        if (tileId < 0) return false;
+        src = &tiles[tileId];
+    }
+
+    nextDueUs_ = nowUs + (uint64_t)options_.intervalMs * 1000;
+    int input;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (free_.empty()) {
+            busy_++;
+            return false;
+        }
+        input = free_.back();
+        free_.pop_back();
+    }
+    if (!Convert(*src, input)) {
+        failures_++;
+        std::lock_guard<std::mutex> lk(mtx_);
+        free_.push_back(input);
+        return false;
+    }
+    if (tileId >= 0) nextTile_ = (tileId + 1) % grid_.TileCount();
+
+    Pending job;
+    job.input = input;
+    job.tileId = tileId;
+    job.frameSeq = frameSeq;
+    job.pts = pts;
+    job.offerUs = nowUs;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        pending_.push_back(job);
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void TileDetector::DetectLoop() {
+    DetectList list;
+    while (true) {
+        Pending job;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            cv_.wait(lk, [this] { return stopping_ || !pending_.empty(); });
+            if (pending_.empty()) break;
+            job = pending_.front();
+            pending_.pop_front();
+        }
+
+        uint64_t startUs = GetUs();
+        const NpuTensor *outputs = NULL;
+        int count = 0;
+        bool ok = backend_->Run(handles_[job.input], &outputs, &count);
+        uint64_t inferUs = GetUs() - startUs;
+        if (ok && !dumpPath_.empty() && runs_.load() < (uint64_t)kDumpRuns &&
+            !AppendNpuTensors(dumpPath_.c_str(), outputs, count)) {
+            printf("TileDetector: dump to %s failed\n", dumpPath_.c_str());
+            dumpPath_.clear();
+        }
+        uint64_t decodeStartUs = GetUs();
+        if (ok) {
+            decoder_.Decode(outputs, count, model_.width, model_.height, options_.confThresh, options_.nmsThresh,
+                            &list);
+        }
+        uint64_t decodeUs = GetUs() - decodeStartUs;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            free_.push_back(job.input);
+        }
+        if (!ok) {
+            failures_++;
+            continue;
+        }
+
+        runs_++;
+        objects_ += list.count;
+        inferUsTotal_ += inferUs;
+        decodeUsTotal_ += decodeUs;
+        if (inferUs > maxInferUs_.load()) maxInferUs_.store(inferUs);
+        Publish(job, list);
+    }
+}
+
+// 框从模型坐标映射回源画面；整帧模式按框中心归到 tile 并换成 tile 内坐标，每个 tile 都发布一次（可能为空）
+void TileDetector::Publish(const Pending &job, const DetectList &list) {
+    int tileCount = grid_.TileCount();
+    int srcW = job.tileId >= 0 ? grid_.tileWidth : grid_.srcWidth;
+    int srcH = job.tileId >= 0 ? grid_.tileHeight : grid_.srcHeight;
+    float sx = (float)srcW / model_.width;
+    float sy = (float)srcH / model_.height;
+
+    std::vector<Result> results(job.tileId >= 0 ? 1 : tileCount);
+    for (size_t i = 0; i < results.size(); ++i) {
+        results[i].tileId = job.tileId >= 0 ? job.tileId : (int)i;
+        results[i].frameSeq = job.frameSeq;
+        results[i].pts = job.pts;
+    }
+    for (int i = 0; i < list.count; ++i) {
+        DetectBox box = list.boxes[i];
+        box.left = (int)(box.left * sx);
+        box.right = (int)(box.right * sx);
+        box.top = (int)(box.top * sy);
+        box.bottom = (int)(box.bottom * sy);
+        Result *result = &results[0];
+        if (job.tileId < 0) {
+            int col = (box.left + box.right) / 2 / grid_.tileWidth;
+            int row = (box.top + box.bottom) / 2 / grid_.tileHeight;
+            if (col >= grid_.cols || row >= grid_.rows) continue; // 落在网格之外未切分的边角
+            int tileId = row * grid_.cols + col;
+            result = &results[tileId];
+            int x0 = grid_.TileX(tileId);
+            int y0 = grid_.TileY(tileId);
+            box.left = std::max(box.left - x0, 0);
+            box.top = std::max(box.top - y0, 0);
+            box.right = std::min(box.right - x0, grid_.tileWidth - 1);
+            box.bottom = std::min(box.bottom - y0, grid_.tileHeight - 1);
+        }
+        if (result->count < kMaxTileBoxes) result->boxes[result->count++] = box;
+    }
+
+    uint64_t nowUs = GetUs();
+    latencyUsTotal_ += nowUs - job.offerUs;
+    {
+        std::lock_guard<std::mutex> lk(resultMtx_);
+        for (size_t i = 0; i < results.size(); ++i) {
+            results[i].latencyUs = nowUs - job.offerUs;
+            latest_[results[i].tileId] = results[i];
+        }
+    }
+    if (callback_) {
+        for (size_t i = 0; i < results.size(); ++i) callback_(results[i]);
+    }
+}
+
+bool TileDetector::Latest(int tileId, Result *out) {
+    std::lock_guard<std::mutex> lk(resultMtx_);
+    if (tileId < 0 || tileId >= (int)latest_.size() || latest_[tileId].tileId < 0) return false;
+    *out = latest_[tileId];
+    return true;
+}
+
+TileDetector::Stats TileDetector::GetStats() const {
+    Stats stats;
+    stats.runs = runs_.load();
+    stats.busy = busy_.load();
+    stats.failures = failures_.load();
+    stats.objects = objects_.load();
+    stats.avgInferUs = stats.runs ? inferUsTotal_.load() / stats.runs : 0;
+    stats.maxInferUs = maxInferUs_.load();
+    stats.avgDecodeUs = stats.runs ? decodeUsTotal_.load() / stats.runs : 0;
+    stats.avgLatencyUs = stats.runs ? latencyUsTotal_.load() / stats.runs : 0;
+    return stats;
+}
+
+void TileDetector::PrintWindow() {
+    if (!running_) return;
+    Stats s = GetStats();
+    printf("[DETECT] runs=%llu busy=%llu failures=%llu objects=%llu infer avg=%lluus max=%lluus decode avg=%lluus "
+           "latency avg=%lluus\n",
+           (unsigned long long)s.runs, (unsigned long long)s.busy, (unsigned long long)s.failures,
+           (unsigned long long)s.objects, (unsigned long long)s.avgInferUs, (unsigned long long)s.maxInferUs,
+           (unsigned long long)s.avgDecodeUs, (unsigned long long)s.avgLatencyUs);
+}
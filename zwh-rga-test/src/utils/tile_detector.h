@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "hal/npu_backend.h"
+#include "tile_slicer.h"
+#include "yolo_decode.h"
+
+// 目标检测：按固定间隔取一个 tile（轮流）或缩放后的整帧送 NPU，与编码帧率解耦
+// - 输入：启动时从 MB 池取 kInputBlocks 块模型尺寸的 RGB888 缓冲，逐块向后端注册一次；
+//   采集线程到点时用 RGA 把 NV12 源一步缩放 + 转色写进空闲块（NPU 直接读该块，不经 CPU 拷贝），
+//   没有空闲块（NPU 跟不上）时本次跳过，从不阻塞采集线程
+// - 推理：检测线程串行 Run + 解码（int8 域判阈值的快速解码），框按比例映射回源画面；整帧模式按框中心分到各 tile
+// - 环境变量 ZWH_NPU_DUMP=<文件> 时把前 kDumpRuns 次推理的原始输出追加到该文件，供 bench_postprocess 回放
+// - 结果：按 tile 发布（tile 内坐标，附 frameSeq/PTS），回调在检测线程中调用，也可随时查各 tile 最近一次结果
+// - 非板端构建缩放转色回退到 CPU 最近邻
+class TileDetector {
+public:
+    struct Options {
+        bool enabled = false;
+        int intervalMs = 200;   // 两次检测的最小间隔
+        bool perTile = false;   // true 时轮流检测各 tile，否则检测缩放后的整帧
+        std::string model = "./model/yolov5.rknn";
+        float confThresh = 0.25f;
+        float nmsThresh = 0.45f;
+    };
+
+    // 解析 "off" 或 "<间隔ms>[,frame|tiles[,<模型路径>]]"
+    static bool ParseOption(const char *text, Options *out);
+
+    static const int kMaxTileBoxes = 32;
+
+    // 单个 tile 的一次检测结果（框为 tile 内坐标）
+    struct Result {
+        int tileId = -1;
+        uint16_t frameSeq = 0;
+        uint64_t pts = 0;
+        uint64_t latencyUs = 0; // 采集线程提交到结果发布
+        int count = 0;
+        DetectBox boxes[kMaxTileBoxes];
+    };
+
+    typedef std::function<void(const Result &)> Callback;
+
+    struct Stats {
+        uint64_t runs = 0;
+        uint64_t busy = 0;       // 到点但没有空闲输入块而跳过的次数
+        uint64_t failures = 0;   // 转色或推理失败
+        uint64_t objects = 0;
+        uint64_t avgInferUs = 0;
+        uint64_t maxInferUs = 0;
+        uint64_t avgDecodeUs = 0;
+        uint64_t avgLatencyUs = 0;
+    };
+
+    ~TileDetector() { Stop(); }
+
+    bool Start(const Options &options, const GridConfig &grid, NpuBackend *backend, const Callback &callback = Callback());
+    // 等检测线程处理完已提交的输入后退出，归还输入块
+    void Stop();
+    bool Running() const { return running_; }
+
+    // 采集线程每帧调用：到了检测时间且有空闲输入块时，把整帧 frame 或 tiles 中轮到的 tile
+    // （只在 tileMask 中挑）转进输入块并提交给检测线程；返回是否提交
+    bool Offer(const Nv12Image &frame, const Nv12Image *tiles, TileMask tileMask, uint16_t frameSeq, uint64_t pts);
+
+    // 某 tile 最近一次检测结果；还没有结果时返回 false
+    bool Latest(int tileId, Result *out);
+
+    Stats GetStats() const;
+
+    // 打印一行检测统计
+    void PrintWindow();
+
+private:
+    static const int kInputBlocks = 2;
+    static const int kDumpRuns = 32;
+
+    struct Pending {
+        int input;
+        int tileId;      // -1 表示整帧
+        uint16_t frameSeq;
+        uint64_t pts;
+        uint64_t offerUs;
+    };
+
+    bool Convert(const Nv12Image &src, int input);
+    void DetectLoop();
+    void Publish(const Pending &job, const DetectList &list);
+
+    Options options_;
+    GridConfig grid_;
+    NpuBackend *backend_ = nullptr;
+    NpuModelInfo model_;
+    Callback callback_;
+    bool running_ = false;
+    YoloV5Decoder decoder_; // 只在检测线程中使用
+    std::string dumpPath_;
+
+    MB_POOL pool_ = MB_INVALID_POOLID;
+    MB_BLK blks_[kInputBlocks];
+    int handles_[kInputBlocks];
+    void *virs_[kInputBlocks];
+    int fds_[kInputBlocks];
+    uint64_t inputBytes_ = 0; // 输入块大小，每次转换时按它向 RgaBufferRegistry 取 handle
+
+    // 采集线程独占
+    uint64_t nextDueUs_ = 0;
+    int nextTile_ = 0;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<int> free_;
+    std::deque<Pending> pending_;
+    bool stopping_ = false;
+    std::thread worker_;
+
+    std::mutex resultMtx_;
+    std::vector<Result> latest_;
+
+    std::atomic<uint64_t> runs_{0};
+    std::atomic<uint64_t> busy_{0};
+    std::atomic<uint64_t> failures_{0};
+    std::atomic<uint64_t> objects_{0};
+    std::atomic<uint64_t> inferUsTotal_{0};
+    std::atomic<uint64_t> maxInferUs_{0};
+    std::atomic<uint64_t> decodeUsTotal_{0};
+    std::atomic<uint64_t> latencyUsTotal_{0};
+};
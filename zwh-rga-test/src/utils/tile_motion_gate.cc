@@ -0,0 +1,151 @@
+#include "tile_motion_gate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool TileMotionGate::ParseOption(const char *text, Options *out) {
+    if (!text || !out) return false;
+    if (strcmp(text, "off") == 0 || strcmp(text, "0") == 0) {
+        out->enabled = false;
+        return true;
+    }
+    char *end = NULL;
+    long threshold = strtol(text, &end, 10);
+    if (end == text || threshold <= 0 || threshold > 255) return false;
+    long refresh = out->refreshFrames;
+    if (*end == ',') {
+        const char *next = end + 1;
+        refresh = strtol(next, &end, 10);
+        if (end == next || refresh < 0) return false;
+    }
+    if (*end != '\0') return false;
+    out->enabled = true;
+    out->threshold = (int)threshold;
+    out->refreshFrames = (int)refresh;
+    return true;
+}
+
+bool TileMotionGate::Init(const GridConfig &grid, const Options &options) {
+    options_ = options;
+    grid_ = grid;
+    if (options_.sampleStep <= 0) options_.sampleStep = 8;
+    samplesX_ = grid.tileWidth / options_.sampleStep;
+    samplesY_ = grid.tileHeight / options_.sampleStep;
+    if (samplesX_ <= 0 || samplesY_ <= 0) {
+        printf("TileMotionGate: tile %dx%d too small for sample step %d\n",
+               grid.tileWidth, grid.tileHeight, options_.sampleStep);
+        return false;
+    }
+    size_t perTile = (size_t)samplesX_ * samplesY_;
+    ref_.assign(perTile * grid.TileCount(), 0);
+    cur_.assign(perTile, 0);
+    stats_.reset(new TileStat[grid.TileCount()]);
+    // 静止 tile 的刷新按 tileId 错开，避免同一帧集中刷新
+    if (options_.refreshFrames > 0) {
+        for (int i = 0; i < grid.TileCount(); ++i) {
+            stats_[i].framesSinceSent = i % options_.refreshFrames;
+        }
+    }
+    hasRef_ = false;
+    if (options_.enabled) {
+        printf("TileMotionGate: threshold=%d refresh=%d frames, %dx%d samples per tile\n",
+               options_.threshold, options_.refreshFrames, samplesX_, samplesY_);
+    }
+    return true;
+}
+
+void TileMotionGate::Sample(const uint8_t *y, int stride, int tileId, uint8_t *out) const {
+    const uint8_t *base = y + (size_t)grid_.TileY(tileId) * stride + grid_.TileX(tileId);
+    int step = options_.sampleStep;
+    for (int sy = 0; sy < samplesY_; ++sy) {
+        const uint8_t *row = base + (size_t)(sy * step + step / 2) * stride + step / 2;
+        for (int sx = 0; sx < samplesX_; ++sx) {
+            *out++ = row[sx * step];
+        }
+    }
+}
+
+TileMask TileMotionGate::Select(const uint8_t *y, int stride, TileMask candidates) {
+    if (!options_.enabled || !y || !stats_) return candidates;
+
+    size_t perTile = cur_.size();
+    uint32_t limit = (uint32_t)options_.threshold * (uint32_t)perTile;
+    TileMask selected = 0;
+    for (int tileId = 0; tileId < grid_.TileCount(); ++tileId) {
+        if ((candidates & TILE_BIT(tileId)) == 0) continue;
+        TileStat &stat = stats_[tileId];
+        stat.windowFrames++;
+
+        uint8_t *ref = &ref_[tileId * perTile];
+        Sample(y, stride, tileId, cur_.data());
+        bool send = !hasRef_ ||
+                    (options_.refreshFrames > 0 && stat.framesSinceSent + 1 >= (uint32_t)options_.refreshFrames);
+        if (!send) {
+            uint32_t sad = 0;
+            for (size_t i = 0; i < perTile && sad <= limit; ++i) {
+                sad += (uint32_t)abs((int)cur_[i] - (int)ref[i]);
+            }
+            send = sad > limit;
+        }
+
+        if (send) {
+            memcpy(ref, cur_.data(), perTile);
+            stat.framesSinceSent = 0;
+            stat.windowSent++;
+            selected |= TILE_BIT(tileId);
+        } else {
+            stat.framesSinceSent++;
+        }
+    }
+    hasRef_ = true;
+    return selected;
+}
+
+void TileMotionGate::RecordEncoded(int tileId, uint32_t bytes, uint64_t encodeUs) {
+    if (!stats_ || tileId < 0 || tileId >= grid_.TileCount()) return;
+    TileStat &stat = stats_[tileId];
+    stat.encodedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    stat.encodedUs.fetch_add(encodeUs, std::memory_order_relaxed);
+    stat.encodedCnt.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TileMotionGate::PrintWindow(uint64_t windowMs) {
+    if (!options_.enabled || !stats_ || windowMs == 0) return;
+
+    double secs = windowMs / 1000.0;
+    uint64_t frames = 0;
+    uint64_t sent = 0;
+    double savedBytes = 0;
+    double savedUs = 0;
+    char perTile[16 * MAX_TILES];
+    int len = 0;
+    for (int tileId = 0; tileId < grid_.TileCount(); ++tileId) {
+        TileStat &stat = stats_[tileId];
+        uint64_t cnt = stat.encodedCnt.exchange(0, std::memory_order_relaxed);
+        uint64_t bytes = stat.encodedBytes.exchange(0, std::memory_order_relaxed);
+        uint64_t us = stat.encodedUs.exchange(0, std::memory_order_relaxed);
+        if (cnt > 0) {
+            // 跨窗口平滑，整窗静止时仍能估算
+            stat.avgBytes = stat.avgBytes > 0 ? (stat.avgBytes + (double)bytes / cnt) / 2 : (double)bytes / cnt;
+            stat.avgEncodeUs = stat.avgEncodeUs > 0 ? (stat.avgEncodeUs + (double)us / cnt) / 2 : (double)us / cnt;
+        }
+        uint64_t skipped = stat.windowFrames - stat.windowSent;
+        double tileSavedBytes = skipped * stat.avgBytes;
+        savedBytes += tileSavedBytes;
+        savedUs += skipped * stat.avgEncodeUs;
+        frames += stat.windowFrames;
+        sent += stat.windowSent;
+        if (len < (int)sizeof(perTile)) {
+            len += snprintf(perTile + len, sizeof(perTile) - len, " %d:%llu%%/%.0fK", tileId,
+                            stat.windowFrames ? (unsigned long long)(stat.windowSent * 100 / stat.windowFrames) : 0ULL,
+                            tileSavedBytes / 1024 / secs);
+        }
+        stat.windowFrames = 0;
+        stat.windowSent = 0;
+    }
+    printf("[MOTION] sent %llu/%llu tiles (%.0f%%), saved ~%.1f KB/s, ~%.1f ms/s encoder time\n",
+           (unsigned long long)sent, (unsigned long long)frames, frames ? sent * 100.0 / frames : 0.0,
+           savedBytes / 1024 / secs, savedUs / 1000 / secs);
+    printf("[MOTION] per tile sent%%/saved KB/s:%s\n", perTile);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "config.h"
+
+// 按 tile 的变化检测，决定本帧哪些 tile 需要裁剪/编码/发送
+// - 在 Y 平面上按 sampleStep 间隔抽样，与该 tile 上一次被发送时的抽样比较平均绝对差（SAD）
+//   与"上次发送"而不是"上一帧"比较，缓慢变化也会累积到阈值
+// - 静止 tile 每 refreshFrames 帧强制刷新一次（按 tileId 错开），接收端保留上一次的画面
+// - 统计窗口内按 tile 估算跳过带来的带宽与编码耗时节省（按该 tile 已发送帧的平均值折算）
+class TileMotionGate {
+public:
+    struct Options {
+        bool enabled = true;
+        int sampleStep = 8;     // 抽样间隔（像素），行列相同
+        int threshold = 3;      // 抽样点平均绝对差阈值（0~255），超过即视为变化
+        int refreshFrames = 30; // 静止 tile 的最长刷新间隔（帧），0 表示静止时一直不发
+    };
+
+    // 解析 "off" 或 "<threshold>[,<refreshFrames>]"
+    static bool ParseOption(const char *text, Options *out);
+    // 关闭检测的选项（默认不开启检测的调用方使用）
+    static Options Off() {
+        Options options;
+        options.enabled = false;
+        return options;
+    }
+
+    bool Init(const GridConfig &grid, const Options &options);
+    bool Enabled() const { return options_.enabled; }
+
+    // 采集线程：y 为整帧 Y 平面（CPU 可读），只在 candidates 中挑选，返回本帧要处理的 tile
+    TileMask Select(const uint8_t *y, int stride, TileMask candidates);
+
+    // 回收线程：登记一个 tile 编码后的字节数与送编码到出码流的耗时
+    void RecordEncoded(int tileId, uint32_t bytes, uint64_t encodeUs);
+
+    // 采集线程：打印本窗口的发送比例与估算节省，随后清零窗口计数
+    void PrintWindow(uint64_t windowMs);
+
+private:
+    struct TileStat {
+        uint32_t framesSinceSent = 0;
+        uint64_t windowFrames = 0;  // 本窗口参与判断的帧数
+        uint64_t windowSent = 0;
+        double avgBytes = 0;        // 已发送帧的平均码流字节数（跨窗口平滑）
+        double avgEncodeUs = 0;
+        std::atomic<uint64_t> encodedBytes{0}; // 回收线程累加，窗口结束时取走
+        std::atomic<uint64_t> encodedUs{0};
+        std::atomic<uint64_t> encodedCnt{0};
+    };
+
+    void Sample(const uint8_t *y, int stride, int tileId, uint8_t *out) const;
+
+    Options options_;
+    GridConfig grid_;
+    int samplesX_ = 0;
+    int samplesY_ = 0;
+    bool hasRef_ = false;
+    std::vector<uint8_t> ref_; // 每个 tile 上次发送时的抽样
+    std::vector<uint8_t> cur_;
+    std::unique_ptr<TileStat[]> stats_;
+};
@@ -0,0 +1,417 @@
+#include "tile_recorder.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+static_assert(sizeof(TileRecorder::SegmentHeader) == 64, "segment header layout");
+static_assert(sizeof(TileRecorder::IndexEntry) == 16, "index entry layout");
+static_assert(sizeof(TileRecorder::RecordHeader) == 16, "record header layout");
+
+static const uint32_t kSegmentVersion = 1;
+static const uint32_t kWriteAlign = 4096;
+
+static uint64_t NowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+static bool WriteFull(int fd, const uint8_t *data, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+static bool ValidHeader(const TileRecorder::SegmentHeader &hdr) {
+    return memcmp(hdr.magic, "ZREC", 4) == 0 && hdr.version == kSegmentVersion && hdr.seq != 0;
+}
+
+bool TileRecorder::ParseOption(const char *text, Options *out) {
+    if (!text || !out) return false;
+    if (strcmp(text, "off") == 0) {
+        out->enabled = false;
+        return true;
+    }
+    Options parsed = *out;
+    char *end = NULL;
+    long total = strtol(text, &end, 10);
+    if (end == text || total <= 0) return false;
+    parsed.totalMB = (int)total;
+    if (*end == ',') {
+        const char *next = end + 1;
+        long segment = strtol(next, &end, 10);
+        if (end == next || segment <= 0) return false;
+        parsed.segmentMB = (int)segment;
+        if (*end == ',') {
+            parsed.dir = end + 1;
+            end += strlen(end);
+        }
+    }
+    // 至少两个段才能循环覆盖
+    if (*end != '\0' || parsed.dir.empty() || parsed.segmentMB * 2 > parsed.totalMB || parsed.segmentMB > 2047) {
+        return false;
+    }
+    parsed.enabled = true;
+    *out = parsed;
+    return true;
+}
+
+bool TileRecorder::Start(const Options &options, int tileCount) {
+    if (running_) return true;
+    options_ = options;
+    dir_ = options.dir;
+    slots_ = options.totalMB / options.segmentMB;
+    segmentBytes_ = (uint32_t)options.segmentMB * 1024 * 1024;
+    chunkBytes_ = ((uint32_t)options.chunkKB * 1024 + kWriteAlign - 1) / kWriteAlign * kWriteAlign;
+    size_t chunkCount = (size_t)options.bufferKB * 1024 / chunkBytes_;
+    if (slots_ < 2 || chunkCount < 2 || segmentBytes_ < kIndexBytes + chunkBytes_ || tileCount <= 0) {
+        printf("TileRecorder: bad geometry %dMB / %dMB segments, %dKB buffer / %dKB chunks\n", options.totalMB,
+               options.segmentMB, options.bufferKB, options.chunkKB);
+        return false;
+    }
+    if (mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+        printf("TileRecorder: mkdir %s failed: %s\n", dir_.c_str(), strerror(errno));
+        return false;
+    }
+
+    // 段文件一次性预分配到定长，之后只覆盖写；从已有段的最大序号之后接着写
+    uint64_t lastSeq = 0;
+    int lastSlot = slots_ - 1;
+    fds_.assign(slots_, -1);
+    for (int i = 0; i < slots_; ++i) {
+        char path[32];
+        snprintf(path, sizeof(path), "/seg_%03d.zrec", i);
+        int fd = open((dir_ + path).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            printf("TileRecorder: open %s%s failed: %s\n", dir_.c_str(), path, strerror(errno));
+            Stop();
+            return false;
+        }
+        fds_[i] = fd;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size < (off_t)segmentBytes_ &&
+            posix_fallocate(fd, 0, segmentBytes_) != 0 && ftruncate(fd, segmentBytes_) != 0) {
+            printf("TileRecorder: cannot size %s%s: %s\n", dir_.c_str(), path, strerror(errno));
+            Stop();
+            return false;
+        }
+        SegmentHeader hdr;
+        if (pread(fd, &hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr) && ValidHeader(hdr) && hdr.seq > lastSeq) {
+            lastSeq = hdr.seq;
+            lastSlot = i;
+        }
+    }
+
+    bufferBytes_ = chunkCount * chunkBytes_;
+    void *mem = mmap(NULL, bufferBytes_ + kIndexBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        printf("TileRecorder: mmap %zu bytes failed: %s\n", bufferBytes_ + kIndexBytes, strerror(errno));
+        Stop();
+        return false;
+    }
+    buffer_ = static_cast<uint8_t *>(mem);
+    metaBuf_ = buffer_ + bufferBytes_;
+    chunks_.assign(chunkCount, Chunk());
+    free_.clear();
+    for (size_t i = 0; i < chunkCount; ++i) {
+        chunks_[i].data = buffer_ + i * chunkBytes_;
+        free_.push_back((int)(chunkCount - 1 - i));
+    }
+
+    waitKeyframe_.assign(tileCount, true);
+    cur_ = -1;
+    seq_ = lastSeq;
+    slot_ = lastSlot;
+    stopping_ = false;
+    running_ = true;
+    worker_ = std::thread(&TileRecorder::WriterLoop, this);
+    OpenSegment();
+    printf("TileRecorder: %s, %d x %dMB segments from seq %llu, %zu x %uKB buffer\n", dir_.c_str(), slots_,
+           options.segmentMB, (unsigned long long)seq_, chunkCount, chunkBytes_ / 1024);
+    return true;
+}
+
+void TileRecorder::Stop() {
+    if (running_) {
+        CloseSegment();
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        if (worker_.joinable()) worker_.join();
+        running_ = false;
+    }
+    for (size_t i = 0; i < fds_.size(); ++i) {
+        if (fds_[i] >= 0) close(fds_[i]);
+    }
+    fds_.clear();
+    if (buffer_) munmap(buffer_, bufferBytes_ + kIndexBytes);
+    buffer_ = metaBuf_ = NULL;
+    chunks_.clear();
+    jobs_.clear();
+}
+
+bool TileRecorder::Submit(int tileId, const StreamFrame &frame) {
+    if (!running_ || tileId < 0 || tileId >= (int)waitKeyframe_.size()) return false;
+    if (waitKeyframe_[tileId] && !frame.keyframe) {
+        skipped_++;
+        return false;
+    }
+    uint32_t need = sizeof(RecordHeader) + frame.bytes;
+    if (need > segmentBytes_ - kIndexBytes) {
+        drops_++;
+        return false;
+    }
+    if (segOffset_ + need > segmentBytes_ || (frame.keyframe && index_.size() >= kMaxIndexEntries)) {
+        CloseSegment();
+        OpenSegment();
+    }
+
+    // 暂存区放不下整条记录就整帧丢弃（不写半条），该路之后从关键帧恢复
+    size_t room = cur_ >= 0 ? chunkBytes_ - chunks_[cur_].used : 0;
+    if (room < need) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        room += free_.size() * chunkBytes_;
+    }
+    if (room < need) {
+        drops_++;
+        waitKeyframe_[tileId] = true;
+        return false;
+    }
+    waitKeyframe_[tileId] = false;
+
+    if (frame.keyframe) {
+        IndexEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.pts = frame.pts;
+        entry.offset = segOffset_;
+        entry.tileId = (uint8_t)tileId;
+        index_.push_back(entry);
+    }
+    RecordHeader rec;
+    rec.magic = kRecordMagic;
+    rec.tileId = (uint8_t)tileId;
+    rec.flags = frame.keyframe ? kRecordKeyframe : 0;
+    rec.len = frame.bytes;
+    rec.pts = frame.pts;
+    Append(&rec, sizeof(rec));
+    for (int i = 0; i < frame.packCount; ++i) Append(frame.iov[i].iov_base, frame.iov[i].iov_len);
+
+    if (header_.records++ == 0) header_.firstPts = frame.pts;
+    header_.lastPts = std::max(header_.lastPts, frame.pts);
+    header_.tileMask |= TILE_BIT(tileId);
+    frames_++;
+    return true;
+}
+
+TileRecorder::Stats TileRecorder::GetStats() const {
+    Stats stats;
+    stats.frames = frames_.load();
+    stats.bytesWritten = bytesWritten_.load();
+    stats.drops = drops_.load();
+    stats.skipped = skipped_.load();
+    stats.segments = segments_.load();
+    stats.maxWriteUs = maxWriteUs_.load();
+    return stats;
+}
+
+// 调用前已确认空块足够，块满立即交给后台线程
+void TileRecorder::Append(const void *data, size_t len) {
+    const uint8_t *src = static_cast<const uint8_t *>(data);
+    while (len > 0) {
+        if (cur_ < 0 && !AcquireChunk(segOffset_)) return;
+        Chunk &chunk = chunks_[cur_];
+        size_t n = std::min(len, (size_t)(chunkBytes_ - chunk.used));
+        memcpy(chunk.data + chunk.used, src, n);
+        chunk.used += (uint32_t)n;
+        segOffset_ += (uint32_t)n;
+        src += n;
+        len -= n;
+        if (chunk.used == chunkBytes_) HandOff();
+    }
+}
+
+bool TileRecorder::AcquireChunk(uint32_t offset) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (free_.empty()) return false;
+    cur_ = free_.back();
+    free_.pop_back();
+    chunks_[cur_].slot = slot_;
+    chunks_[cur_].offset = offset;
+    chunks_[cur_].used = 0;
+    return true;
+}
+
+void TileRecorder::HandOff() {
+    Job job;
+    job.chunk = cur_;
+    cur_ = -1;
+    QueueJob(job);
+}
+
+void TileRecorder::QueueJob(Job &job) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        jobs_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+// 换到下一个槽位；先写一个空段头，旧段的索引立即失效
+void TileRecorder::OpenSegment() {
+    seq_++;
+    slot_ = (slot_ + 1) % slots_;
+    memset(&header_, 0, sizeof(header_));
+    memcpy(header_.magic, "ZREC", 4);
+    header_.version = kSegmentVersion;
+    header_.seq = seq_;
+    header_.dataEnd = kIndexBytes;
+    segOffset_ = kIndexBytes;
+    index_.clear();
+    index_.reserve(256);
+
+    Job job;
+    job.slot = slot_;
+    job.header = header_;
+    QueueJob(job);
+}
+
+// 交出未满的块（写盘时补齐到 4KB），再写段头与索引
+void TileRecorder::CloseSegment() {
+    if (cur_ >= 0) {
+        if (chunks_[cur_].used > 0) {
+            HandOff();
+        } else {
+            std::lock_guard<std::mutex> lk(mtx_);
+            free_.push_back(cur_);
+            cur_ = -1;
+        }
+    }
+    header_.dataEnd = segOffset_;
+    header_.indexCount = (uint32_t)index_.size();
+    if (header_.records > 0) {
+        printf("[REC] segment seq=%llu slot=%d closed: %u frames %u keyframes %.1fMB %.1fs\n",
+               (unsigned long long)header_.seq, slot_, header_.records, header_.indexCount,
+               (segOffset_ - kIndexBytes) / 1048576.0, (header_.lastPts - header_.firstPts) / 1e6);
+    }
+
+    Job job;
+    job.slot = slot_;
+    job.header = header_;
+    job.index.swap(index_);
+    QueueJob(job);
+    segments_++;
+}
+
+void TileRecorder::WriterLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            cv_.wait(lk, [this] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) break;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        uint64_t startUs = NowUs();
+        if (job.chunk >= 0) {
+            WriteChunk(chunks_[job.chunk]);
+            std::lock_guard<std::mutex> lk(mtx_);
+            free_.push_back(job.chunk);
+        } else {
+            WriteHeader(job);
+        }
+        uint64_t us = NowUs() - startUs;
+        if (us > maxWriteUs_.load(std::memory_order_relaxed)) maxWriteUs_.store(us, std::memory_order_relaxed);
+    }
+}
+
+// 整块对齐写入；等该范围落盘后丢掉页缓存，录制不挤占板端本就不多的内存
+void TileRecorder::WriteChunk(const Chunk &chunk) {
+    uint32_t len = (chunk.used + kWriteAlign - 1) / kWriteAlign * kWriteAlign;
+    if (chunk.offset + len > segmentBytes_) len = segmentBytes_ - chunk.offset;
+    memset(chunk.data + chunk.used, 0, len - chunk.used);
+    int fd = fds_[chunk.slot];
+    if (!WriteFull(fd, chunk.data, len, chunk.offset)) {
+        printf("TileRecorder: write slot %d @%u failed: %s\n", chunk.slot, chunk.offset, strerror(errno));
+        return;
+    }
+    bytesWritten_ += len;
+    sync_file_range(fd, chunk.offset, len,
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    posix_fadvise(fd, chunk.offset, len, POSIX_FADV_DONTNEED);
+}
+
+void TileRecorder::WriteHeader(Job &job) {
+    memset(metaBuf_, 0, kIndexBytes);
+    memcpy(metaBuf_, &job.header, sizeof(job.header));
+    if (!job.index.empty()) {
+        memcpy(metaBuf_ + sizeof(SegmentHeader), job.index.data(), job.index.size() * sizeof(IndexEntry));
+    }
+    // 空段头（刚打开的段）只需覆盖头部；关闭时连同索引一起写
+    size_t len = job.index.empty() ? kWriteAlign : kIndexBytes;
+    if (!WriteFull(fds_[job.slot], metaBuf_, len, 0)) {
+        printf("TileRecorder: header write slot %d failed: %s\n", job.slot, strerror(errno));
+        return;
+    }
+    bytesWritten_ += len;
+    fdatasync(fds_[job.slot]);
+}
+
+bool TileRecorder::FindKeyframe(const std::string &dir, int tileId, uint64_t pts, SeekResult *out) {
+    if (!out) return false;
+    DIR *dp = opendir(dir.c_str());
+    if (!dp) return false;
+    std::vector<uint8_t> meta(kIndexBytes);
+    bool found = false;
+    uint64_t bestSeq = 0;
+    while (struct dirent *ent = readdir(dp)) {
+        size_t nameLen = strlen(ent->d_name);
+        if (nameLen < 5 || strcmp(ent->d_name + nameLen - 5, ".zrec") != 0) continue;
+        std::string path = dir + "/" + ent->d_name;
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        ssize_t n = pread(fd, meta.data(), kIndexBytes, 0);
+        close(fd);
+        if (n != (ssize_t)kIndexBytes) continue;
+
+        SegmentHeader hdr;
+        memcpy(&hdr, meta.data(), sizeof(hdr));
+        // 段的首 PTS 晚于目标、或不含该 tile 的段直接跳过
+        if (!ValidHeader(hdr) || hdr.records == 0 || hdr.firstPts > pts || !(hdr.tileMask & TILE_BIT(tileId))) {
+            continue;
+        }
+        uint32_t count = hdr.indexCount < kMaxIndexEntries ? hdr.indexCount : kMaxIndexEntries;
+        const IndexEntry *index = reinterpret_cast<const IndexEntry *>(meta.data() + sizeof(SegmentHeader));
+        for (uint32_t i = 0; i < count; ++i) {
+            const IndexEntry &e = index[i];
+            if (e.tileId != tileId || e.pts > pts) continue;
+            if (!found || e.pts > out->pts || (e.pts == out->pts && hdr.seq > bestSeq)) {
+                found = true;
+                bestSeq = hdr.seq;
+                out->path = path;
+                out->offset = e.offset;
+                out->pts = e.pts;
+            }
+        }
+    }
+    closedir(dp);
+    return found;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "venc_drain.h"
+
+// 各 tile 码流的本地分段录制
+// - 存储：目录下 totalMB / segmentMB 个预分配的定长段文件（seg_NNN.zrec）循环使用，按段序号覆盖最旧的段，
+//   占用空间固定；重启时从已有段的最大序号之后接着写
+// - 段格式（小端）：前 kIndexBytes 为段头 + 关键帧索引（tileId、PTS、文件偏移），其后为连续的记录：
+//   RecordHeader + 一帧所有 pack；段头记录首尾 PTS，按 PTS 找段、在段内查索引即可定位到关键帧
+// - 写入：调用线程只把码流拷进 mmap 的匿名暂存区（按 chunkKB 分块，页对齐），块满交给后台线程
+//   整块 pwrite 到段内对应偏移，写完 fadvise 丢掉页缓存；暂存区没有空块时丢弃本帧，
+//   该路等到下一个关键帧再继续，从不阻塞编码回收线程
+// - 段头与索引在换段时由后台线程写入（新段先写一个空段头，覆盖旧内容）
+class TileRecorder {
+public:
+    struct Options {
+        bool enabled = false;
+        std::string dir = "/tmp/zwh-rec";
+        int totalMB = 256;    // 循环保留的总空间
+        int segmentMB = 16;   // 单个段文件大小
+        int bufferKB = 2048;  // 暂存区大小
+        int chunkKB = 256;    // 单次写盘的块大小
+    };
+
+    // 解析 "off" 或 "<totalMB>[,<segmentMB>[,<目录>]]"
+    static bool ParseOption(const char *text, Options *out);
+
+    static const uint32_t kIndexBytes = 64 * 1024;
+    static const uint16_t kRecordMagic = 0x5A52; // "ZR"
+    static const uint8_t kRecordKeyframe = 1 << 0;
+
+    struct SegmentHeader {
+        char magic[4];      // "ZREC"
+        uint32_t version;
+        uint64_t seq;       // 段序号，越大越新；0 表示该段未写过
+        uint64_t firstPts;
+        uint64_t lastPts;
+        TileMask tileMask;  // 段内出现过的 tile
+        uint32_t dataEnd;   // 最后一条记录之后的文件偏移
+        uint32_t records;
+        uint32_t indexCount;
+        uint8_t rsv[12];
+    };
+
+    struct IndexEntry {
+        uint64_t pts;
+        uint32_t offset; // 该关键帧记录在段文件中的偏移
+        uint8_t tileId;
+        uint8_t rsv[3];
+    };
+
+    struct RecordHeader {
+        uint16_t magic;
+        uint8_t tileId;
+        uint8_t flags;
+        uint32_t len; // 负载字节数
+        uint64_t pts;
+    };
+
+    static const uint32_t kMaxIndexEntries = (kIndexBytes - sizeof(SegmentHeader)) / sizeof(IndexEntry);
+
+    struct Stats {
+        uint64_t frames = 0;         // 已进入暂存区的帧数
+        uint64_t bytesWritten = 0;   // 已写盘字节数（含块尾对齐填充）
+        uint64_t drops = 0;          // 暂存区满而丢弃的帧数
+        uint64_t skipped = 0;        // 丢帧后等关键帧跳过的帧数
+        uint64_t segments = 0;       // 已关闭的段数
+        uint64_t maxWriteUs = 0;     // 单次写盘最长耗时
+    };
+
+    // 查找结果：path 段文件中 offset 处是 tileId 在 pts 之前（含）最近的关键帧
+    struct SeekResult {
+        std::string path;
+        uint32_t offset = 0;
+        uint64_t pts = 0;
+    };
+
+    // 按段头与索引定位，不依赖正在运行的录制实例
+    static bool FindKeyframe(const std::string &dir, int tileId, uint64_t pts, SeekResult *out);
+
+    ~TileRecorder() { Stop(); }
+
+    bool Start(const Options &options, int tileCount);
+    // 写出暂存区剩余数据与当前段头后退出
+    void Stop();
+    bool Running() const { return running_; }
+
+    // 单生产者：把一帧所有 pack 拷入暂存区，返回后即可释放码流；丢弃时返回 false
+    bool Submit(int tileId, const StreamFrame &frame);
+
+    Stats GetStats() const;
+
+private:
+    struct Chunk {
+        uint8_t *data = NULL;
+        int slot = 0;        // 段文件槽位
+        uint32_t offset = 0; // 块在段文件中的起始偏移
+        uint32_t used = 0;
+    };
+
+    struct Job {
+        int chunk = -1; // >= 0 写数据块，否则写段头
+        int slot = 0;
+        SegmentHeader header;
+        std::vector<IndexEntry> index;
+    };
+
+    void WriterLoop();
+    void WriteChunk(const Chunk &chunk);
+    void WriteHeader(Job &job);
+    bool AcquireChunk(uint32_t offset);
+    void HandOff();
+    void Append(const void *data, size_t len);
+    void OpenSegment();
+    void CloseSegment();
+    void QueueJob(Job &job);
+
+    Options options_;
+    bool running_ = false;
+    std::string dir_;
+    int slots_ = 0;
+    uint32_t segmentBytes_ = 0;
+    uint32_t chunkBytes_ = 0;
+    std::vector<int> fds_;
+
+    // 暂存区：mmap 的匿名内存，按块划分
+    uint8_t *buffer_ = NULL;
+    size_t bufferBytes_ = 0;
+    std::vector<Chunk> chunks_;
+
+    // 生产者独占
+    int cur_ = -1;      // 正在填充的块
+    int slot_ = 0;      // 当前段槽位
+    uint64_t seq_ = 0;  // 当前段序号
+    uint32_t segOffset_ = 0;
+    SegmentHeader header_;
+    std::vector<IndexEntry> index_;
+    std::vector<bool> waitKeyframe_;
+
+    // 生产者与后台线程之间
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<int> free_;
+    std::deque<Job> jobs_;
+    bool stopping_ = false;
+    std::thread worker_;
+
+    // 后台线程独占：段头 + 索引的写盘缓冲
+    uint8_t *metaBuf_ = NULL;
+
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> bytesWritten_{0};
+    std::atomic<uint64_t> drops_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> segments_{0};
+    std::atomic<uint64_t> maxWriteUs_{0};
+};
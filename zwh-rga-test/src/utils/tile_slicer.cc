@@ -0,0 +1,177 @@
+#include "tile_slicer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "nv12_blit.h"
+#ifdef RV1106_1103
+#include "im2d.h"
+#include "rga.h"
+#endif
+
+static uint64_t GetUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
+#ifdef RV1106_1103
+static rga_buffer_t WrapNv12(const Nv12Image &img) {
+    int wstride = img.wstride ? img.wstride : img.width;
+    int hstride = img.hstride ? img.hstride : img.height;
+    if (img.handle) {
+        return wrapbuffer_handle(img.handle, img.width, img.height, RK_FORMAT_YCbCr_420_SP, wstride, hstride);
+    }
+    if (img.fd >= 0) {
+        return wrapbuffer_fd(img.fd, img.width, img.height, RK_FORMAT_YCbCr_420_SP, wstride, hstride);
+    }
+    return wrapbuffer_virtualaddr(img.vir, img.width, img.height, RK_FORMAT_YCbCr_420_SP, wstride, hstride);
+}
+#endif
+
+bool TileSlicer::Init(const GridConfig &grid) {
+    inited_ = false;
+    if (grid.rows <= 0 || grid.cols <= 0 || grid.TileCount() > MAX_TILES) {
+        printf("TileSlicer: invalid grid %dx%d\n", grid.rows, grid.cols);
+        return false;
+    }
+    srcWidth_ = grid.srcWidth;
+    srcHeight_ = grid.srcHeight;
+    rows_ = grid.rows;
+    cols_ = grid.cols;
+    tileWidth_ = grid.tileWidth;
+    tileHeight_ = grid.tileHeight;
+
+    for (int i = 0; i < rows_ * cols_; ++i) {
+        TileRect &rect = rects_[i];
+        rect.x = grid.TileX(i);
+        rect.y = grid.TileY(i);
+        rect.width = tileWidth_;
+        rect.height = tileHeight_;
+    }
+
+    if (!ValidateGeometry()) return false;
+
+    inited_ = true;
+    printf("TileSlicer ready: %dx%d -> %dx%d tiles of %dx%d\n",
+           srcWidth_, srcHeight_, rows_, cols_, tileWidth_, tileHeight_);
+    return true;
+}
+
+// 启动时一次性校验网格：NV12 的 UV 平面要求偶数坐标/尺寸，且 tile 不能越界
+// （不整除时右侧/底部余下的像素不切）
+// 板端再用 imcheck 按真实格式跑一遍 RGA 的参数检查，之后每帧不再重复
+bool TileSlicer::ValidateGeometry() const {
+    if (tileWidth_ <= 0 || tileHeight_ <= 0 ||
+        (tileWidth_ & 1) || (tileHeight_ & 1) ||
+        tileWidth_ * cols_ > srcWidth_ || tileHeight_ * rows_ > srcHeight_) {
+        printf("TileSlicer: %dx%d tiles do not fit an NV12 %dx%d grid over %dx%d\n",
+               tileWidth_, tileHeight_, rows_, cols_, srcWidth_, srcHeight_);
+        return false;
+    }
+
+#ifdef RV1106_1103
+    // imcheck 只检查参数，不访问内存，这里用占位地址构造 buffer
+    void *placeholder = reinterpret_cast<void *>(0x1000);
+    rga_buffer_t src = wrapbuffer_virtualaddr(placeholder, srcWidth_, srcHeight_, RK_FORMAT_YCbCr_420_SP);
+    rga_buffer_t dst = wrapbuffer_virtualaddr(placeholder, tileWidth_, tileHeight_, RK_FORMAT_YCbCr_420_SP);
+    for (int i = 0; i < rows_ * cols_; ++i) {
+        im_rect srcRect = {rects_[i].x, rects_[i].y, rects_[i].width, rects_[i].height};
+        IM_STATUS status = imcheck(src, dst, srcRect, {});
+        if (status != IM_STATUS_NOERROR) {
+            printf("TileSlicer: tile %d imcheck failed: %s\n", i, imStrError(status));
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+
+bool TileSlicer::Slice(const Nv12Image &src, const Nv12Image *dst, TileMask tileMask, int *releaseFence) {
+    if (releaseFence) *releaseFence = -1;
+    if (!inited_ || !dst) return false;
+
+    submitUs_ = GetUs();
+
+#ifdef RV1106_1103
+    im_job_handle_t job = imbeginJob();
+    if (job <= 0) {
+        printf("TileSlicer: imbeginJob failed\n");
+        return false;
+    }
+
+    rga_buffer_t srcBuf = WrapNv12(src);
+    int taskCnt = 0;
+    for (int i = 0; i < rows_ * cols_; ++i) {
+        if ((tileMask & TILE_BIT(i)) == 0) continue;
+        rga_buffer_t dstBuf = WrapNv12(dst[i]);
+        im_rect srcRect = {rects_[i].x, rects_[i].y, rects_[i].width, rects_[i].height};
+        IM_STATUS status = imcropTask(job, srcBuf, dstBuf, srcRect);
+        if (status != IM_STATUS_SUCCESS) {
+            printf("TileSlicer: imcropTask tile %d failed: %s\n", i, imStrError(status));
+            imcancelJob(job);
+            return false;
+        }
+        taskCnt++;
+    }
+
+    if (taskCnt == 0) {
+        imcancelJob(job);
+        FinishSlice(0);
+        return true;
+    }
+
+    // 整帧只提交一次；异步时由 release fence 通知完成
+    IM_STATUS status = releaseFence ? imendJob(job, IM_ASYNC, 0, releaseFence)
+                                    : imendJob(job, IM_SYNC);
+    if (status != IM_STATUS_SUCCESS) {
+        printf("TileSlicer: imendJob failed: %s\n", imStrError(status));
+        if (releaseFence) *releaseFence = -1;
+        return false;
+    }
+    pendingCrops_ = taskCnt;
+    if (!releaseFence) FinishSlice(taskCnt);
+#else
+    int taskCnt = 0;
+    for (int i = 0; i < rows_ * cols_; ++i) {
+        if ((tileMask & TILE_BIT(i)) == 0) continue;
+        CpuCrop(src, dst[i], rects_[i]);
+        taskCnt++;
+    }
+    FinishSlice(taskCnt);
+#endif
+    return true;
+}
+
+bool TileSlicer::Wait(int releaseFence) {
+    if (releaseFence < 0) return true;
+#ifdef RV1106_1103
+    // imsync 等待 fence 并负责关闭 fd
+    IM_STATUS status = imsync(releaseFence);
+    FinishSlice(pendingCrops_);
+    if (status != IM_STATUS_SUCCESS) {
+        printf("TileSlicer: imsync failed: %s\n", imStrError(status));
+        return false;
+    }
+#endif
+    return true;
+}
+
+void TileSlicer::FinishSlice(int crops) {
+    lastSliceUs_ = GetUs() - submitUs_;
+    sliceTotalUs_ += lastSliceUs_;
+    sliceCnt_++;
+    cropCnt_ += crops;
+}
+
+// 主机回退：用 NV12 裁剪内核拷贝 Y 与交织的 UV 平面，尊重源/目标 stride
+void TileSlicer::CpuCrop(const Nv12Image &src, const Nv12Image &dst, const TileRect &rect) const {
+    if (!src.vir || !dst.vir) return;
+    int srcStride = src.wstride ? src.wstride : src.width;
+    int srcVStride = src.hstride ? src.hstride : src.height;
+    int dstStride = dst.wstride ? dst.wstride : dst.width;
+    int dstVStride = dst.hstride ? dst.hstride : dst.height;
+    Nv12Copy(Nv12At(src.vir, srcStride, srcVStride), rect.x, rect.y, Nv12At(dst.vir, dstStride, dstVStride), 0, 0,
+             rect.width, rect.height);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "config.h"
+
+// NV12 画面描述：板端优先使用已导入的 RGA handle（见 RgaBufferRegistry），其次 dma-buf fd，
+// 主机回退路径使用虚拟地址做 CPU 裁剪
+struct Nv12Image {
+    uint32_t handle = 0; // 0 表示未导入
+    int fd = -1;
+    void *vir = nullptr;
+    int width = 0;
+    int height = 0;
+    int wstride = 0; // 0 表示与 width 相同
+    int hstride = 0; // 0 表示与 height 相同
+};
+
+// 网格切分器：把一帧大画面按 GridConfig 的 rows x cols 一次性切成若干 tile
+// - Init 阶段计算并校验全部 tile 几何（只做一次，不再逐帧 imcheck）
+// - Slice 将本帧所有 tile 作为一个 RGA job 批量提交（imbeginJob/imcropTask/imendJob）
+// - 异步提交时返回 release fence，调用方可先做别的事情，再 Wait 等待裁剪完成
+// - 非板端构建（未定义 RV1106_1103）回退到 CPU 逐行拷贝，便于主机上跑基准
+class TileSlicer {
+public:
+    bool Init(const GridConfig &grid);
+
+    // 将 src 切到 dst[tileId]，只处理 tileMask 中置位的 tile
+    // releaseFence 非空时异步提交，*releaseFence 返回 fence fd（-1 表示已同步完成）
+    bool Slice(const Nv12Image &src, const Nv12Image *dst, TileMask tileMask, int *releaseFence);
+
+    // 等待异步裁剪完成并记录本帧切分耗时；fence < 0 时直接返回
+    bool Wait(int releaseFence);
+
+    int TileCount() const { return rows_ * cols_; }
+    int TileWidth() const { return tileWidth_; }
+    int TileHeight() const { return tileHeight_; }
+
+    // 最近一帧从提交到完成的耗时，以及累计平均值（微秒）
+    uint64_t LastSliceUs() const { return lastSliceUs_; }
+    uint64_t AvgSliceUs() const { return sliceCnt_ ? sliceTotalUs_ / sliceCnt_ : 0; }
+    // 平均每个 tile 的裁剪耗时（纳秒，整帧耗时按本帧 tile 数分摊）
+    uint64_t AvgCropNs() const { return cropCnt_ ? sliceTotalUs_ * 1000 / cropCnt_ : 0; }
+
+private:
+    struct TileRect {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    bool ValidateGeometry() const;
+    void CpuCrop(const Nv12Image &src, const Nv12Image &dst, const TileRect &rect) const;
+    void FinishSlice(int crops);
+
+    int srcWidth_ = 0;
+    int srcHeight_ = 0;
+    int rows_ = 0;
+    int cols_ = 0;
+    int tileWidth_ = 0;
+    int tileHeight_ = 0;
+    TileRect rects_[MAX_TILES];
+    bool inited_ = false;
+
+    uint64_t submitUs_ = 0;
+    uint64_t lastSliceUs_ = 0;
+    uint64_t sliceTotalUs_ = 0;
+    uint64_t sliceCnt_ = 0;
+    int pendingCrops_ = 0;
+    uint64_t cropCnt_ = 0;
+};
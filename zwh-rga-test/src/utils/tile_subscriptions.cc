@@ -0,0 +1,47 @@
+#include "tile_subscriptions.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool TileSubscriptions::ParseOption(const char *text, Options *out) {
+    if (!text || !out) return false;
+    if (strcmp(text, "off") == 0) {
+        out->enabled = false;
+        return true;
+    }
+    char *end = NULL;
+    unsigned long long pinned = strtoull(text, &end, 0);
+    if (end == text || *end != '\0') return false;
+    out->enabled = true;
+    out->pinned = (TileMask)pinned;
+    return true;
+}
+
+void TileSubscriptions::Init(const Options &options, TileMask allTiles) {
+    enabled_ = options.enabled;
+    allTiles_ = allTiles;
+    pinned_ = options.pinned & allTiles;
+    for (int i = 0; i < MAX_TILES; ++i) expiryUs_[i].store(0, std::memory_order_relaxed);
+}
+
+void TileSubscriptions::Renew(TileMask mask, uint32_t leaseMs, uint64_t nowUs) {
+    uint64_t expiry = nowUs + (uint64_t)leaseMs * 1000;
+    mask &= allTiles_;
+    while (mask) {
+        int tileId = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        // 多个接收端订阅同一 tile 时取较晚的到期时间
+        uint64_t cur = expiryUs_[tileId].load(std::memory_order_relaxed);
+        while (cur < expiry && !expiryUs_[tileId].compare_exchange_weak(cur, expiry, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+TileMask TileSubscriptions::Active(uint64_t nowUs) const {
+    if (!enabled_) return allTiles_;
+    TileMask active = pinned_;
+    for (int i = 0; i < MAX_TILES; ++i) {
+        if (expiryUs_[i].load(std::memory_order_relaxed) > nowUs) active |= TILE_BIT(i);
+    }
+    return active & allTiles_;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "config.h"
+
+// 按需编码的 tile 订阅表：只有被订阅（或常驻）的 tile 才裁剪、编码、发送
+// - 接收端经 tile 发送 socket 回发订阅（掩码 + 租期），回收线程收到后 Renew，各路到期时间取较晚者
+// - 采集线程每帧调用 Active 得到当前应编码的 tile；租期过了没有续订的 tile 自动退出
+// - pinned 中的 tile 常驻编码：rtsp_demo 不暴露客户端是否在拉流，RTSP 观看的 tile 须放在这里
+// - 未启用时 Active 始终返回全部 tile，与原流程一致
+class TileSubscriptions {
+public:
+    struct Options {
+        bool enabled = false;
+        TileMask pinned = 0; // 常驻编码的 tile
+    };
+
+    // 解析 "off" 或 "<常驻掩码>"（支持 0x 前缀，0 表示全部按订阅）
+    static bool ParseOption(const char *text, Options *out);
+
+    void Init(const Options &options, TileMask allTiles);
+    bool Enabled() const { return enabled_; }
+
+    // 任意线程：把 mask 中各 tile 的到期时间延到 nowUs + leaseMs
+    void Renew(TileMask mask, uint32_t leaseMs, uint64_t nowUs);
+    // 任意线程：当前应编码的 tile
+    TileMask Active(uint64_t nowUs) const;
+
+private:
+    bool enabled_ = false;
+    TileMask allTiles_ = 0;
+    TileMask pinned_ = 0;
+    std::atomic<uint64_t> expiryUs_[MAX_TILES] = {};
+};
@@ -0,0 +1,68 @@
+#include "tile_worker_pool.h"
+
+#include <stdio.h>
+
+bool TileWorkerPool::Start(int workerCount, Handler handler, size_t queueDepth) {
+    Stop();
+    if (!handler || workerCount < 0) return false;
+    handler_ = handler;
+    queueDepth_ = queueDepth > 0 ? queueDepth : 1;
+    for (int i = 0; i < workerCount; ++i) {
+        workers_.emplace_back(new Worker());
+        Worker *worker = workers_.back().get();
+        worker->thread = std::thread(&TileWorkerPool::WorkerLoop, this, worker);
+    }
+    printf("TileWorkerPool: %d workers, queue depth %zu\n", workerCount, queueDepth_);
+    return true;
+}
+
+void TileWorkerPool::Stop() {
+    for (auto &worker : workers_) {
+        std::lock_guard<std::mutex> lk(worker->mtx);
+        worker->stopping = true;
+        worker->notEmpty.notify_all();
+    }
+    for (auto &worker : workers_) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+    workers_.clear();
+}
+
+void TileWorkerPool::Submit(const Job &job) {
+    if (workers_.empty()) {
+        handler_(job);
+        return;
+    }
+    Worker *worker = workers_[job.tileId % workers_.size()].get();
+    std::unique_lock<std::mutex> lk(worker->mtx);
+    if (worker->jobs.size() >= queueDepth_) {
+        worker->stalls++;
+        worker->notFull.wait(lk, [&] { return worker->jobs.size() < queueDepth_; });
+    }
+    worker->jobs.push_back(job);
+    worker->notEmpty.notify_one();
+}
+
+uint64_t TileWorkerPool::Stalls() const {
+    uint64_t total = 0;
+    for (auto &worker : workers_) {
+        std::lock_guard<std::mutex> lk(worker->mtx);
+        total += worker->stalls;
+    }
+    return total;
+}
+
+void TileWorkerPool::WorkerLoop(Worker *worker) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lk(worker->mtx);
+            worker->notEmpty.wait(lk, [&] { return !worker->jobs.empty() || worker->stopping; });
+            if (worker->jobs.empty()) break;
+            job = worker->jobs.front();
+            worker->jobs.pop_front();
+            worker->notFull.notify_one();
+        }
+        handler_(job);
+    }
+}
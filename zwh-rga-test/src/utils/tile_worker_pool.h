@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "luckfox_mpi.h"
+
+// 按通道分组的 tile 工作线程池：采集线程裁剪完一帧后把各 tile 交给工作线程送编码，
+// 自己立即释放 VI 帧去取下一帧，使第 N+1 帧的采集/裁剪与第 N 帧的送编码重叠
+// - tileId % workerCount 决定由哪个线程处理，同一路始终在同一线程，保证每路送编码按帧序
+// - 每个线程一个有界队列，队列满时 Submit 阻塞，背压传回采集线程（与子画面池耗尽时一致）
+// - workerCount 为 0 时 Submit 直接在调用线程执行，等同于原来的串行流程
+// - 通道启停也作为任务提交，与该路的帧在同一队列中排序，不会出现停止后还有帧送进来
+class TileWorkerPool {
+public:
+    enum JobKind {
+        JOB_ENCODE = 0, // 送编码一帧子画面
+        JOB_START,      // 该路编码器开始接收（并出 IDR）
+        JOB_STOP,       // 该路编码器停止接收
+    };
+
+    struct Job {
+        JobKind kind = JOB_ENCODE;
+        int tileId;
+        uint16_t frameSeq;
+        uint64_t pts;
+        MB_BLK blk; // 子画面缓冲，由处理函数负责释放（仅 JOB_ENCODE）
+    };
+    typedef std::function<void(const Job &job)> Handler;
+
+    ~TileWorkerPool() { Stop(); }
+
+    // queueDepth 为每个线程最多积压的任务数
+    bool Start(int workerCount, Handler handler, size_t queueDepth);
+    // 处理完已入队的任务后退出
+    void Stop();
+
+    void Submit(const Job &job);
+
+    int WorkerCount() const { return (int)workers_.size(); }
+    // 因队列满而阻塞的 Submit 次数
+    uint64_t Stalls() const;
+
+private:
+    struct Worker {
+        std::mutex mtx;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        std::deque<Job> jobs;
+        bool stopping = false;
+        uint64_t stalls = 0;
+        std::thread thread;
+    };
+
+    void WorkerLoop(Worker *worker);
+
+    Handler handler_;
+    size_t queueDepth_ = 0;
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
@@ -0,0 +1,133 @@
+#include "venc_drain.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal/mpi_hal.h"
+
+// poll 超时：无码流时也要定期回调 idle（RTSP 事件）
+static const int kPollTimeoutMs = 20;
+// 取流前 pack 数组的初始容量：常见 IDR 为 SPS+PPS+SEI+slice
+static const size_t kInitialPacks = 4;
+
+bool CollectStreamFrame(const VENC_STREAM_S &stream, StreamFrame *frame) {
+    frame->packCount = 0;
+    frame->bytes = 0;
+    frame->pts = 0;
+    frame->keyframe = false;
+    if (!stream.pstPack || stream.u32PackCount == 0 || stream.u32PackCount > (RK_U32)StreamFrame::kMaxPacks) {
+        return false;
+    }
+    for (RK_U32 i = 0; i < stream.u32PackCount; ++i) {
+        const VENC_PACK_S &pack = stream.pstPack[i];
+        uint8_t *base = (uint8_t *)GetMpiHal()->MbHandle2VirAddr(pack.pMbBlk);
+        if (!base || pack.u32Offset > pack.u32Len) return false;
+        // u32Len 含 u32Offset 之前的无效部分
+        struct iovec &iov = frame->iov[frame->packCount++];
+        iov.iov_base = base + pack.u32Offset;
+        iov.iov_len = pack.u32Len - pack.u32Offset;
+        frame->bytes += (uint32_t)iov.iov_len;
+        if (pack.DataType.enH264EType == H264E_NALU_IDRSLICE || pack.DataType.enH264EType == H264E_NALU_ISLICE) {
+            frame->keyframe = true;
+        }
+    }
+    frame->pts = stream.pstPack[0].u64PTS;
+    return true;
+}
+
+VencStreamReader::VencStreamReader() : packs_(kInitialPacks) {
+    memset(&stream_, 0, sizeof(stream_));
+}
+
+RK_S32 VencStreamReader::Get(int chn, RK_S32 timeoutMs) {
+    VENC_CHN_STATUS_S status;
+    memset(&status, 0, sizeof(status));
+    if (GetMpiHal()->VencQueryStatus(chn, &status) == RK_SUCCESS && status.u32CurPacks > packs_.size()) {
+        packs_.resize(status.u32CurPacks);
+    }
+    memset(packs_.data(), 0, packs_.size() * sizeof(VENC_PACK_S));
+    stream_.pstPack = packs_.data();
+    stream_.u32PackCount = (RK_U32)packs_.size(); // 入参为数组容量，返回实际 pack 数
+
+    RK_S32 ret = GetMpiHal()->VencGetStream(chn, &stream_, timeoutMs);
+    if (ret != RK_SUCCESS) return ret;
+    if (!CollectStreamFrame(stream_, &frame_)) {
+        printf("VencStreamReader: ch%d bad stream (%u packs)\n", chn, stream_.u32PackCount);
+        GetMpiHal()->VencReleaseStream(chn, &stream_);
+        return RK_ERR_VENC_BUF_EMPTY;
+    }
+    return RK_SUCCESS;
+}
+
+void VencStreamReader::Release(int chn) {
+    GetMpiHal()->VencReleaseStream(chn, &stream_);
+    frame_.packCount = 0;
+}
+
+bool VencStreamDrainer::Start(int firstChn, int chnCount, StreamCallback onStream, IdleCallback onIdle) {
+    if (running_) return true;
+    if (chnCount <= 0 || !onStream) return false;
+
+    firstChn_ = firstChn;
+    onStream_ = onStream;
+    onIdle_ = onIdle;
+    fds_.assign(chnCount, -1);
+    for (int i = 0; i < chnCount; ++i) {
+        fds_[i] = GetMpiHal()->VencGetFd(firstChn_ + i);
+        if (fds_[i] < 0) {
+            printf("VencStreamDrainer: VENC_GetFd ch%d failed: %d\n", firstChn_ + i, fds_[i]);
+            for (int j = 0; j < i; ++j) GetMpiHal()->VencCloseFd(firstChn_ + j);
+            fds_.clear();
+            return false;
+        }
+    }
+
+    running_ = true;
+    worker_ = std::thread(&VencStreamDrainer::DrainLoop, this);
+    printf("VencStreamDrainer started: ch%d~ch%d\n", firstChn_, firstChn_ + chnCount - 1);
+    return true;
+}
+
+void VencStreamDrainer::Stop() {
+    if (!running_) return;
+    running_ = false;
+    if (worker_.joinable()) worker_.join();
+    for (size_t i = 0; i < fds_.size(); ++i) {
+        GetMpiHal()->VencCloseFd(firstChn_ + (int)i);
+    }
+    fds_.clear();
+}
+
+void VencStreamDrainer::DrainLoop() {
+    std::vector<struct pollfd> pfds(fds_.size());
+    for (size_t i = 0; i < fds_.size(); ++i) {
+        pfds[i].fd = fds_[i];
+        pfds[i].events = POLLIN;
+    }
+
+    while (running_) {
+        for (auto &pfd : pfds) pfd.revents = 0;
+        int ready = poll(pfds.data(), pfds.size(), kPollTimeoutMs);
+        if (ready < 0 && errno != EINTR) {
+            printf("VencStreamDrainer: poll failed: %s\n", strerror(errno));
+            break;
+        }
+        for (size_t i = 0; ready > 0 && i < pfds.size(); ++i) {
+            if (pfds[i].revents & POLLIN) {
+                DrainChannel(firstChn_ + (int)i);
+            }
+        }
+        if (onIdle_) onIdle_();
+    }
+}
+
+// 一次把该路已编码完成的码流全部取完，避免积压到下一轮
+void VencStreamDrainer::DrainChannel(int chnId) {
+    while (reader_.Get(chnId, 0) == RK_SUCCESS) {
+        onStream_(chnId, reader_.Stream(), reader_.Frame());
+        reader_.Release(chnId);
+        streamCnt_++;
+    }
+}
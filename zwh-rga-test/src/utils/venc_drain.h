@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "luckfox_mpi.h"
+
+// 一帧（一个访问单元）的全部码流：编码器可能把 SPS/PPS/SEI/各 slice 分成多个 pack 输出，
+// iov 按顺序直接指向各 pack 在 MB 中的有效数据（已计入 u32Offset），下游 writev/sendmsg 或逐段拷贝，不再拼接
+// 只在 ReleaseStream 之前有效
+struct StreamFrame {
+    static const int kMaxPacks = 16;
+    struct iovec iov[kMaxPacks];
+    int packCount = 0;
+    uint32_t bytes = 0;    // 各 pack 长度之和
+    uint64_t pts = 0;
+    bool keyframe = false; // 含 IDR/I slice
+};
+
+// 把 VencGetStream 取到的各 pack 整理成 StreamFrame；pack 数超过 kMaxPacks 或地址无效时返回 false
+bool CollectStreamFrame(const VENC_STREAM_S &stream, StreamFrame *frame);
+
+// 取流封装：pack 数组按 VencQueryStatus 报告的当前帧 pack 数扩容（只增不减），一次取走整帧所有 pack
+class VencStreamReader {
+public:
+    VencStreamReader();
+
+    // 成功后 Stream()/Frame() 有效，直到 Release
+    RK_S32 Get(int chn, RK_S32 timeoutMs);
+    void Release(int chn);
+
+    const VENC_STREAM_S &Stream() const { return stream_; }
+    const StreamFrame &Frame() const { return frame_; }
+
+private:
+    std::vector<VENC_PACK_S> packs_;
+    VENC_STREAM_S stream_;
+    StreamFrame frame_;
+};
+
+// VENC 码流回收线程：与采集线程解耦，采集线程只管 SendFrame
+// - 通过 RK_MPI_VENC_GetFd 拿到每路编码器的事件 fd，poll 统一等待
+// - 某路可读时把该路已完成的码流全部取走（每帧所有 pack），回调给上层（RTSP/网络发送），再 ReleaseStream
+// - 每轮 poll 结束调用 idle 回调（可选），便于在同一线程内做周期性工作
+class VencStreamDrainer {
+public:
+    typedef std::function<void(int chnId, const VENC_STREAM_S &stream, const StreamFrame &frame)> StreamCallback;
+    typedef std::function<void()> IdleCallback;
+
+    ~VencStreamDrainer() { Stop(); }
+
+    // 负责 [firstChn, firstChn + chnCount) 这些编码通道
+    bool Start(int firstChn, int chnCount, StreamCallback onStream, IdleCallback onIdle = IdleCallback());
+    void Stop();
+
+    // 累计取到的码流帧数
+    uint64_t StreamCount() const { return streamCnt_.load(); }
+
+private:
+    void DrainLoop();
+    void DrainChannel(int chnId);
+
+    int firstChn_ = 0;
+    std::vector<int> fds_;
+    StreamCallback onStream_;
+    IdleCallback onIdle_;
+    VencStreamReader reader_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> streamCnt_{0};
+    std::thread worker_;
+};
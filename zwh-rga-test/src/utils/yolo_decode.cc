@@ -0,0 +1,312 @@
+#include "yolo_decode.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+static const int kAnchors = 3;
+static const int kProps = 5 + kYoloClasses;
+static const int kInsertionSortMax = 64;
+static const int kAnchorSizes[3][kAnchors * 2] = {
+    {10, 13, 16, 30, 33, 23},       // 步长 8
+    {30, 61, 62, 45, 59, 119},      // 步长 16
+    {116, 90, 156, 198, 373, 326},  // 步长 32
+};
+
+typedef YoloV5Decoder::Candidate Candidate;
+
+static float Dequantize(int8_t q, int32_t zp, float scale) {
+    return ((float)q - (float)zp) * scale;
+}
+
+static int AnchorSet(const NpuTensor &t, int modelH, int *stride) {
+    if (t.gridH <= 0 || t.channels < kAnchors * kProps) return -1;
+    *stride = modelH / t.gridH;
+    return *stride == 8 ? 0 : *stride == 16 ? 1 : *stride == 32 ? 2 : -1;
+}
+
+// 以下两个函数参考实现与快速实现共用且不内联：编译器对两处的浮点乘加收缩保持一致，结果才能逐位相同
+
+// 已知目标置信度过阈值、类别为 clsId 的 anchor：算综合置信度，过阈值时解出框
+static bool __attribute__((noinline)) MakeCandidate(const int8_t *p, int clsId, const NpuTensor &t, int gx, int gy,
+                                                    int stride, int set, int a, float confThresh, Candidate *out) {
+    float objectness = Dequantize(p[4], t.zp, t.scale);
+    float clsProb = Dequantize(p[5 + clsId], t.zp, t.scale);
+    float prop = objectness * clsProb;
+    if (prop <= confThresh) return false;
+
+    float dx = Dequantize(p[0], t.zp, t.scale) * 2.0f - 0.5f;
+    float dy = Dequantize(p[1], t.zp, t.scale) * 2.0f - 0.5f;
+    float dw = Dequantize(p[2], t.zp, t.scale) * 2.0f;
+    float dh = Dequantize(p[3], t.zp, t.scale) * 2.0f;
+    float cx = (dx + gx) * stride;
+    float cy = (dy + gy) * stride;
+    float w = dw * dw * kAnchorSizes[set][a * 2];
+    float h = dh * dh * kAnchorSizes[set][a * 2 + 1];
+    out->left = cx - w * 0.5f;
+    out->top = cy - h * 0.5f;
+    out->right = cx + w * 0.5f;
+    out->bottom = cy + h * 0.5f;
+    out->prop = prop;
+    out->clsId = clsId;
+    return true;
+}
+
+static float __attribute__((noinline)) Iou(const Candidate &a, const Candidate &b) {
+    float w = std::min(a.right, b.right) - std::max(a.left, b.left);
+    float h = std::min(a.bottom, b.bottom) - std::max(a.top, b.top);
+    if (w <= 0.0f || h <= 0.0f) return 0.0f;
+    float inter = w * h;
+    float uni = (a.right - a.left) * (a.bottom - a.top) + (b.right - b.left) * (b.bottom - b.top) - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+static int Clamp(float v, int hi) {
+    if (v < 0.0f) return 0;
+    if (v > (float)hi) return hi;
+    return (int)v;
+}
+
+static void EmitBox(const Candidate &c, int modelW, int modelH, DetectList *out) {
+    DetectBox &box = out->boxes[out->count++];
+    box.left = Clamp(c.left, modelW - 1);
+    box.top = Clamp(c.top, modelH - 1);
+    box.right = Clamp(c.right, modelW - 1);
+    box.bottom = Clamp(c.bottom, modelH - 1);
+    box.prop = c.prop;
+    box.clsId = c.clsId;
+}
+
+int DecodeYoloV5(const NpuTensor *outputs, int count, int modelW, int modelH, float confThresh, float nmsThresh,
+                 DetectList *out) {
+    out->count = 0;
+    std::vector<Candidate> candidates;
+    for (int i = 0; i < count; ++i) {
+        const NpuTensor &t = outputs[i];
+        int stride = 0;
+        int set = AnchorSet(t, modelH, &stride);
+        if (set < 0) continue;
+        for (int gy = 0; gy < t.gridH; ++gy) {
+            for (int gx = 0; gx < t.gridW; ++gx) {
+                const int8_t *cell = t.data + ((size_t)gy * t.gridW + gx) * t.cellStride;
+                for (int a = 0; a < kAnchors; ++a) {
+                    const int8_t *p = cell + a * kProps;
+                    float objectness = Dequantize(p[4], t.zp, t.scale);
+                    if (objectness < confThresh) continue;
+                    int clsId = 0;
+                    float clsProb = Dequantize(p[5], t.zp, t.scale);
+                    for (int k = 1; k < kYoloClasses; ++k) {
+                        float prob = Dequantize(p[5 + k], t.zp, t.scale);
+                        if (prob > clsProb) {
+                            clsProb = prob;
+                            clsId = k;
+                        }
+                    }
+                    Candidate c;
+                    if (MakeCandidate(p, clsId, t, gx, gy, stride, set, a, confThresh, &c)) candidates.push_back(c);
+                }
+            }
+        }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const Candidate &a, const Candidate &b) { return a.prop > b.prop; });
+    std::vector<bool> suppressed(candidates.size(), false);
+    for (size_t i = 0; i < candidates.size() && out->count < kYoloMaxBoxes; ++i) {
+        if (suppressed[i]) continue;
+        const Candidate &c = candidates[i];
+        for (size_t j = i + 1; j < candidates.size(); ++j) {
+            if (!suppressed[j] && candidates[j].clsId == c.clsId && Iou(c, candidates[j]) > nmsThresh) {
+                suppressed[j] = true;
+            }
+        }
+        EmitBox(c, modelW, modelH, out);
+    }
+    return out->count;
+}
+
+// 80 个类别 int8 值中第一个最大值的下标
+static_assert(kYoloClasses % 16 == 0, "class argmax works on 16-byte lanes");
+static int ArgmaxClasses(const int8_t *p) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    int8x16_t m = vld1q_s8(p);
+    for (int k = 16; k < kYoloClasses; k += 16) m = vmaxq_s8(m, vld1q_s8(p + k));
+    int8x8_t m8 = vpmax_s8(vget_low_s8(m), vget_high_s8(m));
+    m8 = vpmax_s8(m8, m8);
+    m8 = vpmax_s8(m8, m8);
+    m8 = vpmax_s8(m8, m8);
+    int8_t best = vget_lane_s8(m8, 0);
+    int k = 0;
+    while (p[k] != best) ++k;
+    return k;
+#else
+    int clsId = 0;
+    for (int k = 1; k < kYoloClasses; ++k) {
+        if (p[k] > p[clsId]) clsId = k;
+    }
+    return clsId;
+#endif
+}
+
+int YoloV5Decoder::MinPassingQ(int tensor, int32_t zp, float scale, float conf) {
+    if ((int)thresholds_.size() <= tensor) thresholds_.resize(tensor + 1);
+    Threshold &th = thresholds_[tensor];
+    if (th.zp != zp || th.scale != scale || th.conf != conf) {
+        th.zp = zp;
+        th.scale = scale;
+        th.conf = conf;
+        th.minQ = 128;
+        for (int q = -128; q <= 127; ++q) {
+            if (Dequantize((int8_t)q, zp, scale) >= conf) {
+                th.minQ = q;
+                break;
+            }
+        }
+    }
+    return th.minQ;
+}
+
+int YoloV5Decoder::Decode(const NpuTensor *outputs, int count, int modelW, int modelH, float confThresh,
+                          float nmsThresh, DetectList *out) {
+    out->count = 0;
+    candidates_.clear();
+    passed_ = 0;
+    for (int i = 0; i < count; ++i) {
+        const NpuTensor &t = outputs[i];
+        int stride = 0;
+        int set = AnchorSet(t, modelH, &stride);
+        if (set < 0) continue;
+        int minQ = MinPassingQ(i, t.zp, t.scale, confThresh);
+        if (minQ > 127) continue;
+        int8_t qThresh = (int8_t)minQ;
+        for (int gy = 0; gy < t.gridH; ++gy) {
+            const int8_t *row = t.data + (size_t)gy * t.gridW * t.cellStride;
+            for (int gx = 0; gx < t.gridW; ++gx) {
+                const int8_t *cell = row + (size_t)gx * t.cellStride;
+                for (int a = 0; a < kAnchors; ++a) {
+                    const int8_t *p = cell + a * kProps;
+                    if (p[4] < qThresh) continue;
+                    passed_++;
+                    Candidate c;
+                    if (MakeCandidate(p, ArgmaxClasses(p + 5), t, gx, gy, stride, set, a, confThresh, &c)) {
+                        candidates_.push_back(c);
+                    }
+                }
+            }
+        }
+    }
+    int n = (int)candidates_.size();
+    if (n == 0) return 0;
+
+    // 按类别计数分桶（桶内保持扫描顺序），再在桶内按置信度稳定排序
+    classCount_.assign(kYoloClasses, 0);
+    for (int i = 0; i < n; ++i) classCount_[candidates_[i].clsId]++;
+    classStart_.assign(kYoloClasses + 1, 0);
+    for (int k = 0; k < kYoloClasses; ++k) classStart_[k + 1] = classStart_[k] + classCount_[k];
+    order_.resize(n);
+    for (int k = 0; k < kYoloClasses; ++k) classCount_[k] = classStart_[k];
+    for (int i = 0; i < n; ++i) order_[classCount_[candidates_[i].clsId]++] = i;
+
+    const std::vector<Candidate> &cands = candidates_;
+    auto byProp = [&cands](int a, int b) { return cands[a].prop > cands[b].prop; };
+    suppressed_.assign(n, false);
+    kept_.clear();
+    for (int k = 0; k < kYoloClasses; ++k) {
+        int begin = classStart_[k];
+        int end = classStart_[k + 1];
+        if (end - begin > kInsertionSortMax) {
+            std::stable_sort(order_.begin() + begin, order_.begin() + end, byProp);
+        } else {
+            // 桶内通常只有几个到几十个候选：插入排序，不分配临时缓冲
+            for (int i = begin + 1; i < end; ++i) {
+                int idx = order_[i];
+                int j = i;
+                for (; j > begin && byProp(idx, order_[j - 1]); --j) order_[j] = order_[j - 1];
+                order_[j] = idx;
+            }
+        }
+        for (int i = begin; i < end; ++i) {
+            if (suppressed_[i]) continue;
+            const Candidate &c = cands[order_[i]];
+            for (int j = i + 1; j < end; ++j) {
+                if (!suppressed_[j] && Iou(c, cands[order_[j]]) > nmsThresh) suppressed_[j] = true;
+            }
+            kept_.push_back(order_[i]);
+        }
+    }
+
+    // 保留的框按置信度降序、同分按扫描顺序，即参考实现的全局顺序
+    std::sort(kept_.begin(), kept_.end(), [&cands](int a, int b) {
+        return cands[a].prop != cands[b].prop ? cands[a].prop > cands[b].prop : a < b;
+    });
+    for (size_t i = 0; i < kept_.size() && out->count < kYoloMaxBoxes; ++i) {
+        EmitBox(cands[kept_[i]], modelW, modelH, out);
+    }
+    return out->count;
+}
+
+// 录制格式（小端）：每组 "ZNPU" + 张量数，每个张量 gridH/gridW/channels/cellStride/zp（int32）+ scale（float）+ 数据
+static const char kRecordingMagic[4] = {'Z', 'N', 'P', 'U'};
+
+bool AppendNpuTensors(const char *path, const NpuTensor *outputs, int count) {
+    FILE *fp = fopen(path, "ab");
+    if (!fp) return false;
+    int32_t n = count;
+    bool ok = fwrite(kRecordingMagic, 1, 4, fp) == 4 && fwrite(&n, sizeof(n), 1, fp) == 1;
+    for (int i = 0; ok && i < count; ++i) {
+        const NpuTensor &t = outputs[i];
+        int32_t dims[5] = {t.gridH, t.gridW, t.channels, t.cellStride, t.zp};
+        size_t bytes = (size_t)t.gridH * t.gridW * t.cellStride;
+        ok = fwrite(dims, sizeof(dims), 1, fp) == 1 && fwrite(&t.scale, sizeof(t.scale), 1, fp) == 1 &&
+             fwrite(t.data, 1, bytes, fp) == bytes;
+    }
+    return fclose(fp) == 0 && ok;
+}
+
+bool LoadNpuTensors(const char *path, NpuTensorRecording *out) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+    out->frames.clear();
+    out->storage.clear();
+    std::vector<std::vector<NpuTensor> > frames;
+    char magic[4];
+    bool ok = true;
+    while (ok && fread(magic, 1, 4, fp) == 4) {
+        int32_t n = 0;
+        ok = memcmp(magic, kRecordingMagic, 4) == 0 && fread(&n, sizeof(n), 1, fp) == 1 && n > 0 && n <= 16;
+        std::vector<NpuTensor> frame(ok ? n : 0);
+        for (int i = 0; ok && i < n; ++i) {
+            int32_t dims[5];
+            NpuTensor &t = frame[i];
+            ok = fread(dims, sizeof(dims), 1, fp) == 1 && fread(&t.scale, sizeof(t.scale), 1, fp) == 1 &&
+                 dims[0] > 0 && dims[1] > 0 && dims[2] > 0 && dims[3] >= dims[2];
+            if (!ok) break;
+            t.gridH = dims[0];
+            t.gridW = dims[1];
+            t.channels = dims[2];
+            t.cellStride = dims[3];
+            t.zp = dims[4];
+            std::vector<int8_t> data((size_t)t.gridH * t.gridW * t.cellStride);
+            ok = fread(data.data(), 1, data.size(), fp) == data.size();
+            out->storage.push_back(std::move(data));
+        }
+        if (ok) frames.push_back(frame);
+    }
+    fclose(fp);
+    if (!ok) {
+        printf("LoadNpuTensors: %s is truncated or corrupt\n", path);
+        return false;
+    }
+    // 数据全部读完再回填指针
+    size_t next = 0;
+    for (size_t f = 0; f < frames.size(); ++f) {
+        for (size_t i = 0; i < frames[f].size(); ++i) frames[f][i].data = out->storage[next++].data();
+    }
+    out->frames.swap(frames);
+    return !out->frames.empty();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "hal/npu_backend.h"
+
+static const int kYoloClasses = 80;
+static const int kYoloMaxBoxes = 128;
+
+// 检测框（模型输入坐标系，闭区间像素坐标）
+struct DetectBox {
+    int left;
+    int top;
+    int right;
+    int bottom;
+    float prop;  // 目标置信度 x 类别概率
+    int clsId;
+};
+
+struct DetectList {
+    int count = 0;
+    DetectBox boxes[kYoloMaxBoxes];
+};
+
+// YOLOv5 输出解码（参考实现）：三个输出头按步长 8/16/32 选 anchor，每格 3 个 anchor x (5 + 80) 通道，
+// 输出已过 sigmoid；逐元素反量化成 float 后判阈值，候选按置信度降序（同分保持扫描顺序）做同类 NMS
+// 返回保留的框数（最多 kYoloMaxBoxes）
+int DecodeYoloV5(const NpuTensor *outputs, int count, int modelW, int modelH, float confThresh, float nmsThresh,
+                 DetectList *out);
+
+// YOLOv5 输出解码（快速实现），结果与 DecodeYoloV5 逐位一致
+// - 目标置信度在 int8 域比较：按各张量的 zp/scale 求出反量化后不低于阈值的最小 int8 值
+//   （对 256 个取值逐个按参考实现的 float 运算验算，边界不差一位），参数不变时复用
+// - 只有过了阈值的 anchor 才反量化；80 类取最大值直接比 int8（反量化单调），板端用 NEON
+// - NMS 按类别分桶，桶内按置信度排好后抑制，保留的框再归并成全局顺序，不对全部候选整体排序
+// - 各缓冲在多次调用间复用；实例不可多线程共用
+class YoloV5Decoder {
+public:
+    int Decode(const NpuTensor *outputs, int count, int modelW, int modelH, float confThresh, float nmsThresh,
+               DetectList *out);
+
+    // 最近一次 Decode 过了 int8 阈值的 anchor 数与最终候选数
+    int LastPassed() const { return passed_; }
+    int LastCandidates() const { return (int)candidates_.size(); }
+
+    struct Candidate {
+        float left;
+        float top;
+        float right;
+        float bottom;
+        float prop;
+        int clsId;
+    };
+
+private:
+    struct Threshold {
+        int32_t zp = 0;
+        float scale = 0.0f;
+        float conf = -1.0f;
+        int minQ = 128; // 大于 127 表示没有取值能过阈值
+    };
+
+    int MinPassingQ(int tensor, int32_t zp, float scale, float conf);
+
+    std::vector<Threshold> thresholds_;
+    std::vector<Candidate> candidates_;
+    std::vector<int> classCount_;
+    std::vector<int> classStart_;
+    std::vector<int> order_;   // 按类别分桶、桶内按置信度降序的候选下标
+    std::vector<int> kept_;
+    std::vector<bool> suppressed_;
+    int passed_ = 0;
+};
+
+// 输出张量录制：一次推理的全部输出追加为一组，供离线回放对比解码实现
+bool AppendNpuTensors(const char *path, const NpuTensor *outputs, int count);
+
+struct NpuTensorRecording {
+    std::vector<std::vector<NpuTensor> > frames; // 每组为一次推理的全部输出
+    std::vector<std::vector<int8_t> > storage;   // 各张量数据
+};
+
+bool LoadNpuTensors(const char *path, NpuTensorRecording *out);